@@ -182,6 +182,10 @@ S_write_parcel_h(CFCBindCore *self, CFCParcel *parcel) {
         "typedef void\n"
         "(*cfish_method_t)(const void *vself);\n"
         "\n"
+        "/* Class pointer, used for arrays of classes in ivars.\n"
+        " */\n"
+        "typedef cfish_Class *cfish_class_ptr_t;\n"
+        "\n"
         "/* Access the function pointer for a given method from the class.\n"
         " */\n"
         "#define CFISH_METHOD_PTR(_class, _full_meth) \\\n"
@@ -253,6 +257,80 @@ S_write_parcel_h(CFCBindCore *self, CFCParcel *parcel) {
         "extern CFISH_VISIBLE cfish_Obj*\n"
         "cfish_inc_refcount(void *vself);\n"
         "\n"
+        "extern CFISH_VISIBLE uint32_t\n"
+        "cfish_dec_refcount(void *vself);\n"
+        "\n"
+        "/* Flags for internal use. */\n"
+        "#define CFISH_fREFCOUNTSPECIAL 0x00000001\n"
+        "#define CFISH_fFINAL           0x00000002\n"
+        "#define CFISH_fEMPTY           0x00000004\n"
+        "#define CFISH_fHOST            0x00000008\n"
+        "#define CFISH_fATOMICREFCOUNT  0x00000010\n"
+        "\n"
+        "/* Cached Integers and Floats are immortal.  They live in a single\n"
+        " * block of memory, so they can be recognized with a range check.\n"
+        " */\n"
+        "extern CFISH_VISIBLE char   *cfish_num_cache_start;\n"
+        "extern CFISH_VISIBLE size_t  cfish_num_cache_size;\n"
+        "\n"
+        "static CFISH_INLINE bool\n"
+        "cfish_num_is_cached(void *vself) {\n"
+        "    uintptr_t offset\n"
+        "        = (uintptr_t)vself - (uintptr_t)cfish_num_cache_start;\n"
+        "    return offset < cfish_num_cache_size;\n"
+        "}\n"
+        "\n"
+        "#ifdef CFISH_INLINE_REFCOUNT\n"
+        "\n"
+        "/* Hosts which keep the refcount in CFISH_OBJ_HEAD can inline the\n"
+        " * common case.  Only classes with special refcounting and the final\n"
+        " * decrement branch out of line.  Cached Integers and Floats are\n"
+        " * skipped inline.\n"
+        " */\n"
+        "extern CFISH_VISIBLE uint32_t cfish_Class_offset_of_flags;\n"
+        "static CFISH_INLINE uint32_t\n"
+        "cfish_refcount_flags(cfish_Dummy *dummy) {\n"
+        "    char *class_as_char = (char*)dummy->klass;\n"
+        "    return *(uint32_t*)(class_as_char + cfish_Class_offset_of_flags);\n"
+        "}\n"
+        "\n"
+        "static CFISH_INLINE cfish_Obj*\n"
+        "cfish_inc_refcount_inline(void *vself) {\n"
+        "    cfish_Dummy *dummy = (cfish_Dummy*)vself;\n"
+        "    if (cfish_refcount_flags(dummy) & CFISH_fREFCOUNTSPECIAL) {\n"
+        "        return cfish_inc_refcount(vself);\n"
+        "    }\n"
+        "    if (cfish_num_is_cached(vself)) {\n"
+        "        return (cfish_Obj*)vself;\n"
+        "    }\n"
+        "    dummy->refcount++;\n"
+        "    return (cfish_Obj*)vself;\n"
+        "}\n"
+        "\n"
+        "static CFISH_INLINE uint32_t\n"
+        "cfish_dec_refcount_inline(void *vself) {\n"
+        "    cfish_Dummy *dummy = (cfish_Dummy*)vself;\n"
+        "    if (cfish_num_is_cached(vself)) {\n"
+        "        return (uint32_t)dummy->refcount;\n"
+        "    }\n"
+        "    if ((cfish_refcount_flags(dummy) & CFISH_fREFCOUNTSPECIAL)\n"
+        "        || dummy->refcount <= 1\n"
+        "       ) {\n"
+        "        return cfish_dec_refcount(vself);\n"
+        "    }\n"
+        "    return (uint32_t)--dummy->refcount;\n"
+        "}\n"
+        "\n"
+        "#define CFISH_INCREF_NN(_self) cfish_inc_refcount_inline(_self)\n"
+        "#define CFISH_DECREF_NN(_self) cfish_dec_refcount_inline(_self)\n"
+        "\n"
+        "#else /* CFISH_INLINE_REFCOUNT */\n"
+        "\n"
+        "#define CFISH_INCREF_NN(_self) cfish_inc_refcount(_self)\n"
+        "#define CFISH_DECREF_NN(_self) cfish_dec_refcount(_self)\n"
+        "\n"
+        "#endif /* CFISH_INLINE_REFCOUNT */\n"
+        "\n"
         "/** NULL-safe invocation invocation of `cfish_inc_refcount`.\n"
         " *\n"
         " * @return NULL if `self` is NULL, otherwise the return value\n"
@@ -260,15 +338,11 @@ S_write_parcel_h(CFCBindCore *self, CFCParcel *parcel) {
         " */\n"
         "static CFISH_INLINE cfish_Obj*\n"
         "cfish_incref(void *vself) {\n"
-        "    if (vself != NULL) { return cfish_inc_refcount(vself); }\n"
+        "    if (vself != NULL) { return CFISH_INCREF_NN(vself); }\n"
         "    else { return NULL; }\n"
         "}\n"
         "\n"
         "#define CFISH_INCREF(_self) cfish_incref(_self)\n"
-        "#define CFISH_INCREF_NN(_self) cfish_inc_refcount(_self)\n"
-        "\n"
-        "extern CFISH_VISIBLE uint32_t\n"
-        "cfish_dec_refcount(void *vself);\n"
         "\n"
         "/** NULL-safe invocation of `cfish_dec_refcount`.\n"
         " *\n"
@@ -277,24 +351,17 @@ S_write_parcel_h(CFCBindCore *self, CFCParcel *parcel) {
         " */\n"
         "static CFISH_INLINE uint32_t\n"
         "cfish_decref(void *vself) {\n"
-        "    if (vself != NULL) { return cfish_dec_refcount(vself); }\n"
+        "    if (vself != NULL) { return CFISH_DECREF_NN(vself); }\n"
         "    else { return 0; }\n"
         "}\n"
         "\n"
         "#define CFISH_DECREF(_self) cfish_decref(_self)\n"
-        "#define CFISH_DECREF_NN(_self) cfish_dec_refcount(_self)\n"
         "\n"
         "extern CFISH_VISIBLE uint32_t\n"
         "cfish_get_refcount(void *vself);\n"
         "\n"
         "#define CFISH_REFCOUNT_NN(_self) \\\n"
         "    cfish_get_refcount(_self)\n"
-        "\n"
-        "/* Flags for internal use. */\n"
-        "#define CFISH_fREFCOUNTSPECIAL 0x00000001\n"
-        "#define CFISH_fFINAL           0x00000002\n"
-        "#define CFISH_fEMPTY           0x00000004\n"
-        "#define CFISH_fHOST            0x00000008\n"
         ;
     const char *cfish_defs_2 =
         "#ifdef CFISH_USE_SHORT_NAMES\n"
@@ -166,6 +166,14 @@ CFCC_write_hostdefs(CFCC *self) {
         "\n"
         "#define CFISH_NO_DYNAMIC_OVERRIDES\n"
         "\n"
+        "#ifndef CFISH_NO_INLINE_REFCOUNT\n"
+        "  #define CFISH_INLINE_REFCOUNT\n"
+        "#endif\n"
+        "\n"
+        "#ifndef CFISH_NO_OBJ_POOL\n"
+        "  #define CFISH_OBJ_POOL\n"
+        "#endif\n"
+        "\n"
         "#endif /* H_CFISH_HOSTDEFS */\n"
         "\n"
         "%s\n";
@@ -0,0 +1,93 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Compare building and dropping a temporary graph of Hashes, Vectors and
+ * Strings on the heap with doing the same in an Arena.
+ *
+ * Every round creates a Hash with a Vector of Strings per key, like a
+ * request handler collecting parameters, and throws it away.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+#include "Clownfish/Hash.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Util/Arena.h"
+#include "Clownfish/Vector.h"
+
+#define NUM_KEYS   50
+#define NUM_VALUES 10
+
+static uint64_t
+S_usec(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+static Hash*
+S_build_graph(uint64_t round) {
+    Hash *hash = Hash_new(0);
+    for (uint32_t i = 0; i < NUM_KEYS; i++) {
+        String *key    = Str_newf("param-%u32", i);
+        Vector *values = Vec_new(0);
+        for (uint32_t j = 0; j < NUM_VALUES; j++) {
+            Vec_Push(values, (Obj*)Str_newf("value-%u64-%u32", round, j));
+        }
+        Hash_Store(hash, key, (Obj*)values);
+        DECREF(key);
+    }
+    return hash;
+}
+
+int
+main(int argc, char **argv) {
+    uint64_t rounds = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000;
+
+    cfish_bootstrap_parcel();
+
+    uint64_t t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        Hash *hash = S_build_graph(r);
+        DECREF(hash);
+    }
+    uint64_t t1 = S_usec();
+    printf("%-8s %10.2f us/round\n", "heap", (double)(t1 - t0) / rounds);
+
+    Arena *arena = Arena_new(0);
+    t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        Arena_Enter(arena);
+        Hash *hash = S_build_graph(r);
+        DECREF(hash);
+        Arena_Leave(arena);
+        if (Arena_Release(arena) != 0) {
+            fprintf(stderr, "Objects escaped from arena\n");
+            return 1;
+        }
+    }
+    t1 = S_usec();
+    printf("%-8s %10.2f us/round\n", "arena", (double)(t1 - t0) / rounds);
+    DECREF(arena);
+
+    return 0;
+}
+
@@ -0,0 +1,123 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Measure the overhead of atomic refcounting.
+ *
+ * Every thread runs INCREF/DECREF pairs on
+ *
+ * - an object of its own with plain refcounting,
+ * - an object of its own with atomic refcounting,
+ * - an object with atomic refcounting shared by all threads.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+#include "Clownfish/Class.h"
+#include "Clownfish/Obj.h"
+#include "Clownfish/String.h"
+
+#define MAX_THREADS 64
+
+typedef struct {
+    Obj      *obj;
+    uint64_t  iters;
+} ThreadArgs;
+
+static uint64_t
+S_usec(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+static void*
+S_run(void *varg) {
+    ThreadArgs *args = (ThreadArgs*)varg;
+    Obj        *obj  = args->obj;
+
+    for (uint64_t i = 0; i < args->iters; i++) {
+        INCREF_NN(obj);
+        DECREF_NN(obj);
+    }
+
+    return NULL;
+}
+
+static void
+S_bench(const char *name, Class *klass, int shared, int num_threads,
+        uint64_t iters) {
+    pthread_t  threads[MAX_THREADS];
+    ThreadArgs args[MAX_THREADS];
+    Obj       *shared_obj = Class_Make_Obj(klass);
+
+    for (int i = 0; i < num_threads; i++) {
+        args[i].obj   = shared ? shared_obj : Class_Make_Obj(klass);
+        args[i].iters = iters;
+    }
+
+    uint64_t t0 = S_usec();
+    for (int i = 0; i < num_threads; i++) {
+        pthread_create(&threads[i], NULL, S_run, &args[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    uint64_t t1 = S_usec();
+
+    if (REFCOUNT_NN(shared_obj) != 1) {
+        fprintf(stderr, "Unbalanced refcount: %" PRIu32 "\n",
+                REFCOUNT_NN(shared_obj));
+        exit(1);
+    }
+
+    printf("%-16s %2d threads %8.2f ns/pair\n", name, num_threads,
+           (double)(t1 - t0) * 1000.0 / (double)iters);
+
+    for (int i = 0; i < num_threads; i++) {
+        if (args[i].obj != shared_obj) { DECREF(args[i].obj); }
+    }
+    DECREF(shared_obj);
+}
+
+int
+main(int argc, char **argv) {
+    int      num_threads = argc > 1 ? atoi(argv[1]) : 4;
+    uint64_t iters       = argc > 2 ? strtoull(argv[2], NULL, 10) : 10000000;
+
+    if (num_threads < 1 || num_threads > MAX_THREADS) {
+        fprintf(stderr, "Number of threads must be between 1 and %d\n",
+                MAX_THREADS);
+        return 1;
+    }
+
+    cfish_bootstrap_parcel();
+
+    Class *plain  = Class_singleton(SSTR_WRAP_C("Bench::PlainObj"), OBJ);
+    Class *atomic = Class_singleton(SSTR_WRAP_C("Bench::AtomicObj"), OBJ);
+    Class_Enable_Atomic_Refcount(atomic);
+
+    S_bench("plain", plain, 0, num_threads, iters);
+    S_bench("atomic", atomic, 0, num_threads, iters);
+    S_bench("atomic shared", atomic, 1, num_threads, iters);
+
+    return 0;
+}
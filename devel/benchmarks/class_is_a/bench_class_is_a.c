@@ -0,0 +1,112 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Compare Obj_is_a, which looks up the ancestor display of a class, with
+ * walking the chain of parent classes.
+ *
+ * For every depth, a chain of host subclasses of Obj is created and an
+ * instance of the deepest class is checked against its direct child of
+ * Obj.  That's the worst case for the walk, which has to visit every
+ * class in the chain.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define C_CFISH_OBJ
+#define C_CFISH_CLASS
+#define CFISH_USE_SHORT_NAMES
+#include "Clownfish/Class.h"
+#include "Clownfish/Obj.h"
+#include "Clownfish/String.h"
+
+static uint64_t
+S_usec(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+// The subtype check used before the ancestor display.
+static __attribute__((noinline)) bool
+S_walk_is_a(Obj *obj, Class *ancestor) {
+    Class *klass = obj->klass;
+
+    while (klass != NULL) {
+        if (klass == ancestor) {
+            return true;
+        }
+        klass = klass->parent;
+    }
+
+    return false;
+}
+
+static void
+S_report(const char *name, uint32_t depth, uint64_t usec, uint64_t checks) {
+    printf("%-8s depth %2" PRIu32 " %8.2f ns/check\n", name, depth,
+           (double)usec * 1000.0 / (double)checks);
+}
+
+int
+main(int argc, char **argv) {
+    uint64_t iters = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+    static const uint32_t depths[] = { 1, 4, 8, 15, 32 };
+    uint64_t found = 0;
+
+    cfish_bootstrap_parcel();
+
+    for (size_t d = 0; d < sizeof(depths) / sizeof(depths[0]); d++) {
+        uint32_t  depth  = depths[d];
+        Class    *parent = OBJ;
+        Class    *first  = NULL;
+
+        for (uint32_t i = 0; i < depth; i++) {
+            String *name = Str_newf("Bench::Depth%u32::Class%u32", depth, i);
+            parent = Class_singleton(name, parent);
+            if (first == NULL) { first = parent; }
+            DECREF(name);
+        }
+
+        Obj *obj = Class_Make_Obj(parent);
+
+        uint64_t t0 = S_usec();
+        for (uint64_t i = 0; i < iters; i++) {
+            found += S_walk_is_a(obj, first);
+        }
+        uint64_t t1 = S_usec();
+        S_report("walk", depth, t1 - t0, iters);
+
+        t0 = S_usec();
+        for (uint64_t i = 0; i < iters; i++) {
+            found += Obj_is_a(obj, first);
+        }
+        t1 = S_usec();
+        S_report("display", depth, t1 - t0, iters);
+
+        DECREF(obj);
+    }
+
+    if (found != 2 * iters * (sizeof(depths) / sizeof(depths[0]))) {
+        fprintf(stderr, "Unexpected number of hits: %" PRIu64 "\n", found);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Measure the cost of repeated Hash lookups with long keys.
+ *
+ * Fetching with the same heap-allocated String hits the hash sum cached
+ * inside the String.  Fetching with a freshly wrapped stack string has to
+ * hash the key from scratch on every lookup, which is what every fetch
+ * cost before the hash sum was cached.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+#include "Clownfish/Hash.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Vector.h"
+
+#define NUM_KEYS 1000
+#define KEY_LEN  64
+
+static uint64_t
+S_usec(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+// Stack strings live until the enclosing function returns, so wrap each key
+// in its own call frame.
+static __attribute__((noinline)) Obj*
+S_fetch_wrapped(Hash *hash, const char *ptr, size_t size) {
+    String *key = SSTR_WRAP_UTF8(ptr, size);
+    return Hash_Fetch(hash, key);
+}
+
+static void
+S_report(const char *name, uint64_t usec, uint64_t fetches) {
+    printf("%-24s %8.2f ns/fetch\n", name,
+           (double)usec * 1000.0 / (double)fetches);
+}
+
+int
+main(int argc, char **argv) {
+    uint64_t rounds = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000;
+
+    cfish_bootstrap_parcel();
+
+    Hash   *hash = Hash_new(NUM_KEYS);
+    Vector *keys = Vec_new(NUM_KEYS);
+    char   *raw  = (char*)malloc(NUM_KEYS * KEY_LEN);
+
+    for (int i = 0; i < NUM_KEYS; i++) {
+        char *ptr = raw + i * KEY_LEN;
+        // Long keys sharing a common prefix.
+        snprintf(ptr, KEY_LEN, "com.example.service.cache.entry.%040d", i);
+        String *key = Str_new_from_utf8(ptr, KEY_LEN - 1);
+        Hash_Store(hash, key, (Obj*)Str_newf("%i32", i));
+        Vec_Push(keys, (Obj*)key);
+    }
+
+    uint64_t found = 0;
+    uint64_t t0    = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (int i = 0; i < NUM_KEYS; i++) {
+            const char *ptr = raw + i * KEY_LEN;
+            found += S_fetch_wrapped(hash, ptr, KEY_LEN - 1) != NULL;
+        }
+    }
+    uint64_t t1 = S_usec();
+    S_report("uncached (stack key)", t1 - t0, rounds * NUM_KEYS);
+
+    t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (int i = 0; i < NUM_KEYS; i++) {
+            String *key = (String*)Vec_Fetch(keys, (size_t)i);
+            found += Hash_Fetch(hash, key) != NULL;
+        }
+    }
+    t1 = S_usec();
+    S_report("cached (heap key)", t1 - t0, rounds * NUM_KEYS);
+
+    if (found != 2 * rounds * NUM_KEYS) {
+        fprintf(stderr, "Unexpected number of hits: %" PRIu64 "\n", found);
+        return 1;
+    }
+
+    DECREF(keys);
+    DECREF(hash);
+    free(raw);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Compare the object pool with the system allocator.
+ *
+ * The first part allocates and frees blocks of typical object sizes with
+ * calloc/free and with the pool directly.  The second part runs a String
+ * heavy workload through Class_Make_Obj.  It uses whatever allocator the
+ * runtime was built with, so run it once against a runtime built with
+ * -DCFISH_NO_OBJ_POOL to get the numbers for the system allocator.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+#include "Clownfish/Num.h"
+#include "Clownfish/ObjPool.h"
+#include "Clownfish/String.h"
+
+#define BATCH 100
+
+static uint64_t
+S_usec(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+static void
+S_report(const char *name, size_t size, uint64_t usec, uint64_t ops) {
+    printf("%-16s %4zu bytes %8.2f ns/op\n", name, size,
+           (double)usec * 1000.0 / (double)ops);
+}
+
+static void
+S_bench_alloc(size_t size, uint64_t rounds) {
+    void *blocks[BATCH];
+
+    uint64_t t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (int i = 0; i < BATCH; i++) { blocks[i] = calloc(size, 1); }
+        for (int i = 0; i < BATCH; i++) { free(blocks[i]); }
+    }
+    uint64_t t1 = S_usec();
+    S_report("calloc/free", size, t1 - t0, rounds * BATCH);
+
+    t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (int i = 0; i < BATCH; i++) { blocks[i] = ObjPool_alloc(size); }
+        for (int i = 0; i < BATCH; i++) { ObjPool_free(blocks[i], size); }
+    }
+    t1 = S_usec();
+    S_report("ObjPool", size, t1 - t0, rounds * BATCH);
+}
+
+// Create short-lived Strings and Integers as typical text processing does.
+static void
+S_bench_strings(uint64_t rounds) {
+    uint64_t total = 0;
+
+    uint64_t t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        String *str = Str_newf("token-%u64 and some more text", r);
+        for (size_t i = 0; i < 4; i++) {
+            String *word   = Str_SubString(str, i * 4, 4);
+            String *banged = Str_Cat_Trusted_Utf8(word, "!", 1);
+            Obj    *num    = (Obj*)Int_new((int64_t)Str_Length(banged));
+            total += Str_Length(banged);
+            DECREF(num);
+            DECREF(banged);
+            DECREF(word);
+        }
+        DECREF(str);
+    }
+    uint64_t t1 = S_usec();
+
+#ifdef CFISH_OBJ_POOL
+    const char *name = "String workload (pool)";
+#else
+    const char *name = "String workload (malloc)";
+#endif
+    printf("%-26s %8.2f ns/round (%" PRIu64 " chars)\n", name,
+           (double)(t1 - t0) * 1000.0 / (double)rounds, total);
+}
+
+int
+main(int argc, char **argv) {
+    uint64_t rounds = argc > 1 ? strtoull(argv[1], NULL, 10) : 100000;
+
+    cfish_bootstrap_parcel();
+
+    S_bench_alloc(32, rounds);
+    S_bench_alloc(64, rounds);
+    S_bench_alloc(128, rounds);
+    S_bench_strings(rounds * 10);
+
+    return 0;
+}
@@ -0,0 +1,166 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Compare the textbook recursive mergesort formerly used by SortUtils with
+ * the natural mergesort and pattern-defeating quicksort now provided by
+ * Sort_mergesort and Sort_quicksort, on random, sorted, reversed and
+ * few-unique 64-bit keys, as well as Sort_parallel_mergesort with one thread
+ * per online processor or the thread count given on the command line.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+#include "Clownfish/Util/SortUtils.h"
+
+static uint64_t
+S_usec(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+static uint64_t
+S_xorshift(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static int
+S_compare(void *context, const void *va, const void *vb) {
+    uint64_t a = *(const uint64_t*)va;
+    uint64_t b = *(const uint64_t*)vb;
+    (void)context;
+    return (a > b) - (a < b);
+}
+
+// The top-down mergesort that Sort_mergesort used to be.  The comparator is
+// called through a pointer like in the library code.
+static CFISH_Sort_Compare_t volatile textbook_compare = S_compare;
+
+static void
+S_textbook_msort(uint64_t *elems, uint64_t *scratch, size_t left,
+                 size_t right) {
+    if (right > left) {
+        const size_t mid = left + (right - left) / 2 + 1;
+        S_textbook_msort(elems, scratch, left, mid - 1);
+        S_textbook_msort(elems, scratch, mid, right);
+
+        uint64_t *left_ptr    = elems + left;
+        uint64_t *left_limit  = elems + mid;
+        uint64_t *right_ptr   = elems + mid;
+        uint64_t *right_limit = elems + right + 1;
+        uint64_t *dest        = scratch;
+        while (left_ptr < left_limit && right_ptr < right_limit) {
+            if (textbook_compare(NULL, left_ptr, right_ptr) < 1) {
+                *dest++ = *left_ptr++;
+            }
+            else {
+                *dest++ = *right_ptr++;
+            }
+        }
+        memcpy(dest, left_ptr, (size_t)(left_limit - left_ptr) * 8);
+        dest += left_limit - left_ptr;
+        memcpy(dest, right_ptr, (size_t)(right_limit - right_ptr) * 8);
+        memcpy(elems + left, scratch, (right - left + 1) * 8);
+    }
+}
+
+static void
+S_fill(uint64_t *elems, size_t num_elems, const char *pattern) {
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (size_t i = 0; i < num_elems; i++) {
+        if (strcmp(pattern, "random") == 0) {
+            elems[i] = S_xorshift(&state);
+        }
+        else if (strcmp(pattern, "sorted") == 0) {
+            elems[i] = i;
+        }
+        else if (strcmp(pattern, "reversed") == 0) {
+            elems[i] = num_elems - i;
+        }
+        else {
+            elems[i] = S_xorshift(&state) % 16;
+        }
+    }
+}
+
+static void
+S_bench(const char *pattern, size_t num_elems, int rounds,
+        uint32_t num_threads) {
+    uint64_t *elems   = (uint64_t*)malloc(num_elems * sizeof(uint64_t));
+    uint64_t *scratch = (uint64_t*)malloc(num_elems * sizeof(uint64_t));
+    uint64_t  elapsed[4] = { 0, 0, 0, 0 };
+
+    for (int r = 0; r < rounds; r++) {
+        S_fill(elems, num_elems, pattern);
+        uint64_t t0 = S_usec();
+        S_textbook_msort(elems, scratch, 0, num_elems - 1);
+        elapsed[0] += S_usec() - t0;
+
+        S_fill(elems, num_elems, pattern);
+        t0 = S_usec();
+        Sort_mergesort(elems, scratch, num_elems, sizeof(uint64_t),
+                       S_compare, NULL);
+        elapsed[1] += S_usec() - t0;
+
+        S_fill(elems, num_elems, pattern);
+        t0 = S_usec();
+        Sort_quicksort(elems, num_elems, sizeof(uint64_t), S_compare, NULL);
+        elapsed[2] += S_usec() - t0;
+
+        S_fill(elems, num_elems, pattern);
+        t0 = S_usec();
+        Sort_parallel_mergesort(elems, scratch, num_elems, sizeof(uint64_t),
+                                S_compare, NULL, num_threads);
+        elapsed[3] += S_usec() - t0;
+    }
+
+    printf("%-10s textbook %8.2f ms  mergesort %8.2f ms"
+           "  quicksort %8.2f ms  parallel %8.2f ms\n",
+           pattern, elapsed[0] / 1000.0 / rounds,
+           elapsed[1] / 1000.0 / rounds, elapsed[2] / 1000.0 / rounds,
+           elapsed[3] / 1000.0 / rounds);
+
+    free(scratch);
+    free(elems);
+}
+
+int
+main(int argc, char **argv) {
+    size_t num_elems = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    int    rounds    = argc > 2 ? atoi(argv[2]) : 5;
+    uint32_t num_threads
+        = argc > 3 ? (uint32_t)strtoul(argv[3], NULL, 10) : 0;
+    if (num_elems < 2) { num_elems = 2; }
+
+    cfish_bootstrap_parcel();
+
+    printf("Sorting %" PRIu64 " 64-bit keys\n", (uint64_t)num_elems);
+    S_bench("random", num_elems, rounds, num_threads);
+    S_bench("sorted", num_elems, rounds, num_threads);
+    S_bench("reversed", num_elems, rounds, num_threads);
+    S_bench("few unique", num_elems, rounds, num_threads);
+    return 0;
+}
+
@@ -0,0 +1,128 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Compare Str_Contains and a reused StringSearcher with the memchr/memcmp
+ * loop formerly used by String, on English-like text and on repetitive
+ * text where the naive loop finds a candidate at almost every position.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+#include "Clownfish/CharBuf.h"
+#include "Clownfish/String.h"
+#include "Clownfish/StringSearcher.h"
+
+#define TEXT_REPEAT 2000
+
+static uint64_t
+S_usec(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+static const char*
+S_naive_memmem(const char *haystack, size_t haystack_size,
+               const char *needle, size_t needle_size) {
+    if (needle_size > haystack_size) { return NULL; }
+    const char *ptr = haystack;
+    const char *end = haystack + haystack_size - needle_size + 1;
+    while (NULL != (ptr = (const char*)memchr(ptr, needle[0],
+                                              (size_t)(end - ptr)))) {
+        if (memcmp(ptr, needle, needle_size) == 0) { return ptr; }
+        ptr++;
+    }
+    return NULL;
+}
+
+static String*
+S_repeat(const char *unit) {
+    CharBuf *buf = CB_new(0);
+    for (int i = 0; i < TEXT_REPEAT; i++) {
+        CB_Cat_Trusted_Utf8(buf, unit, strlen(unit));
+    }
+    String *retval = CB_Yield_String(buf);
+    DECREF(buf);
+    return retval;
+}
+
+static void
+S_bench(const char *label, String *haystack, String *needle,
+        uint64_t rounds) {
+    const char *hay_ptr  = Str_Get_Ptr8(haystack);
+    size_t      hay_size = Str_Get_Size(haystack);
+    const char *ndl_ptr  = Str_Get_Ptr8(needle);
+    size_t      ndl_size = Str_Get_Size(needle);
+    uint64_t    found    = 0;
+
+    uint64_t t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        found += !!S_naive_memmem(hay_ptr, hay_size, ndl_ptr, ndl_size);
+    }
+    uint64_t t1 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        found += Str_Contains(haystack, needle);
+    }
+    uint64_t t2 = S_usec();
+    StringSearcher *searcher = StrSearcher_new(needle);
+    for (uint64_t r = 0; r < rounds; r++) {
+        found += StrSearcher_Contains(searcher, haystack);
+    }
+    uint64_t t3 = S_usec();
+    DECREF(searcher);
+
+    double mb = (double)hay_size * rounds / (1024.0 * 1024.0);
+    printf("%-22s naive %8.1f MB/s  Contains %8.1f MB/s"
+           "  searcher %8.1f MB/s  (%" PRIu64 ")\n",
+           label, mb / ((t1 - t0) / 1e6), mb / ((t2 - t1) / 1e6),
+           mb / ((t3 - t2) / 1e6), found);
+}
+
+int
+main(int argc, char **argv) {
+    uint64_t rounds = argc > 1 ? strtoull(argv[1], NULL, 10) : 200;
+
+    cfish_bootstrap_parcel();
+
+    String *text = S_repeat("The quick brown fox jumps over the lazy dog. ");
+    String *aaaa = S_repeat("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+
+    String *short_miss = Str_newf("lazy cat");
+    String *long_miss  = Str_newf("jumps over the lazy dog. The quick "
+                                  "brown cat");
+    String *a_short    = Str_newf("aaaaaaaaaaaaaaab");
+    String *a_long     = Str_newf("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+                                  "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab");
+
+    S_bench("text, short needle", text, short_miss, rounds);
+    S_bench("text, long needle", text, long_miss, rounds);
+    S_bench("repetitive, short", aaaa, a_short, rounds);
+    S_bench("repetitive, long", aaaa, a_long, rounds);
+
+    DECREF(a_long);
+    DECREF(a_short);
+    DECREF(long_miss);
+    DECREF(short_miss);
+    DECREF(aaaa);
+    DECREF(text);
+    return 0;
+}
+
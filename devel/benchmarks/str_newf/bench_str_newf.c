@@ -0,0 +1,118 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* Measure Str_newf and precompiled FormatTemplates with typical log
+ * message and key building patterns, compared to snprintf into a stack
+ * buffer.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+#include "Clownfish/CharBuf.h"
+#include "Clownfish/String.h"
+
+static uint64_t
+S_usec(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+static void
+S_report(const char *label, uint64_t usec, uint64_t rounds) {
+    printf("%-22s %8.1f ns/call\n", label, usec * 1000.0 / rounds);
+}
+
+int
+main(int argc, char **argv) {
+    uint64_t rounds = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+    uint64_t total  = 0;
+    char     buf[256];
+
+    cfish_bootstrap_parcel();
+
+    uint64_t t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        String *str = Str_newf("doc-%u64:field-%u32", r, (uint32_t)(r % 17));
+        total += Str_Get_Size(str);
+        DECREF(str);
+    }
+    uint64_t t1 = S_usec();
+    S_report("Str_newf integers", t1 - t0, rounds);
+
+    FormatTemplate *key_tmpl = FmtTmpl_new("doc-%u64:field-%u32");
+    t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        String *str = FmtTmpl_newf(key_tmpl, r, (uint32_t)(r % 17));
+        total += Str_Get_Size(str);
+        DECREF(str);
+    }
+    t1 = S_usec();
+    S_report("FmtTmpl_newf integers", t1 - t0, rounds);
+    DECREF(key_tmpl);
+
+    t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        int size = snprintf(buf, sizeof(buf), "doc-%" PRIu64 ":field-%u",
+                            r, (unsigned)(r % 17));
+        total += (uint64_t)size;
+    }
+    t1 = S_usec();
+    S_report("snprintf integers", t1 - t0, rounds);
+
+    t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        String *str = Str_newf("request %i64 took %f64 ms, status %x32",
+                               (int64_t)r, (double)(r % 1000) / 4.0,
+                               (uint32_t)r);
+        total += Str_Get_Size(str);
+        DECREF(str);
+    }
+    t1 = S_usec();
+    S_report("Str_newf log message", t1 - t0, rounds);
+
+    FormatTemplate *log_tmpl
+        = FmtTmpl_new("request %i64 took %f64 ms, status %x32");
+    t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        String *str = FmtTmpl_newf(log_tmpl, (int64_t)r,
+                                   (double)(r % 1000) / 4.0, (uint32_t)r);
+        total += Str_Get_Size(str);
+        DECREF(str);
+    }
+    t1 = S_usec();
+    S_report("FmtTmpl_newf log msg", t1 - t0, rounds);
+    DECREF(log_tmpl);
+
+    t0 = S_usec();
+    for (uint64_t r = 0; r < rounds; r++) {
+        int size = snprintf(buf, sizeof(buf),
+                            "request %" PRId64 " took %g ms, status %.8x",
+                            (int64_t)r, (double)(r % 1000) / 4.0,
+                            (unsigned)r);
+        total += (uint64_t)size;
+    }
+    t1 = S_usec();
+    S_report("snprintf log message", t1 - t0, rounds);
+
+    printf("(%" PRIu64 ")\n", total);
+    return 0;
+}
+
@@ -0,0 +1,134 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Measure throughput and distribution of the string hash function.
+ *
+ * The hash function is selected when configuring the runtime, so build and
+ * run this benchmark once per choice to compare them:
+ *
+ *     ./configure --string-hash=djb
+ *     ./configure --string-hash=wyhash
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+#include "Clownfish/String.h"
+
+#define NUM_KEYS 100000
+
+static uint64_t
+S_usec(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+// Hash sums are cached in heap Strings, so hash freshly wrapped stack
+// strings, each in its own call frame.
+static __attribute__((noinline)) size_t
+S_hash(const char *ptr, size_t size) {
+    String *string = SSTR_WRAP_UTF8(ptr, size);
+    return Str_Hash_Sum(string);
+}
+
+static void
+S_throughput(size_t len, uint64_t bytes_total) {
+    char *buf = (char*)malloc(len);
+    for (size_t i = 0; i < len; i++) { buf[i] = (char)('a' + i % 26); }
+
+    uint64_t iters = bytes_total / len;
+    size_t   accum = 0;
+    uint64_t t0    = S_usec();
+    for (uint64_t i = 0; i < iters; i++) {
+        buf[i % len] ^= 1;
+        accum += S_hash(buf, len);
+    }
+    uint64_t t1 = S_usec();
+
+    double secs = (double)(t1 - t0) / 1000000.0;
+    printf("len %5zu: %8.1f MB/s %8.2f ns/hash (%zx)\n", len,
+           (double)(iters * len) / secs / 1000000.0,
+           (double)(t1 - t0) * 1000.0 / (double)iters, accum & 0xF);
+    free(buf);
+}
+
+static int
+S_compare_size_t(const void *va, const void *vb) {
+    size_t a = *(const size_t*)va;
+    size_t b = *(const size_t*)vb;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+// Count full hash collisions and bucket collisions in a power-of-two table
+// for keys sharing a long prefix.
+static void
+S_collisions(const char *label, const char *format) {
+    size_t *sums    = (size_t*)malloc(NUM_KEYS * sizeof(size_t));
+    size_t  mask    = 65536 - 1;
+    size_t *buckets = (size_t*)calloc(mask + 1, sizeof(size_t));
+    char    buf[128];
+
+    for (int i = 0; i < NUM_KEYS; i++) {
+        int len = snprintf(buf, sizeof(buf), format, i);
+        sums[i] = S_hash(buf, (size_t)len);
+        buckets[sums[i] & mask]++;
+    }
+
+    qsort(sums, NUM_KEYS, sizeof(size_t), S_compare_size_t);
+    size_t full = 0;
+    for (int i = 1; i < NUM_KEYS; i++) {
+        if (sums[i] == sums[i - 1]) { full++; }
+    }
+
+    size_t max_bucket = 0;
+    size_t empty      = 0;
+    for (size_t i = 0; i <= mask; i++) {
+        if (buckets[i] > max_bucket) { max_bucket = buckets[i]; }
+        if (buckets[i] == 0)         { empty++; }
+    }
+
+    printf("%-10s full collisions: %6zu, empty buckets: %6zu,"
+           " longest bucket: %zu\n", label, full, empty, max_bucket);
+
+    free(buckets);
+    free(sums);
+}
+
+int
+main(int argc, char **argv) {
+    uint64_t megabytes = argc > 1 ? strtoull(argv[1], NULL, 10) : 200;
+
+    cfish_bootstrap_parcel();
+
+    static const size_t lengths[] = { 3, 8, 16, 32, 64, 256, 4096 };
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        S_throughput(lengths[i], megabytes * 1000000);
+    }
+
+    // A random function leaves about e^(-100000/65536) = 22% of the buckets
+    // empty and produces no full collisions.
+    S_collisions("numbers", "%d");
+    S_collisions("prefixed", "/usr/share/application/resource/item-%d");
+    S_collisions("suffixed", "%08d.cache.entry.example.com");
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/* Measure the throughput of Str_utf8_valid on text with different mixes
+ * of sequence lengths, compared to a byte-at-a-time validator.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define CFISH_USE_SHORT_NAMES
+#include "Clownfish/String.h"
+
+#define TEXT_SIZE (1024 * 1024)
+
+static uint64_t
+S_usec(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+// The validation rules of Str_utf8_valid, checked one byte at a time.
+static bool
+S_bytewise_valid(const uint8_t *string, size_t size) {
+    const uint8_t *const end = string + size;
+    while (string < end) {
+        const uint8_t header_byte = *string++;
+        if (header_byte < 0x80) {
+            continue;
+        }
+        else if (header_byte < 0xE0) {
+            if (header_byte < 0xC2)         { return false; }
+            if (string == end)              { return false; }
+            if ((*string++ & 0xC0) != 0x80) { return false; }
+        }
+        else if (header_byte < 0xF0) {
+            if (end - string < 2)           { return false; }
+            if (header_byte == 0xED) {
+                if (*string < 0x80 || *string > 0x9F) { return false; }
+            }
+            else if (!(header_byte & 0x0F)) {
+                if (!(*string & 0x20))      { return false; }
+            }
+            if ((*string++ & 0xC0) != 0x80) { return false; }
+            if ((*string++ & 0xC0) != 0x80) { return false; }
+        }
+        else {
+            if (header_byte > 0xF4)         { return false; }
+            if (end - string < 3)           { return false; }
+            if (!(header_byte & 0x07)) {
+                if (!(*string & 0x30))      { return false; }
+            }
+            else if (header_byte == 0xF4) {
+                if (*string >= 0x90)        { return false; }
+            }
+            if ((*string++ & 0xC0) != 0x80) { return false; }
+            if ((*string++ & 0xC0) != 0x80) { return false; }
+            if ((*string++ & 0xC0) != 0x80) { return false; }
+        }
+    }
+    return true;
+}
+
+// Fill a buffer by repeating `sample`.
+static char*
+S_make_text(const char *sample) {
+    size_t sample_len = strlen(sample);
+    char *text = (char*)malloc(TEXT_SIZE);
+    size_t size = 0;
+    while (size + sample_len <= TEXT_SIZE) {
+        memcpy(text + size, sample, sample_len);
+        size += sample_len;
+    }
+    memset(text + size, ' ', TEXT_SIZE - size);
+    return text;
+}
+
+static void
+S_bench(const char *label, const char *sample, int rounds) {
+    char *text = S_make_text(sample);
+    bool  ok   = true;
+
+    uint64_t t0 = S_usec();
+    for (int i = 0; i < rounds; i++) {
+        ok &= S_bytewise_valid((const uint8_t*)text, TEXT_SIZE);
+    }
+    uint64_t t1 = S_usec();
+    for (int i = 0; i < rounds; i++) {
+        ok &= Str_utf8_valid(text, TEXT_SIZE);
+    }
+    uint64_t t2 = S_usec();
+
+    if (!ok) {
+        fprintf(stderr, "%s: validation failed\n", label);
+        exit(1);
+    }
+    double mbytes = (double)TEXT_SIZE * rounds / (1024 * 1024);
+    printf("%-8s bytewise %8.1f MB/s   utf8_valid %8.1f MB/s\n", label,
+           mbytes * 1000000 / (double)(t1 - t0),
+           mbytes * 1000000 / (double)(t2 - t1));
+    free(text);
+}
+
+int
+main(int argc, char **argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 200;
+
+    cfish_bootstrap_parcel();
+
+    S_bench("ascii", "The quick brown fox jumps over the lazy dog. ", rounds);
+    S_bench("latin", "Fran\xC3\xA7ois a mang\xC3\xA9 une cr\xC3\xAApe. ",
+            rounds);
+    S_bench("cjk", "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE"
+                   "\xE6\x96\x87\xE7\xAB\xA0", rounds);
+    S_bench("emoji", "\xF0\x9F\x98\x80\xF0\x9F\x8E\x89 ok ", rounds);
+
+    return 0;
+}
+
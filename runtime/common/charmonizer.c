@@ -8798,6 +8798,12 @@ int main(int argc, const char **argv) {
                       CHAZ_CLI_ARG_REQUIRED);
     chaz_CLI_register(cli, "disable-threads", "whether to disable threads",
                       CHAZ_CLI_NO_ARG);
+    chaz_CLI_register(cli, "string-hash",
+                      "string hash function: wyhash (default) or djb",
+                      CHAZ_CLI_ARG_OPTIONAL);
+    chaz_CLI_register(cli, "enable-hash-seed",
+                      "seed string hashes randomly per process",
+                      CHAZ_CLI_NO_ARG);
     chaz_CLI_set_usage(cli, "Usage: charmonizer [OPTIONS] [-- [CFLAGS]]");
     if (!chaz_Probe_parse_cli_args(argc, argv, cli)) {
         chaz_Probe_die_usage();
@@ -8925,6 +8931,19 @@ S_add_compiler_flags(struct chaz_CLI *cli) {
     if (chaz_CLI_defined(cli, "disable-threads")) {
         chaz_CFlags_append(extra_cflags, "-DCFISH_NOTHREADS");
     }
+
+    if (chaz_CLI_defined(cli, "string-hash")) {
+        const char *string_hash = chaz_CLI_strval(cli, "string-hash");
+        if (strcmp(string_hash, "djb") == 0) {
+            chaz_CFlags_append(extra_cflags, "-DCFISH_STR_HASH_DJB");
+        }
+        else if (strcmp(string_hash, "wyhash") != 0) {
+            chaz_Util_die("Unknown string hash function: %s", string_hash);
+        }
+    }
+    if (chaz_CLI_defined(cli, "enable-hash-seed")) {
+        chaz_CFlags_append(extra_cflags, "-DCFISH_STR_HASH_SEED");
+    }
 }
 
 static chaz_CFlags*
@@ -15,15 +15,16 @@
  */
 
 #include "Clownfish/Boolean.h"
-#include "Clownfish/Hash.h"
-#include "Clownfish/HashIterator.h"
 #include "Clownfish/Err.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/String.h"
 
 void
 cfish_init_parcel() {
     cfish_Bool_init_class();
-    cfish_Hash_init_class();
-    cfish_HashIter_init_class();
     cfish_Err_init_class();
+    cfish_Float_init_class();
+    cfish_Int_init_class();
+    cfish_Str_init_class();
 }
 
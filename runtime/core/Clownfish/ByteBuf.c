@@ -26,6 +26,7 @@
 #include "Clownfish/Blob.h"
 #include "Clownfish/Err.h"
 #include "Clownfish/String.h"
+#include "Clownfish/Util/AllocStats.h"
 #include "Clownfish/Util/Memory.h"
 
 // Ensure that the ByteBuf's capacity is at least (size + extra).
@@ -60,6 +61,7 @@ BB_init(ByteBuf *self, size_t min_cap) {
     self->buf  = (char*)MALLOCATE(capacity);
     self->size = 0;
     self->cap  = capacity;
+    ALLOCSTATS_BUF_ALLOC(self->klass, capacity);
     return self;
 }
 
@@ -79,6 +81,7 @@ BB_init_bytes(ByteBuf *self, const void *bytes, size_t size) {
     self->buf  = (char*)MALLOCATE(capacity);
     self->size = size;
     self->cap  = capacity;
+    ALLOCSTATS_BUF_ALLOC(self->klass, capacity);
     memcpy(self->buf, bytes, size);
     return self;
 }
@@ -95,11 +98,15 @@ BB_init_steal_bytes(ByteBuf *self, void *bytes, size_t size,
     self->buf  = (char*)bytes;
     self->size = size;
     self->cap  = capacity;
+    ALLOCSTATS_BUF_ALLOC(self->klass, capacity);
     return self;
 }
 
 void
 BB_Destroy_IMP(ByteBuf *self) {
+    if (self->buf) {
+        ALLOCSTATS_BUF_FREE(self->klass, self->cap);
+    }
     FREEMEM(self->buf);
     SUPER_DESTROY(self, BYTEBUF);
 }
@@ -177,6 +184,7 @@ BB_Grow_IMP(ByteBuf *self, size_t min_cap) {
         // Check for overflow.
         if (capacity < min_cap) { capacity = SIZE_MAX; }
 
+        ALLOCSTATS_BUF_RESIZE(self->klass, self->cap, capacity);
         self->buf = (char*)REALLOCATE(self->buf, capacity);
         self->cap = capacity;
     }
@@ -186,6 +194,8 @@ BB_Grow_IMP(ByteBuf *self, size_t min_cap) {
 
 Blob*
 BB_Yield_Blob_IMP(ByteBuf *self) {
+    // The Blob takes over the buffer.
+    ALLOCSTATS_BUF_FREE(self->klass, self->cap);
     Blob *blob = Blob_new_steal(self->buf, self->size);
     self->buf  = NULL;
     self->size = 0;
@@ -241,6 +251,7 @@ S_grow_and_oversize(ByteBuf *self, size_t min_size) {
     // Check for overflow.
     if (capacity < min_size) { capacity = SIZE_MAX; }
 
+    ALLOCSTATS_BUF_RESIZE(self->klass, self->cap, capacity);
     self->buf = (char*)REALLOCATE(self->buf, capacity);
     self->cap = capacity;
 }
@@ -15,6 +15,7 @@
  */
 
 #define C_CFISH_CHARBUF
+#define C_CFISH_FORMATTEMPLATE
 #define C_CFISH_STRING
 #define CFISH_USE_SHORT_NAMES
 
@@ -29,9 +30,31 @@
 
 #include "Clownfish/Err.h"
 #include "Clownfish/String.h"
+#include "Clownfish/Util/AllocStats.h"
+#include "Clownfish/Util/Arena.h"
+#include "Clownfish/Util/Atomic.h"
 #include "Clownfish/Util/Memory.h"
 #include "Clownfish/Class.h"
 
+// Conversions supported by VCatF.  `%%` is treated as literal text.
+typedef enum {
+    FMT_LITERAL,
+    FMT_OBJ,
+    FMT_CSTR,
+    FMT_I32,
+    FMT_I64,
+    FMT_U32,
+    FMT_U64,
+    FMT_F64,
+    FMT_X32
+} FormatOpType;
+
+typedef struct FormatOp {
+    FormatOpType type;
+    size_t       offset;  /* into the literals of a FormatTemplate */
+    size_t       size;
+} FormatOp;
+
 // Append trusted UTF-8 to the CharBuf.
 static void
 S_cat_utf8(CharBuf *self, const char* ptr, size_t size);
@@ -60,6 +83,56 @@ S_overflow_error(void);
 static void
 S_die_invalid_specifier(const char *specifier);
 
+// Parse the conversion specifier after a '%' other than `%%`.  Advance
+// `*pattern_ptr` to the last character of the specifier.  Return
+// FMT_LITERAL if the specifier is invalid.
+static FormatOpType
+S_parse_specifier(const char **pattern_ptr);
+
+// Consume the argument for a conversion and append it.
+static void
+S_cat_arg(CharBuf *self, FormatOpType type, va_list *args);
+
+// Write the decimal digits of `value` so that they end right before `end`.
+// Return a pointer to the first digit.
+static CFISH_INLINE char*
+SI_format_u64(uint64_t value, char *end);
+
+// Format a double like `sprintf("%g")`.  Return the number of bytes written
+// to `buf`, which must hold at least F64_BUF_SIZE bytes.
+static size_t
+S_format_f64(double num, char *buf);
+
+#define U64_BUF_SIZE 24
+#define F64_BUF_SIZE 32
+
+// Maximum output size of each conversion, zero if unbounded.
+static const size_t FORMAT_MAX_SIZE[] = {
+    0,   /* FMT_LITERAL */
+    0,   /* FMT_OBJ */
+    0,   /* FMT_CSTR */
+    11,  /* FMT_I32: -2147483648 */
+    20,  /* FMT_I64: -9223372036854775808 */
+    10,  /* FMT_U32: 4294967295 */
+    20,  /* FMT_U64: 18446744073709551615 */
+    13,  /* FMT_F64: -1.79769e+308 */
+    8    /* FMT_X32 */
+};
+
+static const char DIGIT_PAIRS[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+static const double POW10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
 CharBuf*
 CB_new(size_t size) {
     CharBuf *self = (CharBuf*)Class_Make_Obj(CHARBUF);
@@ -69,7 +142,8 @@ CB_new(size_t size) {
 CharBuf*
 CB_init(CharBuf *self, size_t size) {
     // Derive.
-    self->ptr = (char*)MALLOCATE(size);
+    self->ptr = (char*)Arena_buf_malloc(self, size);
+    ALLOCSTATS_BUF_ALLOC(self->klass, size);
 
     // Assign.
     self->size = 0;
@@ -80,15 +154,19 @@ CB_init(CharBuf *self, size_t size) {
 
 void
 CB_Destroy_IMP(CharBuf *self) {
-    FREEMEM(self->ptr);
+    if (self->ptr) {
+        ALLOCSTATS_BUF_FREE(self->klass, self->cap);
+    }
+    Arena_buf_free(self, self->ptr);
     SUPER_DESTROY(self, CHARBUF);
 }
 
 void
 CB_Grow_IMP(CharBuf *self, size_t size) {
     if (size > self->cap) {
+        ALLOCSTATS_BUF_RESIZE(self->klass, self->cap, size);
+        self->ptr = (char*)Arena_buf_realloc(self, self->ptr, self->cap, size);
         self->cap = size;
-        self->ptr = (char*)REALLOCATE(self->ptr, size);
     }
 }
 
@@ -128,16 +206,22 @@ void
 CB_VCatF_IMP(CharBuf *self, const char *pattern, va_list args) {
     size_t      pattern_len = strlen(pattern);
     const char *pattern_end = pattern + pattern_len;
-    char        buf[64];
+    va_list     args_copy;
+
+    va_copy(args_copy, args);
 
     for (; pattern < pattern_end; pattern++) {
         const char *slice_end = pattern;
+        uint8_t     high_bits = 0;
 
-        // Consume all characters leading up to a '%'.
-        while (slice_end < pattern_end && *slice_end != '%') { slice_end++; }
+        // Consume all characters leading up to a '%'.  Only segments with
+        // non-ASCII characters have to be validated.
+        while (slice_end < pattern_end && *slice_end != '%') {
+            high_bits |= (uint8_t)*slice_end++;
+        }
         if (pattern != slice_end) {
             ptrdiff_t size = slice_end - pattern;
-            VALIDATE_UTF8(pattern, size);
+            if (high_bits & 0x80) { VALIDATE_UTF8(pattern, size); }
             S_cat_utf8(self, pattern, (size_t)size);
             pattern = slice_end;
         }
@@ -145,114 +229,171 @@ CB_VCatF_IMP(CharBuf *self, const char *pattern, va_list args) {
         if (pattern < pattern_end) {
             pattern++; // Move past '%'.
 
-            switch (*pattern) {
-                case '%': {
-                        S_cat_utf8(self, "%", 1);
-                    }
-                    break;
-                case 'o': {
-                        Obj *obj = va_arg(args, Obj*);
-                        if (!obj) {
-                            S_cat_utf8(self, "[NULL]", 6);
-                        }
-                        else if (Obj_is_a(obj, STRING)) {
-                            CB_Cat(self, (String*)obj);
-                        }
-                        else {
-                            String *string = Obj_To_String(obj);
-                            CB_Cat(self, string);
-                            DECREF(string);
-                        }
-                    }
-                    break;
-                case 'i': {
-                        int64_t val = 0;
-                        if (pattern[1] == '8') {
-                            val = va_arg(args, int32_t);
-                            pattern++;
-                        }
-                        else if (pattern[1] == '3' && pattern[2] == '2') {
-                            val = va_arg(args, int32_t);
-                            pattern += 2;
-                        }
-                        else if (pattern[1] == '6' && pattern[2] == '4') {
-                            val = va_arg(args, int64_t);
-                            pattern += 2;
-                        }
-                        else {
-                            S_die_invalid_specifier(pattern);
-                        }
-                        int size = sprintf(buf, "%" PRId64, val);
-                        S_cat_utf8(self, buf, (size_t)size);
-                    }
-                    break;
-                case 'u': {
-                        uint64_t val = 0;
-                        if (pattern[1] == '8') {
-                            val = va_arg(args, uint32_t);
-                            pattern += 1;
-                        }
-                        else if (pattern[1] == '3' && pattern[2] == '2') {
-                            val = va_arg(args, uint32_t);
-                            pattern += 2;
-                        }
-                        else if (pattern[1] == '6' && pattern[2] == '4') {
-                            val = va_arg(args, uint64_t);
-                            pattern += 2;
-                        }
-                        else {
-                            S_die_invalid_specifier(pattern);
-                        }
-                        int size = sprintf(buf, "%" PRIu64, val);
-                        S_cat_utf8(self, buf, (size_t)size);
-                    }
-                    break;
-                case 'f': {
-                        if (pattern[1] == '6' && pattern[2] == '4') {
-                            double num  = va_arg(args, double);
-                            char bigbuf[512];
-                            int size = sprintf(bigbuf, "%g", num);
-                            S_cat_utf8(self, bigbuf, (size_t)size);
-                            pattern += 2;
-                        }
-                        else {
-                            S_die_invalid_specifier(pattern);
-                        }
-                    }
-                    break;
-                case 'x': {
-                        if (pattern[1] == '3' && pattern[2] == '2') {
-                            unsigned long val = va_arg(args, uint32_t);
-                            int size = sprintf(buf, "%.8lx", val);
-                            S_cat_utf8(self, buf, (size_t)size);
-                            pattern += 2;
-                        }
-                        else {
-                            S_die_invalid_specifier(pattern);
-                        }
-                    }
-                    break;
-                case 's': {
-                        char *string = va_arg(args, char*);
-                        if (string == NULL) {
-                            S_cat_utf8(self, "[NULL]", 6);
-                        }
-                        else {
-                            size_t size = strlen(string);
-                            VALIDATE_UTF8(string, size);
-                            S_cat_utf8(self, string, size);
-                        }
-                    }
-                    break;
-                default: {
-                        // Assume NULL-terminated pattern string, which
-                        // eliminates the need for bounds checking if '%' is
-                        // the last visible character.
-                        S_die_invalid_specifier(pattern);
-                    }
+            if (*pattern == '%') {
+                S_cat_utf8(self, "%", 1);
+            }
+            else {
+                FormatOpType type = S_parse_specifier(&pattern);
+                if (type == FMT_LITERAL) {
+                    va_end(args_copy);
+                    S_die_invalid_specifier(pattern);
+                }
+                S_cat_arg(self, type, &args_copy);
             }
         }
     }
+
+    va_end(args_copy);
+}
+
+static FormatOpType
+S_parse_specifier(const char **pattern_ptr) {
+    const char   *pattern = *pattern_ptr;
+    FormatOpType  type    = FMT_LITERAL;
+
+    switch (*pattern) {
+        case 'o':
+            type = FMT_OBJ;
+            break;
+        case 's':
+            type = FMT_CSTR;
+            break;
+        case 'i':
+            if (pattern[1] == '8') {
+                type = FMT_I32;
+                pattern += 1;
+            }
+            else if (pattern[1] == '3' && pattern[2] == '2') {
+                type = FMT_I32;
+                pattern += 2;
+            }
+            else if (pattern[1] == '6' && pattern[2] == '4') {
+                type = FMT_I64;
+                pattern += 2;
+            }
+            else {
+                return FMT_LITERAL;
+            }
+            break;
+        case 'u':
+            if (pattern[1] == '8') {
+                type = FMT_U32;
+                pattern += 1;
+            }
+            else if (pattern[1] == '3' && pattern[2] == '2') {
+                type = FMT_U32;
+                pattern += 2;
+            }
+            else if (pattern[1] == '6' && pattern[2] == '4') {
+                type = FMT_U64;
+                pattern += 2;
+            }
+            else {
+                return FMT_LITERAL;
+            }
+            break;
+        case 'f':
+            if (pattern[1] == '6' && pattern[2] == '4') {
+                type = FMT_F64;
+                pattern += 2;
+            }
+            else {
+                return FMT_LITERAL;
+            }
+            break;
+        case 'x':
+            if (pattern[1] == '3' && pattern[2] == '2') {
+                type = FMT_X32;
+                pattern += 2;
+            }
+            else {
+                return FMT_LITERAL;
+            }
+            break;
+        default:
+            // Assume NULL-terminated pattern string, which eliminates the
+            // need for bounds checking if '%' is the last visible character.
+            return FMT_LITERAL;
+    }
+
+    *pattern_ptr = pattern;
+    return type;
+}
+
+static void
+S_cat_arg(CharBuf *self, FormatOpType type, va_list *args) {
+    char buf[F64_BUF_SIZE];
+
+    switch (type) {
+        case FMT_OBJ: {
+                Obj *obj = va_arg(*args, Obj*);
+                if (!obj) {
+                    SI_cat_utf8(self, "[NULL]", 6);
+                }
+                else if (Obj_is_a(obj, STRING)) {
+                    CB_Cat(self, (String*)obj);
+                }
+                else {
+                    String *string = Obj_To_String(obj);
+                    CB_Cat(self, string);
+                    DECREF(string);
+                }
+            }
+            break;
+        case FMT_CSTR: {
+                char *string = va_arg(*args, char*);
+                if (string == NULL) {
+                    SI_cat_utf8(self, "[NULL]", 6);
+                }
+                else {
+                    size_t size = strlen(string);
+                    VALIDATE_UTF8(string, size);
+                    SI_cat_utf8(self, string, size);
+                }
+            }
+            break;
+        case FMT_I32:
+        case FMT_I64: {
+                int64_t val = type == FMT_I32
+                              ? (int64_t)va_arg(*args, int32_t)
+                              : va_arg(*args, int64_t);
+                uint64_t magnitude = val < 0
+                                     ? (uint64_t)0 - (uint64_t)val
+                                     : (uint64_t)val;
+                char *end   = buf + U64_BUF_SIZE;
+                char *start = SI_format_u64(magnitude, end);
+                if (val < 0) { *--start = '-'; }
+                SI_cat_utf8(self, start, (size_t)(end - start));
+            }
+            break;
+        case FMT_U32:
+        case FMT_U64: {
+                uint64_t val = type == FMT_U32
+                               ? (uint64_t)va_arg(*args, uint32_t)
+                               : va_arg(*args, uint64_t);
+                char *end   = buf + U64_BUF_SIZE;
+                char *start = SI_format_u64(val, end);
+                SI_cat_utf8(self, start, (size_t)(end - start));
+            }
+            break;
+        case FMT_F64: {
+                double num  = va_arg(*args, double);
+                size_t size = S_format_f64(num, buf);
+                SI_cat_utf8(self, buf, size);
+            }
+            break;
+        case FMT_X32: {
+                uint32_t val = va_arg(*args, uint32_t);
+                for (int i = 7; i >= 0; i--) {
+                    buf[i] = HEX_DIGITS[val & 0xF];
+                    val >>= 4;
+                }
+                SI_cat_utf8(self, buf, 8);
+            }
+            break;
+        default:
+            THROW(ERR, "Unexpected format op: %i32", (int32_t)type);
+    }
 }
 
 String*
@@ -267,6 +408,8 @@ CB_Yield_String_IMP(CharBuf *self) {
     SI_add_grow_and_oversize(self, size, 1);
     self->ptr[size] = '\0';
 
+    // The String takes over the buffer.
+    ALLOCSTATS_BUF_FREE(self->klass, self->cap);
     String *retval = Str_new_steal_trusted_utf8(self->ptr, size);
 
     // Clear CharBuf.
@@ -368,8 +511,304 @@ S_grow_and_oversize(CharBuf *self, size_t min_size) {
         capacity = SIZE_MAX;
     }
 
+    ALLOCSTATS_BUF_RESIZE(self->klass, self->cap, capacity);
+    self->ptr = (char*)Arena_buf_realloc(self, self->ptr, self->cap,
+                                         capacity);
     self->cap = capacity;
-    self->ptr = (char*)REALLOCATE(self->ptr, capacity);
+}
+
+/******************************* FormatTemplate ****************************/
+
+FormatTemplate*
+FmtTmpl_new(const char *pattern) {
+    FormatTemplate *self = (FormatTemplate*)Class_Make_Obj(FORMATTEMPLATE);
+    return FmtTmpl_init(self, pattern);
+}
+
+FormatTemplate*
+FmtTmpl_init(FormatTemplate *self, const char *pattern) {
+    size_t      pattern_len = strlen(pattern);
+    const char *pattern_end = pattern + pattern_len;
+
+    VALIDATE_UTF8(pattern, pattern_len);
+
+    // Neither the literal text nor the number of ops can exceed the
+    // pattern length.
+    char     *literals = (char*)MALLOCATE(pattern_len + 1);
+    FormatOp *ops      = (FormatOp*)MALLOCATE((pattern_len + 1)
+                                              * sizeof(FormatOp));
+    size_t    literal_size = 0;
+    size_t    num_ops      = 0;
+    size_t    reserve      = 0;
+
+    self->literals = literals;
+    self->ops      = ops;
+    self->num_ops  = 0;
+    self->reserve  = 0;
+
+    for (; pattern < pattern_end; pattern++) {
+        size_t start = literal_size;
+
+        // Gather literal text, resolving `%%`.
+        while (pattern < pattern_end
+               && (*pattern != '%' || pattern[1] == '%')
+              ) {
+            literals[literal_size++] = *pattern;
+            pattern += *pattern == '%' ? 2 : 1;
+        }
+        if (literal_size != start) {
+            ops[num_ops].type   = FMT_LITERAL;
+            ops[num_ops].offset = start;
+            ops[num_ops].size   = literal_size - start;
+            num_ops++;
+            reserve += literal_size - start;
+        }
+
+        if (pattern < pattern_end) {
+            pattern++; // Move past '%'.
+            FormatOpType type = S_parse_specifier(&pattern);
+            if (type == FMT_LITERAL) {
+                DECREF(self);
+                S_die_invalid_specifier(pattern);
+            }
+            ops[num_ops].type   = type;
+            ops[num_ops].offset = 0;
+            ops[num_ops].size   = 0;
+            num_ops++;
+            reserve += FORMAT_MAX_SIZE[type];
+        }
+    }
+
+    self->num_ops = num_ops;
+    self->reserve = reserve;
+
+    return self;
+}
+
+void
+FmtTmpl_Destroy_IMP(FormatTemplate *self) {
+    FREEMEM(self->literals);
+    FREEMEM(self->ops);
+    SUPER_DESTROY(self, FORMATTEMPLATE);
+}
+
+// Throw an exception if `pattern` isn't a valid format pattern.
+static void
+S_validate_pattern(const char *pattern) {
+    size_t      pattern_len = strlen(pattern);
+    const char *pattern_end = pattern + pattern_len;
+
+    VALIDATE_UTF8(pattern, pattern_len);
+
+    while (pattern < pattern_end) {
+        if (*pattern != '%') {
+            pattern++;
+        }
+        else if (pattern[1] == '%') {
+            pattern += 2;
+        }
+        else {
+            pattern++; // Move past '%'.
+            if (S_parse_specifier(&pattern) == FMT_LITERAL) {
+                S_die_invalid_specifier(pattern);
+            }
+            pattern++;
+        }
+    }
+}
+
+FormatTemplate*
+FmtTmpl_cached(FormatTemplate **slot, const char *pattern) {
+    FormatTemplate *self = *slot;
+    if (self == NULL) {
+        // Cached templates live forever, so they must not be allocated
+        // from an Arena.  Validate the pattern first, so that the arena
+        // isn't left suspended if it's invalid.
+        S_validate_pattern(pattern);
+        Arena *arena = Arena_suspend();
+        self = FmtTmpl_new(pattern);
+        Arena_resume(arena);
+        if (!Atomic_cas_ptr((void*volatile*)slot, NULL, self)) {
+            // Another thread was faster.
+            DECREF(self);
+            self = *slot;
+        }
+    }
+    return self;
+}
+
+void
+FmtTmpl_catf(FormatTemplate *self, CharBuf *buf, ...) {
+    va_list args;
+    va_start(args, buf);
+    FmtTmpl_VCatF(self, buf, args);
+    va_end(args);
+}
+
+void
+FmtTmpl_VCatF_IMP(FormatTemplate *self, CharBuf *buf, va_list args) {
+    const FormatOp *ops = (const FormatOp*)self->ops;
+    va_list args_copy;
+
+    SI_add_grow_and_oversize(buf, buf->size, self->reserve);
+    va_copy(args_copy, args);
+
+    for (size_t i = 0; i < self->num_ops; i++) {
+        const FormatOp *op = &ops[i];
+        if (op->type == FMT_LITERAL) {
+            SI_cat_utf8(buf, self->literals + op->offset, op->size);
+        }
+        else {
+            S_cat_arg(buf, op->type, &args_copy);
+        }
+    }
+
+    va_end(args_copy);
+}
+
+String*
+FmtTmpl_newf(FormatTemplate *self, ...) {
+    va_list args;
+    va_start(args, self);
+    String *retval = FmtTmpl_VNewF(self, args);
+    va_end(args);
+    return retval;
+}
+
+String*
+FmtTmpl_VNewF_IMP(FormatTemplate *self, va_list args) {
+    // Leave room for the terminating NUL added by Yield_String.
+    CharBuf *buf = CB_new(self->reserve + 1);
+    FmtTmpl_VCatF(self, buf, args);
+    String *retval = CB_Yield_String(buf);
+    DECREF(buf);
+    return retval;
+}
+
+/***************************************************************************/
+
+static CFISH_INLINE char*
+SI_format_u64(uint64_t value, char *end) {
+    char *ptr = end;
+    while (value >= 100) {
+        size_t pair = (size_t)(value % 100) * 2;
+        value /= 100;
+        ptr -= 2;
+        ptr[0] = DIGIT_PAIRS[pair];
+        ptr[1] = DIGIT_PAIRS[pair + 1];
+    }
+    if (value >= 10) {
+        ptr -= 2;
+        ptr[0] = DIGIT_PAIRS[value * 2];
+        ptr[1] = DIGIT_PAIRS[value * 2 + 1];
+    }
+    else {
+        *--ptr = (char)('0' + value);
+    }
+    return ptr;
+}
+
+/* `%g` prints six significant digits.  If the double is the correctly
+ * rounded value of a decimal with six significant digits, those are the
+ * digits `%g` prints, since the decimal is much closer to the double than
+ * to the next rounding boundary.  The candidate is found by scaling with a
+ * power of ten and verified by scaling back, which is exact as long as the
+ * integer and the power of ten are both representable (Clinger's fast
+ * path).  Everything else is left to sprintf.
+ */
+static size_t
+S_format_f64(double num, char *buf) {
+    char *ptr = buf;
+    double abs_num = num < 0 ? -num : num;
+
+    if (num == 0.0) {
+        // Distinguish -0.0 without depending on libm.
+        if (1.0 / num < 0) { *ptr++ = '-'; }
+        *ptr++ = '0';
+        return (size_t)(ptr - buf);
+    }
+    if (!(abs_num >= 1e-17 && abs_num < 1e22)) {
+        // Out of range for the fast path, infinite or NaN.
+        return (size_t)sprintf(buf, "%g", num);
+    }
+
+    // Estimate the decimal exponent.
+    int exp10 = 0;
+    if (abs_num >= 1.0) {
+        while (exp10 < 21 && abs_num >= POW10[exp10 + 1]) { exp10++; }
+    }
+    else {
+        while (abs_num * POW10[-exp10] < 1.0) { exp10--; }
+    }
+
+    // Compute six significant digits, adjusting the exponent if the
+    // estimate was off.
+    uint64_t digits = 0;
+    for (int attempt = 0; attempt < 3; attempt++) {
+        int scale = exp10 - 5;
+        if (scale < -22 || scale > 22) { break; }
+        double scaled = scale >= 0 ? abs_num / POW10[scale]
+                                   : abs_num * POW10[-scale];
+        digits = (uint64_t)(scaled + 0.5);
+        if (digits >= 1000000)    { exp10++; }
+        else if (digits < 100000) { exp10--; }
+        else                      { break; }
+    }
+    int scale = exp10 - 5;
+    if (digits < 100000 || digits >= 1000000 || scale < -22 || scale > 22
+        || (scale >= 0 ? (double)digits * POW10[scale]
+                       : (double)digits / POW10[-scale]) != abs_num
+       ) {
+        return (size_t)sprintf(buf, "%g", num);
+    }
+
+    // Six digits without trailing zeros.
+    char digit_buf[U64_BUF_SIZE];
+    char *digit_end = digit_buf + U64_BUF_SIZE;
+    char *digit_ptr = SI_format_u64(digits, digit_end);
+    while (digit_end[-1] == '0') { digit_end--; }
+    int num_digits = (int)(digit_end - digit_ptr);
+
+    if (num < 0) { *ptr++ = '-'; }
+    if (exp10 < -4 || exp10 >= 6) {
+        *ptr++ = digit_ptr[0];
+        if (num_digits > 1) {
+            *ptr++ = '.';
+            memcpy(ptr, digit_ptr + 1, (size_t)num_digits - 1);
+            ptr += num_digits - 1;
+        }
+        *ptr++ = 'e';
+        *ptr++ = exp10 < 0 ? '-' : '+';
+        int abs_exp = exp10 < 0 ? -exp10 : exp10;
+        ptr[0] = DIGIT_PAIRS[abs_exp * 2];
+        ptr[1] = DIGIT_PAIRS[abs_exp * 2 + 1];
+        ptr += 2;
+    }
+    else if (exp10 >= 0) {
+        int int_digits = exp10 + 1;
+        if (num_digits <= int_digits) {
+            memcpy(ptr, digit_ptr, (size_t)num_digits);
+            ptr += num_digits;
+            for (int i = num_digits; i < int_digits; i++) { *ptr++ = '0'; }
+        }
+        else {
+            memcpy(ptr, digit_ptr, (size_t)int_digits);
+            ptr += int_digits;
+            *ptr++ = '.';
+            memcpy(ptr, digit_ptr + int_digits,
+                   (size_t)(num_digits - int_digits));
+            ptr += num_digits - int_digits;
+        }
+    }
+    else {
+        *ptr++ = '0';
+        *ptr++ = '.';
+        for (int i = -1; i > exp10; i--) { *ptr++ = '0'; }
+        memcpy(ptr, digit_ptr, (size_t)num_digits);
+        ptr += num_digits;
+    }
+
+    return (size_t)(ptr - buf);
 }
 
 static void
@@ -32,7 +32,10 @@
 #include "Clownfish/Hash.h"
 #include "Clownfish/LockFreeRegistry.h"
 #include "Clownfish/Method.h"
+#include "Clownfish/Num.h"
 #include "Clownfish/Vector.h"
+#include "Clownfish/Util/AllocStats.h"
+#include "Clownfish/Util/Arena.h"
 #include "Clownfish/Util/Atomic.h"
 #include "Clownfish/Util/Memory.h"
 
@@ -42,6 +45,7 @@
 #define ClassSpec                cfish_ClassSpec
 
 uint32_t Class_offset_of_parent = offsetof(Class, parent);
+uint32_t Class_offset_of_flags  = offsetof(Class, flags);
 
 static void
 S_set_name(Class *self, const char *utf8, size_t size);
@@ -49,6 +53,9 @@ S_set_name(Class *self, const char *utf8, size_t size);
 static Method*
 S_find_method(Class *self, const char *meth_name);
 
+static void
+S_init_display(Class *self, Class *parent);
+
 static LockFreeRegistry *Class_registry;
 cfish_Class_bootstrap_hook1_t cfish_Class_bootstrap_hook1;
 
@@ -133,6 +140,8 @@ Class_bootstrap(const cfish_ParcelSpec *parcel_spec) {
 
         klass->parent      = parent;
         klass->parcel_spec = parcel_spec;
+        S_init_display(klass, parent);
+        AllocStats_register_class(klass);
 
         // CLASS->obj_alloc_size must stay at 0.
         if (klass != CLASS) {
@@ -243,6 +252,23 @@ Class_bootstrap(const cfish_ParcelSpec *parcel_spec) {
     }
 }
 
+/* Record the depth of the class and its ancestors indexed by depth, so that
+ * Obj_is_a can check for an ancestor at a known depth with a single load.
+ */
+static void
+S_init_display(Class *self, Class *parent) {
+    self->depth = parent ? parent->depth + 1 : 0;
+
+    // Assign every element separately.  Class_bootstrap may run in several
+    // threads at once, so the display must never be cleared temporarily.
+    for (uint32_t i = 0; i < CFISH_CLASS_DISPLAY_SIZE; i++) {
+        Class *ancestor = NULL;
+        if (i < self->depth)       { ancestor = parent->display[i]; }
+        else if (i == self->depth) { ancestor = self; }
+        self->display[i] = ancestor;
+    }
+}
+
 void
 Class_Destroy_IMP(Class *self) {
     THROW(ERR, "Insane attempt to destroy Class for class '%o'", self->name);
@@ -255,6 +281,12 @@ Class_Override_IMP(Class *self, cfish_method_t method, uint32_t offset) {
     pointer.func_ptr[0] = method;
 }
 
+void
+Class_Enable_Atomic_Refcount_IMP(Class *self) {
+    // Special refcounting keeps instances off the inline fast path.
+    self->flags |= CFISH_fREFCOUNTSPECIAL | CFISH_fATOMICREFCOUNT;
+}
+
 String*
 Class_Get_Name_IMP(Class *self) {
     return self->name;
@@ -307,6 +339,8 @@ S_subclass_from_host(Class *parent, String *name) {
     subclass->obj_alloc_size   = parent->obj_alloc_size;
     subclass->class_alloc_size = parent->class_alloc_size;
     subclass->methods          = (Method**)CALLOCATE(1, sizeof(Method*));
+    S_init_display(subclass, parent);
+    AllocStats_register_class(subclass);
 
     S_set_name(subclass, Str_Get_Ptr8(name), Str_Get_Size(name));
 
@@ -456,11 +490,14 @@ S_set_name(Class *self, const char *utf8, size_t size) {
     /*
      * We use a "wrapped" String for `name` because it's effectively
      * threadsafe: the sole reference is owned by an immortal object and any
-     * INCREF spawns a copy.
+     * INCREF spawns a copy.  Classes live forever, so the names must not
+     * be allocated from an Arena.
      */
+    Arena *arena = Arena_suspend();
     self->name_internal = Str_new_from_trusted_utf8(utf8, size);
     self->name = Str_new_wrap_trusted_utf8(Str_Get_Ptr8(self->name_internal),
                                            Str_Get_Size(self->name_internal));
+    Arena_resume(arena);
 }
 
 static Method*
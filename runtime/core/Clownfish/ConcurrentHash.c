@@ -0,0 +1,713 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_CFISH_CONCURRENTHASH
+#define CFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Class.h"
+
+#include "Clownfish/ConcurrentHash.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Util/Arena.h"
+#include "Clownfish/Util/Atomic.h"
+#include "Clownfish/Util/Memory.h"
+
+/* The table is an array of buckets, each holding a linked list of nodes.
+ * Readers traverse the lists without taking any locks, so a node is never
+ * modified once it has been published except for its `next` pointer.
+ * Replacing a value links a new node in place of the old one.
+ *
+ * Writers lock the stripe `hash_sum % NUM_STRIPES`.  The capacity is always
+ * a multiple of NUM_STRIPES, so all keys in a bucket belong to the same
+ * stripe, in every table.
+ *
+ * To grow, a table of twice the size is attached as `next`.  Every write
+ * then copies a few buckets into the new table and replaces them with the
+ * MOVED marker, which sends readers and writers on to the new table.  Once
+ * all buckets have been moved, the new table becomes the current one.
+ *
+ * Unlinked nodes and old tables are retired together with the epoch at the
+ * time of retirement.  Every operation registers with the counter for the
+ * parity of the current epoch while it runs.  The epoch is only advanced
+ * from `e` to `e + 1` once the counter of epoch `e - 1` has drained, at
+ * which point no operation can still access memory retired before epoch
+ * `e`.
+ */
+#define NUM_STRIPES         64
+#define MIGRATE_BATCH       4
+#define RECLAIM_THRESHOLD   64
+#define CACHE_LINE_SIZE     64
+
+#define LIMBO_NODE          1  /* node which owns its key and value */
+#define LIMBO_MOVED_NODE    2  /* node whose key and value were moved */
+#define LIMBO_TABLE         3
+#define LIMBO_VALUE_NODE    4  /* node whose key was moved */
+
+#define CHashLimbo    cfish_CHashLimbo
+#define CHashNode     cfish_CHashNode
+#define CHashTable    cfish_CHashTable
+#define CHashStripe   cfish_CHashStripe
+#define CHashReclaim  cfish_CHashReclaim
+
+typedef struct CHashLimbo {
+    struct CHashLimbo *next;
+    size_t             epoch;
+    int                kind;
+} CHashLimbo;
+
+typedef struct CHashNode {
+    CHashLimbo                 limbo;
+    String                    *key;
+    Obj                       *value;
+    size_t                     hash_sum;
+    struct CHashNode *volatile next;
+} CHashNode;
+
+typedef struct CHashTable {
+    CHashLimbo                  limbo;
+    size_t                      capacity;
+    CHashNode *volatile        *buckets;
+    struct CHashTable *volatile next;         /* table being migrated to */
+    volatile size_t             migrate_pos;  /* next bucket to move */
+    volatile size_t             num_migrated;
+} CHashTable;
+
+typedef struct CHashStripe {
+    void *volatile lock;
+    size_t         size;
+    char           padding[CACHE_LINE_SIZE - sizeof(void*) - sizeof(size_t)];
+} CHashStripe;
+
+typedef struct CHashReclaim {
+    volatile size_t      epoch;
+    volatile size_t      readers[2];
+    CHashLimbo *volatile retired;
+    volatile size_t      num_retired;
+    void *volatile       lock;
+} CHashReclaim;
+
+static CHashNode moved_sentinel;
+#define MOVED (&moved_sentinel)
+
+static CFISH_INLINE size_t
+SI_atomic_add(volatile size_t *target, size_t delta) {
+    size_t old_value;
+    do {
+        old_value = *target;
+    } while (!Atomic_cas_size(target, old_value, old_value + delta));
+    return old_value + delta;
+}
+
+static CFISH_INLINE void
+SI_lock(void *volatile *lock) {
+    while (!Atomic_cas_ptr(lock, NULL, (void*)lock)) {
+        while (*lock != NULL) { /* spin */ }
+    }
+}
+
+static CFISH_INLINE void
+SI_unlock(void *volatile *lock) {
+    Atomic_cas_ptr(lock, (void*)lock, NULL);
+}
+
+// Make sure that a node is fully initialized before it can be reached
+// through `slot`.
+static CFISH_INLINE void
+SI_publish(CHashNode *volatile *slot, CHashNode *node) {
+    Atomic_fence();
+    *slot = node;
+}
+
+static CFISH_INLINE CHashTable*
+SI_current_table(ConcurrentHash *self) {
+    return *(CHashTable *volatile*)&self->table;
+}
+
+static CFISH_INLINE CHashStripe*
+SI_stripe(ConcurrentHash *self, size_t hash_sum) {
+    return (CHashStripe*)self->stripes + (hash_sum & (NUM_STRIPES - 1));
+}
+
+// Return the bucket which currently holds the keys for `hash_sum`.
+static CFISH_INLINE CHashNode *volatile*
+SI_live_bucket(CHashTable *table, size_t hash_sum) {
+    while (1) {
+        CHashNode *volatile *bucket
+            = table->buckets + (hash_sum & (table->capacity - 1));
+        if (*bucket != MOVED) { return bucket; }
+        table = table->next;
+    }
+}
+
+static CFISH_INLINE bool
+SI_matches(CHashNode *node, String *key, size_t hash_sum) {
+    return node->hash_sum == hash_sum && Str_Equals(key, (Obj*)node->key);
+}
+
+static CHashTable*
+S_new_table(size_t capacity) {
+    CHashTable *table = (CHashTable*)CALLOCATE(1, sizeof(CHashTable));
+    table->limbo.kind = LIMBO_TABLE;
+    table->capacity   = capacity;
+    table->buckets
+        = (CHashNode *volatile*)CALLOCATE(capacity, sizeof(CHashNode*));
+    return table;
+}
+
+static CHashNode*
+S_new_node(String *key, Obj *value, size_t hash_sum) {
+    CHashNode *node = (CHashNode*)MALLOCATE(sizeof(CHashNode));
+    node->key      = key;
+    node->value    = value;
+    node->hash_sum = hash_sum;
+    node->next     = NULL;
+    return node;
+}
+
+// Register the calling thread as accessing the hash and return the epoch
+// which must be passed to S_leave.
+static size_t
+S_enter(CHashReclaim *reclaim);
+
+static void
+S_leave(CHashReclaim *reclaim, size_t epoch);
+
+static void
+S_retire(CHashReclaim *reclaim, CHashLimbo *limbo, int kind);
+
+// Free retired memory which can no longer be accessed, if enough has
+// accumulated and no other thread is already doing so.
+static void
+S_maybe_reclaim(CHashReclaim *reclaim);
+
+static void
+S_free_limbo(CHashLimbo *limbo);
+
+// Move a few buckets if the table is growing.
+static void
+S_help_migrate(ConcurrentHash *self);
+
+static void
+S_start_growth(ConcurrentHash *self);
+
+ConcurrentHash*
+CHash_new(size_t capacity) {
+    ConcurrentHash *self = (ConcurrentHash*)Class_Make_Obj(CONCURRENTHASH);
+    return CHash_init(self, capacity);
+}
+
+ConcurrentHash*
+CHash_init(ConcurrentHash *self, size_t min_capacity) {
+    size_t capacity = NUM_STRIPES;
+    while (capacity < min_capacity
+           && capacity <= SIZE_MAX / 2 / sizeof(CHashNode*)
+          ) {
+        capacity *= 2;
+    }
+
+    self->table   = S_new_table(capacity);
+    self->stripes = CALLOCATE(NUM_STRIPES, sizeof(CHashStripe));
+    self->reclaim = CALLOCATE(1, sizeof(CHashReclaim));
+
+    return self;
+}
+
+static void
+S_free_chains(CHashTable *table) {
+    for (size_t tick = 0; tick < table->capacity; tick++) {
+        CHashNode *node = table->buckets[tick];
+        if (node == MOVED) { continue; }
+        while (node) {
+            CHashNode *next = node->next;
+            DECREF(node->key);
+            DECREF(node->value);
+            FREEMEM(node);
+            node = next;
+        }
+    }
+}
+
+void
+CHash_Destroy_IMP(ConcurrentHash *self) {
+    CHashTable *table = (CHashTable*)self->table;
+    if (table) {
+        S_free_chains(table);
+        if (table->next) {
+            S_free_chains(table->next);
+            S_free_limbo(&table->next->limbo);
+        }
+        S_free_limbo(&table->limbo);
+    }
+
+    CHashReclaim *reclaim = (CHashReclaim*)self->reclaim;
+    if (reclaim) {
+        CHashLimbo *limbo = reclaim->retired;
+        while (limbo) {
+            CHashLimbo *next = limbo->next;
+            S_free_limbo(limbo);
+            limbo = next;
+        }
+        FREEMEM(reclaim);
+    }
+
+    FREEMEM(self->stripes);
+    SUPER_DESTROY(self, CONCURRENTHASH);
+}
+
+static void
+S_traverse_chains(CHashTable *table, Obj_Visit_t visit, void *context) {
+    for (size_t tick = 0; tick < table->capacity; tick++) {
+        CHashNode *node = table->buckets[tick];
+        if (node == MOVED) { continue; }
+        for (; node != NULL; node = node->next) {
+            visit(context, (Obj*)node->key);
+            if (node->value) { visit(context, node->value); }
+        }
+    }
+}
+
+// Must not be called concurrently with writers.
+void
+CHash_Traverse_IMP(ConcurrentHash *self, Obj_Visit_t visit, void *context) {
+    CHashTable *table = (CHashTable*)self->table;
+    if (table) {
+        S_traverse_chains(table, visit, context);
+        if (table->next) {
+            S_traverse_chains(table->next, visit, context);
+        }
+    }
+
+    // Retired nodes keep their references until they're reclaimed.
+    CHashReclaim *reclaim = (CHashReclaim*)self->reclaim;
+    if (reclaim) {
+        for (CHashLimbo *limbo = reclaim->retired;
+             limbo != NULL;
+             limbo = limbo->next
+            ) {
+            CHashNode *node = (CHashNode*)limbo;
+            if (limbo->kind == LIMBO_NODE) {
+                visit(context, (Obj*)node->key);
+            }
+            if ((limbo->kind == LIMBO_NODE || limbo->kind == LIMBO_VALUE_NODE)
+                && node->value
+               ) {
+                visit(context, node->value);
+            }
+        }
+    }
+}
+
+// Copy a key to be owned by the hash.  Since the copy lives as long as the
+// entry, it must not be allocated from an Arena.
+static String*
+S_copy_key(String *key) {
+    Arena  *arena = Arena_suspend();
+    String *copy  = Str_new_from_trusted_utf8(Str_Get_Ptr8(key),
+                                              Str_Get_Size(key));
+    Arena_resume(arena);
+    return copy;
+}
+
+void
+CHash_Store_IMP(ConcurrentHash *self, String *key, Obj *value) {
+    size_t     hash_sum = Str_Hash_Sum(key);
+    CHashNode *node     = S_new_node(NULL, value, hash_sum);
+
+    CHashReclaim *reclaim = (CHashReclaim*)self->reclaim;
+    size_t        epoch   = S_enter(reclaim);
+    S_help_migrate(self);
+
+    // Overwriting reuses the key of the existing entry, so only copy the
+    // key up front if it isn't present yet.
+    CHashNode *found = *SI_live_bucket(SI_current_table(self), hash_sum);
+    while (found && !SI_matches(found, key, hash_sum)) {
+        found = found->next;
+    }
+    String *key_copy = found ? NULL : S_copy_key(key);
+
+    CHashStripe *stripe = SI_stripe(self, hash_sum);
+    SI_lock(&stripe->lock);
+
+    CHashTable           *table  = SI_current_table(self);
+    CHashNode *volatile  *bucket = SI_live_bucket(table, hash_sum);
+    CHashNode *volatile  *link   = bucket;
+    CHashNode            *old    = NULL;
+    for (CHashNode *cur = *link; cur != NULL; cur = *link) {
+        if (SI_matches(cur, key, hash_sum)) {
+            old = cur;
+            break;
+        }
+        link = &cur->next;
+    }
+
+    bool grow = false;
+    if (old) {
+        node->key  = old->key;
+        node->next = old->next;
+        SI_publish(link, node);
+    }
+    else {
+        // The key may have been deleted by another thread in the meantime.
+        if (!key_copy) { key_copy = S_copy_key(key); }
+        node->key  = key_copy;
+        key_copy   = NULL;
+        node->next = *bucket;
+        SI_publish(bucket, node);
+        stripe->size++;
+        grow = stripe->size > table->capacity / NUM_STRIPES;
+    }
+
+    SI_unlock(&stripe->lock);
+
+    // Another thread may have inserted the key in the meantime.
+    DECREF(key_copy);
+
+    if (old)  { S_retire(reclaim, &old->limbo, LIMBO_VALUE_NODE); }
+    if (grow) { S_start_growth(self); }
+    S_leave(reclaim, epoch);
+    S_maybe_reclaim(reclaim);
+}
+
+Obj*
+CHash_Fetch_IMP(ConcurrentHash *self, String *key) {
+    size_t        hash_sum = Str_Hash_Sum(key);
+    CHashReclaim *reclaim  = (CHashReclaim*)self->reclaim;
+    size_t        epoch    = S_enter(reclaim);
+    Obj          *value    = NULL;
+
+    CHashNode *node = *SI_live_bucket(SI_current_table(self), hash_sum);
+    for (; node != NULL; node = node->next) {
+        if (SI_matches(node, key, hash_sum)) {
+            value = INCREF(node->value);
+            break;
+        }
+    }
+
+    S_leave(reclaim, epoch);
+    return value;
+}
+
+Obj*
+CHash_Fetch_Utf8_IMP(ConcurrentHash *self, const char *key, size_t key_len) {
+    String *key_buf = SSTR_WRAP_UTF8(key, key_len);
+    return CHash_Fetch_IMP(self, key_buf);
+}
+
+bool
+CHash_Has_Key_IMP(ConcurrentHash *self, String *key) {
+    size_t        hash_sum = Str_Hash_Sum(key);
+    CHashReclaim *reclaim  = (CHashReclaim*)self->reclaim;
+    size_t        epoch    = S_enter(reclaim);
+    bool          found    = false;
+
+    CHashNode *node = *SI_live_bucket(SI_current_table(self), hash_sum);
+    for (; node != NULL; node = node->next) {
+        if (SI_matches(node, key, hash_sum)) {
+            found = true;
+            break;
+        }
+    }
+
+    S_leave(reclaim, epoch);
+    return found;
+}
+
+Obj*
+CHash_Delete_IMP(ConcurrentHash *self, String *key) {
+    size_t        hash_sum = Str_Hash_Sum(key);
+    CHashReclaim *reclaim  = (CHashReclaim*)self->reclaim;
+    size_t        epoch    = S_enter(reclaim);
+    S_help_migrate(self);
+
+    CHashStripe *stripe = SI_stripe(self, hash_sum);
+    SI_lock(&stripe->lock);
+
+    CHashNode *volatile *link
+        = SI_live_bucket(SI_current_table(self), hash_sum);
+    CHashNode *old   = NULL;
+    Obj       *value = NULL;
+    for (CHashNode *cur = *link; cur != NULL; cur = *link) {
+        if (SI_matches(cur, key, hash_sum)) {
+            old = cur;
+            break;
+        }
+        link = &cur->next;
+    }
+
+    if (old) {
+        *link = old->next;
+        stripe->size--;
+        value = INCREF(old->value);
+    }
+
+    SI_unlock(&stripe->lock);
+
+    if (old) { S_retire(reclaim, &old->limbo, LIMBO_NODE); }
+    S_leave(reclaim, epoch);
+    S_maybe_reclaim(reclaim);
+    return value;
+}
+
+static void
+S_collect_keys(CHashTable *table, size_t tick, Vector *keys) {
+    CHashNode *node = table->buckets[tick];
+    if (node == MOVED) {
+        // The bucket was split in two.
+        S_collect_keys(table->next, tick, keys);
+        S_collect_keys(table->next, tick + table->capacity, keys);
+        return;
+    }
+    for (; node != NULL; node = node->next) {
+        // Return copies, so that the refcounts of the keys are only
+        // touched by writers.
+        Vec_Push(keys, (Obj*)Str_new_from_trusted_utf8(
+                                Str_Get_Ptr8(node->key),
+                                Str_Get_Size(node->key)));
+    }
+}
+
+Vector*
+CHash_Keys_IMP(ConcurrentHash *self) {
+    Vector       *keys    = Vec_new(CHash_Get_Size(self));
+    CHashReclaim *reclaim = (CHashReclaim*)self->reclaim;
+    size_t        epoch   = S_enter(reclaim);
+
+    CHashTable *table = SI_current_table(self);
+    for (size_t tick = 0; tick < table->capacity; tick++) {
+        S_collect_keys(table, tick, keys);
+    }
+
+    S_leave(reclaim, epoch);
+    return keys;
+}
+
+size_t
+CHash_Get_Size_IMP(ConcurrentHash *self) {
+    CHashStripe *stripes = (CHashStripe*)self->stripes;
+    size_t       size    = 0;
+    for (size_t i = 0; i < NUM_STRIPES; i++) {
+        size += *(volatile size_t*)&stripes[i].size;
+    }
+    return size;
+}
+
+size_t
+CHash_Get_Capacity_IMP(ConcurrentHash *self) {
+    return SI_current_table(self)->capacity;
+}
+
+/***************************** Growth *************************************/
+
+static void
+S_start_growth(ConcurrentHash *self) {
+    CHashTable *table = SI_current_table(self);
+    if (table->next != NULL) { return; } // Already growing.
+    if (table->capacity > SIZE_MAX / 2 / sizeof(CHashNode*)) {
+        THROW(ERR, "ConcurrentHash grew too large");
+    }
+
+    CHashTable *next = S_new_table(table->capacity * 2);
+    if (!Atomic_cas_ptr((void *volatile*)&table->next, NULL, next)) {
+        // Another thread was faster.
+        S_free_limbo(&next->limbo);
+    }
+}
+
+// Copy the nodes in bucket `tick` of `table` into the two buckets of the
+// next table that they are split into, then mark the bucket as moved.
+static void
+S_migrate_bucket(ConcurrentHash *self, CHashTable *table, size_t tick) {
+    CHashTable  *next   = table->next;
+    CHashStripe *stripe = (CHashStripe*)self->stripes
+                          + (tick & (NUM_STRIPES - 1));
+    CHashNode   *low    = NULL;
+    CHashNode   *high   = NULL;
+
+    SI_lock(&stripe->lock);
+
+    CHashNode *old_chain = table->buckets[tick];
+    for (CHashNode *node = old_chain; node != NULL; node = node->next) {
+        CHashNode *copy = S_new_node(node->key, node->value, node->hash_sum);
+        if (node->hash_sum & table->capacity) {
+            copy->next = high;
+            high       = copy;
+        }
+        else {
+            copy->next = low;
+            low        = copy;
+        }
+    }
+
+    // Nothing can reach the target buckets before the old one is marked.
+    next->buckets[tick]                   = low;
+    next->buckets[tick + table->capacity] = high;
+    SI_publish(table->buckets + tick, MOVED);
+
+    SI_unlock(&stripe->lock);
+
+    CHashReclaim *reclaim = (CHashReclaim*)self->reclaim;
+    while (old_chain) {
+        CHashNode *following = old_chain->next;
+        S_retire(reclaim, &old_chain->limbo, LIMBO_MOVED_NODE);
+        old_chain = following;
+    }
+}
+
+static void
+S_help_migrate(ConcurrentHash *self) {
+    CHashTable *table = SI_current_table(self);
+    if (table->next == NULL) { return; }
+
+    uint32_t num_moved = 0;
+    while (num_moved < MIGRATE_BATCH) {
+        size_t tick = table->migrate_pos;
+        if (tick >= table->capacity) { return; }
+        if (!Atomic_cas_size(&table->migrate_pos, tick, tick + 1)) {
+            continue;
+        }
+
+        S_migrate_bucket(self, table, tick);
+        num_moved++;
+
+        if (SI_atomic_add(&table->num_migrated, 1) == table->capacity) {
+            // All buckets moved.  Switch to the new table.
+            Atomic_cas_ptr((void *volatile*)&self->table, table,
+                           table->next);
+            S_retire((CHashReclaim*)self->reclaim, &table->limbo,
+                     LIMBO_TABLE);
+            return;
+        }
+    }
+}
+
+/***************************** Reclamation ********************************/
+
+static size_t
+S_enter(CHashReclaim *reclaim) {
+    while (1) {
+        size_t epoch = reclaim->epoch;
+        SI_atomic_add(&reclaim->readers[epoch & 1], 1);
+        Atomic_fence();
+        if (reclaim->epoch == epoch) { return epoch; }
+        // The epoch was advanced in the meantime.
+        SI_atomic_add(&reclaim->readers[epoch & 1], (size_t)-1);
+    }
+}
+
+static void
+S_leave(CHashReclaim *reclaim, size_t epoch) {
+    SI_atomic_add(&reclaim->readers[epoch & 1], (size_t)-1);
+}
+
+static void
+S_retire(CHashReclaim *reclaim, CHashLimbo *limbo, int kind) {
+    // The epoch must be read after the memory was made unreachable.
+    Atomic_fence();
+    limbo->epoch = reclaim->epoch;
+    limbo->kind  = kind;
+
+    CHashLimbo *head;
+    do {
+        head        = reclaim->retired;
+        limbo->next = head;
+    } while (!Atomic_cas_ptr((void *volatile*)&reclaim->retired, head,
+                             limbo));
+
+    SI_atomic_add(&reclaim->num_retired, 1);
+}
+
+static void
+S_maybe_reclaim(CHashReclaim *reclaim) {
+    if (reclaim->num_retired < RECLAIM_THRESHOLD) { return; }
+    if (!Atomic_cas_ptr(&reclaim->lock, NULL, reclaim)) { return; }
+
+    size_t epoch = reclaim->epoch;
+    Atomic_fence();
+
+    // Epochs `epoch - 1` and `epoch + 1` share a counter.
+    if (reclaim->readers[(epoch + 1) & 1] == 0) {
+        CHashLimbo *list;
+        do {
+            list = reclaim->retired;
+        } while (!Atomic_cas_ptr((void *volatile*)&reclaim->retired, list,
+                                 NULL));
+
+        CHashLimbo *keep      = NULL;
+        CHashLimbo *keep_tail = NULL;
+        size_t      num_freed = 0;
+        while (list) {
+            CHashLimbo *next = list->next;
+            if (list->epoch < epoch) {
+                S_free_limbo(list);
+                num_freed++;
+            }
+            else {
+                if (!keep) { keep_tail = list; }
+                list->next = keep;
+                keep       = list;
+            }
+            list = next;
+        }
+
+        if (keep) {
+            CHashLimbo *head;
+            do {
+                head            = reclaim->retired;
+                keep_tail->next = head;
+            } while (!Atomic_cas_ptr((void *volatile*)&reclaim->retired,
+                                     head, keep));
+        }
+
+        SI_atomic_add(&reclaim->num_retired, (size_t)0 - num_freed);
+        Atomic_cas_size(&reclaim->epoch, epoch, epoch + 1);
+    }
+
+    Atomic_cas_ptr(&reclaim->lock, reclaim, NULL);
+}
+
+static void
+S_free_limbo(CHashLimbo *limbo) {
+    switch (limbo->kind) {
+        case LIMBO_NODE: {
+                CHashNode *node = (CHashNode*)limbo;
+                DECREF(node->key);
+                DECREF(node->value);
+                FREEMEM(node);
+            }
+            break;
+        case LIMBO_VALUE_NODE: {
+                CHashNode *node = (CHashNode*)limbo;
+                DECREF(node->value);
+                FREEMEM(node);
+            }
+            break;
+        case LIMBO_MOVED_NODE:
+            FREEMEM(limbo);
+            break;
+        case LIMBO_TABLE: {
+                CHashTable *table = (CHashTable*)limbo;
+                FREEMEM((void*)table->buckets);
+                FREEMEM(table);
+            }
+            break;
+        default:
+            THROW(ERR, "Unknown limbo kind: %i32", (int32_t)limbo->kind);
+    }
+}
+
+
@@ -49,6 +49,11 @@ Err_Destroy_IMP(Err *self) {
     SUPER_DESTROY(self, ERR);
 }
 
+void
+Err_Traverse_IMP(Err *self, Obj_Visit_t visit, void *context) {
+    if (self->mess) { visit(context, (Obj*)self->mess); }
+}
+
 String*
 Err_To_String_IMP(Err *self) {
     return (String*)INCREF(self->mess);
@@ -0,0 +1,504 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_CFISH_FROZENHASH
+#define CFISH_USE_SHORT_NAMES
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "Clownfish/Class.h"
+
+#include "Clownfish/FrozenHash.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/HashIterator.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Util/Memory.h"
+
+/* Keys are placed with a "hash and displace" minimal perfect hash function
+ * (CHD).  Every distinct hash sum is mapped to a bucket and to two values
+ * `f1` and `f2` in the range [0, num_slots).  Each bucket has a pair of
+ * displacements `(d0, d1)` chosen at build time so that the slots
+ *
+ *     (f1 + d0 * f2 + d1) % num_slots
+ *
+ * of all hash sums in the bucket are distinct and unused by other buckets.
+ * Buckets are placed from largest to smallest while the table is still
+ * sparse.
+ *
+ * The function is computed from the cached hash sum of the key, so keys
+ * which share a hash sum end up in the same slot.  Entries are ordered by
+ * slot, and `slots` holds the index of the first entry of every slot.  In
+ * practice, a slot holds a single entry and a lookup requires exactly one
+ * key comparison.
+ */
+#define BUCKET_LOAD   2
+#define MAX_SEEDS     64
+
+#define FrozenHashEntry cfish_FrozenHashEntry
+
+typedef struct FrozenHashEntry {
+    String     *key;
+    Obj        *value;
+    size_t      hash_sum;
+    const char *key_ptr;   /* points into the arena */
+    size_t      key_size;
+} FrozenHashEntry;
+
+typedef struct {
+    uint32_t bucket;
+    uint32_t f1;
+    uint32_t f2;
+} SlotHash;
+
+static CFISH_INLINE uint64_t
+SI_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= UINT64_C(0xBF58476D1CE4E5B9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94D049BB133111EB);
+    x ^= x >> 31;
+    return x;
+}
+
+// Map `x` onto [0, range) without a division.
+static CFISH_INLINE uint32_t
+SI_reduce(uint32_t x, uint32_t range) {
+    return (uint32_t)(((uint64_t)x * range) >> 32);
+}
+
+static CFISH_INLINE SlotHash
+SI_slot_hash(FrozenHash *self, size_t hash_sum) {
+    uint64_t x1 = SI_mix((uint64_t)hash_sum ^ self->seed);
+    uint64_t x2 = SI_mix(x1 + UINT64_C(0x9E3779B97F4A7C15));
+    SlotHash sh;
+    sh.bucket = SI_reduce((uint32_t)x1, self->num_buckets);
+    sh.f1     = SI_reduce((uint32_t)(x1 >> 32), self->num_slots);
+    sh.f2     = SI_reduce((uint32_t)x2, self->num_slots);
+    return sh;
+}
+
+static CFISH_INLINE uint32_t
+SI_slot(uint32_t num_slots, SlotHash sh, uint32_t d0, uint32_t d1) {
+    return (uint32_t)((sh.f1 + (uint64_t)d0 * sh.f2 + d1) % num_slots);
+}
+
+static int
+S_compare_hash_sums(const void *va, const void *vb) {
+    const FrozenHashEntry *a = (const FrozenHashEntry*)va;
+    const FrozenHashEntry *b = (const FrozenHashEntry*)vb;
+    return a->hash_sum < b->hash_sum ? -1
+           : a->hash_sum > b->hash_sum ? 1
+           : 0;
+}
+
+// Try to find displacements for all buckets with the current seed.
+static bool
+S_place_buckets(FrozenHash *self, SlotHash *hashes, uint32_t *bucket_starts,
+                uint32_t *members, uint32_t *order, uint8_t *taken,
+                uint32_t *positions);
+
+// Compute the perfect hash function for the `num_slots` distinct hash sums
+// in `hash_sums` and store the slot of each in `slot_of`.
+static void
+S_build_function(FrozenHash *self, const size_t *hash_sums,
+                 uint32_t *slot_of);
+
+FrozenHash*
+FrozenHash_new(Hash *hash) {
+    FrozenHash *self = (FrozenHash*)Class_Make_Obj(FROZENHASH);
+    return FrozenHash_init(self, hash);
+}
+
+FrozenHash*
+FrozenHash_init(FrozenHash *self, Hash *hash) {
+    size_t size = Hash_Get_Size(hash);
+    if (size >= UINT32_MAX) {
+        THROW(ERR, "Hash too large to freeze: %u64", (uint64_t)size);
+    }
+
+    // Copy the entries, ordered by hash sum.
+    FrozenHashEntry *sorted
+        = (FrozenHashEntry*)CALLOCATE(size + 1, sizeof(FrozenHashEntry));
+    size_t arena_size = 0;
+    size_t num_hashes = 0;
+    {
+        HashIterator *iter = HashIter_new(hash);
+        size_t        i    = 0;
+        while (HashIter_Next(iter)) {
+            String *key = HashIter_Get_Key(iter);
+            sorted[i].key      = (String*)INCREF(key);
+            sorted[i].value    = INCREF(HashIter_Get_Value(iter));
+            sorted[i].hash_sum = Str_Hash_Sum(key);
+            sorted[i].key_size = Str_Get_Size(key);
+            arena_size += sorted[i].key_size;
+            i++;
+        }
+        DECREF(iter);
+    }
+    qsort(sorted, size, sizeof(FrozenHashEntry), S_compare_hash_sums);
+
+    size_t *hash_sums = (size_t*)MALLOCATE((size + 1) * sizeof(size_t));
+    for (size_t i = 0; i < size; i++) {
+        if (i == 0 || sorted[i].hash_sum != sorted[i - 1].hash_sum) {
+            hash_sums[num_hashes++] = sorted[i].hash_sum;
+        }
+    }
+
+    // Init.
+    self->size        = size;
+    self->num_slots   = (uint32_t)num_hashes;
+    self->num_buckets = (uint32_t)((num_hashes + BUCKET_LOAD - 1)
+                                   / BUCKET_LOAD);
+    if (self->num_buckets == 0) { self->num_buckets = 1; }
+    self->disps = (uint32_t*)CALLOCATE(2 * self->num_buckets,
+                                       sizeof(uint32_t));
+    self->slots = (uint32_t*)CALLOCATE(num_hashes + 1, sizeof(uint32_t));
+    self->arena = (char*)MALLOCATE(arena_size + 1);
+
+    uint32_t *slot_of = (uint32_t*)MALLOCATE((num_hashes + 1)
+                                             * sizeof(uint32_t));
+    S_build_function(self, hash_sums, slot_of);
+
+    // Count the entries in every slot and turn the counts into offsets.
+    for (size_t i = 0, h = 0; i < size; i++) {
+        if (i > 0 && sorted[i].hash_sum != sorted[i - 1].hash_sum) { h++; }
+        self->slots[slot_of[h] + 1]++;
+    }
+    for (size_t s = 0; s < num_hashes; s++) {
+        self->slots[s + 1] += self->slots[s];
+    }
+
+    // Order the entries by slot and pack the keys into the arena.
+    FrozenHashEntry *entries
+        = (FrozenHashEntry*)CALLOCATE(size + 1, sizeof(FrozenHashEntry));
+    uint32_t *fill = (uint32_t*)MALLOCATE((num_hashes + 1)
+                                          * sizeof(uint32_t));
+    memcpy(fill, self->slots, num_hashes * sizeof(uint32_t));
+    char *arena_ptr = self->arena;
+    for (size_t i = 0, h = 0; i < size; i++) {
+        if (i > 0 && sorted[i].hash_sum != sorted[i - 1].hash_sum) { h++; }
+        FrozenHashEntry *entry = entries + fill[slot_of[h]]++;
+        *entry = sorted[i];
+        memcpy(arena_ptr, Str_Get_Ptr8(entry->key), entry->key_size);
+        entry->key_ptr = arena_ptr;
+        arena_ptr += entry->key_size;
+    }
+    self->entries = entries;
+
+    FREEMEM(fill);
+    FREEMEM(slot_of);
+    FREEMEM(hash_sums);
+    FREEMEM(sorted);
+
+    return self;
+}
+
+static void
+S_build_function(FrozenHash *self, const size_t *hash_sums,
+                 uint32_t *slot_of) {
+    const uint32_t num_hashes  = self->num_slots;
+    const uint32_t num_buckets = self->num_buckets;
+
+    SlotHash *hashes
+        = (SlotHash*)MALLOCATE((num_hashes + 1) * sizeof(SlotHash));
+    uint32_t *bucket_starts
+        = (uint32_t*)MALLOCATE((num_buckets + 1) * sizeof(uint32_t));
+    uint32_t *members
+        = (uint32_t*)MALLOCATE((num_hashes + 1) * sizeof(uint32_t));
+    uint32_t *order
+        = (uint32_t*)MALLOCATE(num_buckets * sizeof(uint32_t));
+    uint8_t  *taken     = (uint8_t*)MALLOCATE(num_hashes + 1);
+    uint32_t *positions = (uint32_t*)MALLOCATE((num_hashes + 1)
+                                               * sizeof(uint32_t));
+
+    bool     success = num_hashes == 0;
+    uint64_t seed    = UINT64_C(0x2545F4914F6CDD1D);
+    for (uint32_t attempt = 0; !success && attempt < MAX_SEEDS; attempt++) {
+        self->seed = seed;
+        for (uint32_t i = 0; i < num_hashes; i++) {
+            hashes[i] = SI_slot_hash(self, hash_sums[i]);
+        }
+        success = S_place_buckets(self, hashes, bucket_starts, members,
+                                  order, taken, positions);
+        seed = SI_mix(seed + attempt + 1);
+    }
+
+    if (success) {
+        for (uint32_t i = 0; i < num_hashes; i++) {
+            uint32_t bucket = hashes[i].bucket;
+            slot_of[i] = SI_slot(num_hashes, hashes[i],
+                                 self->disps[2 * bucket],
+                                 self->disps[2 * bucket + 1]);
+        }
+    }
+
+    FREEMEM(positions);
+    FREEMEM(taken);
+    FREEMEM(order);
+    FREEMEM(members);
+    FREEMEM(bucket_starts);
+    FREEMEM(hashes);
+
+    if (!success) {
+        THROW(ERR, "Failed to build perfect hash for %u32 keys",
+              num_hashes);
+    }
+}
+
+static bool
+S_place_buckets(FrozenHash *self, SlotHash *hashes, uint32_t *bucket_starts,
+                uint32_t *members, uint32_t *order, uint8_t *taken,
+                uint32_t *positions) {
+    const uint32_t num_slots   = self->num_slots;
+    const uint32_t num_buckets = self->num_buckets;
+
+    // Group the hash sums by bucket.
+    memset(bucket_starts, 0, (num_buckets + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < num_slots; i++) {
+        bucket_starts[hashes[i].bucket + 1]++;
+    }
+    uint32_t max_bucket_size = 0;
+    for (uint32_t b = 0; b < num_buckets; b++) {
+        if (bucket_starts[b + 1] > max_bucket_size) {
+            max_bucket_size = bucket_starts[b + 1];
+        }
+        bucket_starts[b + 1] += bucket_starts[b];
+    }
+    memcpy(positions, bucket_starts, num_buckets * sizeof(uint32_t));
+    for (uint32_t i = 0; i < num_slots; i++) {
+        members[positions[hashes[i].bucket]++] = i;
+    }
+
+    // Order the buckets by decreasing size.
+    uint32_t num_ordered = 0;
+    for (uint32_t bucket_size = max_bucket_size;
+         bucket_size > 0;
+         bucket_size--
+        ) {
+        for (uint32_t b = 0; b < num_buckets; b++) {
+            if (bucket_starts[b + 1] - bucket_starts[b] == bucket_size) {
+                order[num_ordered++] = b;
+            }
+        }
+    }
+
+    memset(taken, 0, num_slots);
+    memset(self->disps, 0, 2 * num_buckets * sizeof(uint32_t));
+
+    uint32_t free_slot = 0;
+    for (uint32_t o = 0; o < num_ordered; o++) {
+        const uint32_t  b      = order[o];
+        const uint32_t *bucket = members + bucket_starts[b];
+        const uint32_t  count  = bucket_starts[b + 1] - bucket_starts[b];
+        bool            placed = false;
+
+        if (count == 1) {
+            // Any free slot can be reached with `d0 == 0`.  All remaining
+            // buckets are single, so the free slots can be handed out in
+            // order.
+            while (taken[free_slot]) { free_slot++; }
+            taken[free_slot]       = 1;
+            self->disps[2 * b + 1] = free_slot >= hashes[bucket[0]].f1
+                                     ? free_slot - hashes[bucket[0]].f1
+                                     : free_slot + num_slots
+                                       - hashes[bucket[0]].f1;
+            continue;
+        }
+
+        // A bucket whose members share both `f1` and `f2` can't be placed.
+        for (uint32_t i = 1; i < count; i++) {
+            for (uint32_t j = 0; j < i; j++) {
+                if (hashes[bucket[i]].f1 == hashes[bucket[j]].f1
+                    && hashes[bucket[i]].f2 == hashes[bucket[j]].f2
+                   ) {
+                    return false;
+                }
+            }
+        }
+
+        for (uint32_t d0 = 0; d0 < num_slots && !placed; d0++) {
+            for (uint32_t d1 = 0; d1 < num_slots && !placed; d1++) {
+                uint32_t i = 0;
+                for (; i < count; i++) {
+                    uint32_t slot = SI_slot(num_slots, hashes[bucket[i]],
+                                            d0, d1);
+                    if (taken[slot]) { break; }
+                    taken[slot]  = 1;
+                    positions[i] = slot;
+                }
+                if (i == count) {
+                    self->disps[2 * b]     = d0;
+                    self->disps[2 * b + 1] = d1;
+                    placed = true;
+                }
+                else {
+                    // Undo the partial placement.
+                    while (i > 0) { taken[positions[--i]] = 0; }
+                }
+            }
+        }
+
+        if (!placed) { return false; }
+    }
+
+    return true;
+}
+
+void
+FrozenHash_Destroy_IMP(FrozenHash *self) {
+    if (self->entries) {
+        FrozenHashEntry *const entries = (FrozenHashEntry*)self->entries;
+        for (size_t i = 0; i < self->size; i++) {
+            DECREF(entries[i].key);
+            DECREF(entries[i].value);
+        }
+        FREEMEM(self->entries);
+    }
+    FREEMEM(self->arena);
+    FREEMEM(self->slots);
+    FREEMEM(self->disps);
+    SUPER_DESTROY(self, FROZENHASH);
+}
+
+void
+FrozenHash_Traverse_IMP(FrozenHash *self, Obj_Visit_t visit, void *context) {
+    FrozenHashEntry *const entries = (FrozenHashEntry*)self->entries;
+    for (size_t i = 0; i < self->size; i++) {
+        visit(context, (Obj*)entries[i].key);
+        if (entries[i].value) { visit(context, entries[i].value); }
+    }
+}
+
+static CFISH_INLINE FrozenHashEntry*
+SI_fetch_entry(FrozenHash *self, const char *key_ptr, size_t key_size,
+               size_t hash_sum) {
+    if (self->num_slots == 0) { return NULL; }
+
+    SlotHash sh     = SI_slot_hash(self, hash_sum);
+    uint32_t slot   = SI_slot(self->num_slots, sh,
+                              self->disps[2 * sh.bucket],
+                              self->disps[2 * sh.bucket + 1]);
+    uint32_t end    = self->slots[slot + 1];
+    FrozenHashEntry *const entries = (FrozenHashEntry*)self->entries;
+
+    for (uint32_t i = self->slots[slot]; i < end; i++) {
+        FrozenHashEntry *entry = entries + i;
+        if (entry->hash_sum != hash_sum) {
+            // Another key occupies the slot.
+            return NULL;
+        }
+        if (entry->key_size == key_size
+            && memcmp(entry->key_ptr, key_ptr, key_size) == 0
+           ) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+Obj*
+FrozenHash_Fetch_IMP(FrozenHash *self, String *key) {
+    FrozenHashEntry *entry
+        = SI_fetch_entry(self, Str_Get_Ptr8(key), Str_Get_Size(key),
+                         Str_Hash_Sum(key));
+    return entry ? entry->value : NULL;
+}
+
+Obj*
+FrozenHash_Fetch_Utf8_IMP(FrozenHash *self, const char *key, size_t key_len) {
+    String *key_buf = SSTR_WRAP_UTF8(key, key_len);
+    FrozenHashEntry *entry
+        = SI_fetch_entry(self, key, key_len, Str_Hash_Sum(key_buf));
+    return entry ? entry->value : NULL;
+}
+
+bool
+FrozenHash_Has_Key_IMP(FrozenHash *self, String *key) {
+    FrozenHashEntry *entry
+        = SI_fetch_entry(self, Str_Get_Ptr8(key), Str_Get_Size(key),
+                         Str_Hash_Sum(key));
+    return entry ? true : false;
+}
+
+Vector*
+FrozenHash_Keys_IMP(FrozenHash *self) {
+    Vector          *keys    = Vec_new(self->size);
+    FrozenHashEntry *entries = (FrozenHashEntry*)self->entries;
+
+    for (size_t i = 0; i < self->size; i++) {
+        Vec_Push(keys, INCREF(entries[i].key));
+    }
+
+    return keys;
+}
+
+Vector*
+FrozenHash_Values_IMP(FrozenHash *self) {
+    Vector          *values  = Vec_new(self->size);
+    FrozenHashEntry *entries = (FrozenHashEntry*)self->entries;
+
+    for (size_t i = 0; i < self->size; i++) {
+        Vec_Push(values, INCREF(entries[i].value));
+    }
+
+    return values;
+}
+
+size_t
+FrozenHash_Get_Size_IMP(FrozenHash *self) {
+    return self->size;
+}
+
+bool
+FrozenHash_Equals_IMP(FrozenHash *self, Obj *other) {
+    if ((FrozenHash*)other == self) { return true; }
+
+    FrozenHash *frozen = NULL;
+    Hash       *hash   = NULL;
+    size_t      size;
+    if (Obj_is_a(other, FROZENHASH)) {
+        frozen = (FrozenHash*)other;
+        size   = frozen->size;
+    }
+    else if (Obj_is_a(other, HASH)) {
+        hash = (Hash*)other;
+        size = Hash_Get_Size(hash);
+    }
+    else {
+        return false;
+    }
+    if (self->size != size) { return false; }
+
+    FrozenHashEntry *const entries = (FrozenHashEntry*)self->entries;
+
+    for (size_t i = 0; i < self->size; i++) {
+        FrozenHashEntry *entry = entries + i;
+        Obj *other_val = frozen
+                         ? FrozenHash_Fetch(frozen, entry->key)
+                         : Hash_Fetch(hash, entry->key);
+        if (!other_val || !Obj_Equals(other_val, entry->value)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
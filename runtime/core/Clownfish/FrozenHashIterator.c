@@ -0,0 +1,101 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_CFISH_FROZENHASH
+#define C_CFISH_FROZENHASHITERATOR
+#define CFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/String.h"
+
+#include "Clownfish/FrozenHash.h"
+#include "Clownfish/FrozenHashIterator.h"
+
+typedef struct FrozenHashEntry {
+    String     *key;
+    Obj        *value;
+    size_t      hash_sum;
+    const char *key_ptr;
+    size_t      key_size;
+} FrozenHashEntry;
+
+FrozenHashIterator*
+FrozenHashIter_new(FrozenHash *hash) {
+    FrozenHashIterator *self
+        = (FrozenHashIterator*)Class_Make_Obj(FROZENHASHITERATOR);
+    return FrozenHashIter_init(self, hash);
+}
+
+FrozenHashIterator*
+FrozenHashIter_init(FrozenHashIterator *self, FrozenHash *hash) {
+    self->hash = (FrozenHash*)INCREF(hash);
+    self->tick = (size_t)-1;
+    return self;
+}
+
+bool
+FrozenHashIter_Next_IMP(FrozenHashIterator *self) {
+    if (++self->tick >= self->hash->size) {
+        // Iteration complete. Pin tick at size.
+        self->tick = self->hash->size;
+        return false;
+    }
+    return true;
+}
+
+String*
+FrozenHashIter_Get_Key_IMP(FrozenHashIterator *self) {
+    if (self->tick == (size_t)-1) {
+        THROW(ERR, "Invalid call to Get_Key before iteration.");
+    }
+    else if (self->tick >= self->hash->size) {
+        THROW(ERR, "Invalid call to Get_Key after end of iteration.");
+    }
+
+    FrozenHashEntry *const entry
+        = (FrozenHashEntry*)self->hash->entries + self->tick;
+    return entry->key;
+}
+
+Obj*
+FrozenHashIter_Get_Value_IMP(FrozenHashIterator *self) {
+    if (self->tick == (size_t)-1) {
+        THROW(ERR, "Invalid call to Get_Value before iteration.");
+    }
+    else if (self->tick >= self->hash->size) {
+        THROW(ERR, "Invalid call to Get_Value after end of iteration.");
+    }
+
+    FrozenHashEntry *const entry
+        = (FrozenHashEntry*)self->hash->entries + self->tick;
+    return entry->value;
+}
+
+void
+FrozenHashIter_Destroy_IMP(FrozenHashIterator *self) {
+    DECREF(self->hash);
+
+    SUPER_DESTROY(self, FROZENHASHITERATOR);
+}
+
+void
+FrozenHashIter_Traverse_IMP(FrozenHashIterator *self, Obj_Visit_t visit,
+                            void *context) {
+    if (self->hash) { visit(context, (Obj*)self->hash); }
+}
+
+
@@ -20,18 +20,58 @@
 #include <string.h>
 #include <stdlib.h>
 
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define HASH_SSE2
+  #include <emmintrin.h>
+#elif (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
+  #define HASH_NEON
+  #include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+#endif
+
 #include "Clownfish/Class.h"
 
 #include "Clownfish/Hash.h"
+#include "Clownfish/FrozenHash.h"
 #include "Clownfish/String.h"
 #include "Clownfish/Err.h"
 #include "Clownfish/Vector.h"
-#include "Clownfish/Util/Atomic.h"
+#include "Clownfish/Util/AllocStats.h"
+#include "Clownfish/Util/Arena.h"
 #include "Clownfish/Util/Memory.h"
 
-// TOMBSTONE is shared across threads, so it must never be incref'd or
-// decref'd.
-static String *TOMBSTONE;
+/* The table is split into an array of one-byte control codes and a parallel
+ * array of entries.  The control byte of an occupied slot holds the low
+ * seven bits of the key's hash sum, so lookups can compare a whole group of
+ * slots against the fragment at once and only touch entries whose fragment
+ * matches.  Empty slots have the high bit set.
+ *
+ * Probing starts at the "home" slot chosen by the remaining hash bits and
+ * scans GROUP_WIDTH consecutive control bytes at a time.  The first
+ * GROUP_WIDTH control bytes are mirrored past the end of the array so that
+ * a group can be loaded from any slot without wrapping.
+ *
+ * Entries are always stored in the first empty slot at or after their home
+ * slot, so there's never an empty slot between an entry and its home.
+ * Deletion maintains this invariant by shifting entries backwards instead of
+ * leaving tombstones, so a lookup can stop at the first group containing an
+ * empty slot.
+ *
+ * While iterators are active, shifting would move entries underneath them,
+ * so deletion marks the slot as CTRL_DELETED instead.  Lookups probe past
+ * deleted slots like full ones and inserts never reuse them.  Once the last
+ * iterator goes away, the table is rehashed to drop the deleted slots.
+ */
+#define GROUP_WIDTH  16
+#define CTRL_EMPTY   ((uint8_t)0x80)
+#define CTRL_DELETED ((uint8_t)0xFE)
+#define CTRL_IS_FULL(ctrl_byte) (((ctrl_byte) & 0x80) == 0)
+#define HASH_H1(hash_sum) ((hash_sum) >> 7)
+#define HASH_H2(hash_sum) ((uint8_t)((hash_sum) & 0x7F))
 
 #define HashEntry cfish_HashEntry
 
@@ -45,15 +85,108 @@ typedef struct HashEntry {
 static CFISH_INLINE HashEntry*
 SI_fetch_entry(Hash *self, String *key, size_t hash_sum);
 
-// Double the number of buckets and redistribute all entries.
-static CFISH_INLINE HashEntry*
-SI_rebuild_hash(Hash *self);
+// Double the number of slots and redistribute all entries.
+static void
+S_rebuild_hash(Hash *self);
 
-void
-Hash_init_class() {
-    String *tombstone = Str_newf("[HASHTOMBSTONE]");
-    if (!Atomic_cas_ptr((void**)&TOMBSTONE, NULL, tombstone)) {
-        DECREF(tombstone);
+// Redistribute all entries into a fresh table with `capacity` slots.
+static void
+S_rehash(Hash *self, size_t capacity);
+
+/* Return a bit mask with bit `n` set if the control byte of slot `n` in the
+ * group equals `byte`.
+ */
+static CFISH_INLINE uint32_t
+SI_match_byte(const uint8_t *group, uint8_t byte) {
+#if defined(HASH_SSE2)
+    __m128i ctrl  = _mm_loadu_si128((const __m128i*)group);
+    __m128i match = _mm_set1_epi8((char)byte);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, match));
+#elif defined(HASH_NEON)
+    static const uint8_t weights[GROUP_WIDTH] = {
+        1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+    };
+    uint8x16_t eq   = vceqq_u8(vld1q_u8(group), vdupq_n_u8(byte));
+    uint8x16_t bits = vandq_u8(eq, vld1q_u8(weights));
+    return (uint32_t)vaddv_u8(vget_low_u8(bits))
+           | ((uint32_t)vaddv_u8(vget_high_u8(bits)) << 8);
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < GROUP_WIDTH; i++) {
+        if (group[i] == byte) { mask |= 1u << i; }
+    }
+    return mask;
+#endif
+}
+
+// Index of the lowest set bit.  `mask` must not be zero.
+static CFISH_INLINE uint32_t
+SI_lowest_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t)__builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (uint32_t)index;
+#else
+    uint32_t index = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+static CFISH_INLINE void
+SI_set_ctrl(Hash *self, size_t tick, uint8_t ctrl_byte) {
+    self->ctrl[tick] = ctrl_byte;
+    if (tick < GROUP_WIDTH) {
+        // Keep the mirrored copy in sync.
+        self->ctrl[self->capacity + tick] = ctrl_byte;
+    }
+}
+
+// Maximum number of entries for a given capacity.
+static CFISH_INLINE size_t
+SI_max_load(size_t capacity) {
+    return capacity - capacity / 8;
+}
+
+// Bytes allocated for a table with `capacity` slots.
+static CFISH_INLINE size_t
+SI_table_size(size_t capacity) {
+    return capacity + GROUP_WIDTH + capacity * sizeof(HashEntry);
+}
+
+static void
+S_alloc_table(Hash *self, size_t capacity) {
+    ALLOCSTATS_BUF_ALLOC(self->klass, SI_table_size(capacity));
+    self->capacity  = capacity;
+    self->threshold = SI_max_load(capacity);
+    self->num_deleted = 0;
+    self->ctrl      = (uint8_t*)Arena_buf_malloc(self, capacity + GROUP_WIDTH);
+    self->entries   = Arena_buf_calloc(self, capacity, sizeof(HashEntry));
+    memset(self->ctrl, CTRL_EMPTY, capacity + GROUP_WIDTH);
+}
+
+static CFISH_INLINE size_t
+SI_home_slot(Hash *self, size_t hash_sum) {
+    return HASH_H1(hash_sum) & (self->capacity - 1);
+}
+
+// Return the first empty slot in the probe sequence for `hash_sum`.
+static CFISH_INLINE size_t
+SI_find_free_slot(Hash *self, size_t hash_sum) {
+    const size_t mask = self->capacity - 1;
+    size_t       pos  = SI_home_slot(self, hash_sum);
+
+    while (1) {
+        uint32_t empty = SI_match_byte(self->ctrl + pos, CTRL_EMPTY);
+        if (empty) {
+            return (pos + SI_lowest_bit(empty)) & mask;
+        }
+        pos = (pos + GROUP_WIDTH) & mask;
     }
 }
 
@@ -67,21 +200,18 @@ Hash*
 Hash_init(Hash *self, size_t min_threshold) {
     // Allocate enough space to hold the requested number of elements without
     // triggering a rebuild.
-    size_t threshold;
-    size_t capacity = 16;
-    do {
-        threshold = (capacity / 3) * 2;
-        if (threshold > min_threshold) { break; }
+    size_t capacity = GROUP_WIDTH;
+    while (SI_max_load(capacity) <= min_threshold
+           && capacity <= SIZE_MAX / 2 / sizeof(HashEntry)
+          ) {
         capacity *= 2;
-    } while (capacity <= SIZE_MAX / 2);
+    }
 
     // Init.
-    self->size      = 0;
+    self->size = 0;
 
     // Derive.
-    self->capacity  = capacity;
-    self->entries   = (HashEntry*)CALLOCATE(capacity, sizeof(HashEntry));
-    self->threshold = threshold;
+    S_alloc_table(self, capacity);
 
     return self;
 }
@@ -90,33 +220,43 @@ void
 Hash_Destroy_IMP(Hash *self) {
     if (self->entries) {
         Hash_Clear(self);
-        FREEMEM(self->entries);
+        ALLOCSTATS_BUF_FREE(self->klass, SI_table_size(self->capacity));
+        Arena_buf_free(self, self->entries);
+        Arena_buf_free(self, self->ctrl);
     }
     SUPER_DESTROY(self, HASH);
 }
 
+void
+Hash_Traverse_IMP(Hash *self, Obj_Visit_t visit, void *context) {
+    HashEntry *const entries = (HashEntry*)self->entries;
+
+    for (size_t tick = 0; tick < self->capacity; tick++) {
+        if (!CTRL_IS_FULL(self->ctrl[tick])) { continue; }
+        HashEntry *entry = entries + tick;
+        visit(context, (Obj*)entry->key);
+        if (entry->value) { visit(context, entry->value); }
+    }
+}
+
 void
 Hash_Clear_IMP(Hash *self) {
-    HashEntry *entry       = (HashEntry*)self->entries;
-    HashEntry *const limit = entry + self->capacity;
+    HashEntry *const entries = (HashEntry*)self->entries;
 
     // Iterate through all entries.
-    for (; entry < limit; entry++) {
-        if (!entry->key) { continue; }
-        if (entry->key == TOMBSTONE) {
-            entry->key = NULL;
-            continue;
-        }
+    for (size_t tick = 0; tick < self->capacity; tick++) {
+        if (!CTRL_IS_FULL(self->ctrl[tick])) { continue; }
+        HashEntry *entry = entries + tick;
         DECREF(entry->key);
         DECREF(entry->value);
         entry->key       = NULL;
         entry->value     = NULL;
         entry->hash_sum  = 0;
     }
+    memset(self->ctrl, CTRL_EMPTY, self->capacity + GROUP_WIDTH);
 
-    self->size = 0;
-    // All tombstones were removed, reset threshold.
-    self->threshold = (self->capacity / 3) * 2;
+    self->size        = 0;
+    self->num_deleted = 0;
 }
 
 static void
@@ -129,30 +269,21 @@ S_do_store(Hash *self, String *key, Obj *value, size_t hash_sum,
         return;
     }
 
-    HashEntry *entries = self->size >= self->threshold
-                         ? SI_rebuild_hash(self)
-                         : (HashEntry*)self->entries;
-    size_t       tick = hash_sum;
-    const size_t mask = self->capacity - 1;
-
-    while (1) {
-        tick &= mask;
-        HashEntry *entry = entries + tick;
-        if (entry->key == TOMBSTONE || !entry->key) {
-            if (entry->key == TOMBSTONE) {
-                // Take note of diminished tombstone clutter.
-                self->threshold++;
-            }
-            entry->key       = incref_key
-                               ? (String*)INCREF(key)
-                               : key;
-            entry->value     = value;
-            entry->hash_sum  = hash_sum;
-            self->size++;
-            break;
-        }
-        tick++; // linear scan
+    // Deleted slots still occupy space in the probe sequences.
+    if (self->size + self->num_deleted >= self->threshold) {
+        S_rebuild_hash(self);
     }
+
+    size_t tick = SI_find_free_slot(self, hash_sum);
+
+    entry = (HashEntry*)self->entries + tick;
+    entry->key       = incref_key
+                       ? (String*)INCREF(key)
+                       : key;
+    entry->value     = value;
+    entry->hash_sum  = hash_sum;
+    SI_set_ctrl(self, tick, HASH_H2(hash_sum));
+    self->size++;
 }
 
 void
@@ -174,24 +305,32 @@ Hash_Fetch_Utf8_IMP(Hash *self, const char *key, size_t key_len) {
 
 static CFISH_INLINE HashEntry*
 SI_fetch_entry(Hash *self, String *key, size_t hash_sum) {
-    size_t tick = hash_sum;
     HashEntry *const entries = (HashEntry*)self->entries;
-    HashEntry *entry;
+    const uint8_t    h2      = HASH_H2(hash_sum);
+    const size_t     mask    = self->capacity - 1;
+    size_t           pos     = SI_home_slot(self, hash_sum);
 
     while (1) {
-        tick &= self->capacity - 1;
-        entry = entries + tick;
-        if (!entry->key) {
+        const uint8_t *group = self->ctrl + pos;
+
+        for (uint32_t matches = SI_match_byte(group, h2);
+             matches;
+             matches &= matches - 1
+            ) {
+            HashEntry *entry
+                = entries + ((pos + SI_lowest_bit(matches)) & mask);
+            if (entry->hash_sum == hash_sum
+                && (entry->key == key || Str_Equals(key, (Obj*)entry->key))
+               ) {
+                return entry;
+            }
+        }
+
+        if (SI_match_byte(group, CTRL_EMPTY)) {
             // Failed to find the key, so return NULL.
             return NULL;
         }
-        else if (entry->hash_sum == hash_sum
-                 && entry->key != TOMBSTONE
-                 && Str_Equals(key, (Obj*)entry->key)
-                ) {
-            return entry;
-        }
-        tick++;
+        pos = (pos + GROUP_WIDTH) & mask;
     }
 }
 
@@ -201,17 +340,58 @@ Hash_Fetch_IMP(Hash *self, String *key) {
     return entry ? entry->value : NULL;
 }
 
+/* Empty the slot at `tick`, then move back any following entries of the
+ * cluster which would otherwise become unreachable from their home slot.
+ */
+static void
+S_backward_shift(Hash *self, size_t tick) {
+    HashEntry *const entries = (HashEntry*)self->entries;
+    const size_t     mask    = self->capacity - 1;
+    size_t           hole    = tick;
+
+    for (size_t next = (hole + 1) & mask;
+         self->ctrl[next] != CTRL_EMPTY;
+         next = (next + 1) & mask
+        ) {
+        size_t home = SI_home_slot(self, entries[next].hash_sum);
+
+        // Leave the entry alone if its home lies cyclically in
+        // (hole, next].
+        bool stays = hole <= next
+                     ? hole < home && home <= next
+                     : hole < home || home <= next;
+        if (stays) { continue; }
+
+        entries[hole] = entries[next];
+        SI_set_ctrl(self, hole, self->ctrl[next]);
+        hole = next;
+    }
+
+    entries[hole].key      = NULL;
+    entries[hole].value    = NULL;
+    entries[hole].hash_sum = 0;
+    SI_set_ctrl(self, hole, CTRL_EMPTY);
+}
+
 Obj*
 Hash_Delete_IMP(Hash *self, String *key) {
     HashEntry *entry = SI_fetch_entry(self, key, Str_Hash_Sum(key));
     if (entry) {
-        Obj *value = entry->value;
+        Obj    *value = entry->value;
+        size_t  tick  = (size_t)(entry - (HashEntry*)self->entries);
         DECREF(entry->key);
-        entry->key       = TOMBSTONE;
-        entry->value     = NULL;
-        entry->hash_sum  = 0;
+        if (self->num_iterators) {
+            // Don't move entries while they're being iterated.
+            entry->key      = NULL;
+            entry->value    = NULL;
+            entry->hash_sum = 0;
+            SI_set_ctrl(self, tick, CTRL_DELETED);
+            self->num_deleted++;
+        }
+        else {
+            S_backward_shift(self, tick);
+        }
         self->size--;
-        self->threshold--; // limit number of tombstones
         return value;
     }
     else {
@@ -233,13 +413,12 @@ Hash_Has_Key_IMP(Hash *self, String *key) {
 
 Vector*
 Hash_Keys_IMP(Hash *self) {
-    Vector    *keys        = Vec_new(self->size);
-    HashEntry *entry       = (HashEntry*)self->entries;
-    HashEntry *const limit = entry + self->capacity;
+    Vector    *keys          = Vec_new(self->size);
+    HashEntry *const entries = (HashEntry*)self->entries;
 
-    for (; entry < limit; entry++) {
-        if (entry->key && entry->key != TOMBSTONE) {
-            Vec_Push(keys, INCREF(entry->key));
+    for (size_t tick = 0; tick < self->capacity; tick++) {
+        if (CTRL_IS_FULL(self->ctrl[tick])) {
+            Vec_Push(keys, INCREF(entries[tick].key));
         }
     }
 
@@ -248,13 +427,12 @@ Hash_Keys_IMP(Hash *self) {
 
 Vector*
 Hash_Values_IMP(Hash *self) {
-    Vector    *values      = Vec_new(self->size);
-    HashEntry *entry       = (HashEntry*)self->entries;
-    HashEntry *const limit = entry + self->capacity;
+    Vector    *values        = Vec_new(self->size);
+    HashEntry *const entries = (HashEntry*)self->entries;
 
-    for (; entry < limit; entry++) {
-        if (entry->key && entry->key != TOMBSTONE) {
-            Vec_Push(values, INCREF(entry->value));
+    for (size_t tick = 0; tick < self->capacity; tick++) {
+        if (CTRL_IS_FULL(self->ctrl[tick])) {
+            Vec_Push(values, INCREF(entries[tick].value));
         }
     }
 
@@ -266,14 +444,17 @@ Hash_Equals_IMP(Hash *self, Obj *other) {
     Hash    *twin = (Hash*)other;
 
     if (twin == self)             { return true; }
+    if (Obj_is_a(other, FROZENHASH)) {
+        return FrozenHash_Equals((FrozenHash*)other, (Obj*)self);
+    }
     if (!Obj_is_a(other, HASH))   { return false; }
     if (self->size != twin->size) { return false; }
 
-    HashEntry *entry       = (HashEntry*)self->entries;
-    HashEntry *const limit = entry + self->capacity;
+    HashEntry *const entries = (HashEntry*)self->entries;
 
-    for (; entry < limit; entry++) {
-        if (entry->key && entry->key != TOMBSTONE) {
+    for (size_t tick = 0; tick < self->capacity; tick++) {
+        if (CTRL_IS_FULL(self->ctrl[tick])) {
+            HashEntry *entry = entries + tick;
             Obj *other_val = Hash_Fetch(twin, entry->key);
             if (!other_val || !Obj_Equals(other_val, entry->value)) {
                 return false;
@@ -284,6 +465,11 @@ Hash_Equals_IMP(Hash *self, Obj *other) {
     return true;
 }
 
+FrozenHash*
+Hash_Freeze_IMP(Hash *self) {
+    return FrozenHash_new(self);
+}
+
 size_t
 Hash_Get_Capacity_IMP(Hash *self) {
     return self->capacity;
@@ -294,35 +480,45 @@ Hash_Get_Size_IMP(Hash *self) {
     return self->size;
 }
 
-static CFISH_INLINE HashEntry*
-SI_rebuild_hash(Hash *self) {
-    if (self->capacity > SIZE_MAX / 2) {
+void
+Hash_Begin_Iteration_IMP(Hash *self) {
+    self->num_iterators++;
+}
+
+void
+Hash_End_Iteration_IMP(Hash *self) {
+    if (--self->num_iterators == 0 && self->num_deleted) {
+        S_rehash(self, self->capacity);
+    }
+}
+
+static void
+S_rebuild_hash(Hash *self) {
+    if (self->capacity > SIZE_MAX / 2 / sizeof(HashEntry)) {
         THROW(ERR, "Hash grew too large");
     }
+    S_rehash(self, self->capacity * 2);
+}
 
-    HashEntry *old_entries = (HashEntry*)self->entries;
-    HashEntry *entry       = old_entries;
-    HashEntry *limit       = old_entries + self->capacity;
+static void
+S_rehash(Hash *self, size_t capacity) {
+    uint8_t   *old_ctrl     = self->ctrl;
+    HashEntry *old_entries  = (HashEntry*)self->entries;
+    size_t     old_capacity = self->capacity;
 
-    self->capacity *= 2;
-    self->threshold = (self->capacity / 3) * 2;
-    self->entries   = (HashEntry*)CALLOCATE(self->capacity, sizeof(HashEntry));
-    self->size      = 0;
+    S_alloc_table(self, capacity);
+    self->generation++;
 
-    for (; entry < limit; entry++) {
-        if (!entry->key || entry->key == TOMBSTONE) {
-            continue;
-        }
-        S_do_store(self, entry->key, entry->value, entry->hash_sum, false);
+    HashEntry *const entries = (HashEntry*)self->entries;
+    for (size_t old_tick = 0; old_tick < old_capacity; old_tick++) {
+        if (!CTRL_IS_FULL(old_ctrl[old_tick])) { continue; }
+        HashEntry *old_entry = old_entries + old_tick;
+        size_t     tick      = SI_find_free_slot(self, old_entry->hash_sum);
+        entries[tick] = *old_entry;
+        SI_set_ctrl(self, tick, HASH_H2(old_entry->hash_sum));
     }
 
-    FREEMEM(old_entries);
-
-    return (HashEntry*)self->entries;
+    ALLOCSTATS_BUF_FREE(self->klass, SI_table_size(old_capacity));
+    Arena_buf_free(self, old_ctrl);
+    Arena_buf_free(self, old_entries);
 }
-
-String*
-Hash_get_tombstone() {
-    return TOMBSTONE;
-}
-
@@ -25,21 +25,14 @@
 #include "Clownfish/Hash.h"
 #include "Clownfish/HashIterator.h"
 
-static String *TOMBSTONE;
-
 typedef struct HashEntry {
     String *key;
     Obj    *value;
     size_t  hash_sum;
 } HashEntry;
 
-void
-HashIter_init_class() {
-    TOMBSTONE = Hash_get_tombstone();
-    if (!TOMBSTONE) {
-        THROW(ERR, "Singleton tombstone not set in Hash.");
-    }
-}
+// Control bytes of occupied slots have the high bit clear.
+#define CTRL_IS_FULL(ctrl_byte) (((ctrl_byte) & 0x80) == 0)
 
 HashIterator*
 HashIter_new(Hash *hash) {
@@ -49,15 +42,17 @@ HashIter_new(Hash *hash) {
 
 HashIterator*
 HashIter_init(HashIterator *self, Hash *hash) {
-    self->hash     = (Hash*)INCREF(hash);
-    self->tick     = (size_t)-1;
-    self->capacity = hash->capacity;
+    self->hash       = (Hash*)INCREF(hash);
+    Hash_Begin_Iteration(hash);
+    self->tick       = (size_t)-1;
+    self->capacity   = hash->capacity;
+    self->generation = hash->generation;
     return self;
 }
 
 bool
 HashIter_Next_IMP(HashIterator *self) {
-    if (self->capacity != self->hash->capacity) {
+    if (self->generation != self->hash->generation) {
         THROW(ERR, "Hash modified during iteration.");
     }
     while (1) {
@@ -67,9 +62,7 @@ HashIter_Next_IMP(HashIterator *self) {
             return false;
         }
         else {
-            HashEntry *const entry
-                = (HashEntry*)self->hash->entries + self->tick;
-            if (entry->key && entry->key != TOMBSTONE) {
+            if (CTRL_IS_FULL(self->hash->ctrl[self->tick])) {
                 // Success.
                 return true;
             }
@@ -79,7 +72,7 @@ HashIter_Next_IMP(HashIterator *self) {
 
 String*
 HashIter_Get_Key_IMP(HashIterator *self) {
-    if (self->capacity != self->hash->capacity) {
+    if (self->generation != self->hash->generation) {
         THROW(ERR, "Hash modified during iteration.");
     }
     if (self->tick == (size_t)-1) {
@@ -89,17 +82,18 @@ HashIter_Get_Key_IMP(HashIterator *self) {
         THROW(ERR, "Invalid call to Get_Key after end of iteration.");
     }
 
-    HashEntry *const entry
-        = (HashEntry*)self->hash->entries + self->tick;
-    if (entry->key == TOMBSTONE) {
+    if (!CTRL_IS_FULL(self->hash->ctrl[self->tick])) {
         THROW(ERR, "Hash modified during iteration.");
     }
+
+    HashEntry *const entry
+        = (HashEntry*)self->hash->entries + self->tick;
     return entry->key;
 }
 
 Obj*
 HashIter_Get_Value_IMP(HashIterator *self) {
-    if (self->capacity != self->hash->capacity) {
+    if (self->generation != self->hash->generation) {
         THROW(ERR, "Hash modified during iteration.");
     }
     if (self->tick == (size_t)-1) {
@@ -109,6 +103,10 @@ HashIter_Get_Value_IMP(HashIterator *self) {
         THROW(ERR, "Invalid call to Get_Value after end of iteration.");
     }
 
+    if (!CTRL_IS_FULL(self->hash->ctrl[self->tick])) {
+        THROW(ERR, "Hash modified during iteration.");
+    }
+
     HashEntry *const entry
         = (HashEntry*)self->hash->entries + self->tick;
     return entry->value;
@@ -116,8 +114,17 @@ HashIter_Get_Value_IMP(HashIterator *self) {
 
 void
 HashIter_Destroy_IMP(HashIterator *self) {
-    DECREF(self->hash);
+    if (self->hash) {
+        Hash_End_Iteration(self->hash);
+        DECREF(self->hash);
+    }
 
     SUPER_DESTROY(self, HASHITERATOR);
 }
 
+void
+HashIter_Traverse_IMP(HashIterator *self, Obj_Visit_t visit,
+                      void *context) {
+    if (self->hash) { visit(context, (Obj*)self->hash); }
+}
+
@@ -21,126 +21,295 @@
 #include "Clownfish/Err.h"
 #include "Clownfish/Class.h"
 #include "Clownfish/String.h"
+#include "Clownfish/Util/Arena.h"
 #include "Clownfish/Util/Atomic.h"
 #include "Clownfish/Util/Memory.h"
 
-struct cfish_LockFreeRegistry {
-    size_t  capacity;
-    void   *entries;
-};
+/* The registry is a split-ordered list (Shalev and Shavit): all entries
+ * live in a single lock-free linked list sorted by their bit-reversed hash
+ * sum.  With this order, the entries of bucket `b` in a table of `2^n`
+ * buckets form a contiguous run of the list, which splits into the runs of
+ * buckets `b` and `b + 2^n` when the table doubles.  Every bucket points to
+ * a dummy node marking the start of its run, so growing the table only
+ * requires inserting new dummy nodes lazily.  Nothing is ever moved, and
+ * readers are never blocked.
+ *
+ * The bucket array is divided into segments which are allocated on demand.
+ * Segment 0 holds the first `base_size` buckets, segment `k > 0` holds the
+ * buckets from `base_size << (k - 1)` to `(base_size << k) - 1`.
+ */
+#define LOAD_FACTOR  2
+#define MAX_SEGMENTS (sizeof(size_t) * 8)
 
 typedef struct cfish_LFRegEntry {
-    String *key;
+    String *key;          /* NULL for dummy nodes */
     Obj *value;
     size_t hash_sum;
+    size_t order_key;     /* bit-reversed hash sum or bucket index */
     struct cfish_LFRegEntry *volatile next;
 } cfish_LFRegEntry;
 #define LFRegEntry cfish_LFRegEntry
 
+struct cfish_LockFreeRegistry {
+    size_t base_size;
+    size_t base_bits;
+    volatile size_t num_buckets;
+    volatile size_t size;
+    LFRegEntry *volatile *volatile segments[MAX_SEGMENTS];
+};
+
+static CFISH_INLINE size_t
+SI_reverse_bits(size_t value) {
+#if SIZE_MAX > 0xFFFFFFFFu
+    value = ((value >> 1) & 0x5555555555555555u)
+            | ((value & 0x5555555555555555u) << 1);
+    value = ((value >> 2) & 0x3333333333333333u)
+            | ((value & 0x3333333333333333u) << 2);
+    value = ((value >> 4) & 0x0F0F0F0F0F0F0F0Fu)
+            | ((value & 0x0F0F0F0F0F0F0F0Fu) << 4);
+    value = ((value >> 8) & 0x00FF00FF00FF00FFu)
+            | ((value & 0x00FF00FF00FF00FFu) << 8);
+    value = ((value >> 16) & 0x0000FFFF0000FFFFu)
+            | ((value & 0x0000FFFF0000FFFFu) << 16);
+    return (value >> 32) | (value << 32);
+#else
+    value = ((value >> 1) & 0x55555555u) | ((value & 0x55555555u) << 1);
+    value = ((value >> 2) & 0x33333333u) | ((value & 0x33333333u) << 2);
+    value = ((value >> 4) & 0x0F0F0F0Fu) | ((value & 0x0F0F0F0Fu) << 4);
+    value = ((value >> 8) & 0x00FF00FFu) | ((value & 0x00FF00FFu) << 8);
+    return (value >> 16) | (value << 16);
+#endif
+}
+
+// Index of the highest set bit.  `value` must not be zero.
+static CFISH_INLINE size_t
+SI_highest_bit(size_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return sizeof(unsigned long long) * 8 - 1
+           - (size_t)__builtin_clzll((unsigned long long)value);
+#else
+    size_t index = 0;
+    while (value >>= 1) { index++; }
+    return index;
+#endif
+}
+
+// Regular nodes have the lowest bit of the order key set, so they sort
+// after the dummy node of their bucket.
+static CFISH_INLINE size_t
+SI_regular_order_key(size_t hash_sum) {
+    return SI_reverse_bits(hash_sum) | 1;
+}
+
+static CFISH_INLINE size_t
+SI_dummy_order_key(size_t bucket) {
+    return SI_reverse_bits(bucket);
+}
+
+static CFISH_INLINE LFRegEntry *volatile*
+SI_bucket_slot(LockFreeRegistry *self, size_t bucket, bool create);
+
+// Return the dummy node of a bucket, creating it if necessary.
+static LFRegEntry*
+S_get_bucket(LockFreeRegistry *self, size_t bucket);
+
+// Insert `entry` into the list after `start`.  If an equal entry already
+// exists, return it instead.
+static LFRegEntry*
+S_list_insert(LFRegEntry *start, LFRegEntry *entry);
+
 LockFreeRegistry*
 LFReg_new(size_t capacity) {
     LockFreeRegistry *self
         = (LockFreeRegistry*)CALLOCATE(1, sizeof(LockFreeRegistry));
-    self->capacity = capacity;
-    self->entries  = CALLOCATE(capacity, sizeof(void*));
+    self->base_size = 1;
+    self->base_bits = 0;
+    while (self->base_size < capacity) {
+        self->base_size *= 2;
+        self->base_bits++;
+    }
+    self->num_buckets = self->base_size;
+
+    // The dummy node of bucket 0 is the head of the list.
+    LFRegEntry *head = (LFRegEntry*)CALLOCATE(1, sizeof(LFRegEntry));
+    *SI_bucket_slot(self, 0, true) = head;
+
     return self;
 }
 
-bool
-LFReg_register(LockFreeRegistry *self, String *key, Obj *value) {
-    LFRegEntry  *new_entry = NULL;
-    size_t       hash_sum  = Str_Hash_Sum(key);
-    size_t       bucket    = hash_sum  % self->capacity;
-    LFRegEntry  *volatile *entries = (LFRegEntry*volatile*)self->entries;
-    LFRegEntry  *volatile *slot    = &(entries[bucket]);
-
-    // Proceed through the linked list.  Bail out if the key has already been
-    // registered.
-FIND_END_OF_LINKED_LIST:
-    while (*slot) {
-        LFRegEntry *entry = *slot;
-        if (entry->hash_sum == hash_sum) {
-            if (Str_Equals(key, (Obj*)entry->key)) {
-                if (new_entry) {
-                    DECREF(new_entry->key);
-                    DECREF(new_entry->value);
-                    FREEMEM(new_entry);
-                }
-                return false;
-            }
+static CFISH_INLINE LFRegEntry *volatile*
+SI_bucket_slot(LockFreeRegistry *self, size_t bucket, bool create) {
+    size_t segment = 0;
+    size_t offset  = bucket;
+    size_t seg_size = self->base_size;
+    if (bucket >= self->base_size) {
+        size_t high_bit = SI_highest_bit(bucket);
+        segment  = high_bit - self->base_bits + 1;
+        offset   = bucket - ((size_t)1 << high_bit);
+        seg_size = (size_t)1 << high_bit;
+    }
+
+    LFRegEntry *volatile *slots = self->segments[segment];
+    if (slots == NULL) {
+        if (!create) { return NULL; }
+        LFRegEntry *volatile *new_slots
+            = (LFRegEntry *volatile*)CALLOCATE(seg_size, sizeof(void*));
+        if (Atomic_cas_ptr((void *volatile*)&self->segments[segment], NULL,
+                           (void*)new_slots)) {
+            slots = new_slots;
+        }
+        else {
+            // Another thread was faster.
+            FREEMEM((void*)new_slots);
+            slots = self->segments[segment];
         }
-        slot = &(entry->next);
     }
 
-    // We've found an empty slot. Create the new entry.
-    if (!new_entry) {
-        new_entry = (LFRegEntry*)MALLOCATE(sizeof(LFRegEntry));
-        new_entry->hash_sum  = hash_sum;
-        new_entry->key       = Str_new_from_trusted_utf8(Str_Get_Ptr8(key),
-                                                         Str_Get_Size(key));
-        new_entry->value     = INCREF(value);
-        new_entry->next      = NULL;
+    return slots + offset;
+}
+
+static LFRegEntry*
+S_get_bucket(LockFreeRegistry *self, size_t bucket) {
+    LFRegEntry *volatile *slot  = SI_bucket_slot(self, bucket, true);
+    LFRegEntry           *dummy = *slot;
+    if (dummy) { return dummy; }
+
+    // The run of a new bucket is split off from its parent bucket, which
+    // is the bucket without the highest bit.
+    size_t      parent_bucket = bucket & ~((size_t)1 << SI_highest_bit(bucket));
+    LFRegEntry *parent        = S_get_bucket(self, parent_bucket);
+
+    LFRegEntry *new_dummy = (LFRegEntry*)CALLOCATE(1, sizeof(LFRegEntry));
+    new_dummy->order_key = SI_dummy_order_key(bucket);
+    dummy = S_list_insert(parent, new_dummy);
+    if (dummy != new_dummy) {
+        // Another thread inserted the dummy node first.
+        FREEMEM(new_dummy);
+    }
+
+    Atomic_cas_ptr((void *volatile*)slot, NULL, dummy);
+    return dummy;
+}
+
+static CFISH_INLINE bool
+SI_same_entry(LFRegEntry *a, LFRegEntry *b) {
+    if (a->order_key != b->order_key) { return false; }
+    if (a->key == NULL || b->key == NULL) { return a->key == b->key; }
+    return a->hash_sum == b->hash_sum && Str_Equals(a->key, (Obj*)b->key);
+}
+
+static LFRegEntry*
+S_list_insert(LFRegEntry *start, LFRegEntry *entry) {
+    LFRegEntry *prev = start;
+
+    while (1) {
+        // Nodes are never removed, so it's always safe to continue the
+        // search from `prev`.
+        LFRegEntry *cur = prev->next;
+        while (cur != NULL && cur->order_key <= entry->order_key) {
+            if (SI_same_entry(cur, entry)) { return cur; }
+            prev = cur;
+            cur  = cur->next;
+        }
+
+        entry->next = cur;
+        if (Atomic_cas_ptr((void *volatile*)&prev->next, cur, entry)) {
+            return entry;
+        }
     }
+}
 
-    /* Attempt to append the new node onto the end of the linked list.
-     * However, if another thread filled the slot since we found it (perhaps
-     * while we were allocating that new node), the compare-and-swap will
-     * fail.  If that happens, we have to go back and find the new end of the
-     * linked list, then try again. */
-#if 1
-    if (!Atomic_cas_ptr((void*volatile*)slot, NULL, new_entry)) {
-        goto FIND_END_OF_LINKED_LIST;
+static LFRegEntry*
+S_find(LockFreeRegistry *self, String *key, size_t hash_sum) {
+    size_t      bucket    = hash_sum & (self->num_buckets - 1);
+    size_t      order_key = SI_regular_order_key(hash_sum);
+    LFRegEntry *entry     = S_get_bucket(self, bucket)->next;
+
+    while (entry != NULL && entry->order_key <= order_key) {
+        if (entry->order_key == order_key
+            && entry->hash_sum == hash_sum
+            && (entry->key == key || Str_Equals(key, (Obj*)entry->key))
+           ) {
+            return entry;
+        }
+        entry = entry->next;
     }
-#else
-    // This non-atomic version can be used to check whether the test suite
-    // catches any race conditions.
-    if (*slot == NULL) {
-        *slot = new_entry;
+
+    return NULL;
+}
+
+bool
+LFReg_register(LockFreeRegistry *self, String *key, Obj *value) {
+    size_t hash_sum = Str_Hash_Sum(key);
+
+    // Bail out if the key has already been registered.
+    if (S_find(self, key, hash_sum)) { return false; }
+
+    // Registry entries live as long as the registry, so copies of keys
+    // must not be allocated from an Arena.
+    LFRegEntry *new_entry = (LFRegEntry*)MALLOCATE(sizeof(LFRegEntry));
+    new_entry->hash_sum  = hash_sum;
+    new_entry->order_key = SI_regular_order_key(hash_sum);
+    if (Str_Is_Interned(key)) {
+        new_entry->key = (String*)INCREF(key);
     }
     else {
-        goto FIND_END_OF_LINKED_LIST;
+        Arena *arena = Arena_suspend();
+        new_entry->key = Str_new_from_trusted_utf8(Str_Get_Ptr8(key),
+                                                   Str_Get_Size(key));
+        Arena_resume(arena);
+    }
+    new_entry->value     = INCREF(value);
+    new_entry->next      = NULL;
+
+    LFRegEntry *bucket
+        = S_get_bucket(self, hash_sum & (self->num_buckets - 1));
+    if (S_list_insert(bucket, new_entry) != new_entry) {
+        // Another thread registered the same key in the meantime.
+        DECREF(new_entry->key);
+        DECREF(new_entry->value);
+        FREEMEM(new_entry);
+        return false;
+    }
+
+    // Double the number of buckets if the average run grows too long.
+    size_t size;
+    do {
+        size = self->size;
+    } while (!Atomic_cas_size(&self->size, size, size + 1));
+    size_t num_buckets = self->num_buckets;
+    if (size + 1 > num_buckets * LOAD_FACTOR
+        && num_buckets <= SIZE_MAX / 4
+       ) {
+        Atomic_cas_size(&self->num_buckets, num_buckets, num_buckets * 2);
     }
-#endif
 
     return true;
 }
 
 Obj*
 LFReg_fetch(LockFreeRegistry *self, String *key) {
-    size_t       hash_sum  = Str_Hash_Sum(key);
-    size_t       bucket    = hash_sum  % self->capacity;
-    LFRegEntry **entries   = (LFRegEntry**)self->entries;
-    LFRegEntry  *entry     = entries[bucket];
-
-    while (entry) {
-        if (entry->hash_sum  == hash_sum) {
-            if (Str_Equals(key, (Obj*)entry->key)) {
-                return entry->value;
-            }
-        }
-        entry = entry->next;
-    }
-
-    return NULL;
+    LFRegEntry *entry = S_find(self, key, Str_Hash_Sum(key));
+    return entry ? entry->value : NULL;
 }
 
 void
 LFReg_destroy(LockFreeRegistry *self) {
-    LFRegEntry **entries = (LFRegEntry**)self->entries;
-
-    for (size_t i = 0; i < self->capacity; i++) {
-        LFRegEntry *entry = entries[i];
-        while (entry) {
-            LFRegEntry *next_entry = entry->next;
-            DECREF(entry->key);
-            DECREF(entry->value);
-            FREEMEM(entry);
-            entry = next_entry;
-        }
+    // All nodes, including the dummies, are part of the list starting at
+    // the dummy node of bucket 0.
+    LFRegEntry *entry = *SI_bucket_slot(self, 0, false);
+    while (entry) {
+        LFRegEntry *next_entry = entry->next;
+        DECREF(entry->key);
+        DECREF(entry->value);
+        FREEMEM(entry);
+        entry = next_entry;
+    }
+
+    for (size_t i = 0; i < MAX_SEGMENTS; i++) {
+        FREEMEM((void*)self->segments[i]);
     }
-    FREEMEM(self->entries);
 
     FREEMEM(self);
 }
 
-
@@ -25,7 +25,8 @@
 extern "C" {
 #endif
 
-/** Specialized lock free hash table for storing Classes.
+/** Specialized lock free hash table for storing Classes.  Grows without
+ * blocking readers.
  */
 
 struct cfish_Obj;
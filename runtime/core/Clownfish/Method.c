@@ -24,6 +24,7 @@
 #include "Clownfish/Err.h"
 #include "Clownfish/Class.h"
 #include "Clownfish/CharBuf.h"
+#include "Clownfish/Util/Arena.h"
 
 Method*
 Method_new(String *name, cfish_method_t callback_func, uint32_t offset) {
@@ -72,11 +73,15 @@ Method_Set_Host_Alias_IMP(Method *self, String *name) {
     if (self->host_alias) {
         THROW(ERR, "Can't Set_Host_Alias more than once");
     }
+    // Methods live forever, so the alias must not be allocated from an
+    // Arena.
+    Arena *arena = Arena_suspend();
     self->host_alias_internal
         = Str_new_from_trusted_utf8(Str_Get_Ptr8(name), Str_Get_Size(name));
     self->host_alias
         = Str_new_wrap_trusted_utf8(Str_Get_Ptr8(self->host_alias_internal),
                                     Str_Get_Size(self->host_alias_internal));
+    Arena_resume(arena);
 }
 
 String*
@@ -19,6 +19,7 @@
 #define CFISH_USE_SHORT_NAMES
 
 #include <float.h>
+#include <string.h>
 
 #include "charmony.h"
 
@@ -26,6 +27,8 @@
 #include "Clownfish/String.h"
 #include "Clownfish/Err.h"
 #include "Clownfish/Class.h"
+#include "Clownfish/Util/Atomic.h"
+#include "Clownfish/Util/Memory.h"
 
 #if FLT_RADIX != 2
   #error Unsupported FLT_RADIX
@@ -43,14 +46,80 @@
 // wrong results.
 #define POW_2_63 9223372036854775808.0
 
+// Range of preallocated Integers.  Can be overridden at compile time.
+#ifndef CFISH_INT_CACHE_MIN
+  #define CFISH_INT_CACHE_MIN -128
+#endif
+#ifndef CFISH_INT_CACHE_MAX
+  #define CFISH_INT_CACHE_MAX 1023
+#endif
+#define INT_CACHE_SIZE (CFISH_INT_CACHE_MAX - CFISH_INT_CACHE_MIN + 1)
+
+// Cached Floats and Integers live in a single block of memory, so the
+// inline refcount code can recognize them with a range check.
+typedef struct {
+    Float   floats[2];
+    Integer ints[INT_CACHE_SIZE];
+} NumCache;
+
+char   *cfish_num_cache_start;
+size_t  cfish_num_cache_size;
+
+static NumCache *Num_cache;
+
 static int32_t
 S_compare_i64_f64(int64_t i64, double f64);
 
 static bool
 S_equals_i64_f64(int64_t i64, double f64);
 
+static void
+S_init_cache() {
+    if (Num_cache) { return; }
+
+    NumCache *cache = (NumCache*)CALLOCATE(1, sizeof(NumCache));
+    Float_init((Float*)Class_Init_Obj(FLOAT, &cache->floats[0]), 0.0);
+    Float_init((Float*)Class_Init_Obj(FLOAT, &cache->floats[1]), 1.0);
+    for (int64_t i = 0; i < INT_CACHE_SIZE; i++) {
+        Int_init((Integer*)Class_Init_Obj(INTEGER, &cache->ints[i]),
+                 i + CFISH_INT_CACHE_MIN);
+    }
+    if (Atomic_cas_ptr((void**)&Num_cache, NULL, cache)) {
+        cfish_num_cache_start = (char*)cache;
+        cfish_num_cache_size  = sizeof(NumCache);
+    }
+    else {
+        // Another thread was faster.
+        FREEMEM(cache);
+    }
+}
+
+void
+Float_init_class() {
+    S_init_cache();
+}
+
+// Compare bit patterns so that -0.0 and NaNs never match.
+static CFISH_INLINE bool
+SI_same_bits(double a, double b) {
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+bool
+Float_is_cached(Float *self) {
+    return cfish_num_is_cached(self);
+}
+
 Float*
 Float_new(double value) {
+    if (Num_cache) {
+        if (SI_same_bits(value, 0.0)) {
+            return (Float*)INCREF(&Num_cache->floats[0]);
+        }
+        if (SI_same_bits(value, 1.0)) {
+            return (Float*)INCREF(&Num_cache->floats[1]);
+        }
+    }
     Float *self = (Float*)Class_Make_Obj(FLOAT);
     return Float_init(self, value);
 }
@@ -119,8 +188,24 @@ Float_Clone_IMP(Float *self) {
 
 /***************************************************************************/
 
+void
+Int_init_class() {
+    S_init_cache();
+}
+
+bool
+Int_is_cached(Integer *self) {
+    return cfish_num_is_cached(self);
+}
+
 Integer*
 Int_new(int64_t value) {
+    if (value >= CFISH_INT_CACHE_MIN
+        && value <= CFISH_INT_CACHE_MAX
+        && Num_cache != NULL
+       ) {
+        return (Integer*)INCREF(&Num_cache->ints[value - CFISH_INT_CACHE_MIN]);
+    }
     Integer *self = (Integer*)Class_Make_Obj(INTEGER);
     return Int_init(self, value);
 }
@@ -29,20 +29,29 @@
 #include "Clownfish/Err.h"
 #include "Clownfish/Hash.h"
 #include "Clownfish/Class.h"
+#include "Clownfish/ObjPool.h"
+#include "Clownfish/Util/AllocStats.h"
+#include "Clownfish/Util/Arena.h"
 #include "Clownfish/Util/Memory.h"
 
 static CFISH_INLINE bool
 SI_obj_is_a(Obj *obj, Class *ancestor) {
-    Class *klass = obj->klass;
+    Class    *klass = obj->klass;
+    uint32_t  depth = ancestor->depth;
 
-    while (klass != NULL) {
-        if (klass == ancestor) {
-            return true;
-        }
+    if (depth < CFISH_CLASS_DISPLAY_SIZE) {
+        return klass->display[depth] == ancestor;
+    }
+
+    // Ancestors too deep for the display.
+    if (klass->depth < depth) {
+        return false;
+    }
+    while (klass->depth > depth) {
         klass = klass->parent;
     }
 
-    return false;
+    return klass == ancestor;
 }
 
 Obj*
@@ -53,12 +62,26 @@ Obj_init(Obj *self) {
 
 void
 Obj_Destroy_IMP(Obj *self) {
-    FREEMEM(self);
+    ALLOCSTATS_OBJ_FREE(self->klass);
+    // Arena objects are freed when their arena is released.
+    if (Arena_owns_obj(self)) { return; }
+#ifdef CFISH_OBJ_POOL
+    ObjPool_free(self, self->klass->obj_alloc_size);
+#else
+    Memory_sized_free(self, self->klass->obj_alloc_size);
+#endif
+}
+
+void
+Obj_Traverse_IMP(Obj *self, Obj_Visit_t visit, void *context) {
+    UNUSED_VAR(self);
+    UNUSED_VAR(visit);
+    UNUSED_VAR(context);
 }
 
 bool
 Obj_is_a(Obj *self, Class *ancestor) {
-    return self ? SI_obj_is_a(self, ancestor) : false;
+    return self && ancestor ? SI_obj_is_a(self, ancestor) : false;
 }
 
 Obj*
@@ -0,0 +1,278 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define CFISH_USE_SHORT_NAMES
+
+#include "charmony.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Clownfish/ObjPool.h"
+#include "Clownfish/Util/Atomic.h"
+#include "Clownfish/Util/Memory.h"
+
+/* Blocks are carved out of slabs of BATCH_SIZE blocks which are never
+ * returned to the system.  Free blocks are linked through their first word.
+ * Batches of free blocks in the depot are linked through the second word of
+ * their first block.
+ */
+#define SIZE_CLASS_SHIFT 4
+#define NUM_SIZE_CLASSES 16
+#define MAX_POOLED_SIZE  (NUM_SIZE_CLASSES << SIZE_CLASS_SHIFT)
+#define BATCH_SIZE       64
+
+typedef struct FreeBlock {
+    struct FreeBlock *next;
+    struct FreeBlock *next_batch;
+} FreeBlock;
+
+typedef struct {
+    FreeBlock *head;
+    size_t     count;
+} FreeList;
+
+typedef struct {
+    FreeList lists[NUM_SIZE_CLASSES];
+} ThreadCache;
+
+typedef struct {
+    void *volatile  lock;
+    FreeBlock      *batches;
+} Depot;
+
+static Depot depots[NUM_SIZE_CLASSES];
+
+static ThreadCache*
+S_get_cache(void);
+
+static CFISH_INLINE void
+SI_lock(void *volatile *lock) {
+    while (!Atomic_cas_ptr(lock, NULL, (void*)lock)) {
+        while (*lock != NULL) { /* spin */ }
+    }
+}
+
+static CFISH_INLINE void
+SI_unlock(void *volatile *lock) {
+    Atomic_cas_ptr(lock, (void*)lock, NULL);
+}
+
+// Move up to `max` blocks from a thread's free list to the depot.
+static void
+S_flush(FreeList *list, size_t size_class, size_t max) {
+    FreeBlock *batch = list->head;
+    FreeBlock *last  = batch;
+    size_t     count = 1;
+
+    if (batch == NULL) { return; }
+    while (count < max && last->next != NULL) {
+        last = last->next;
+        count++;
+    }
+    list->head   = last->next;
+    list->count -= count;
+    last->next   = NULL;
+
+    Depot *depot = &depots[size_class];
+    SI_lock(&depot->lock);
+    batch->next_batch = depot->batches;
+    depot->batches    = batch;
+    SI_unlock(&depot->lock);
+}
+
+// Refill an empty free list from the depot or with a new slab.
+static void
+S_refill(FreeList *list, size_t size_class) {
+    Depot     *depot = &depots[size_class];
+    FreeBlock *batch = NULL;
+
+    if (depot->batches != NULL) {
+        SI_lock(&depot->lock);
+        batch = depot->batches;
+        if (batch) { depot->batches = batch->next_batch; }
+        SI_unlock(&depot->lock);
+    }
+
+    if (batch) {
+        size_t count = 0;
+        for (FreeBlock *block = batch; block; block = block->next) {
+            count++;
+        }
+        list->head  = batch;
+        list->count = count;
+        return;
+    }
+
+    size_t  block_size = (size_class + 1) << SIZE_CLASS_SHIFT;
+    char   *slab       = (char*)MALLOCATE(BATCH_SIZE * block_size);
+    for (size_t i = 0; i < BATCH_SIZE - 1; i++) {
+        ((FreeBlock*)(slab + i * block_size))->next
+            = (FreeBlock*)(slab + (i + 1) * block_size);
+    }
+    ((FreeBlock*)(slab + (BATCH_SIZE - 1) * block_size))->next = NULL;
+    list->head  = (FreeBlock*)slab;
+    list->count = BATCH_SIZE;
+}
+
+void*
+ObjPool_alloc(size_t size) {
+    // Sizes of zero wrap around and aren't pooled.
+    size_t size_class = (size - 1) >> SIZE_CLASS_SHIFT;
+    if (size_class >= NUM_SIZE_CLASSES) {
+        return CALLOCATE(size, 1);
+    }
+
+    FreeList *list = &S_get_cache()->lists[size_class];
+    if (list->head == NULL) {
+        S_refill(list, size_class);
+    }
+
+    FreeBlock *block = list->head;
+    list->head = block->next;
+    list->count--;
+
+    memset(block, 0, size);
+    return block;
+}
+
+void
+ObjPool_free(void *ptr, size_t size) {
+    size_t size_class = (size - 1) >> SIZE_CLASS_SHIFT;
+    if (size_class >= NUM_SIZE_CLASSES) {
+        Memory_sized_free(ptr, size);
+        return;
+    }
+
+    FreeList  *list  = &S_get_cache()->lists[size_class];
+    FreeBlock *block = (FreeBlock*)ptr;
+    block->next = list->head;
+    list->head  = block;
+    list->count++;
+
+    if (list->count >= 2 * BATCH_SIZE) {
+        S_flush(list, size_class, BATCH_SIZE);
+    }
+}
+
+#ifndef CFISH_NOTHREADS
+// Hand all blocks of an exiting thread to the depot.
+static void
+S_destroy_cache(void *arg) {
+    ThreadCache *cache = (ThreadCache*)arg;
+    for (size_t i = 0; i < NUM_SIZE_CLASSES; i++) {
+        FreeList *list = &cache->lists[i];
+        while (list->head != NULL) {
+            S_flush(list, i, BATCH_SIZE);
+        }
+    }
+    FREEMEM(cache);
+}
+#endif
+
+/**************************** No thread support ****************************/
+#ifdef CFISH_NOTHREADS
+
+static ThreadCache thread_cache;
+
+static ThreadCache*
+S_get_cache(void) {
+    return &thread_cache;
+}
+
+/********************************** Windows ********************************/
+#elif defined(CHY_HAS_WINDOWS_H)
+
+#include <windows.h>
+
+// Fiber local storage supports a destructor callback.
+static DWORD cache_fls_index = FLS_OUT_OF_INDEXES;
+
+static VOID WINAPI
+S_fls_destroy_cache(PVOID arg) {
+    if (arg) { S_destroy_cache(arg); }
+}
+
+static ThreadCache*
+S_get_cache(void) {
+    if (cache_fls_index == FLS_OUT_OF_INDEXES) {
+        DWORD fls_index = FlsAlloc(S_fls_destroy_cache);
+        if (fls_index == FLS_OUT_OF_INDEXES) {
+            fprintf(stderr, "FlsAlloc failed (FLS_OUT_OF_INDEXES)\n");
+            abort();
+        }
+        if (InterlockedCompareExchange((LONG*)&cache_fls_index, fls_index,
+                                       FLS_OUT_OF_INDEXES)
+            != (LONG)FLS_OUT_OF_INDEXES
+           ) {
+            FlsFree(fls_index);
+        }
+    }
+
+    ThreadCache *cache = (ThreadCache*)FlsGetValue(cache_fls_index);
+    if (!cache) {
+        cache = (ThreadCache*)CALLOCATE(1, sizeof(ThreadCache));
+        if (!FlsSetValue(cache_fls_index, cache)) {
+            fprintf(stderr, "FlsSetValue failed: %lu\n", GetLastError());
+            abort();
+        }
+    }
+
+    return cache;
+}
+
+/******************************** pthreads *********************************/
+#elif defined(CHY_HAS_PTHREAD_H)
+
+#include <pthread.h>
+
+static pthread_key_t  cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+static void
+S_create_cache_key(void) {
+    int error = pthread_key_create(&cache_key, S_destroy_cache);
+    if (error) {
+        fprintf(stderr, "pthread_key_create failed: %d\n", error);
+        abort();
+    }
+}
+
+static ThreadCache*
+S_get_cache(void) {
+    pthread_once(&cache_key_once, S_create_cache_key);
+
+    ThreadCache *cache = (ThreadCache*)pthread_getspecific(cache_key);
+    if (!cache) {
+        cache = (ThreadCache*)CALLOCATE(1, sizeof(ThreadCache));
+        int error = pthread_setspecific(cache_key, cache);
+        if (error) {
+            fprintf(stderr, "pthread_setspecific failed: %d\n", error);
+            abort();
+        }
+    }
+
+    return cache;
+}
+
+/****************** No support for thread-local storage ********************/
+#else
+
+#error "No support for thread-local storage."
+
+#endif
+
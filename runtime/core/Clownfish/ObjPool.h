@@ -0,0 +1,60 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef H_CLOWNFISH_OBJPOOL
+#define H_CLOWNFISH_OBJPOOL 1
+
+#include <stddef.h>
+
+#include "cfish_parcel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size-segregated memory pools for small objects.
+ *
+ * Every thread keeps a free list per size class.  Surplus blocks move to a
+ * global depot in batches and threads refill their lists from there, so
+ * blocks freed in one thread are reused by others.  Larger allocations are
+ * passed through to the system allocator.
+ *
+ * The host enables pooling of objects created with Class_Make_Obj by
+ * defining CFISH_OBJ_POOL.
+ */
+
+/** Allocate `size` bytes of zeroed memory.
+ */
+CFISH_VISIBLE void*
+cfish_ObjPool_alloc(size_t size);
+
+/** Release memory obtained from [](cfish_ObjPool_alloc).  `size` must
+ * match the size passed to `alloc`.
+ */
+CFISH_VISIBLE void
+cfish_ObjPool_free(void *ptr, size_t size);
+
+#ifdef CFISH_USE_SHORT_NAMES
+  #define ObjPool_alloc   cfish_ObjPool_alloc
+  #define ObjPool_free    cfish_ObjPool_free
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H_CLOWNFISH_OBJPOOL */
+
@@ -22,6 +22,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <time.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+  #define STR_UTF8_X86
+  #include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  #define STR_UTF8_NEON
+  #include <arm_neon.h>
+#endif
 
 #include "Clownfish/Class.h"
 #include "Clownfish/String.h"
@@ -29,21 +39,23 @@
 #include "Clownfish/ByteBuf.h"
 #include "Clownfish/CharBuf.h"
 #include "Clownfish/Err.h"
+#include "Clownfish/LockFreeRegistry.h"
+#include "Clownfish/StringSearcher.h"
+#include "Clownfish/Util/AllocStats.h"
+#include "Clownfish/Util/Arena.h"
+#include "Clownfish/Util/Atomic.h"
 #include "Clownfish/Util/Memory.h"
 
 #define STACK_ITER(string, byte_offset) \
     S_new_stack_iter(alloca(sizeof(StringIterator)), string, byte_offset)
 
-static const char*
-S_memmem(String *self, const char *substring, size_t size);
-
 static StringIterator*
 S_new_stack_iter(void *allocation, String *string, size_t byte_offset);
 
 // Return a pointer to the first invalid UTF-8 sequence, or NULL if
 // the UTF-8 is valid.
 static const uint8_t*
-S_find_invalid_utf8(const uint8_t *string, size_t size) {
+S_find_invalid_utf8_scalar(const uint8_t *string, size_t size) {
     const uint8_t *const end = string + size;
     while (string < end) {
         const uint8_t *start = string;
@@ -103,6 +115,332 @@ S_find_invalid_utf8(const uint8_t *string, size_t size) {
     return NULL;
 }
 
+/* Vectorized validation based on the lookup algorithm by John Keiser and
+ * Daniel Lemire ("Validating UTF-8 In Less Than One Instruction Per Byte",
+ * 2021).  Every byte is classified by three 16-entry tables indexed by the
+ * high nibble of the previous byte, the low nibble of the previous byte and
+ * the high nibble of the byte itself.  A bit which survives in all three
+ * lookups flags an error.  Continuation bytes required by three- and
+ * four-byte sequences are checked separately.
+ *
+ * The vector loops only detect that a block contains an error.  The scalar
+ * validator then rescans from the start of the last complete character to
+ * find the exact position, so error reports don't depend on the code path.
+ * It also handles the tail which doesn't fill a whole vector.
+ */
+
+#define UTF8_TOO_SHORT   0x01 /* lead byte not followed by continuation */
+#define UTF8_TOO_LONG    0x02 /* continuation after ASCII */
+#define UTF8_OVERLONG_3  0x04 /* E0 80..9F */
+#define UTF8_TOO_LARGE   0x08 /* F4 90..BF, F5..FF */
+#define UTF8_SURROGATE   0x10 /* ED A0..BF */
+#define UTF8_OVERLONG_2  0x20 /* C0..C1 */
+#define UTF8_TOO_LARGE_1000 0x40 /* F5..FF 80..8F */
+#define UTF8_OVERLONG_4  0x40 /* F0 80..8F */
+#define UTF8_TWO_CONTS   0x80 /* continuation after continuation */
+#define UTF8_CARRY       (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS)
+
+#if defined(STR_UTF8_X86) || defined(STR_UTF8_NEON)
+
+static const uint8_t utf8_byte_1_high[16] = {
+    // 0_______: ASCII
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,
+    // 10______: continuation
+    UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,
+    // 1100____
+    UTF8_TOO_SHORT | UTF8_OVERLONG_2,
+    // 1101____
+    UTF8_TOO_SHORT,
+    // 1110____
+    UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,
+    // 1111____
+    UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+};
+
+static const uint8_t utf8_byte_1_low[16] = {
+    // ____0000
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,
+    // ____0001
+    UTF8_CARRY | UTF8_OVERLONG_2,
+    // ____001_
+    UTF8_CARRY,
+    UTF8_CARRY,
+    // ____0100
+    UTF8_CARRY | UTF8_TOO_LARGE,
+    // ____0101 to ____1100
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    // ____1101
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,
+    // ____111_
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,
+    UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+};
+
+static const uint8_t utf8_byte_2_high[16] = {
+    // 0_______: ASCII
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,
+    // 1000____
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3
+    | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,
+    // 1001____
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3
+    | UTF8_TOO_LARGE,
+    // 101_____
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE
+    | UTF8_TOO_LARGE,
+    UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE
+    | UTF8_TOO_LARGE,
+    // 11______: lead byte
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+};
+
+/* Return the start of the character which contains the byte before `ptr`
+ * if that character might extend to `ptr` or beyond.  Otherwise, return
+ * `ptr`.  Everything before the returned position has been validated.
+ */
+static CFISH_INLINE const uint8_t*
+SI_utf8_restart(const uint8_t *begin, const uint8_t *ptr) {
+    for (int i = 1; i <= 3 && ptr - i >= begin; i++) {
+        uint8_t byte = ptr[-i];
+        if (byte >= 0xC0) { return ptr - i; }
+        if (byte < 0x80)  { break; }
+    }
+    return ptr;
+}
+
+#endif /* STR_UTF8_X86 || STR_UTF8_NEON */
+
+#ifdef STR_UTF8_X86
+
+__attribute__((target("sse4.2")))
+static const uint8_t*
+S_find_invalid_utf8_sse42(const uint8_t *string, size_t size) {
+    const uint8_t *const end = string + size;
+    const uint8_t *ptr = string;
+    const __m128i table1 = _mm_loadu_si128((const __m128i*)utf8_byte_1_high);
+    const __m128i table2 = _mm_loadu_si128((const __m128i*)utf8_byte_1_low);
+    const __m128i table3 = _mm_loadu_si128((const __m128i*)utf8_byte_2_high);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    const __m128i high   = _mm_set1_epi8((char)0x80);
+    const __m128i third  = _mm_set1_epi8((char)(0xE0 - 0x80));
+    const __m128i fourth = _mm_set1_epi8((char)(0xF0 - 0x80));
+    __m128i prev_input = _mm_setzero_si128();
+    bool    prev_ascii = true;
+
+    while (end - ptr >= 16) {
+        if (prev_ascii && end - ptr >= 64) {
+            // ASCII fast path.
+            __m128i any = _mm_or_si128(
+                _mm_or_si128(_mm_loadu_si128((const __m128i*)ptr),
+                             _mm_loadu_si128((const __m128i*)(ptr + 16))),
+                _mm_or_si128(_mm_loadu_si128((const __m128i*)(ptr + 32)),
+                             _mm_loadu_si128((const __m128i*)(ptr + 48))));
+            if (_mm_movemask_epi8(any) == 0) {
+                ptr += 64;
+                continue;
+            }
+        }
+
+        __m128i input = _mm_loadu_si128((const __m128i*)ptr);
+        bool    ascii = _mm_movemask_epi8(input) == 0;
+        if (!(ascii && prev_ascii)) {
+            __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+            __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+            __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+            __m128i special = _mm_and_si128(
+                _mm_and_si128(
+                    _mm_shuffle_epi8(table1, _mm_and_si128(
+                        _mm_srli_epi16(prev1, 4), nibble)),
+                    _mm_shuffle_epi8(table2, _mm_and_si128(prev1, nibble))),
+                _mm_shuffle_epi8(table3, _mm_and_si128(
+                    _mm_srli_epi16(input, 4), nibble)));
+            __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, third),
+                                          _mm_subs_epu8(prev3, fourth));
+            __m128i error
+                = _mm_xor_si128(_mm_and_si128(must23, high), special);
+            if (!_mm_testz_si128(error, error)) { break; }
+        }
+
+        prev_input = input;
+        prev_ascii = ascii;
+        ptr += 16;
+    }
+
+    const uint8_t *restart = SI_utf8_restart(string, ptr);
+    return S_find_invalid_utf8_scalar(restart, (size_t)(end - restart));
+}
+
+__attribute__((target("avx2")))
+static const uint8_t*
+S_find_invalid_utf8_avx2(const uint8_t *string, size_t size) {
+    const uint8_t *const end = string + size;
+    const uint8_t *ptr = string;
+    const __m256i table1 = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)utf8_byte_1_high));
+    const __m256i table2 = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)utf8_byte_1_low));
+    const __m256i table3 = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128((const __m128i*)utf8_byte_2_high));
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i high   = _mm256_set1_epi8((char)0x80);
+    const __m256i third  = _mm256_set1_epi8((char)(0xE0 - 0x80));
+    const __m256i fourth = _mm256_set1_epi8((char)(0xF0 - 0x80));
+    __m256i prev_input = _mm256_setzero_si256();
+    bool    prev_ascii = true;
+
+    while (end - ptr >= 32) {
+        if (prev_ascii && end - ptr >= 64) {
+            // ASCII fast path.
+            __m256i any = _mm256_or_si256(
+                _mm256_loadu_si256((const __m256i*)ptr),
+                _mm256_loadu_si256((const __m256i*)(ptr + 32)));
+            if (_mm256_movemask_epi8(any) == 0) {
+                ptr += 64;
+                continue;
+            }
+        }
+
+        __m256i input = _mm256_loadu_si256((const __m256i*)ptr);
+        bool    ascii = _mm256_movemask_epi8(input) == 0;
+        if (!(ascii && prev_ascii)) {
+            // Bytes 16..31 of prev_input followed by bytes 0..15 of input.
+            __m256i shifted = _mm256_permute2x128_si256(prev_input, input,
+                                                        0x21);
+            __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+            __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+            __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+            __m256i special = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(table1, _mm256_and_si256(
+                        _mm256_srli_epi16(prev1, 4), nibble)),
+                    _mm256_shuffle_epi8(table2,
+                                        _mm256_and_si256(prev1, nibble))),
+                _mm256_shuffle_epi8(table3, _mm256_and_si256(
+                    _mm256_srli_epi16(input, 4), nibble)));
+            __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, third),
+                                             _mm256_subs_epu8(prev3, fourth));
+            __m256i error
+                = _mm256_xor_si256(_mm256_and_si256(must23, high), special);
+            if (!_mm256_testz_si256(error, error)) { break; }
+        }
+
+        prev_input = input;
+        prev_ascii = ascii;
+        ptr += 32;
+    }
+
+    const uint8_t *restart = SI_utf8_restart(string, ptr);
+    return S_find_invalid_utf8_scalar(restart, (size_t)(end - restart));
+}
+
+#endif /* STR_UTF8_X86 */
+
+#ifdef STR_UTF8_NEON
+
+static const uint8_t*
+S_find_invalid_utf8_neon(const uint8_t *string, size_t size) {
+    const uint8_t *const end = string + size;
+    const uint8_t *ptr = string;
+    const uint8x16_t table1 = vld1q_u8(utf8_byte_1_high);
+    const uint8x16_t table2 = vld1q_u8(utf8_byte_1_low);
+    const uint8x16_t table3 = vld1q_u8(utf8_byte_2_high);
+    const uint8x16_t nibble = vdupq_n_u8(0x0F);
+    const uint8x16_t high   = vdupq_n_u8(0x80);
+    const uint8x16_t third  = vdupq_n_u8(0xE0 - 0x80);
+    const uint8x16_t fourth = vdupq_n_u8(0xF0 - 0x80);
+    uint8x16_t prev_input = vdupq_n_u8(0);
+    bool       prev_ascii = true;
+
+    while (end - ptr >= 16) {
+        if (prev_ascii && end - ptr >= 64) {
+            // ASCII fast path.
+            uint8x16_t any = vorrq_u8(
+                vorrq_u8(vld1q_u8(ptr), vld1q_u8(ptr + 16)),
+                vorrq_u8(vld1q_u8(ptr + 32), vld1q_u8(ptr + 48)));
+            if (vmaxvq_u8(any) < 0x80) {
+                ptr += 64;
+                continue;
+            }
+        }
+
+        uint8x16_t input = vld1q_u8(ptr);
+        bool       ascii = vmaxvq_u8(input) < 0x80;
+        if (!(ascii && prev_ascii)) {
+            uint8x16_t prev1 = vextq_u8(prev_input, input, 15);
+            uint8x16_t prev2 = vextq_u8(prev_input, input, 14);
+            uint8x16_t prev3 = vextq_u8(prev_input, input, 13);
+            uint8x16_t special = vandq_u8(
+                vandq_u8(vqtbl1q_u8(table1, vshrq_n_u8(prev1, 4)),
+                         vqtbl1q_u8(table2, vandq_u8(prev1, nibble))),
+                vqtbl1q_u8(table3, vshrq_n_u8(input, 4)));
+            uint8x16_t must23 = vorrq_u8(vqsubq_u8(prev2, third),
+                                         vqsubq_u8(prev3, fourth));
+            uint8x16_t error = veorq_u8(vandq_u8(must23, high), special);
+            if (vmaxvq_u8(error) != 0) { break; }
+        }
+
+        prev_input = input;
+        prev_ascii = ascii;
+        ptr += 16;
+    }
+
+    const uint8_t *restart = SI_utf8_restart(string, ptr);
+    return S_find_invalid_utf8_scalar(restart, (size_t)(end - restart));
+}
+
+#endif /* STR_UTF8_NEON */
+
+typedef const uint8_t*
+(*S_find_invalid_utf8_t)(const uint8_t *string, size_t size);
+
+// Selected once by Str_init_class, before other threads can run.  Until
+// then, the scalar code is used.
+static S_find_invalid_utf8_t find_invalid_utf8_impl;
+
+static S_find_invalid_utf8_t
+S_select_find_invalid_utf8(void) {
+#if defined(STR_UTF8_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return S_find_invalid_utf8_avx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return S_find_invalid_utf8_sse42;
+    }
+    return S_find_invalid_utf8_scalar;
+#elif defined(STR_UTF8_NEON)
+    return S_find_invalid_utf8_neon;
+#else
+    return S_find_invalid_utf8_scalar;
+#endif
+}
+
+static const uint8_t*
+S_find_invalid_utf8(const uint8_t *string, size_t size) {
+    if (size < 16) {
+        return S_find_invalid_utf8_scalar(string, size);
+    }
+    S_find_invalid_utf8_t impl = find_invalid_utf8_impl;
+    if (impl == NULL) {
+        return S_find_invalid_utf8_scalar(string, size);
+    }
+    return impl(string, size);
+}
+
+void
+Str_init_class() {
+    find_invalid_utf8_impl = S_select_find_invalid_utf8();
+}
+
 bool
 Str_utf8_valid(const char *ptr, size_t size) {
     return S_find_invalid_utf8((const uint8_t*)ptr, size) == NULL;
@@ -219,6 +557,19 @@ Str_new_from_utf8(const char *utf8, size_t size) {
     return Str_init_from_trusted_utf8(self, utf8, size);
 }
 
+// Content of up to this many bytes is stored in the String object itself.
+#define INLINE_MAX_SIZE (sizeof(((String*)NULL)->inline_buf) - 1)
+
+// Return a buffer for `size` bytes of content plus a terminating NUL.
+static char*
+S_alloc_content(String *self, size_t size) {
+    if (size <= INLINE_MAX_SIZE) {
+        return self->inline_buf;
+    }
+    ALLOCSTATS_BUF_ALLOC(self->klass, size + 1);
+    return (char*)Arena_buf_malloc(self, size + 1);
+}
+
 String*
 Str_new_from_trusted_utf8(const char *utf8, size_t size) {
     String *self = (String*)Class_Make_Obj(STRING);
@@ -228,16 +579,20 @@ Str_new_from_trusted_utf8(const char *utf8, size_t size) {
 String*
 Str_init_from_trusted_utf8(String *self, const char *utf8, size_t size) {
     // Allocate.
-    char *ptr = (char*)MALLOCATE(size + 1);
+    char *ptr = S_alloc_content(self, size);
 
     // Copy.
     memcpy(ptr, utf8, size);
     ptr[size] = '\0'; // Null terminate.
 
     // Assign.
-    self->ptr    = ptr;
-    self->size   = size;
-    self->origin = self;
+    self->ptr      = ptr;
+    self->size     = size;
+    self->origin   = self;
+    self->hash_sum = 0;
+    self->interned = false;
+    self->length   = 0;
+    self->cp_index = NULL;
 
     return self;
 }
@@ -257,9 +612,14 @@ Str_new_steal_trusted_utf8(char *utf8, size_t size) {
 
 String*
 Str_init_steal_trusted_utf8(String *self, char *utf8, size_t size) {
-    self->ptr    = utf8;
-    self->size   = size;
-    self->origin = self;
+    self->ptr      = (char*)Arena_buf_adopt(self, utf8, size + 1);
+    ALLOCSTATS_BUF_ALLOC(self->klass, size + 1);
+    self->size     = size;
+    self->origin   = self;
+    self->hash_sum = 0;
+    self->interned = false;
+    self->length   = 0;
+    self->cp_index = NULL;
     return self;
 }
 
@@ -284,26 +644,88 @@ Str_init_stack_string(void *allocation, const char *utf8, size_t size) {
 
 String*
 Str_init_wrap_trusted_utf8(String *self, const char *ptr, size_t size) {
-    self->ptr    = ptr;
-    self->size   = size;
-    self->origin = NULL;
+    self->ptr      = ptr;
+    self->size     = size;
+    self->origin   = NULL;
+    self->hash_sum = 0;
+    self->interned = false;
+    self->length   = 0;
+    self->cp_index = NULL;
     return self;
 }
 
 String*
 Str_new_from_char(int32_t code_point) {
     const size_t MAX_UTF8_BYTES = 4;
-    char   *ptr  = (char*)MALLOCATE(MAX_UTF8_BYTES + 1);
+    String *self = (String*)Class_Make_Obj(STRING);
+    char   *ptr  = S_alloc_content(self, MAX_UTF8_BYTES);
     size_t  size = Str_encode_utf8_char(code_point, (uint8_t*)ptr);
     ptr[size] = '\0';
 
-    String *self = (String*)Class_Make_Obj(STRING);
-    self->ptr    = ptr;
-    self->size   = size;
-    self->origin = self;
+    self->ptr      = ptr;
+    self->size     = size;
+    self->origin   = self;
+    self->hash_sum = 0;
+    self->interned = false;
+    self->length   = 0;
+    self->cp_index = NULL;
     return self;
 }
 
+bool Str_intern_host_keys = false;
+
+static LockFreeRegistry *volatile intern_pool;
+
+static LockFreeRegistry*
+S_intern_pool(void) {
+    LockFreeRegistry *pool = intern_pool;
+    if (pool == NULL) {
+        pool = LFReg_new(256);
+        if (!Atomic_cas_ptr((void*volatile*)&intern_pool, NULL, pool)) {
+            // Another thread was faster.
+            LFReg_destroy(pool);
+            pool = intern_pool;
+        }
+    }
+    return pool;
+}
+
+String*
+Str_intern(String *string) {
+    if (string->interned) { return (String*)INCREF(string); }
+
+    LockFreeRegistry *pool = S_intern_pool();
+    String *canonical = (String*)LFReg_fetch(pool, string);
+    if (canonical) { return (String*)INCREF(canonical); }
+
+    // Interned Strings live forever, so they must not be allocated from
+    // an Arena.
+    Arena *arena = Arena_suspend();
+    canonical = Str_new_from_trusted_utf8(string->ptr, string->size);
+    Arena_resume(arena);
+    Str_Hash_Sum(canonical);
+
+    // Only flag the String as interned once it's registered.  Equals
+    // assumes that distinct interned Strings differ, so the registry
+    // couldn't detect a racing thread registering the same content.
+    if (LFReg_register(pool, canonical, (Obj*)canonical)) {
+        canonical->interned = true;
+    }
+    else {
+        // Another thread registered the same content in the meantime.
+        DECREF(canonical);
+        canonical = (String*)INCREF(LFReg_fetch(pool, string));
+    }
+
+    return canonical;
+}
+
+String*
+Str_intern_utf8(const char *utf8, size_t size) {
+    VALIDATE_UTF8(utf8, size);
+    return Str_intern(SSTR_WRAP_UTF8(utf8, size));
+}
+
 String*
 Str_newf(const char *pattern, ...) {
     CharBuf *buf = CB_new(strlen(pattern));
@@ -320,14 +742,19 @@ static String*
 S_new_substring(String *string, size_t byte_offset, size_t size) {
     String *self = (String*)Class_Make_Obj(STRING);
 
-    if (string->origin == NULL) {
-        // Copy substring of wrapped strings.
+    if (string->origin == NULL || size <= INLINE_MAX_SIZE) {
+        // Copy substring of wrapped strings.  Short substrings are copied
+        // as well because they fit into the String object.
         Str_init_from_trusted_utf8(self, string->ptr + byte_offset, size);
     }
     else {
-        self->ptr    = string->ptr + byte_offset;
-        self->size   = size;
-        self->origin = (String*)INCREF(string->origin);
+        self->ptr      = string->ptr + byte_offset;
+        self->size     = size;
+        self->origin   = (String*)INCREF(string->origin);
+        self->hash_sum = 0;
+        self->interned = false;
+        self->length   = 0;
+        self->cp_index = NULL;
     }
 
     return self;
@@ -338,10 +765,19 @@ Str_Is_Copy_On_IncRef_IMP(String *self) {
     return self->origin == NULL;
 }
 
+bool
+Str_Is_Interned_IMP(String *self) {
+    return self->interned;
+}
+
 void
 Str_Destroy_IMP(String *self) {
+    FREEMEM(self->cp_index);
     if (self->origin == self) {
-        FREEMEM((char*)self->ptr);
+        if (self->ptr != self->inline_buf) {
+            ALLOCSTATS_BUF_FREE(self->klass, self->size + 1);
+            Arena_buf_free(self, (char*)self->ptr);
+        }
     }
     else {
         DECREF(self->origin);
@@ -349,9 +785,64 @@ Str_Destroy_IMP(String *self) {
     SUPER_DESTROY(self, STRING);
 }
 
-size_t
-Str_Hash_Sum_IMP(String *self) {
-    size_t hashvalue = 5381;
+void
+Str_Traverse_IMP(String *self, Obj_Visit_t visit, void *context) {
+    if (self->origin && self->origin != self) {
+        visit(context, (Obj*)self->origin);
+    }
+}
+
+#ifdef CFISH_STR_HASH_SEED
+
+static uint64_t *volatile hash_seed;
+
+static CFISH_INLINE uint64_t
+SI_mix64(uint64_t x) {
+    // SplitMix64 finalizer.
+    x ^= x >> 30;
+    x *= UINT64_C(0xBF58476D1CE4E5B9);
+    x ^= x >> 27;
+    x *= UINT64_C(0x94D049BB133111EB);
+    x ^= x >> 31;
+    return x;
+}
+
+// Return the per-process hash seed, creating it on first use.  The seed
+// isn't cryptographically strong, but it varies between runs, which is
+// enough to defeat precomputed hash flooding attacks.
+static uint64_t
+S_hash_seed(void) {
+    uint64_t *seed = hash_seed;
+    if (seed != NULL) { return *seed; }
+
+    seed = (uint64_t*)MALLOCATE(sizeof(uint64_t));
+    uint64_t entropy = (uint64_t)time(NULL);
+    entropy ^= (uint64_t)clock() << 32;
+    entropy ^= (uint64_t)CHY_PTR_TO_I64(seed);
+    entropy ^= (uint64_t)CHY_PTR_TO_I64(&entropy) << 16;
+    *seed = SI_mix64(entropy);
+
+    if (!Atomic_cas_ptr((void*volatile*)&hash_seed, NULL, seed)) {
+        // Another thread beat us to it.
+        FREEMEM(seed);
+        seed = hash_seed;
+    }
+
+    return *seed;
+}
+
+#else /* CFISH_STR_HASH_SEED */
+
+#define S_hash_seed() UINT64_C(0)
+
+#endif /* CFISH_STR_HASH_SEED */
+
+#ifdef CFISH_STR_HASH_DJB
+
+// Legacy hash function: DJB's "times 33 xor" over code points.
+static size_t
+S_compute_hash_sum(String *self) {
+    size_t hashvalue = 5381 ^ (size_t)S_hash_seed();
     StringIterator *iter = STACK_ITER(self, 0);
 
     const StrIter_Next_t next = METHOD_PTR(STRINGITERATOR, CFISH_StrIter_Next);
@@ -363,6 +854,142 @@ Str_Hash_Sum_IMP(String *self) {
     return hashvalue;
 }
 
+#else /* CFISH_STR_HASH_DJB */
+
+/* Byte-oriented hash function based on wyhash (final version 4) by Wang Yi,
+ * which was released into the public domain.  Keys of up to 16 bytes are
+ * mixed with a single multiplication, longer keys are consumed 48 bytes per
+ * step in three independent lanes.
+ *
+ * Words are read in native byte order, so hash sums differ between little-
+ * and big-endian machines.  They are never persisted, so that's harmless.
+ */
+
+static const uint64_t wyhash_secret[4] = {
+    UINT64_C(0xA0761D6478BD642F), UINT64_C(0xE7037ED1A0B428DB),
+    UINT64_C(0x8EBC6AF09C88C6E3), UINT64_C(0x589965CC75374CC3)
+};
+
+static CFISH_INLINE void
+SI_wymum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+    __extension__ unsigned __int128 r = *a;
+    r *= *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32;
+    uint64_t la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static CFISH_INLINE uint64_t
+SI_wymix(uint64_t a, uint64_t b) {
+    SI_wymum(&a, &b);
+    return a ^ b;
+}
+
+static CFISH_INLINE uint64_t
+SI_wyr8(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static CFISH_INLINE uint64_t
+SI_wyr4(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static CFISH_INLINE uint64_t
+SI_wyr3(const uint8_t *p, size_t k) {
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+static uint64_t
+S_wyhash(const uint8_t *p, size_t len, uint64_t seed) {
+    const uint64_t *secret = wyhash_secret;
+    uint64_t a, b;
+
+    seed ^= SI_wymix(seed ^ secret[0], secret[1]);
+
+    if (len <= 16) {
+        if (len >= 4) {
+            size_t shift = (len >> 3) << 2;
+            a = (SI_wyr4(p) << 32) | SI_wyr4(p + shift);
+            b = (SI_wyr4(p + len - 4) << 32) | SI_wyr4(p + len - 4 - shift);
+        }
+        else if (len > 0) {
+            a = SI_wyr3(p, len);
+            b = 0;
+        }
+        else {
+            a = b = 0;
+        }
+    }
+    else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t see1 = seed;
+            uint64_t see2 = seed;
+            do {
+                seed = SI_wymix(SI_wyr8(p) ^ secret[1], SI_wyr8(p + 8) ^ seed);
+                see1 = SI_wymix(SI_wyr8(p + 16) ^ secret[2],
+                                SI_wyr8(p + 24) ^ see1);
+                see2 = SI_wymix(SI_wyr8(p + 32) ^ secret[3],
+                                SI_wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = SI_wymix(SI_wyr8(p) ^ secret[1], SI_wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = SI_wyr8(p + i - 16);
+        b = SI_wyr8(p + i - 8);
+    }
+
+    a ^= secret[1];
+    b ^= seed;
+    SI_wymum(&a, &b);
+    return SI_wymix(a ^ secret[0] ^ (uint64_t)len, b ^ secret[1]);
+}
+
+static size_t
+S_compute_hash_sum(String *self) {
+    return (size_t)S_wyhash((const uint8_t*)self->ptr, self->size,
+                            S_hash_seed());
+}
+
+#endif /* CFISH_STR_HASH_DJB */
+
+size_t
+Str_Hash_Sum_IMP(String *self) {
+    // Zero doubles as the "not yet computed" sentinel. Strings which
+    // really hash to zero are simply rehashed on every call.
+    //
+    // Strings are immutable and may be shared between threads, but every
+    // thread computes the same value, so the unsynchronized store is benign.
+    size_t hash_sum = self->hash_sum;
+    if (hash_sum == 0) {
+        hash_sum = S_compute_hash_sum(self);
+        self->hash_sum = hash_sum;
+    }
+    return hash_sum;
+}
+
 String*
 Str_To_String_IMP(String *self) {
     return (String*)INCREF(self);
@@ -449,12 +1076,20 @@ Str_Cat_Utf8_IMP(String *self, const char* ptr, size_t size) {
 String*
 Str_Cat_Trusted_Utf8_IMP(String *self, const char* ptr, size_t size) {
     size_t  result_size = self->size + size;
-    char   *result_ptr  = (char*)MALLOCATE(result_size + 1);
+    String *result      = (String*)Class_Make_Obj(STRING);
+    char   *result_ptr  = S_alloc_content(result, result_size);
     memcpy(result_ptr, self->ptr, self->size);
     memcpy(result_ptr + self->size, ptr, size);
     result_ptr[result_size] = '\0';
-    String *result = (String*)Class_Make_Obj(STRING);
-    return Str_init_steal_trusted_utf8(result, result_ptr, result_size);
+
+    result->ptr      = result_ptr;
+    result->size     = result_size;
+    result->origin   = result;
+    result->hash_sum = 0;
+    result->interned = false;
+    result->length   = 0;
+    result->cp_index = NULL;
+    return result;
 }
 
 bool
@@ -479,6 +1114,8 @@ Str_Equals_IMP(String *self, Obj *other) {
     String *const twin = (String*)other;
     if (twin == self)              { return true; }
     if (!Obj_is_a(other, STRING)) { return false; }
+    // Distinct interned Strings never have the same content.
+    if (self->interned && twin->interned) { return false; }
     return Str_Equals_Utf8(self, twin->ptr, twin->size);
 }
 
@@ -531,12 +1168,13 @@ Str_Ends_With_Utf8_IMP(String *self, const char *suffix, size_t suffix_len) {
 
 bool
 Str_Contains_IMP(String *self, String *substring) {
-    return !!S_memmem(self, substring->ptr, substring->size);
+    return !!StrSearcher_find_utf8(self->ptr, self->size, substring->ptr,
+                                   substring->size);
 }
 
 bool
 Str_Contains_Utf8_IMP(String *self, const char *substring, size_t size) {
-    return !!S_memmem(self, substring, size);
+    return !!StrSearcher_find_utf8(self->ptr, self->size, substring, size);
 }
 
 StringIterator*
@@ -546,28 +1184,11 @@ Str_Find_IMP(String *self, String *substring) {
 
 StringIterator*
 Str_Find_Utf8_IMP(String *self, const char *substring, size_t size) {
-    const char *ptr = S_memmem(self, substring, size);
+    const char *ptr
+        = StrSearcher_find_utf8(self->ptr, self->size, substring, size);
     return ptr ? StrIter_new(self, (size_t)(ptr - self->ptr)) : NULL;
 }
 
-static const char*
-S_memmem(String *self, const char *substring, size_t size) {
-    if (size == 0)         { return self->ptr; }
-    if (size > self->size) { return NULL;      }
-
-    const char *ptr = self->ptr;
-    const char *end = ptr + self->size - size + 1;
-    char first_char = substring[0];
-
-    // Naive string search.
-    while (NULL != (ptr = (const char*)memchr(ptr, first_char, (size_t)(end - ptr)))) {
-        if (memcmp(ptr, substring, size) == 0) { break; }
-        ptr++;
-    }
-
-    return ptr;
-}
-
 String*
 Str_Trim_IMP(String *self) {
     StringIterator *top = STACK_ITER(self, 0);
@@ -596,38 +1217,120 @@ Str_Trim_Tail_IMP(String *self) {
     return StrIter_crop(NULL, (StringIterator*)tail);
 }
 
+/* Random access by code point.  The number of code points is counted once
+ * and cached.  If it equals the byte size, the String is pure ASCII and
+ * code point offsets are byte offsets.  Otherwise, Strings of at least
+ * CP_INDEX_MIN_SIZE bytes which own or share a buffer get an index with
+ * the byte offset of every CP_INDEX_STRIDE-th code point, so that at most
+ * CP_INDEX_STRIDE - 1 code points have to be skipped.  Both are computed
+ * lazily.  Racing threads compute the same values, and the index is
+ * published with CAS.
+ *
+ * Wrapped Strings don't get an index because stack Strings are never
+ * destroyed.
+ */
+
+#define CP_INDEX_STRIDE   32
+#define CP_INDEX_MIN_SIZE 256
+
+static CFISH_INLINE size_t
+SI_length(String *self) {
+    size_t length = self->length;
+    if (length == 0 && self->size != 0) {
+        const uint8_t *ptr = (const uint8_t*)self->ptr;
+        for (size_t i = 0; i < self->size; i++) {
+            length += (ptr[i] & 0xC0) != 0x80;
+        }
+        self->length = length;
+    }
+    return length;
+}
+
+static const size_t*
+S_cp_index(String *self) {
+    size_t *index = self->cp_index;
+    if (index != NULL
+        || self->size < CP_INDEX_MIN_SIZE
+        || self->origin == NULL
+       ) {
+        return index;
+    }
+
+    size_t length = SI_length(self);
+    index = (size_t*)MALLOCATE((length / CP_INDEX_STRIDE + 1)
+                               * sizeof(size_t));
+    const uint8_t *ptr = (const uint8_t*)self->ptr;
+    size_t tick = 0;
+    for (size_t i = 0; i < self->size; i++) {
+        if ((ptr[i] & 0xC0) != 0x80) {
+            if (tick % CP_INDEX_STRIDE == 0) {
+                index[tick / CP_INDEX_STRIDE] = i;
+            }
+            tick++;
+        }
+    }
+
+    if (!Atomic_cas_ptr((void*volatile*)&self->cp_index, NULL, index)) {
+        // Another thread was faster.
+        FREEMEM(index);
+        index = self->cp_index;
+    }
+    return index;
+}
+
+// Return the byte offset of the code point at `tick`, or the size of the
+// String if `tick` is out of bounds.
+static size_t
+S_byte_offset(String *self, size_t tick) {
+    size_t length = SI_length(self);
+    if (tick >= length)       { return self->size; }
+    if (length == self->size) { return tick; }
+
+    size_t byte_offset = 0;
+    size_t cur_tick    = 0;
+    const size_t *index = S_cp_index(self);
+    if (index) {
+        byte_offset = index[tick / CP_INDEX_STRIDE];
+        cur_tick    = tick - tick % CP_INDEX_STRIDE;
+    }
+
+    const uint8_t *ptr = (const uint8_t*)self->ptr;
+    while (cur_tick < tick) {
+        do {
+            byte_offset++;
+        } while ((ptr[byte_offset] & 0xC0) == 0x80);
+        cur_tick++;
+    }
+
+    return byte_offset;
+}
+
 size_t
 Str_Length_IMP(String *self) {
-    StringIterator *iter = STACK_ITER(self, 0);
-    return StrIter_Advance(iter, SIZE_MAX);
+    return SI_length(self);
 }
 
 int32_t
 Str_Code_Point_At_IMP(String *self, size_t tick) {
-    StringIterator *iter = STACK_ITER(self, 0);
-    StrIter_Advance(iter, tick);
+    StringIterator *iter = STACK_ITER(self, S_byte_offset(self, tick));
     return StrIter_Next(iter);
 }
 
 int32_t
 Str_Code_Point_From_IMP(String *self, size_t tick) {
-    if (tick == 0) { return STR_OOB; }
-    StringIterator *iter = STACK_ITER(self, self->size);
-    StrIter_Recede(iter, tick - 1);
-    return StrIter_Prev(iter);
+    size_t length = SI_length(self);
+    if (tick == 0 || tick > length) { return STR_OOB; }
+    return Str_Code_Point_At_IMP(self, length - tick);
 }
 
 String*
 Str_SubString_IMP(String *self, size_t offset, size_t len) {
-    StringIterator *iter = STACK_ITER(self, 0);
-
-    StrIter_Advance(iter, offset);
-    size_t start_offset = iter->byte_offset;
-
-    StrIter_Advance(iter, len);
-    size_t size = iter->byte_offset - start_offset;
-
-    return S_new_substring(self, start_offset, size);
+    size_t length       = SI_length(self);
+    size_t start_offset = S_byte_offset(self, offset);
+    size_t end_offset   = offset < length && len < length - offset
+                          ? S_byte_offset(self, offset + len)
+                          : self->size;
+    return S_new_substring(self, start_offset, end_offset - start_offset);
 }
 
 size_t
@@ -975,4 +1678,10 @@ StrIter_Destroy_IMP(StringIterator *self) {
     SUPER_DESTROY(self, STRINGITERATOR);
 }
 
+void
+StrIter_Traverse_IMP(StringIterator *self, Obj_Visit_t visit,
+                     void *context) {
+    if (self->string) { visit(context, (Obj*)self->string); }
+}
+
 
@@ -0,0 +1,370 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_CFISH_STRING
+#define C_CFISH_STRINGSEARCHER
+#define CFISH_USE_SHORT_NAMES
+
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define STRSEARCH_SSE2
+  #include <emmintrin.h>
+#elif (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
+  #define STRSEARCH_NEON
+  #include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+  #include <intrin.h>
+#endif
+
+#include "Clownfish/Class.h"
+#include "Clownfish/String.h"
+#include "Clownfish/StringSearcher.h"
+#include "Clownfish/Util/Memory.h"
+
+/* Needles up to this size are searched by filtering candidate positions on
+ * their first and last byte.  The cost of verifying a candidate is bounded
+ * by the needle size, so even pathological inputs stay cheap.  Longer
+ * needles use Two-Way.
+ */
+#define SHORT_NEEDLE_MAX  32
+#define BLOCK_WIDTH       16
+#define SHIFT_TABLE_SIZE  256
+
+static const char*
+S_find_short(const char *haystack, size_t haystack_size,
+             const char *needle, size_t needle_size);
+
+static void
+S_two_way_prepare(const uint8_t *needle, size_t size, size_t *critical_pos,
+                  size_t *period, size_t *memory, size_t *shift);
+
+static const char*
+S_two_way_search(const uint8_t *haystack, size_t haystack_size,
+                 const uint8_t *needle, size_t size, size_t critical_pos,
+                 size_t period, size_t memory, const size_t *shift);
+
+StringSearcher*
+StrSearcher_new(String *needle) {
+    StringSearcher *self
+        = (StringSearcher*)Class_Make_Obj(STRINGSEARCHER);
+    return StrSearcher_init(self, needle);
+}
+
+StringSearcher*
+StrSearcher_init(StringSearcher *self, String *needle) {
+    self->needle       = (String*)INCREF(needle);
+    self->critical_pos = 0;
+    self->period       = 0;
+    self->memory       = 0;
+    self->shift        = NULL;
+
+    if (self->needle->size > SHORT_NEEDLE_MAX) {
+        self->shift
+            = (size_t*)MALLOCATE(SHIFT_TABLE_SIZE * sizeof(size_t));
+        S_two_way_prepare((const uint8_t*)self->needle->ptr,
+                          self->needle->size, &self->critical_pos,
+                          &self->period, &self->memory, self->shift);
+    }
+
+    return self;
+}
+
+void
+StrSearcher_Destroy_IMP(StringSearcher *self) {
+    DECREF(self->needle);
+    FREEMEM(self->shift);
+    SUPER_DESTROY(self, STRINGSEARCHER);
+}
+
+void
+StrSearcher_Traverse_IMP(StringSearcher *self, Obj_Visit_t visit,
+                         void *context) {
+    if (self->needle) { visit(context, (Obj*)self->needle); }
+}
+
+static const char*
+S_find(StringSearcher *self, const char *haystack, size_t haystack_size) {
+    String *needle = self->needle;
+    if (self->shift == NULL) {
+        return StrSearcher_find_utf8(haystack, haystack_size, needle->ptr,
+                                     needle->size);
+    }
+    return S_two_way_search((const uint8_t*)haystack, haystack_size,
+                            (const uint8_t*)needle->ptr, needle->size,
+                            self->critical_pos, self->period, self->memory,
+                            self->shift);
+}
+
+StringIterator*
+StrSearcher_Find_IMP(StringSearcher *self, String *haystack) {
+    const char *ptr = S_find(self, haystack->ptr, haystack->size);
+    return ptr ? StrIter_new(haystack, (size_t)(ptr - haystack->ptr)) : NULL;
+}
+
+bool
+StrSearcher_Contains_IMP(StringSearcher *self, String *haystack) {
+    return !!S_find(self, haystack->ptr, haystack->size);
+}
+
+bool
+StrSearcher_Contains_Utf8_IMP(StringSearcher *self, const char *utf8,
+                              size_t size) {
+    return !!S_find(self, utf8, size);
+}
+
+String*
+StrSearcher_Get_Needle_IMP(StringSearcher *self) {
+    return self->needle;
+}
+
+const char*
+StrSearcher_find_utf8(const char *haystack, size_t haystack_size,
+                      const char *needle, size_t needle_size) {
+    if (needle_size == 0)            { return haystack; }
+    if (needle_size > haystack_size) { return NULL;     }
+    if (needle_size == 1) {
+        return (const char*)memchr(haystack, needle[0], haystack_size);
+    }
+    if (needle_size <= SHORT_NEEDLE_MAX) {
+        return S_find_short(haystack, haystack_size, needle, needle_size);
+    }
+
+    size_t critical_pos, period, memory;
+    size_t shift[SHIFT_TABLE_SIZE];
+    S_two_way_prepare((const uint8_t*)needle, needle_size, &critical_pos,
+                      &period, &memory, shift);
+    return S_two_way_search((const uint8_t*)haystack, haystack_size,
+                            (const uint8_t*)needle, needle_size,
+                            critical_pos, period, memory, shift);
+}
+
+/* Return a bit mask with bit `n` set if byte `n` of the block at `first`
+ * equals `first_byte` and byte `n` of the block at `last` equals
+ * `last_byte`.
+ */
+#if defined(STRSEARCH_SSE2) || defined(STRSEARCH_NEON)
+static CFISH_INLINE uint32_t
+SI_match_block(const char *first, const char *last, uint8_t first_byte,
+               uint8_t last_byte) {
+#if defined(STRSEARCH_SSE2)
+    __m128i eq_first = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)first),
+                                      _mm_set1_epi8((char)first_byte));
+    __m128i eq_last  = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)last),
+                                      _mm_set1_epi8((char)last_byte));
+    return (uint32_t)_mm_movemask_epi8(_mm_and_si128(eq_first, eq_last));
+#else
+    static const uint8_t weights[BLOCK_WIDTH] = {
+        1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+    };
+    uint8x16_t eq_first = vceqq_u8(vld1q_u8((const uint8_t*)first),
+                                   vdupq_n_u8(first_byte));
+    uint8x16_t eq_last  = vceqq_u8(vld1q_u8((const uint8_t*)last),
+                                   vdupq_n_u8(last_byte));
+    uint8x16_t bits = vandq_u8(vandq_u8(eq_first, eq_last),
+                               vld1q_u8(weights));
+    return (uint32_t)vaddv_u8(vget_low_u8(bits))
+           | ((uint32_t)vaddv_u8(vget_high_u8(bits)) << 8);
+#endif
+}
+
+// Index of the lowest set bit.  `mask` must not be zero.
+static CFISH_INLINE uint32_t
+SI_lowest_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint32_t)__builtin_ctz(mask);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return (uint32_t)index;
+#else
+    uint32_t index = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+#endif /* STRSEARCH_SSE2 || STRSEARCH_NEON */
+
+// Search for a needle of at least two bytes.
+static const char*
+S_find_short(const char *haystack, size_t haystack_size,
+             const char *needle, size_t needle_size) {
+    const char *ptr = haystack;
+    const char *end = haystack + haystack_size - needle_size + 1;
+
+#if defined(STRSEARCH_SSE2) || defined(STRSEARCH_NEON)
+    // Compare a block of candidate positions against the first byte of the
+    // needle and the corresponding block shifted by `needle_size - 1`
+    // against the last byte.  Only the positions which match both are
+    // verified.
+    const uint8_t first_byte = (uint8_t)needle[0];
+    const uint8_t last_byte  = (uint8_t)needle[needle_size - 1];
+    while (end - ptr >= BLOCK_WIDTH) {
+        uint32_t mask = SI_match_block(ptr, ptr + needle_size - 1,
+                                       first_byte, last_byte);
+        while (mask) {
+            const char *candidate = ptr + SI_lowest_bit(mask);
+            if (memcmp(candidate + 1, needle + 1, needle_size - 2) == 0) {
+                return candidate;
+            }
+            mask &= mask - 1;
+        }
+        ptr += BLOCK_WIDTH;
+    }
+#endif
+
+    // Naive search for the remaining positions.
+    while (ptr < end) {
+        ptr = (const char*)memchr(ptr, needle[0], (size_t)(end - ptr));
+        if (ptr == NULL) { break; }
+        if (memcmp(ptr, needle, needle_size) == 0) { return ptr; }
+        ptr++;
+    }
+
+    return NULL;
+}
+
+/* Return the position before the start of the lexicographically maximal
+ * suffix of `needle`, using the reversed byte order if `reverse` is true.
+ * The period of the suffix is stored in `period`.  (size_t)-1 stands for the
+ * position before the start of the needle.
+ */
+static size_t
+S_max_suffix(const uint8_t *needle, size_t size, bool reverse,
+             size_t *period) {
+    size_t suffix = (size_t)-1;
+    size_t tick   = 0;
+    size_t offset = 1;
+    *period = 1;
+
+    while (tick + offset < size) {
+        uint8_t a = needle[suffix + offset];
+        uint8_t b = needle[tick + offset];
+        if (a == b) {
+            if (offset == *period) {
+                tick   += *period;
+                offset = 1;
+            }
+            else {
+                offset++;
+            }
+        }
+        else if (reverse ? a < b : a > b) {
+            tick    += offset;
+            offset  = 1;
+            *period = tick - suffix;
+        }
+        else {
+            suffix  = tick++;
+            offset  = 1;
+            *period = 1;
+        }
+    }
+
+    return suffix;
+}
+
+/* Compute the critical factorization of the needle.  The right half starts
+ * at `critical_pos + 1`.  For periodic needles, `memory` is set to the
+ * size of the prefix which is known to match again after shifting by the
+ * period.  The shift table maps every byte to one past its last position
+ * in the needle, or zero if it doesn't occur.
+ */
+static void
+S_two_way_prepare(const uint8_t *needle, size_t size, size_t *critical_pos,
+                  size_t *period, size_t *memory, size_t *shift) {
+    memset(shift, 0, SHIFT_TABLE_SIZE * sizeof(size_t));
+    for (size_t i = 0; i < size; i++) {
+        shift[needle[i]] = i + 1;
+    }
+
+    size_t period_fwd, period_rev;
+    size_t suffix_fwd = S_max_suffix(needle, size, false, &period_fwd);
+    size_t suffix_rev = S_max_suffix(needle, size, true, &period_rev);
+    size_t pos;
+    size_t per;
+
+    // Choose the later of the two positions.  Add one to deal with -1.
+    if (suffix_rev + 1 > suffix_fwd + 1) {
+        pos = suffix_rev;
+        per = period_rev;
+    }
+    else {
+        pos = suffix_fwd;
+        per = period_fwd;
+    }
+
+    if (memcmp(needle, needle + per, pos + 1) == 0) {
+        // The period of the needle is `per`.
+        *memory = size - per;
+    }
+    else {
+        // The period is unknown, but large shifts are safe.
+        size_t right = size - pos - 1;
+        per = (pos > right ? pos : right) + 1;
+        *memory = 0;
+    }
+
+    *critical_pos = pos;
+    *period       = per;
+}
+
+static const char*
+S_two_way_search(const uint8_t *haystack, size_t haystack_size,
+                 const uint8_t *needle, size_t size, size_t critical_pos,
+                 size_t period, size_t memory, const size_t *shift) {
+    const uint8_t *ptr = haystack;
+    const uint8_t *const end = haystack + haystack_size;
+    const size_t right_start = critical_pos + 1;
+    size_t matched = 0;
+
+    while ((size_t)(end - ptr) >= size) {
+        // Align the last byte of the window with its last occurrence in the
+        // needle, skipping the whole window if it doesn't occur at all.
+        size_t last = shift[ptr[size - 1]];
+        if (last != size) {
+            ptr     += size - last;
+            matched = 0;
+            continue;
+        }
+
+        // Compare the right half.
+        size_t i = right_start > matched ? right_start : matched;
+        while (i < size && needle[i] == ptr[i]) { i++; }
+        if (i < size) {
+            ptr     += i - critical_pos;
+            matched = 0;
+            continue;
+        }
+
+        // Compare the left half, skipping the prefix known to match.
+        i = right_start;
+        while (i > matched && needle[i - 1] == ptr[i - 1]) { i--; }
+        if (i <= matched) { return (const char*)ptr; }
+
+        ptr     += period;
+        matched = memory;
+    }
+
+    return NULL;
+}
+
@@ -0,0 +1,587 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_CFISH_OBJ
+#define C_CFISH_I64VECTOR
+#define C_CFISH_F64VECTOR
+#define C_CFISH_U32VECTOR
+#include <string.h>
+#include <stdlib.h>
+
+#define CFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Class.h"
+#include "Clownfish/TypedVector.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Util/AllocStats.h"
+#include "Clownfish/Util/Arena.h"
+#include "Clownfish/Util/Memory.h"
+#include "Clownfish/Util/SortUtils.h"
+
+/* The three classes share their memory management.  The helpers operate on
+ * the `elems` and `cap` members of any of them, given the element width.
+ */
+
+// Allocate a zeroed buffer for `capacity` elements.
+static void*
+S_alloc_elems(Obj *self, size_t capacity, size_t width);
+
+// Ensure that the capacity is at least (size + extra).  If the buffer must
+// be grown, oversize the allocation.
+static CFISH_INLINE void
+SI_add_grow_and_oversize(Obj *self, void **elems, size_t *cap, size_t size,
+                         size_t extra, size_t width);
+
+// Reallocate the buffer to hold exactly `capacity` elements.
+static void
+S_realloc_elems(Obj *self, void **elems, size_t *cap, size_t capacity,
+                size_t width);
+
+// Zero the elements in the range [size, new_size) after growing the buffer
+// as needed.
+static void
+S_extend_zeroed(Obj *self, void **elems, size_t *cap, size_t size,
+                size_t new_size, size_t width);
+
+static void
+S_free_elems(Obj *self, void *elems, size_t cap, size_t width);
+
+static void
+S_overflow_error(void);
+
+static void
+S_out_of_bounds_error(size_t tick, size_t size);
+
+#define MAX_ELEMS(width) (SIZE_MAX / (width))
+
+static void*
+S_alloc_elems(Obj *self, size_t capacity, size_t width) {
+    if (capacity > MAX_ELEMS(width)) {
+        S_overflow_error();
+        return NULL;
+    }
+    ALLOCSTATS_BUF_ALLOC(self->klass, capacity * width);
+    return Arena_buf_calloc(self, capacity, width);
+}
+
+static CFISH_INLINE void
+SI_add_grow_and_oversize(Obj *self, void **elems, size_t *cap, size_t size,
+                         size_t extra, size_t width) {
+    if (extra > MAX_ELEMS(width) - size) {
+        S_overflow_error();
+        return;
+    }
+
+    size_t min_size = size + extra;
+    if (min_size > *cap) {
+        // Oversize by 25%, but at least eight elements.
+        size_t oversize = min_size / 4;
+        if (oversize < 8) { oversize = 8; }
+        size_t capacity = min_size + oversize;
+        if (capacity < min_size || capacity > MAX_ELEMS(width)) {
+            capacity = MAX_ELEMS(width);
+        }
+        S_realloc_elems(self, elems, cap, capacity, width);
+    }
+}
+
+static void
+S_realloc_elems(Obj *self, void **elems, size_t *cap, size_t capacity,
+                size_t width) {
+    if (capacity > MAX_ELEMS(width)) {
+        S_overflow_error();
+        return;
+    }
+    ALLOCSTATS_BUF_RESIZE(self->klass, *cap * width, capacity * width);
+    *elems = Arena_buf_realloc(self, *elems, *cap * width, capacity * width);
+    *cap   = capacity;
+}
+
+static void
+S_extend_zeroed(Obj *self, void **elems, size_t *cap, size_t size,
+                size_t new_size, size_t width) {
+    SI_add_grow_and_oversize(self, elems, cap, size, new_size - size, width);
+    memset((char*)*elems + size * width, 0, (new_size - size) * width);
+}
+
+static void
+S_free_elems(Obj *self, void *elems, size_t cap, size_t width) {
+    if (elems) {
+        ALLOCSTATS_BUF_FREE(self->klass, cap * width);
+    }
+    Arena_buf_free(self, elems);
+}
+
+static void
+S_overflow_error() {
+    THROW(ERR, "Vector index overflow");
+}
+
+static void
+S_out_of_bounds_error(size_t tick, size_t size) {
+    THROW(ERR, "Tick %u64 out of bounds (size %u64)", (uint64_t)tick,
+          (uint64_t)size);
+}
+
+static int
+S_compare_i64(void *context, const void *va, const void *vb) {
+    int64_t a = *(const int64_t*)va;
+    int64_t b = *(const int64_t*)vb;
+    UNUSED_VAR(context);
+    return (a > b) - (a < b);
+}
+
+static int
+S_compare_f64(void *context, const void *va, const void *vb) {
+    double a = *(const double*)va;
+    double b = *(const double*)vb;
+    UNUSED_VAR(context);
+    // Order NaNs after all other values.
+    if (a != a) { return b != b ? 0 : 1; }
+    if (b != b) { return -1; }
+    return (a > b) - (a < b);
+}
+
+static int
+S_compare_u32(void *context, const void *va, const void *vb) {
+    uint32_t a = *(const uint32_t*)va;
+    uint32_t b = *(const uint32_t*)vb;
+    UNUSED_VAR(context);
+    return (a > b) - (a < b);
+}
+
+/********************************* I64Vector *********************************/
+
+I64Vector*
+I64Vec_new(size_t capacity) {
+    I64Vector *self = (I64Vector*)Class_Make_Obj(I64VECTOR);
+    return I64Vec_init(self, capacity);
+}
+
+I64Vector*
+I64Vec_init(I64Vector *self, size_t capacity) {
+    self->size  = 0;
+    self->cap   = capacity;
+    self->elems = (int64_t*)S_alloc_elems((Obj*)self, capacity,
+                                          sizeof(int64_t));
+    return self;
+}
+
+void
+I64Vec_Destroy_IMP(I64Vector *self) {
+    S_free_elems((Obj*)self, self->elems, self->cap, sizeof(int64_t));
+    SUPER_DESTROY(self, I64VECTOR);
+}
+
+void
+I64Vec_Push_IMP(I64Vector *self, int64_t value) {
+    SI_add_grow_and_oversize((Obj*)self, (void**)&self->elems, &self->cap,
+                             self->size, 1, sizeof(int64_t));
+    self->elems[self->size++] = value;
+}
+
+void
+I64Vec_Push_Array_IMP(I64Vector *self, const int64_t *values, size_t count) {
+    SI_add_grow_and_oversize((Obj*)self, (void**)&self->elems, &self->cap,
+                             self->size, count, sizeof(int64_t));
+    memcpy(self->elems + self->size, values, count * sizeof(int64_t));
+    self->size += count;
+}
+
+void
+I64Vec_Push_All_IMP(I64Vector *self, I64Vector *other) {
+    size_t count = other->size;
+    SI_add_grow_and_oversize((Obj*)self, (void**)&self->elems, &self->cap,
+                             self->size, count, sizeof(int64_t));
+    // Read `other->elems` after growing in case `other` is `self`.
+    memcpy(self->elems + self->size, other->elems, count * sizeof(int64_t));
+    self->size += count;
+}
+
+int64_t
+I64Vec_Fetch_IMP(I64Vector *self, size_t tick) {
+    if (tick >= self->size) { S_out_of_bounds_error(tick, self->size); }
+    return self->elems[tick];
+}
+
+void
+I64Vec_Store_IMP(I64Vector *self, size_t tick, int64_t value) {
+    if (tick >= self->size) {
+        if (tick == SIZE_MAX) { S_overflow_error(); }
+        S_extend_zeroed((Obj*)self, (void**)&self->elems, &self->cap,
+                        self->size, tick + 1, sizeof(int64_t));
+        self->size = tick + 1;
+    }
+    self->elems[tick] = value;
+}
+
+void
+I64Vec_Sort_IMP(I64Vector *self) {
+    Sort_quicksort(self->elems, self->size, sizeof(int64_t), S_compare_i64,
+                   NULL);
+}
+
+void
+I64Vec_Grow_IMP(I64Vector *self, size_t capacity) {
+    if (capacity > self->cap) {
+        S_realloc_elems((Obj*)self, (void**)&self->elems, &self->cap,
+                        capacity, sizeof(int64_t));
+    }
+}
+
+void
+I64Vec_Resize_IMP(I64Vector *self, size_t size) {
+    if (size > self->size) {
+        S_extend_zeroed((Obj*)self, (void**)&self->elems, &self->cap,
+                        self->size, size, sizeof(int64_t));
+    }
+    self->size = size;
+}
+
+void
+I64Vec_Clear_IMP(I64Vector *self) {
+    self->size = 0;
+}
+
+size_t
+I64Vec_Get_Size_IMP(I64Vector *self) {
+    return self->size;
+}
+
+size_t
+I64Vec_Get_Capacity_IMP(I64Vector *self) {
+    return self->cap;
+}
+
+int64_t*
+I64Vec_Get_Ptr_IMP(I64Vector *self) {
+    return self->elems;
+}
+
+I64Vector*
+I64Vec_Slice_IMP(I64Vector *self, size_t offset, size_t length) {
+    // Adjust ranges if necessary.
+    if (offset >= self->size) {
+        offset = 0;
+        length = 0;
+    }
+    else if (length > self->size - offset) {
+        length = self->size - offset;
+    }
+
+    I64Vector *slice = I64Vec_new(length);
+    memcpy(slice->elems, self->elems + offset, length * sizeof(int64_t));
+    slice->size = length;
+    return slice;
+}
+
+I64Vector*
+I64Vec_Clone_IMP(I64Vector *self) {
+    return I64Vec_Slice_IMP(self, 0, self->size);
+}
+
+bool
+I64Vec_Equals_IMP(I64Vector *self, Obj *other) {
+    I64Vector *twin = (I64Vector*)other;
+    if (twin == self)                { return true; }
+    if (!Obj_is_a(other, I64VECTOR)) { return false; }
+    if (twin->size != self->size)    { return false; }
+    return memcmp(self->elems, twin->elems,
+                  self->size * sizeof(int64_t)) == 0;
+}
+
+/********************************* F64Vector *********************************/
+
+F64Vector*
+F64Vec_new(size_t capacity) {
+    F64Vector *self = (F64Vector*)Class_Make_Obj(F64VECTOR);
+    return F64Vec_init(self, capacity);
+}
+
+F64Vector*
+F64Vec_init(F64Vector *self, size_t capacity) {
+    self->size  = 0;
+    self->cap   = capacity;
+    self->elems = (double*)S_alloc_elems((Obj*)self, capacity,
+                                         sizeof(double));
+    return self;
+}
+
+void
+F64Vec_Destroy_IMP(F64Vector *self) {
+    S_free_elems((Obj*)self, self->elems, self->cap, sizeof(double));
+    SUPER_DESTROY(self, F64VECTOR);
+}
+
+void
+F64Vec_Push_IMP(F64Vector *self, double value) {
+    SI_add_grow_and_oversize((Obj*)self, (void**)&self->elems, &self->cap,
+                             self->size, 1, sizeof(double));
+    self->elems[self->size++] = value;
+}
+
+void
+F64Vec_Push_Array_IMP(F64Vector *self, const double *values, size_t count) {
+    SI_add_grow_and_oversize((Obj*)self, (void**)&self->elems, &self->cap,
+                             self->size, count, sizeof(double));
+    memcpy(self->elems + self->size, values, count * sizeof(double));
+    self->size += count;
+}
+
+void
+F64Vec_Push_All_IMP(F64Vector *self, F64Vector *other) {
+    size_t count = other->size;
+    SI_add_grow_and_oversize((Obj*)self, (void**)&self->elems, &self->cap,
+                             self->size, count, sizeof(double));
+    // Read `other->elems` after growing in case `other` is `self`.
+    memcpy(self->elems + self->size, other->elems, count * sizeof(double));
+    self->size += count;
+}
+
+double
+F64Vec_Fetch_IMP(F64Vector *self, size_t tick) {
+    if (tick >= self->size) { S_out_of_bounds_error(tick, self->size); }
+    return self->elems[tick];
+}
+
+void
+F64Vec_Store_IMP(F64Vector *self, size_t tick, double value) {
+    if (tick >= self->size) {
+        if (tick == SIZE_MAX) { S_overflow_error(); }
+        S_extend_zeroed((Obj*)self, (void**)&self->elems, &self->cap,
+                        self->size, tick + 1, sizeof(double));
+        self->size = tick + 1;
+    }
+    self->elems[tick] = value;
+}
+
+void
+F64Vec_Sort_IMP(F64Vector *self) {
+    Sort_quicksort(self->elems, self->size, sizeof(double), S_compare_f64,
+                   NULL);
+}
+
+void
+F64Vec_Grow_IMP(F64Vector *self, size_t capacity) {
+    if (capacity > self->cap) {
+        S_realloc_elems((Obj*)self, (void**)&self->elems, &self->cap,
+                        capacity, sizeof(double));
+    }
+}
+
+void
+F64Vec_Resize_IMP(F64Vector *self, size_t size) {
+    if (size > self->size) {
+        S_extend_zeroed((Obj*)self, (void**)&self->elems, &self->cap,
+                        self->size, size, sizeof(double));
+    }
+    self->size = size;
+}
+
+void
+F64Vec_Clear_IMP(F64Vector *self) {
+    self->size = 0;
+}
+
+size_t
+F64Vec_Get_Size_IMP(F64Vector *self) {
+    return self->size;
+}
+
+size_t
+F64Vec_Get_Capacity_IMP(F64Vector *self) {
+    return self->cap;
+}
+
+double*
+F64Vec_Get_Ptr_IMP(F64Vector *self) {
+    return self->elems;
+}
+
+F64Vector*
+F64Vec_Slice_IMP(F64Vector *self, size_t offset, size_t length) {
+    // Adjust ranges if necessary.
+    if (offset >= self->size) {
+        offset = 0;
+        length = 0;
+    }
+    else if (length > self->size - offset) {
+        length = self->size - offset;
+    }
+
+    F64Vector *slice = F64Vec_new(length);
+    memcpy(slice->elems, self->elems + offset, length * sizeof(double));
+    slice->size = length;
+    return slice;
+}
+
+F64Vector*
+F64Vec_Clone_IMP(F64Vector *self) {
+    return F64Vec_Slice_IMP(self, 0, self->size);
+}
+
+bool
+F64Vec_Equals_IMP(F64Vector *self, Obj *other) {
+    F64Vector *twin = (F64Vector*)other;
+    if (twin == self)                { return true; }
+    if (!Obj_is_a(other, F64VECTOR)) { return false; }
+    if (twin->size != self->size)    { return false; }
+    // Compare values rather than bits, like Float_Equals.
+    for (size_t i = 0; i < self->size; i++) {
+        if (self->elems[i] != twin->elems[i]) { return false; }
+    }
+    return true;
+}
+
+/********************************* U32Vector *********************************/
+
+U32Vector*
+U32Vec_new(size_t capacity) {
+    U32Vector *self = (U32Vector*)Class_Make_Obj(U32VECTOR);
+    return U32Vec_init(self, capacity);
+}
+
+U32Vector*
+U32Vec_init(U32Vector *self, size_t capacity) {
+    self->size  = 0;
+    self->cap   = capacity;
+    self->elems = (uint32_t*)S_alloc_elems((Obj*)self, capacity,
+                                           sizeof(uint32_t));
+    return self;
+}
+
+void
+U32Vec_Destroy_IMP(U32Vector *self) {
+    S_free_elems((Obj*)self, self->elems, self->cap, sizeof(uint32_t));
+    SUPER_DESTROY(self, U32VECTOR);
+}
+
+void
+U32Vec_Push_IMP(U32Vector *self, uint32_t value) {
+    SI_add_grow_and_oversize((Obj*)self, (void**)&self->elems, &self->cap,
+                             self->size, 1, sizeof(uint32_t));
+    self->elems[self->size++] = value;
+}
+
+void
+U32Vec_Push_Array_IMP(U32Vector *self, const uint32_t *values, size_t count) {
+    SI_add_grow_and_oversize((Obj*)self, (void**)&self->elems, &self->cap,
+                             self->size, count, sizeof(uint32_t));
+    memcpy(self->elems + self->size, values, count * sizeof(uint32_t));
+    self->size += count;
+}
+
+void
+U32Vec_Push_All_IMP(U32Vector *self, U32Vector *other) {
+    size_t count = other->size;
+    SI_add_grow_and_oversize((Obj*)self, (void**)&self->elems, &self->cap,
+                             self->size, count, sizeof(uint32_t));
+    // Read `other->elems` after growing in case `other` is `self`.
+    memcpy(self->elems + self->size, other->elems, count * sizeof(uint32_t));
+    self->size += count;
+}
+
+uint32_t
+U32Vec_Fetch_IMP(U32Vector *self, size_t tick) {
+    if (tick >= self->size) { S_out_of_bounds_error(tick, self->size); }
+    return self->elems[tick];
+}
+
+void
+U32Vec_Store_IMP(U32Vector *self, size_t tick, uint32_t value) {
+    if (tick >= self->size) {
+        if (tick == SIZE_MAX) { S_overflow_error(); }
+        S_extend_zeroed((Obj*)self, (void**)&self->elems, &self->cap,
+                        self->size, tick + 1, sizeof(uint32_t));
+        self->size = tick + 1;
+    }
+    self->elems[tick] = value;
+}
+
+void
+U32Vec_Sort_IMP(U32Vector *self) {
+    Sort_quicksort(self->elems, self->size, sizeof(uint32_t), S_compare_u32,
+                   NULL);
+}
+
+void
+U32Vec_Grow_IMP(U32Vector *self, size_t capacity) {
+    if (capacity > self->cap) {
+        S_realloc_elems((Obj*)self, (void**)&self->elems, &self->cap,
+                        capacity, sizeof(uint32_t));
+    }
+}
+
+void
+U32Vec_Resize_IMP(U32Vector *self, size_t size) {
+    if (size > self->size) {
+        S_extend_zeroed((Obj*)self, (void**)&self->elems, &self->cap,
+                        self->size, size, sizeof(uint32_t));
+    }
+    self->size = size;
+}
+
+void
+U32Vec_Clear_IMP(U32Vector *self) {
+    self->size = 0;
+}
+
+size_t
+U32Vec_Get_Size_IMP(U32Vector *self) {
+    return self->size;
+}
+
+size_t
+U32Vec_Get_Capacity_IMP(U32Vector *self) {
+    return self->cap;
+}
+
+uint32_t*
+U32Vec_Get_Ptr_IMP(U32Vector *self) {
+    return self->elems;
+}
+
+U32Vector*
+U32Vec_Slice_IMP(U32Vector *self, size_t offset, size_t length) {
+    // Adjust ranges if necessary.
+    if (offset >= self->size) {
+        offset = 0;
+        length = 0;
+    }
+    else if (length > self->size - offset) {
+        length = self->size - offset;
+    }
+
+    U32Vector *slice = U32Vec_new(length);
+    memcpy(slice->elems, self->elems + offset, length * sizeof(uint32_t));
+    slice->size = length;
+    return slice;
+}
+
+U32Vector*
+U32Vec_Clone_IMP(U32Vector *self) {
+    return U32Vec_Slice_IMP(self, 0, self->size);
+}
+
+bool
+U32Vec_Equals_IMP(U32Vector *self, Obj *other) {
+    U32Vector *twin = (U32Vector*)other;
+    if (twin == self)                { return true; }
+    if (!Obj_is_a(other, U32VECTOR)) { return false; }
+    if (twin->size != self->size)    { return false; }
+    return memcmp(self->elems, twin->elems,
+                  self->size * sizeof(uint32_t)) == 0;
+}
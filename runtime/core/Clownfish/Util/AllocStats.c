@@ -0,0 +1,419 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_CFISH_CLASS
+#define CFISH_USE_SHORT_NAMES
+
+#include "charmony.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Clownfish/Util/AllocStats.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Util/Atomic.h"
+#include "Clownfish/Util/Memory.h"
+
+/* Every thread has a table of counters indexed by class ID.  The table is
+ * split into pages which are allocated on demand and never move, so that
+ * readers can sum them up while the owning thread keeps counting.
+ */
+#define PAGE_BITS   8
+#define PAGE_SIZE   (1 << PAGE_BITS)
+#define MAX_PAGES   256
+#define MAX_CLASSES (MAX_PAGES * PAGE_SIZE)
+
+typedef struct {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t bytes_allocated;
+    uint64_t bytes_freed;
+    uint64_t buffer_allocs;
+    uint64_t buffer_frees;
+} Counters;
+
+typedef struct ThreadStats {
+    Counters           *pages[MAX_PAGES];
+    struct ThreadStats *next;
+} ThreadStats;
+
+bool AllocStats_enabled = false;
+
+// Protects the class table and the list of thread stats.
+static void *volatile lock = NULL;
+
+static Class **classes     = NULL;
+static size_t  num_classes = 0;
+static size_t  classes_cap = 0;
+
+static ThreadStats *thread_stats = NULL;
+
+// Counters of threads that exited.
+static ThreadStats retired;
+
+// Sink for classes beyond MAX_CLASSES.
+static Counters overflow;
+
+static ThreadStats*
+S_get_stats(void);
+
+static CFISH_INLINE void
+SI_lock(void) {
+    while (!Atomic_cas_ptr(&lock, NULL, (void*)&lock)) {
+        while (lock != NULL) { /* spin */ }
+    }
+}
+
+static CFISH_INLINE void
+SI_unlock(void) {
+    Atomic_cas_ptr(&lock, (void*)&lock, NULL);
+}
+
+void
+AllocStats_enable() {
+    AllocStats_enabled = true;
+}
+
+void
+AllocStats_disable() {
+    AllocStats_enabled = false;
+}
+
+void
+AllocStats_register_class(Class *klass) {
+    SI_lock();
+    // Class_bootstrap may initialize a class in several threads at once.
+    if (klass->class_id == 0) {
+        if (num_classes + 1 >= classes_cap) {
+            classes_cap = classes_cap ? classes_cap * 2 : 256;
+            classes = (Class**)REALLOCATE(classes,
+                                          classes_cap * sizeof(Class*));
+        }
+        // ID 0 marks unregistered classes.
+        num_classes++;
+        classes[num_classes] = klass;
+        klass->class_id = (uint32_t)num_classes;
+    }
+    SI_unlock();
+}
+
+static Counters*
+S_counters(Class *klass) {
+    uint32_t id = klass->class_id;
+    if (id >= MAX_CLASSES) { return &overflow; }
+
+    ThreadStats *stats = S_get_stats();
+    Counters    *page  = stats->pages[id >> PAGE_BITS];
+    if (page == NULL) {
+        page = (Counters*)CALLOCATE(PAGE_SIZE, sizeof(Counters));
+        stats->pages[id >> PAGE_BITS] = page;
+    }
+
+    return &page[id & (PAGE_SIZE - 1)];
+}
+
+void
+AllocStats_obj_alloc(Class *klass) {
+    Counters *counters = S_counters(klass);
+    counters->allocs++;
+    counters->bytes_allocated += klass->obj_alloc_size;
+}
+
+void
+AllocStats_obj_free(Class *klass) {
+    Counters *counters = S_counters(klass);
+    counters->frees++;
+    counters->bytes_freed += klass->obj_alloc_size;
+}
+
+void
+AllocStats_buf_alloc(Class *klass, size_t size) {
+    Counters *counters = S_counters(klass);
+    counters->buffer_allocs++;
+    counters->bytes_allocated += size;
+}
+
+void
+AllocStats_buf_free(Class *klass, size_t size) {
+    Counters *counters = S_counters(klass);
+    counters->buffer_frees++;
+    counters->bytes_freed += size;
+}
+
+void
+AllocStats_buf_resize(Class *klass, size_t old_size, size_t new_size) {
+    Counters *counters = S_counters(klass);
+    counters->bytes_allocated += new_size;
+    counters->bytes_freed     += old_size;
+}
+
+static void
+S_add_counters(Counters *totals, ThreadStats *stats, size_t count) {
+    for (size_t id = 0; id < count; id++) {
+        Counters *page = stats->pages[id >> PAGE_BITS];
+        if (page == NULL) {
+            id |= PAGE_SIZE - 1;
+            continue;
+        }
+        Counters *counters = &page[id & (PAGE_SIZE - 1)];
+        totals[id].allocs          += counters->allocs;
+        totals[id].frees           += counters->frees;
+        totals[id].bytes_allocated += counters->bytes_allocated;
+        totals[id].bytes_freed     += counters->bytes_freed;
+        totals[id].buffer_allocs   += counters->buffer_allocs;
+        totals[id].buffer_frees    += counters->buffer_frees;
+    }
+}
+
+static void
+S_store_int(Hash *hash, const char *key, int64_t value) {
+    Hash_Store_Utf8(hash, key, strlen(key), (Obj*)Int_new(value));
+}
+
+Hash*
+AllocStats_snapshot() {
+    // Sum up counters into a private array first.  Creating the Hash
+    // allocates, which may need the lock.
+    SI_lock();
+    size_t count = num_classes + 1;
+    if (count > MAX_CLASSES) { count = MAX_CLASSES; }
+    Counters *totals = (Counters*)CALLOCATE(count, sizeof(Counters));
+    Class   **snapshot_classes = (Class**)MALLOCATE(count * sizeof(Class*));
+    if (classes != NULL) {
+        memcpy(snapshot_classes, classes, count * sizeof(Class*));
+    }
+    S_add_counters(totals, &retired, count);
+    for (ThreadStats *stats = thread_stats; stats; stats = stats->next) {
+        S_add_counters(totals, stats, count);
+    }
+    SI_unlock();
+
+    Hash *snapshot = Hash_new(0);
+    for (size_t id = 1; id < count; id++) {
+        Counters *counters = &totals[id];
+        if (counters->allocs == 0
+            && counters->frees == 0
+            && counters->buffer_allocs == 0
+            && counters->buffer_frees == 0
+           ) {
+            continue;
+        }
+
+        Hash *entry = Hash_new(6);
+        S_store_int(entry, "allocs", (int64_t)counters->allocs);
+        S_store_int(entry, "frees", (int64_t)counters->frees);
+        S_store_int(entry, "live_objects",
+                    (int64_t)(counters->allocs - counters->frees));
+        S_store_int(entry, "live_bytes",
+                    (int64_t)(counters->bytes_allocated
+                              - counters->bytes_freed));
+        S_store_int(entry, "buffer_allocs", (int64_t)counters->buffer_allocs);
+        S_store_int(entry, "buffer_frees", (int64_t)counters->buffer_frees);
+        Hash_Store(snapshot, snapshot_classes[id]->name, (Obj*)entry);
+    }
+
+    FREEMEM(snapshot_classes);
+    FREEMEM(totals);
+    return snapshot;
+}
+
+static int64_t
+S_fetch_int(Hash *hash, const char *key) {
+    Integer *value = (Integer*)Hash_Fetch_Utf8(hash, key, strlen(key));
+    return value ? Int_Get_Value(value) : 0;
+}
+
+void
+AllocStats_dump() {
+    Hash   *snapshot = AllocStats_snapshot();
+    Vector *names    = Hash_Keys(snapshot);
+    Vec_Sort(names);
+
+    fprintf(stderr, "%-40s %12s %12s %12s %14s\n", "class", "allocs",
+            "frees", "live_objects", "live_bytes");
+    for (size_t i = 0, max = Vec_Get_Size(names); i < max; i++) {
+        String *name  = (String*)Vec_Fetch(names, i);
+        Hash   *entry = (Hash*)Hash_Fetch(snapshot, name);
+        char   *utf8  = Str_To_Utf8(name);
+        fprintf(stderr, "%-40s %12" PRId64 " %12" PRId64 " %12" PRId64
+                " %14" PRId64 "\n", utf8,
+                S_fetch_int(entry, "allocs"), S_fetch_int(entry, "frees"),
+                S_fetch_int(entry, "live_objects"),
+                S_fetch_int(entry, "live_bytes"));
+        FREEMEM(utf8);
+    }
+
+    DECREF(names);
+    DECREF(snapshot);
+}
+
+static void
+S_dump_at_exit(void) {
+    AllocStats_dump();
+}
+
+void
+AllocStats_dump_at_exit() {
+    static void *registered = NULL;
+    if (Atomic_cas_ptr(&registered, NULL, (void*)&registered)) {
+        atexit(S_dump_at_exit);
+    }
+}
+
+#ifndef CFISH_NOTHREADS
+// Fold the counters of an exiting thread into the retired counters.
+static void
+S_destroy_stats(void *arg) {
+    ThreadStats *stats = (ThreadStats*)arg;
+
+    SI_lock();
+    for (ThreadStats **next_ptr = &thread_stats;
+         *next_ptr != NULL;
+         next_ptr = &(*next_ptr)->next
+        ) {
+        if (*next_ptr == stats) {
+            *next_ptr = stats->next;
+            break;
+        }
+    }
+    for (size_t p = 0; p < MAX_PAGES; p++) {
+        Counters *page = stats->pages[p];
+        if (page == NULL) { continue; }
+        if (retired.pages[p] == NULL) {
+            retired.pages[p]
+                = (Counters*)CALLOCATE(PAGE_SIZE, sizeof(Counters));
+        }
+        for (size_t i = 0; i < PAGE_SIZE; i++) {
+            Counters *dest = &retired.pages[p][i];
+            dest->allocs          += page[i].allocs;
+            dest->frees           += page[i].frees;
+            dest->bytes_allocated += page[i].bytes_allocated;
+            dest->bytes_freed     += page[i].bytes_freed;
+            dest->buffer_allocs   += page[i].buffer_allocs;
+            dest->buffer_frees    += page[i].buffer_frees;
+        }
+        FREEMEM(page);
+    }
+    SI_unlock();
+
+    FREEMEM(stats);
+}
+
+static ThreadStats*
+S_new_stats(void) {
+    ThreadStats *stats = (ThreadStats*)CALLOCATE(1, sizeof(ThreadStats));
+    SI_lock();
+    stats->next  = thread_stats;
+    thread_stats = stats;
+    SI_unlock();
+    return stats;
+}
+#endif
+
+/**************************** No thread support ****************************/
+#ifdef CFISH_NOTHREADS
+
+static ThreadStats*
+S_get_stats(void) {
+    return &retired;
+}
+
+/********************************** Windows ********************************/
+#elif defined(CHY_HAS_WINDOWS_H)
+
+#include <windows.h>
+
+static DWORD stats_fls_index = FLS_OUT_OF_INDEXES;
+
+static VOID WINAPI
+S_fls_destroy_stats(PVOID arg) {
+    if (arg) { S_destroy_stats(arg); }
+}
+
+static ThreadStats*
+S_get_stats(void) {
+    if (stats_fls_index == FLS_OUT_OF_INDEXES) {
+        DWORD fls_index = FlsAlloc(S_fls_destroy_stats);
+        if (fls_index == FLS_OUT_OF_INDEXES) {
+            fprintf(stderr, "FlsAlloc failed (FLS_OUT_OF_INDEXES)\n");
+            abort();
+        }
+        if (InterlockedCompareExchange((LONG*)&stats_fls_index, fls_index,
+                                       FLS_OUT_OF_INDEXES)
+            != (LONG)FLS_OUT_OF_INDEXES
+           ) {
+            FlsFree(fls_index);
+        }
+    }
+
+    ThreadStats *stats = (ThreadStats*)FlsGetValue(stats_fls_index);
+    if (!stats) {
+        stats = S_new_stats();
+        if (!FlsSetValue(stats_fls_index, stats)) {
+            fprintf(stderr, "FlsSetValue failed: %lu\n", GetLastError());
+            abort();
+        }
+    }
+
+    return stats;
+}
+
+/******************************** pthreads *********************************/
+#elif defined(CHY_HAS_PTHREAD_H)
+
+#include <pthread.h>
+
+static pthread_key_t  stats_key;
+static pthread_once_t stats_key_once = PTHREAD_ONCE_INIT;
+
+static void
+S_create_stats_key(void) {
+    int error = pthread_key_create(&stats_key, S_destroy_stats);
+    if (error) {
+        fprintf(stderr, "pthread_key_create failed: %d\n", error);
+        abort();
+    }
+}
+
+static ThreadStats*
+S_get_stats(void) {
+    pthread_once(&stats_key_once, S_create_stats_key);
+
+    ThreadStats *stats = (ThreadStats*)pthread_getspecific(stats_key);
+    if (!stats) {
+        stats = S_new_stats();
+        int error = pthread_setspecific(stats_key, stats);
+        if (error) {
+            fprintf(stderr, "pthread_setspecific failed: %d\n", error);
+            abort();
+        }
+    }
+
+    return stats;
+}
+
+/****************** No support for thread-local storage ********************/
+#else
+
+#error "No support for thread-local storage."
+
+#endif
+
@@ -0,0 +1,643 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define C_CFISH_ARENA
+#define C_CFISH_CLASS
+#define C_CFISH_OBJ
+#define CFISH_USE_SHORT_NAMES
+
+#include "charmony.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Clownfish/Util/Arena.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/PtrHash.h"
+#include "Clownfish/Util/Atomic.h"
+#include "Clownfish/Util/Memory.h"
+
+#define DEFAULT_CHUNK_SIZE 0x10000
+#define MAX_CHUNK_SIZE     0x400000
+#define ALIGNMENT          16
+
+#define ALIGN_UP(size) (((size) + (ALIGNMENT - 1)) & ~(size_t)(ALIGNMENT - 1))
+
+/* Memory is bump-allocated from the newest chunk of a list.  Objects and
+ * buffers live in separate lists so that the objects can be walked on
+ * release:  every object takes up the aligned allocation size of its class.
+ */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t             size;
+    size_t             used;
+} ArenaChunk;
+
+#define CHUNK_DATA(chunk) ((char*)(chunk) + ALIGN_UP(sizeof(ArenaChunk)))
+
+typedef struct {
+    Arena *current;
+    Arena *live;
+} ArenaState;
+
+/* Number of arenas in all threads.  As long as it's zero, no thread-local
+ * state has to be consulted.
+ */
+static volatile size_t num_live = 0;
+
+/* Set once the first arena is created.  Objects which escaped from an arena
+ * outlive it, so they can exist even if no arena is live.
+ */
+static volatile bool arenas_used = false;
+
+// Chunks of arenas that objects escaped from.
+static ArenaChunk *volatile retained = NULL;
+
+static ArenaState*
+S_get_state(void);
+
+Arena*
+Arena_new(size_t chunk_size) {
+    Arena *self = (Arena*)Class_Make_Obj(ARENA);
+    return Arena_init(self, chunk_size);
+}
+
+Arena*
+Arena_init(Arena *self, size_t chunk_size) {
+    ArenaState *state = S_get_state();
+
+    self->chunk_size = chunk_size ? ALIGN_UP(chunk_size) : DEFAULT_CHUNK_SIZE;
+    self->next_live  = state->live;
+    state->live      = self;
+    Atomic_inc_size(&num_live);
+    arenas_used = true;
+
+    return self;
+}
+
+void
+Arena_Enter_IMP(Arena *self) {
+    if (self->entered) {
+        THROW(ERR, "Arena has already been entered");
+    }
+    ArenaState *state = S_get_state();
+    self->prev     = state->current;
+    self->entered  = true;
+    state->current = self;
+}
+
+void
+Arena_Leave_IMP(Arena *self) {
+    ArenaState *state = S_get_state();
+    if (state->current != self) {
+        THROW(ERR, "Arena isn't the current arena");
+    }
+    state->current = self->prev;
+    self->prev     = NULL;
+    self->entered  = false;
+}
+
+Arena*
+Arena_current() {
+    if (num_live == 0) { return NULL; }
+    return S_get_state()->current;
+}
+
+Arena*
+Arena_suspend() {
+    Arena *arena = Arena_current();
+    if (arena) { Arena_Leave(arena); }
+    return arena;
+}
+
+void
+Arena_resume(Arena *arena) {
+    if (arena) { Arena_Enter(arena); }
+}
+
+static ArenaChunk*
+S_find_chunk(ArenaChunk *chunk, const char *ptr) {
+    for (; chunk != NULL; chunk = chunk->next) {
+        const char *data = CHUNK_DATA(chunk);
+        if (ptr >= data && ptr < data + chunk->size) {
+            return chunk;
+        }
+    }
+    return NULL;
+}
+
+/* Arena objects are recognized by the bias of their refcount, so that
+ * objects allocated from the heap never have to consult thread-local state.
+ * Allow for the refcount to drop below the bias while an arena is released.
+ */
+static CFISH_INLINE bool
+SI_is_arena_obj(const void *obj) {
+    return arenas_used
+           && obj != NULL
+           && REFCOUNT_NN((void*)obj) >= CFISH_ARENA_REFCOUNT_BIAS / 2;
+}
+
+// Return the arena that holds `ptr`, or NULL if it isn't arena memory.
+static Arena*
+S_find_owner(const void *ptr) {
+    if (num_live == 0 || ptr == NULL) { return NULL; }
+
+    for (Arena *arena = S_get_state()->live;
+         arena != NULL;
+         arena = arena->next_live
+        ) {
+        if (S_find_chunk((ArenaChunk*)arena->obj_chunks, (const char*)ptr)
+            || S_find_chunk((ArenaChunk*)arena->buf_chunks, (const char*)ptr)
+           ) {
+            return arena;
+        }
+    }
+
+    return NULL;
+}
+
+// Return the live arena of an arena object, or NULL if the object escaped
+// from an arena which has been released.
+static Arena*
+S_find_obj_owner(const void *obj) {
+    for (Arena *arena = S_get_state()->live;
+         arena != NULL;
+         arena = arena->next_live
+        ) {
+        if (S_find_chunk((ArenaChunk*)arena->obj_chunks, (const char*)obj)) {
+            return arena;
+        }
+    }
+    return NULL;
+}
+
+static void*
+S_bump(Arena *self, void **chunks, size_t size) {
+    ArenaChunk *chunk = (ArenaChunk*)*chunks;
+    size = ALIGN_UP(size);
+
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        size_t chunk_size = self->chunk_size;
+        if (chunk_size < MAX_CHUNK_SIZE) {
+            self->chunk_size *= 2;
+        }
+        if (chunk_size < size) {
+            chunk_size = size;
+        }
+        chunk = (ArenaChunk*)MALLOCATE(ALIGN_UP(sizeof(ArenaChunk))
+                                       + chunk_size);
+        chunk->size = chunk_size;
+        chunk->used = 0;
+        chunk->next = (ArenaChunk*)*chunks;
+        *chunks     = chunk;
+    }
+
+    void *ptr = CHUNK_DATA(chunk) + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+void*
+Arena_Alloc_IMP(Arena *self, size_t size) {
+    return S_bump(self, &self->buf_chunks, size);
+}
+
+void*
+Arena_obj_alloc(Class *klass) {
+    if (num_live == 0) { return NULL; }
+
+    Arena *arena = S_get_state()->current;
+    if (arena == NULL || klass == ARENA) { return NULL; }
+
+    void *obj = S_bump(arena, &arena->obj_chunks, klass->obj_alloc_size);
+    memset(obj, 0, klass->obj_alloc_size);
+    arena->num_objects++;
+    return obj;
+}
+
+bool
+Arena_owns(const void *ptr) {
+    return S_find_owner(ptr) != NULL;
+}
+
+bool
+Arena_owns_obj(Obj *obj) {
+    return SI_is_arena_obj(obj);
+}
+
+/* The buffers of arena objects are never freed individually.  If the arena
+ * of an escaped object is gone, new buffers come from the heap and are
+ * leaked along with the object.
+ */
+
+void*
+Arena_buf_malloc(const void *owner, size_t size) {
+    Arena *arena = SI_is_arena_obj(owner) ? S_find_obj_owner(owner) : NULL;
+    if (arena == NULL) {
+        return MALLOCATE(size);
+    }
+    return S_bump(arena, &arena->buf_chunks, size);
+}
+
+void*
+Arena_buf_calloc(const void *owner, size_t count, size_t size) {
+    Arena *arena = SI_is_arena_obj(owner) ? S_find_obj_owner(owner) : NULL;
+    if (arena == NULL) {
+        return CALLOCATE(count, size);
+    }
+    if (size != 0 && count > SIZE_MAX / size) {
+        THROW(ERR, "Arena allocation too large");
+    }
+    void *ptr = S_bump(arena, &arena->buf_chunks, count * size);
+    memset(ptr, 0, count * size);
+    return ptr;
+}
+
+void*
+Arena_buf_realloc(const void *owner, void *ptr, size_t old_size,
+                  size_t new_size) {
+    if (!SI_is_arena_obj(owner)) {
+        return REALLOCATE(ptr, new_size);
+    }
+
+    Arena *arena = S_find_obj_owner(owner);
+    if (arena != NULL && ptr != NULL && arena->buf_chunks != NULL) {
+        // Grow in place if the buffer is the last allocation of the chunk.
+        ArenaChunk *chunk = (ArenaChunk*)arena->buf_chunks;
+        char       *data  = CHUNK_DATA(chunk);
+        size_t      start = (size_t)((char*)ptr - data);
+        if ((char*)ptr >= data
+            && start + ALIGN_UP(old_size) == chunk->used
+            && chunk->size - start >= ALIGN_UP(new_size)
+           ) {
+            chunk->used = start + ALIGN_UP(new_size);
+            return ptr;
+        }
+    }
+
+    void *new_ptr = arena != NULL
+                    ? S_bump(arena, &arena->buf_chunks, new_size)
+                    : MALLOCATE(new_size);
+    if (ptr != NULL) {
+        memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    }
+    return new_ptr;
+}
+
+void
+Arena_buf_free(const void *owner, void *ptr) {
+    if (!SI_is_arena_obj(owner)) {
+        FREEMEM(ptr);
+    }
+}
+
+void*
+Arena_buf_adopt(const void *owner, void *ptr, size_t size) {
+    if (num_live == 0) { return ptr; }
+
+    // Buffers of arena objects must come from their arena and buffers of
+    // other objects from the heap, so copy if necessary.
+    Arena *ptr_arena = S_find_owner(ptr);
+    void  *copy      = NULL;
+    if (SI_is_arena_obj(owner)) {
+        Arena *arena = S_find_obj_owner(owner);
+        if (arena == NULL || arena == ptr_arena) { return ptr; }
+        copy = S_bump(arena, &arena->buf_chunks, size);
+        memcpy(copy, ptr, size);
+        if (ptr_arena == NULL) { FREEMEM(ptr); }
+    }
+    else {
+        if (ptr_arena == NULL) { return ptr; }
+        copy = MALLOCATE(size);
+        memcpy(copy, ptr, size);
+    }
+    return copy;
+}
+
+static void
+S_retain_chunks(ArenaChunk *chunks) {
+    if (chunks == NULL) { return; }
+
+    ArenaChunk *last = chunks;
+    while (last->next != NULL) { last = last->next; }
+
+    do {
+        last->next = retained;
+    } while (!Atomic_cas_ptr((void*volatile*)&retained, last->next, chunks));
+}
+
+static void
+S_free_chunks(ArenaChunk *chunk) {
+    while (chunk != NULL) {
+        ArenaChunk *next = chunk->next;
+        Memory_sized_free(chunk, ALIGN_UP(sizeof(ArenaChunk)) + chunk->size);
+        chunk = next;
+    }
+}
+
+static void
+S_recycle_chunks(void **chunks) {
+    ArenaChunk *chunk = (ArenaChunk*)*chunks;
+    if (chunk == NULL) { return; }
+    S_free_chunks(chunk->next);
+    chunk->next = NULL;
+    chunk->used = 0;
+}
+
+/* Objects are released in three phases:
+ *
+ * 1. The references that arena objects hold to each other are subtracted
+ *    from the refcounts.  The remaining references come from outside the
+ *    arena.  This includes the reference returned by the constructor
+ *    unless it was released or handed to another arena object.  Objects
+ *    with any remaining reference have escaped.
+ * 2. If objects escaped, they are marked along with all objects reachable
+ *    from them, and the subtracted references are added back.
+ * 3. All unmarked objects are destroyed.  Marked objects stay intact.
+ */
+typedef struct {
+    Arena    *arena;
+    PtrHash  *marked;
+    Obj     **stack;
+    size_t    stack_size;
+    size_t    stack_cap;
+    size_t    num_escaped;
+} ReleaseState;
+
+// Invoke `func` for every object of the arena.
+static void
+S_each_obj(Arena *self, Obj_Visit_t func, void *context) {
+    for (ArenaChunk *chunk = (ArenaChunk*)self->obj_chunks;
+         chunk != NULL;
+         chunk = chunk->next
+        ) {
+        char *ptr   = CHUNK_DATA(chunk);
+        char *limit = ptr + chunk->used;
+        while (ptr < limit) {
+            Obj *obj = (Obj*)ptr;
+            ptr += ALIGN_UP(obj->klass->obj_alloc_size);
+            func(context, obj);
+        }
+    }
+}
+
+static CFISH_INLINE bool
+SI_holds_obj(Arena *self, Obj *obj) {
+    return SI_is_arena_obj(obj)
+           && S_find_chunk((ArenaChunk*)self->obj_chunks, (const char*)obj);
+}
+
+static void
+S_release_member(void *context, Obj *member) {
+    if (SI_holds_obj((Arena*)context, member)) { DECREF(member); }
+}
+
+static void
+S_restore_member(void *context, Obj *member) {
+    if (SI_holds_obj((Arena*)context, member)) { INCREF(member); }
+}
+
+static void
+S_release_members(void *context, Obj *obj) {
+    Obj_Traverse(obj, S_release_member, context);
+}
+
+static void
+S_restore_members(void *context, Obj *obj) {
+    Obj_Traverse(obj, S_restore_member, context);
+}
+
+static void
+S_mark(ReleaseState *state, Obj *obj) {
+    if (PtrHash_Fetch(state->marked, obj)) { return; }
+    PtrHash_Store(state->marked, obj, obj);
+    if (state->stack_size == state->stack_cap) {
+        state->stack_cap = state->stack_cap ? state->stack_cap * 2 : 64;
+        state->stack = (Obj**)REALLOCATE(state->stack,
+                                         state->stack_cap * sizeof(Obj*));
+    }
+    state->stack[state->stack_size++] = obj;
+}
+
+static void
+S_mark_member(void *context, Obj *member) {
+    ReleaseState *state = (ReleaseState*)context;
+    if (SI_holds_obj(state->arena, member)) { S_mark(state, member); }
+}
+
+static void
+S_mark_if_escaped(void *context, Obj *obj) {
+    ReleaseState *state = (ReleaseState*)context;
+    if (REFCOUNT_NN(obj) > CFISH_ARENA_REFCOUNT_BIAS) {
+        state->num_escaped++;
+        S_mark(state, obj);
+        while (state->stack_size) {
+            Obj *reachable = state->stack[--state->stack_size];
+            Obj_Traverse(reachable, S_mark_member, state);
+        }
+    }
+}
+
+static void
+S_destroy_unmarked(void *context, Obj *obj) {
+    ReleaseState *state = (ReleaseState*)context;
+    if (!PtrHash_Fetch(state->marked, obj)) {
+        Obj_Destroy(obj);
+    }
+}
+
+size_t
+Arena_Release_IMP(Arena *self) {
+    if (self->entered) {
+        THROW(ERR, "Can't release an Arena while it's entered");
+    }
+
+    ReleaseState state;
+    memset(&state, 0, sizeof(state));
+    state.arena = self;
+
+    S_each_obj(self, S_release_members, self);
+    state.marked = PtrHash_new(0);
+    S_each_obj(self, S_mark_if_escaped, &state);
+    if (state.num_escaped) {
+        S_each_obj(self, S_restore_members, self);
+    }
+
+    // Memory of arena objects isn't freed and DECREF never destroys them,
+    // so the order doesn't matter.
+    S_each_obj(self, S_destroy_unmarked, &state);
+
+    // Keep the memory around for good if objects escaped.  Otherwise,
+    // keep the newest and largest chunks for reuse.
+    if (state.num_escaped == 0) {
+        S_recycle_chunks(&self->obj_chunks);
+        S_recycle_chunks(&self->buf_chunks);
+    }
+    else {
+        S_retain_chunks((ArenaChunk*)self->obj_chunks);
+        S_retain_chunks((ArenaChunk*)self->buf_chunks);
+        self->obj_chunks = NULL;
+        self->buf_chunks = NULL;
+    }
+    self->num_objects = 0;
+    PtrHash_Destroy(state.marked);
+    FREEMEM(state.stack);
+
+    return state.num_escaped;
+}
+
+size_t
+Arena_Get_Num_Objects_IMP(Arena *self) {
+    return self->num_objects;
+}
+
+void
+Arena_Destroy_IMP(Arena *self) {
+    ArenaState *state = S_get_state();
+
+    // Unlink from the stack of entered arenas.
+    if (self->entered) {
+        for (Arena **arena_ptr = &state->current;
+             *arena_ptr != NULL;
+             arena_ptr = &(*arena_ptr)->prev
+            ) {
+            if (*arena_ptr == self) {
+                *arena_ptr = self->prev;
+                break;
+            }
+        }
+        self->entered = false;
+    }
+
+    size_t num_escaped = Arena_Release_IMP(self);
+    if (num_escaped) {
+        WARN("%u64 objects escaped from Arena", (uint64_t)num_escaped);
+    }
+
+    for (Arena **arena_ptr = &state->live;
+         *arena_ptr != NULL;
+         arena_ptr = &(*arena_ptr)->next_live
+        ) {
+        if (*arena_ptr == self) {
+            *arena_ptr = self->next_live;
+            break;
+        }
+    }
+    Atomic_dec_size(&num_live);
+
+    S_free_chunks((ArenaChunk*)self->obj_chunks);
+    S_free_chunks((ArenaChunk*)self->buf_chunks);
+    SUPER_DESTROY(self, ARENA);
+}
+
+/**************************** No thread support ****************************/
+#ifdef CFISH_NOTHREADS
+
+static ArenaState arena_state;
+
+static ArenaState*
+S_get_state(void) {
+    return &arena_state;
+}
+
+/********************************** Windows ********************************/
+#elif defined(CHY_HAS_WINDOWS_H)
+
+#include <windows.h>
+
+static DWORD state_fls_index = FLS_OUT_OF_INDEXES;
+
+static VOID WINAPI
+S_fls_destroy_state(PVOID arg) {
+    FREEMEM(arg);
+}
+
+static ArenaState*
+S_get_state(void) {
+    if (state_fls_index == FLS_OUT_OF_INDEXES) {
+        DWORD fls_index = FlsAlloc(S_fls_destroy_state);
+        if (fls_index == FLS_OUT_OF_INDEXES) {
+            fprintf(stderr, "FlsAlloc failed (FLS_OUT_OF_INDEXES)\n");
+            abort();
+        }
+        if (InterlockedCompareExchange((LONG*)&state_fls_index, fls_index,
+                                       FLS_OUT_OF_INDEXES)
+            != (LONG)FLS_OUT_OF_INDEXES
+           ) {
+            FlsFree(fls_index);
+        }
+    }
+
+    ArenaState *state = (ArenaState*)FlsGetValue(state_fls_index);
+    if (!state) {
+        state = (ArenaState*)CALLOCATE(1, sizeof(ArenaState));
+        if (!FlsSetValue(state_fls_index, state)) {
+            fprintf(stderr, "FlsSetValue failed: %lu\n", GetLastError());
+            abort();
+        }
+    }
+
+    return state;
+}
+
+/******************************** pthreads *********************************/
+#elif defined(CHY_HAS_PTHREAD_H)
+
+#include <pthread.h>
+
+static pthread_key_t  state_key;
+static pthread_once_t state_key_once = PTHREAD_ONCE_INIT;
+
+static void
+S_destroy_state(void *arg) {
+    FREEMEM(arg);
+}
+
+static void
+S_create_state_key(void) {
+    int error = pthread_key_create(&state_key, S_destroy_state);
+    if (error) {
+        fprintf(stderr, "pthread_key_create failed: %d\n", error);
+        abort();
+    }
+}
+
+static ArenaState*
+S_get_state(void) {
+    pthread_once(&state_key_once, S_create_state_key);
+
+    ArenaState *state = (ArenaState*)pthread_getspecific(state_key);
+    if (!state) {
+        state = (ArenaState*)CALLOCATE(1, sizeof(ArenaState));
+        int error = pthread_setspecific(state_key, state);
+        if (error) {
+            fprintf(stderr, "pthread_setspecific failed: %d\n", error);
+            abort();
+        }
+    }
+
+    return state;
+}
+
+/****************** No support for thread-local storage ********************/
+#else
+
+#error "No support for thread-local storage."
+
+#endif
+
@@ -31,6 +31,31 @@ extern "C" {
 static CFISH_INLINE bool
 cfish_Atomic_cas_ptr(void *volatile *target, void *old_value, void *new_value);
 
+/** Compare and swap a size_t.  Works like [](cfish_Atomic_cas_ptr).
+ */
+static CFISH_INLINE bool
+cfish_Atomic_cas_size(volatile size_t *target, size_t old_value,
+                      size_t new_value);
+
+/** Full memory barrier.  Neither loads nor stores are reordered across the
+ * fence.
+ */
+static CFISH_INLINE void
+cfish_Atomic_fence(void);
+
+/** Atomically increment a size_t and return the new value.  The increment
+ * doesn't order any other memory accesses.
+ */
+static CFISH_INLINE size_t
+cfish_Atomic_inc_size(volatile size_t *target);
+
+/** Atomically decrement a size_t and return the new value.  Memory accesses
+ * preceding the decrement in any thread happen before accesses following a
+ * decrement to zero.
+ */
+static CFISH_INLINE size_t
+cfish_Atomic_dec_size(volatile size_t *target);
+
 /************************** Single threaded *******************************/
 #ifdef CFISH_NOTHREADS
 
@@ -45,6 +70,32 @@ cfish_Atomic_cas_ptr(void *volatile *target, void *old_value, void *new_value) {
     }
 }
 
+static CFISH_INLINE bool
+cfish_Atomic_cas_size(volatile size_t *target, size_t old_value,
+                      size_t new_value) {
+    if (*target == old_value) {
+        *target = new_value;
+        return true;
+    }
+    else {
+        return false;
+    }
+}
+
+static CFISH_INLINE void
+cfish_Atomic_fence(void) {
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_inc_size(volatile size_t *target) {
+    return ++*target;
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_dec_size(volatile size_t *target) {
+    return --*target;
+}
+
 /**************************** C11 stdatomic.h *****************************/
 #elif defined(CHY_HAS_STDATOMIC_H)
 #include <stdatomic.h>
@@ -55,6 +106,39 @@ cfish_Atomic_cas_ptr(void *volatile *target, void *old_value, void *new_value) {
                                           new_value);
 }
 
+static CFISH_INLINE bool
+cfish_Atomic_cas_size(volatile size_t *target, size_t old_value,
+                      size_t new_value) {
+    return atomic_compare_exchange_strong((_Atomic size_t *)target,
+                                          &old_value, new_value);
+}
+
+static CFISH_INLINE void
+cfish_Atomic_fence(void) {
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+/* Unlike the compare-exchange macros, the fetch-and-modify macros don't
+ * hide the cast to an _Atomic type from -Wpedantic in C99 mode.
+ */
+#ifdef __GNUC__
+  #define CFISH_ATOMIC_SIZE_PTR(ptr) (__extension__ (_Atomic size_t *)(ptr))
+#else
+  #define CFISH_ATOMIC_SIZE_PTR(ptr) ((_Atomic size_t *)(ptr))
+#endif
+
+static CFISH_INLINE size_t
+cfish_Atomic_inc_size(volatile size_t *target) {
+    return atomic_fetch_add_explicit(CFISH_ATOMIC_SIZE_PTR(target), 1,
+                                     memory_order_relaxed) + 1;
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_dec_size(volatile size_t *target) {
+    return atomic_fetch_sub_explicit(CFISH_ATOMIC_SIZE_PTR(target), 1,
+                                     memory_order_acq_rel) - 1;
+}
+
 /************************** Mac OS X 10.4 and later ***********************/
 #elif defined(CHY_HAS_OSATOMIC_CAS_PTR)
 #include <libkern/OSAtomic.h>
@@ -64,6 +148,37 @@ cfish_Atomic_cas_ptr(void *volatile *target, void *old_value, void *new_value) {
     return OSAtomicCompareAndSwapPtr(old_value, new_value, target);
 }
 
+static CFISH_INLINE bool
+cfish_Atomic_cas_size(volatile size_t *target, size_t old_value,
+                      size_t new_value) {
+    return OSAtomicCompareAndSwapPtrBarrier((void*)old_value,
+                                            (void*)new_value,
+                                            (void*volatile*)target);
+}
+
+static CFISH_INLINE void
+cfish_Atomic_fence(void) {
+    OSMemoryBarrier();
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_inc_size(volatile size_t *target) {
+    size_t value;
+    do {
+        value = *target;
+    } while (!cfish_Atomic_cas_size(target, value, value + 1));
+    return value + 1;
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_dec_size(volatile size_t *target) {
+    size_t value;
+    do {
+        value = *target;
+    } while (!cfish_Atomic_cas_size(target, value, value - 1));
+    return value - 1;
+}
+
 /********************************** Windows *******************************/
 #elif defined(CHY_HAS_WINDOWS_H)
 
@@ -71,11 +186,44 @@ CFISH_VISIBLE bool
 cfish_Atomic_wrapped_cas_ptr(void *volatile *target, void *old_value,
                             void *new_value);
 
+CFISH_VISIBLE void
+cfish_Atomic_wrapped_fence(void);
+
 static CFISH_INLINE bool
 cfish_Atomic_cas_ptr(void *volatile *target, void *old_value, void *new_value) {
     return cfish_Atomic_wrapped_cas_ptr(target, old_value, new_value);
 }
 
+static CFISH_INLINE bool
+cfish_Atomic_cas_size(volatile size_t *target, size_t old_value,
+                      size_t new_value) {
+    return cfish_Atomic_wrapped_cas_ptr((void*volatile*)target,
+                                        (void*)old_value, (void*)new_value);
+}
+
+static CFISH_INLINE void
+cfish_Atomic_fence(void) {
+    cfish_Atomic_wrapped_fence();
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_inc_size(volatile size_t *target) {
+    size_t value;
+    do {
+        value = *target;
+    } while (!cfish_Atomic_cas_size(target, value, value + 1));
+    return value + 1;
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_dec_size(volatile size_t *target) {
+    size_t value;
+    do {
+        value = *target;
+    } while (!cfish_Atomic_cas_size(target, value, value - 1));
+    return value - 1;
+}
+
 /**************************** Solaris 10 and later ************************/
 #elif defined(CHY_HAS_SYS_ATOMIC_H)
 #include <sys/atomic.h>
@@ -85,6 +233,32 @@ cfish_Atomic_cas_ptr(void *volatile *target, void *old_value, void *new_value) {
     return atomic_cas_ptr(target, old_value, new_value) == old_value;
 }
 
+static CFISH_INLINE bool
+cfish_Atomic_cas_size(volatile size_t *target, size_t old_value,
+                      size_t new_value) {
+    return atomic_cas_ulong((volatile ulong_t*)target, old_value, new_value)
+           == old_value;
+}
+
+static CFISH_INLINE void
+cfish_Atomic_fence(void) {
+    membar_enter();
+    membar_exit();
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_inc_size(volatile size_t *target) {
+    return atomic_inc_ulong_nv((volatile ulong_t*)target);
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_dec_size(volatile size_t *target) {
+    membar_exit();
+    size_t value = atomic_dec_ulong_nv((volatile ulong_t*)target);
+    membar_enter();
+    return value;
+}
+
 /****************************** GCC 4.1 and later *************************/
 #elif defined(CHY_HAS___SYNC_BOOL_COMPARE_AND_SWAP)
 
@@ -93,6 +267,27 @@ cfish_Atomic_cas_ptr(void *volatile *target, void *old_value, void *new_value) {
     return __sync_bool_compare_and_swap(target, old_value, new_value);
 }
 
+static CFISH_INLINE bool
+cfish_Atomic_cas_size(volatile size_t *target, size_t old_value,
+                      size_t new_value) {
+    return __sync_bool_compare_and_swap(target, old_value, new_value);
+}
+
+static CFISH_INLINE void
+cfish_Atomic_fence(void) {
+    __sync_synchronize();
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_inc_size(volatile size_t *target) {
+    return __sync_add_and_fetch(target, 1);
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_dec_size(volatile size_t *target) {
+    return __sync_sub_and_fetch(target, 1);
+}
+
 /************************ Fall back to pthread.h. **************************/
 #elif defined(CHY_HAS_PTHREAD_H)
 #include <pthread.h>
@@ -113,6 +308,44 @@ cfish_Atomic_cas_ptr(void *volatile *target, void *old_value, void *new_value) {
     }
 }
 
+static CFISH_INLINE bool
+cfish_Atomic_cas_size(volatile size_t *target, size_t old_value,
+                      size_t new_value) {
+    pthread_mutex_lock(&cfish_Atomic_mutex);
+    if (*target == old_value) {
+        *target = new_value;
+        pthread_mutex_unlock(&cfish_Atomic_mutex);
+        return true;
+    }
+    else {
+        pthread_mutex_unlock(&cfish_Atomic_mutex);
+        return false;
+    }
+}
+
+static CFISH_INLINE void
+cfish_Atomic_fence(void) {
+    // Locking and unlocking the mutex acts as a barrier.
+    pthread_mutex_lock(&cfish_Atomic_mutex);
+    pthread_mutex_unlock(&cfish_Atomic_mutex);
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_inc_size(volatile size_t *target) {
+    pthread_mutex_lock(&cfish_Atomic_mutex);
+    size_t value = ++*target;
+    pthread_mutex_unlock(&cfish_Atomic_mutex);
+    return value;
+}
+
+static CFISH_INLINE size_t
+cfish_Atomic_dec_size(volatile size_t *target) {
+    pthread_mutex_lock(&cfish_Atomic_mutex);
+    size_t value = --*target;
+    pthread_mutex_unlock(&cfish_Atomic_mutex);
+    return value;
+}
+
 /******************** No support for atomics at all. ***********************/
 #else
 
@@ -121,7 +354,11 @@ cfish_Atomic_cas_ptr(void *volatile *target, void *old_value, void *new_value) {
 #endif /* Big platform if-else chain. */
 
 #ifdef CFISH_USE_SHORT_NAMES
-  #define Atomic_cas_ptr cfish_Atomic_cas_ptr
+  #define Atomic_cas_ptr  cfish_Atomic_cas_ptr
+  #define Atomic_cas_size cfish_Atomic_cas_size
+  #define Atomic_fence    cfish_Atomic_fence
+  #define Atomic_inc_size cfish_Atomic_inc_size
+  #define Atomic_dec_size cfish_Atomic_dec_size
 #endif
 
 #ifdef __cplusplus
@@ -24,9 +24,74 @@
 
 #include "Clownfish/Util/Memory.h"
 
+static void*
+S_default_malloc(void *context, size_t size) {
+    UNUSED_VAR(context);
+    return malloc(size);
+}
+
+static void*
+S_default_calloc(void *context, size_t count, size_t size) {
+    UNUSED_VAR(context);
+    return calloc(count, size);
+}
+
+static void*
+S_default_realloc(void *context, void *ptr, size_t size) {
+    UNUSED_VAR(context);
+    return realloc(ptr, size);
+}
+
+static void
+S_default_free(void *context, void *ptr) {
+    UNUSED_VAR(context);
+    free(ptr);
+}
+
+static Allocator allocator = {
+    S_default_malloc,
+    S_default_calloc,
+    S_default_realloc,
+    S_default_free,
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+static Memory_OOM_Handler_t oom_handler = NULL;
+
+void
+Memory_set_allocator(const Allocator *new_allocator) {
+    allocator = *new_allocator;
+}
+
+const Allocator*
+Memory_get_allocator() {
+    return &allocator;
+}
+
+Memory_OOM_Handler_t
+Memory_set_oom_handler(Memory_OOM_Handler_t handler) {
+    Memory_OOM_Handler_t previous = oom_handler;
+    oom_handler = handler;
+    return previous;
+}
+
+// Give the OOM handler a chance to free memory.  Returns true if the
+// allocation should be retried.
+static bool
+S_retry(size_t size) {
+    Memory_OOM_Handler_t handler = oom_handler;
+    return handler != NULL && handler(size);
+}
+
 void*
 Memory_wrapped_malloc(size_t count) {
-    void *pointer = malloc(count);
+    void *pointer;
+    do {
+        pointer = allocator.mallocate(allocator.context, count);
+    } while (pointer == NULL && count != 0 && S_retry(count));
     if (pointer == NULL && count != 0) {
         fprintf(stderr, "Can't malloc %" PRIu64 " bytes.\n", (uint64_t)count);
         exit(1);
@@ -36,7 +101,12 @@ Memory_wrapped_malloc(size_t count) {
 
 void*
 Memory_wrapped_calloc(size_t count, size_t size) {
-    void *pointer = calloc(count, size);
+    size_t total = size != 0 && count > SIZE_MAX / size
+                   ? SIZE_MAX : count * size;
+    void *pointer;
+    do {
+        pointer = allocator.callocate(allocator.context, count, size);
+    } while (pointer == NULL && count != 0 && S_retry(total));
     if (pointer == NULL && count != 0) {
         fprintf(stderr, "Can't calloc %" PRIu64 " elements of size %" PRIu64 ".\n",
                 (uint64_t)count, (uint64_t)size);
@@ -47,7 +117,10 @@ Memory_wrapped_calloc(size_t count, size_t size) {
 
 void*
 Memory_wrapped_realloc(void *ptr, size_t size) {
-    void *pointer = realloc(ptr, size);
+    void *pointer;
+    do {
+        pointer = allocator.reallocate(allocator.context, ptr, size);
+    } while (pointer == NULL && size != 0 && S_retry(size));
     if (pointer == NULL && size != 0) {
         fprintf(stderr, "Can't realloc %" PRIu64 " bytes.\n", (uint64_t)size);
         exit(1);
@@ -57,7 +130,72 @@ Memory_wrapped_realloc(void *ptr, size_t size) {
 
 void
 Memory_wrapped_free(void *ptr) {
-    free(ptr);
+    allocator.freemem(allocator.context, ptr);
+}
+
+void
+Memory_sized_free(void *ptr, size_t size) {
+    if (allocator.sized_freemem != NULL && ptr != NULL) {
+        allocator.sized_freemem(allocator.context, ptr, size);
+    }
+    else {
+        allocator.freemem(allocator.context, ptr);
+    }
+}
+
+void*
+Memory_aligned_malloc(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        fprintf(stderr, "Invalid alignment: %" PRIu64 "\n",
+                (uint64_t)alignment);
+        exit(1);
+    }
+
+    if (allocator.aligned_mallocate != NULL
+        && allocator.aligned_freemem != NULL
+       ) {
+        void *pointer;
+        do {
+            pointer = allocator.aligned_mallocate(allocator.context,
+                                                  alignment, size);
+        } while (pointer == NULL && S_retry(size));
+        if (pointer == NULL) {
+            fprintf(stderr, "Can't malloc %" PRIu64 " bytes aligned to %"
+                    PRIu64 ".\n", (uint64_t)size, (uint64_t)alignment);
+            exit(1);
+        }
+        return pointer;
+    }
+
+    // Over-allocate and store the original pointer right before the
+    // aligned block.
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    if (size > SIZE_MAX - alignment - sizeof(void*)) {
+        fprintf(stderr, "Can't malloc %" PRIu64 " bytes.\n", (uint64_t)size);
+        exit(1);
+    }
+    char *raw = (char*)Memory_wrapped_malloc(size + alignment - 1
+                                             + sizeof(void*));
+    uintptr_t address = ((uintptr_t)(raw + sizeof(void*)) + alignment - 1)
+                        & ~(uintptr_t)(alignment - 1);
+    void **pointer = (void**)address;
+    pointer[-1] = raw;
+    return pointer;
+}
+
+void
+Memory_aligned_free(void *ptr, size_t alignment) {
+    if (ptr == NULL) { return; }
+    if (allocator.aligned_mallocate != NULL
+        && allocator.aligned_freemem != NULL
+       ) {
+        allocator.aligned_freemem(allocator.context, ptr, alignment);
+    }
+    else {
+        Memory_wrapped_free(((void**)ptr)[-1]);
+    }
 }
 
 size_t
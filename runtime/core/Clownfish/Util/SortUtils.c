@@ -18,130 +18,1429 @@
 #define CFISH_USE_SHORT_NAMES
 
 #include <string.h>
+
+#include "charmony.h"
+
 #include "Clownfish/Util/SortUtils.h"
 #include "Clownfish/Err.h"
+#include "Clownfish/Util/Memory.h"
+
+/* Copy or swap single elements.  Element widths of 4 and 8 bytes are by far
+ * the most common, so give the compiler a chance to use plain loads and
+ * stores for them.
+ */
+static CFISH_INLINE void
+SI_copy(uint8_t *dest, const uint8_t *src, size_t width) {
+    switch (width) {
+        case 8:  memcpy(dest, src, 8); break;
+        case 4:  memcpy(dest, src, 4); break;
+        default: memcpy(dest, src, width); break;
+    }
+}
+
+static CFISH_INLINE void
+SI_swap(uint8_t *a, uint8_t *b, size_t width) {
+    if (width == 8) {
+        uint64_t tmp;
+        memcpy(&tmp, a, 8);
+        memcpy(a, b, 8);
+        memcpy(b, &tmp, 8);
+    }
+    else if (width == 4) {
+        uint32_t tmp;
+        memcpy(&tmp, a, 4);
+        memcpy(a, b, 4);
+        memcpy(b, &tmp, 4);
+    }
+    else {
+        for (size_t i = 0; i < width; i++) {
+            uint8_t tmp = a[i];
+            a[i] = b[i];
+            b[i] = tmp;
+        }
+    }
+}
+
+/***************************************************************************
+ * Natural mergesort
+ *
+ * This follows the design of TimSort as described in Tim Peters'
+ * listsort.txt: the input is split into runs which are already sorted,
+ * short runs are extended to a minimum length with binary insertion sort,
+ * and the runs are merged while maintaining invariants on a stack of
+ * pending runs which keep the merges balanced.  Merges switch to galloping
+ * mode when one run keeps winning.
+ */
+
+// Number of consecutive wins by one run after which a merge switches to
+// galloping mode.  The threshold adapts while merging.
+#define MIN_GALLOP 7
+
+// The stack invariants guarantee that run lengths grow at least as fast as
+// the Fibonacci numbers, so 85 entries suffice for any 64-bit size.
+#define MAX_PENDING_RUNS 85
+
+typedef struct {
+    uint8_t              *elems;
+    uint8_t              *scratch;
+    size_t                width;
+    CFISH_Sort_Compare_t  compare;
+    void                 *context;
+    size_t                min_gallop;
+    size_t                num_runs;
+    size_t                run_base[MAX_PENDING_RUNS];
+    size_t                run_len[MAX_PENDING_RUNS];
+} MergeState;
+
+#define MS_LESS(ms, a, b) ((ms)->compare((ms)->context, (a), (b)) < 0)
 
-// Recursive merge sorting functions.
+// Return the minimum run length for an array of `num_elems` elements.
+static size_t
+S_min_run_length(size_t num_elems);
+
+// Return the length of the run starting at `lo`.  Strictly descending runs
+// are reversed in place.
+static size_t
+S_count_run(MergeState *ms, size_t lo, size_t hi);
+
+// Sort the range [lo, hi) with binary insertion sort, given that [lo,
+// start) is already sorted.
+static void
+S_binary_insertion_sort(MergeState *ms, size_t lo, size_t hi, size_t start);
+
+// Locate the position at which to insert `key` into the sorted array `base`
+// of `size` elements, starting the search at `hint`.  S_gallop_left returns
+// the leftmost such position, S_gallop_right the rightmost one.
+static size_t
+S_gallop_left(MergeState *ms, const uint8_t *key, const uint8_t *base,
+              size_t size, size_t hint);
+static size_t
+S_gallop_right(MergeState *ms, const uint8_t *key, const uint8_t *base,
+               size_t size, size_t hint);
+
+// Merge the pending runs at stack positions i and i + 1.
 static void
-S_msort4(void *velems, void *vscratch, size_t left, size_t right,
-         CFISH_Sort_Compare_t compare, void *context);
+S_merge_at(MergeState *ms, size_t i);
+
+// Merge two adjacent runs, copying the shorter one into the scratch buffer.
 static void
-S_msort8(void *velems, void *vscratch, size_t left, size_t right,
-         CFISH_Sort_Compare_t compare, void *context);
+S_merge_lo(MergeState *ms, uint8_t *pa, size_t na, uint8_t *pb, size_t nb);
 static void
-S_msort_any(void *velems, void *vscratch, size_t left, size_t right,
-            CFISH_Sort_Compare_t compare, void *context, size_t width);
+S_merge_hi(MergeState *ms, uint8_t *pa, size_t na, uint8_t *pb, size_t nb);
 
-static CFISH_INLINE void
-SI_merge(void *left_vptr,  size_t left_size,
-         void *right_vptr, size_t right_size,
-         void *vdest, size_t width, CFISH_Sort_Compare_t compare, void *context);
+// Merge runs until the stack invariants hold again.
+static void
+S_merge_collapse(MergeState *ms);
+
+// Merge all remaining runs.
+static void
+S_merge_force_collapse(MergeState *ms);
 
 void
 Sort_mergesort(void *elems, void *scratch, size_t num_elems, size_t width,
                CFISH_Sort_Compare_t compare, void *context) {
     // Arrays of 0 or 1 items are already sorted.
     if (num_elems < 2) { return; }
+    if (width == 0) {
+        THROW(ERR, "Parameter 'width' cannot be 0");
+    }
 
-    // Dispatch by element size.
-    switch (width) {
-        case 0:
-            THROW(ERR, "Parameter 'width' cannot be 0");
-            break;
-        case 4:
-            S_msort4(elems, scratch, 0, num_elems - 1, compare, context);
-            break;
-        case 8:
-            S_msort8(elems, scratch, 0, num_elems - 1, compare, context);
-            break;
-        default:
-            S_msort_any(elems, scratch, 0, num_elems - 1, compare,
-                        context, width);
-            break;
+    MergeState ms;
+    ms.elems      = (uint8_t*)elems;
+    ms.scratch    = (uint8_t*)scratch;
+    ms.width      = width;
+    ms.compare    = compare;
+    ms.context    = context;
+    ms.min_gallop = MIN_GALLOP;
+    ms.num_runs   = 0;
+
+    const size_t min_run = S_min_run_length(num_elems);
+    size_t lo = 0;
+    while (lo < num_elems) {
+        size_t remaining = num_elems - lo;
+        size_t run_len   = S_count_run(&ms, lo, num_elems);
+        if (run_len < min_run) {
+            size_t forced = remaining < min_run ? remaining : min_run;
+            S_binary_insertion_sort(&ms, lo, lo + forced, lo + run_len);
+            run_len = forced;
+        }
+        ms.run_base[ms.num_runs] = lo;
+        ms.run_len[ms.num_runs]  = run_len;
+        ms.num_runs++;
+        S_merge_collapse(&ms);
+        lo += run_len;
+    }
+    S_merge_force_collapse(&ms);
+}
+
+static size_t
+S_min_run_length(size_t num_elems) {
+    // Pick a length between 32 and 64 so that num_elems / min_run is a power
+    // of two or slightly less.
+    size_t low_bits = 0;
+    while (num_elems >= 64) {
+        low_bits  |= num_elems & 1;
+        num_elems >>= 1;
+    }
+    return num_elems + low_bits;
+}
+
+static size_t
+S_count_run(MergeState *ms, size_t lo, size_t hi) {
+    const size_t  width = ms->width;
+    uint8_t      *elems = ms->elems;
+    size_t        i     = lo + 1;
+
+    if (i == hi) { return 1; }
+
+    if (MS_LESS(ms, elems + i * width, elems + lo * width)) {
+        // Only strictly descending runs may be reversed without breaking
+        // stability.
+        for (i++; i < hi; i++) {
+            if (!MS_LESS(ms, elems + i * width, elems + (i - 1) * width)) {
+                break;
+            }
+        }
+        uint8_t *left  = elems + lo * width;
+        uint8_t *right = elems + (i - 1) * width;
+        while (left < right) {
+            SI_swap(left, right, width);
+            left  += width;
+            right -= width;
+        }
+    }
+    else {
+        for (i++; i < hi; i++) {
+            if (MS_LESS(ms, elems + i * width, elems + (i - 1) * width)) {
+                break;
+            }
+        }
+    }
+
+    return i - lo;
+}
+
+static void
+S_binary_insertion_sort(MergeState *ms, size_t lo, size_t hi, size_t start) {
+    const size_t  width = ms->width;
+    uint8_t      *elems = ms->elems;
+    // The scratch buffer is not in use while runs are being built.
+    uint8_t      *pivot = ms->scratch;
+
+    for (size_t i = start; i < hi; i++) {
+        uint8_t *elem = elems + i * width;
+        if (!MS_LESS(ms, elem, elem - width)) { continue; }
+
+        // Find the rightmost position in [lo, i) where the element can be
+        // inserted.  The element before it is known to compare greater.
+        // The search is written so that the compiler can use conditional
+        // moves instead of unpredictable branches.
+        size_t base = lo;
+        size_t size = i - lo;
+        while (size > 1) {
+            size_t half = size / 2;
+            base  = MS_LESS(ms, elem, elems + (base + half) * width)
+                    ? base : base + half;
+            size -= half;
+        }
+        size_t left = base + !MS_LESS(ms, elem, elems + base * width);
+
+        SI_copy(pivot, elem, width);
+        memmove(elems + (left + 1) * width, elems + left * width,
+                (i - left) * width);
+        SI_copy(elems + left * width, pivot, width);
+    }
+}
+
+static size_t
+S_gallop_left(MergeState *ms, const uint8_t *key, const uint8_t *base,
+              size_t size, size_t hint) {
+    const size_t   width    = ms->width;
+    const uint8_t *hint_ptr = base + hint * width;
+    size_t         last_ofs = 0;
+    size_t         ofs      = 1;
+
+    if (MS_LESS(ms, hint_ptr, key)) {
+        // base[hint] < key: gallop right until
+        // base[hint + last_ofs] < key <= base[hint + ofs].
+        const size_t max_ofs = size - hint;
+        while (ofs < max_ofs && MS_LESS(ms, hint_ptr + ofs * width, key)) {
+            last_ofs = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= last_ofs) { ofs = max_ofs; } // Overflow.
+        }
+        if (ofs > max_ofs) { ofs = max_ofs; }
+        last_ofs += hint + 1;
+        ofs      += hint;
+    }
+    else {
+        // key <= base[hint]: gallop left until
+        // base[hint - ofs] < key <= base[hint - last_ofs].
+        const size_t max_ofs = hint + 1;
+        while (ofs < max_ofs && !MS_LESS(ms, hint_ptr - ofs * width, key)) {
+            last_ofs = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= last_ofs) { ofs = max_ofs; } // Overflow.
+        }
+        if (ofs > max_ofs) { ofs = max_ofs; }
+        size_t tmp = last_ofs;
+        last_ofs = hint + 1 - ofs;
+        ofs      = hint - tmp;
+    }
+
+    // Binary search with invariant base[last_ofs - 1] < key <= base[ofs].
+    while (last_ofs < ofs) {
+        size_t mid = last_ofs + ((ofs - last_ofs) >> 1);
+        if (MS_LESS(ms, base + mid * width, key)) {
+            last_ofs = mid + 1;
+        }
+        else {
+            ofs = mid;
+        }
+    }
+    return ofs;
+}
+
+static size_t
+S_gallop_right(MergeState *ms, const uint8_t *key, const uint8_t *base,
+               size_t size, size_t hint) {
+    const size_t   width    = ms->width;
+    const uint8_t *hint_ptr = base + hint * width;
+    size_t         last_ofs = 0;
+    size_t         ofs      = 1;
+
+    if (MS_LESS(ms, key, hint_ptr)) {
+        // key < base[hint]: gallop left until
+        // base[hint - ofs] <= key < base[hint - last_ofs].
+        const size_t max_ofs = hint + 1;
+        while (ofs < max_ofs && MS_LESS(ms, key, hint_ptr - ofs * width)) {
+            last_ofs = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= last_ofs) { ofs = max_ofs; } // Overflow.
+        }
+        if (ofs > max_ofs) { ofs = max_ofs; }
+        size_t tmp = last_ofs;
+        last_ofs = hint + 1 - ofs;
+        ofs      = hint - tmp;
+    }
+    else {
+        // base[hint] <= key: gallop right until
+        // base[hint + last_ofs] <= key < base[hint + ofs].
+        const size_t max_ofs = size - hint;
+        while (ofs < max_ofs && !MS_LESS(ms, key, hint_ptr + ofs * width)) {
+            last_ofs = ofs;
+            ofs = (ofs << 1) + 1;
+            if (ofs <= last_ofs) { ofs = max_ofs; } // Overflow.
+        }
+        if (ofs > max_ofs) { ofs = max_ofs; }
+        last_ofs += hint + 1;
+        ofs      += hint;
+    }
+
+    // Binary search with invariant base[last_ofs - 1] <= key < base[ofs].
+    while (last_ofs < ofs) {
+        size_t mid = last_ofs + ((ofs - last_ofs) >> 1);
+        if (MS_LESS(ms, key, base + mid * width)) {
+            ofs = mid;
+        }
+        else {
+            last_ofs = mid + 1;
+        }
+    }
+    return ofs;
+}
+
+static void
+S_merge_at(MergeState *ms, size_t i) {
+    const size_t  width = ms->width;
+    uint8_t      *pa    = ms->elems + ms->run_base[i] * width;
+    size_t        na    = ms->run_len[i];
+    uint8_t      *pb    = ms->elems + ms->run_base[i + 1] * width;
+    size_t        nb    = ms->run_len[i + 1];
+
+    // Record the combined run and drop run i + 1 from the stack.
+    ms->run_len[i] = na + nb;
+    if (i + 3 == ms->num_runs) {
+        ms->run_base[i + 1] = ms->run_base[i + 2];
+        ms->run_len[i + 1]  = ms->run_len[i + 2];
+    }
+    ms->num_runs--;
+
+    // Elements at the start of run A which are not greater than the first
+    // element of run B are already in place.
+    size_t k = S_gallop_right(ms, pb, pa, na, 0);
+    pa += k * width;
+    na -= k;
+    if (na == 0) { return; }
+
+    // Likewise for elements at the end of run B which are not less than the
+    // last element of run A.
+    nb = S_gallop_left(ms, pa + (na - 1) * width, pb, nb, nb - 1);
+    if (nb == 0) { return; }
+
+    if (na <= nb) {
+        S_merge_lo(ms, pa, na, pb, nb);
+    }
+    else {
+        S_merge_hi(ms, pa, na, pb, nb);
     }
 }
 
-#define WIDTH 4
+// Merge run A = [pa, pa + na) and run B = [pb, pb + nb) where run B
+// directly follows run A, na <= nb, the first element of B belongs before
+// the first element of A, and the last element of A belongs after the last
+// element of B.  Run A is moved to the scratch buffer and the merge proceeds
+// from left to right.
 static void
-S_msort4(void *velems, void *vscratch, size_t left, size_t right,
-         CFISH_Sort_Compare_t compare, void *context) {
-    uint8_t *elems   = (uint8_t*)velems;
-    uint8_t *scratch = (uint8_t*)vscratch;
-    if (right > left) {
-        const size_t mid = left + (right - left) / 2 + 1;
-        S_msort4(elems, scratch, left, mid - 1, compare, context);
-        S_msort4(elems, scratch, mid,  right, compare, context);
-        SI_merge((elems + left * WIDTH), (mid - left),
-                 (elems + mid * WIDTH), (right - mid + 1),
-                 scratch, WIDTH, compare, context);
-        memcpy((elems + left * WIDTH), scratch, ((right - left + 1) * WIDTH));
+S_merge_lo(MergeState *ms, uint8_t *pa, size_t na, uint8_t *pb, size_t nb) {
+    const size_t  width      = ms->width;
+    size_t        min_gallop = ms->min_gallop;
+    uint8_t      *dest       = pa;
+
+    memcpy(ms->scratch, pa, na * width);
+    pa = ms->scratch;
+
+    SI_copy(dest, pb, width);
+    dest += width;
+    pb   += width;
+    if (--nb == 0) { goto succeed; }
+    if (na == 1)   { goto copy_b; }
+
+    while (1) {
+        size_t a_count = 0; // Number of times A won in a row.
+        size_t b_count = 0; // Number of times B won in a row.
+
+        // Merge one element at a time until one run appears to win
+        // consistently.
+        while (1) {
+            // The outcome of the comparison is unpredictable for random
+            // input, so avoid branching on it.
+            size_t take_b = MS_LESS(ms, pb, pa);
+            size_t take_a = take_b ^ 1;
+            SI_copy(dest, take_b ? pb : pa, width);
+            dest    += width;
+            pb      += take_b * width;
+            pa      += take_a * width;
+            nb      -= take_b;
+            na      -= take_a;
+            b_count  = (b_count + 1) * take_b;
+            a_count  = (a_count + 1) * take_a;
+            if (nb == 0) { goto succeed; }
+            if (na == 1) { goto copy_b; }
+            if (a_count >= min_gallop || b_count >= min_gallop) { break; }
+        }
+
+        // Gallop until neither run wins consistently anymore.  The longer
+        // galloping pays off, the easier it becomes to enter again.
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            ms->min_gallop = min_gallop;
+
+            size_t k = S_gallop_right(ms, pb, pa, na, 0);
+            a_count = k;
+            if (k) {
+                memcpy(dest, pa, k * width);
+                dest += k * width;
+                pa   += k * width;
+                na   -= k;
+                if (na == 1) { goto copy_b; }
+                // Only possible with an inconsistent comparison function.
+                if (na == 0) { goto succeed; }
+            }
+            SI_copy(dest, pb, width);
+            dest += width;
+            pb   += width;
+            if (--nb == 0) { goto succeed; }
+
+            k = S_gallop_left(ms, pa, pb, nb, 0);
+            b_count = k;
+            if (k) {
+                memmove(dest, pb, k * width);
+                dest += k * width;
+                pb   += k * width;
+                nb   -= k;
+                if (nb == 0) { goto succeed; }
+            }
+            SI_copy(dest, pa, width);
+            dest += width;
+            pa   += width;
+            if (--na == 1) { goto copy_b; }
+        } while (a_count >= MIN_GALLOP || b_count >= MIN_GALLOP);
+        min_gallop++;
+        ms->min_gallop = min_gallop;
+    }
+
+succeed:
+    if (na) { memcpy(dest, pa, na * width); }
+    return;
+
+copy_b:
+    // The last element of A belongs at the end of the merge.
+    memmove(dest, pb, nb * width);
+    SI_copy(dest + nb * width, pa, width);
+}
+
+// Like S_merge_lo, but with na > nb.  Run B is moved to the scratch buffer
+// and the merge proceeds from right to left.
+static void
+S_merge_hi(MergeState *ms, uint8_t *pa, size_t na, uint8_t *pb, size_t nb) {
+    const size_t  width      = ms->width;
+    size_t        min_gallop = ms->min_gallop;
+    uint8_t      *base_a     = pa;
+    uint8_t      *base_b     = ms->scratch;
+    uint8_t      *dest       = pb + (nb - 1) * width;
+
+    memcpy(base_b, pb, nb * width);
+
+    // Let pa and pb point to the last element of their runs.
+    pa += (na - 1) * width;
+    pb  = base_b + (nb - 1) * width;
+
+    SI_copy(dest, pa, width);
+    dest -= width;
+    pa   -= width;
+    if (--na == 0) { goto succeed; }
+    if (nb == 1)   { goto copy_a; }
+
+    while (1) {
+        size_t a_count = 0; // Number of times A won in a row.
+        size_t b_count = 0; // Number of times B won in a row.
+
+        while (1) {
+            size_t take_a = MS_LESS(ms, pb, pa);
+            size_t take_b = take_a ^ 1;
+            SI_copy(dest, take_a ? pa : pb, width);
+            dest    -= width;
+            pa      -= take_a * width;
+            pb      -= take_b * width;
+            na      -= take_a;
+            nb      -= take_b;
+            a_count  = (a_count + 1) * take_a;
+            b_count  = (b_count + 1) * take_b;
+            if (na == 0) { goto succeed; }
+            if (nb == 1) { goto copy_a; }
+            if (a_count >= min_gallop || b_count >= min_gallop) { break; }
+        }
+
+        min_gallop++;
+        do {
+            min_gallop -= min_gallop > 1;
+            ms->min_gallop = min_gallop;
+
+            size_t k = na - S_gallop_right(ms, pb, base_a, na, na - 1);
+            a_count = k;
+            if (k) {
+                dest -= k * width;
+                pa   -= k * width;
+                memmove(dest + width, pa + width, k * width);
+                na -= k;
+                if (na == 0) { goto succeed; }
+            }
+            SI_copy(dest, pb, width);
+            dest -= width;
+            pb   -= width;
+            if (--nb == 1) { goto copy_a; }
+
+            k = nb - S_gallop_left(ms, pa, base_b, nb, nb - 1);
+            b_count = k;
+            if (k) {
+                dest -= k * width;
+                pb   -= k * width;
+                memcpy(dest + width, pb + width, k * width);
+                nb -= k;
+                if (nb == 1) { goto copy_a; }
+                // Only possible with an inconsistent comparison function.
+                if (nb == 0) { goto succeed; }
+            }
+            SI_copy(dest, pa, width);
+            dest -= width;
+            pa   -= width;
+            if (--na == 0) { goto succeed; }
+        } while (a_count >= MIN_GALLOP || b_count >= MIN_GALLOP);
+        min_gallop++;
+        ms->min_gallop = min_gallop;
+    }
+
+succeed:
+    if (nb) { memcpy(dest - (nb - 1) * width, base_b, nb * width); }
+    return;
+
+copy_a:
+    // The first element of B belongs at the start of the merge.
+    dest -= na * width;
+    pa   -= na * width;
+    memmove(dest + width, pa + width, na * width);
+    SI_copy(dest, pb, width);
+}
+
+static void
+S_merge_collapse(MergeState *ms) {
+    size_t *run_len = ms->run_len;
+
+    while (ms->num_runs > 1) {
+        size_t n = ms->num_runs - 2;
+        if ((n > 0 && run_len[n - 1] <= run_len[n] + run_len[n + 1])
+            || (n > 1 && run_len[n - 2] <= run_len[n - 1] + run_len[n])
+           ) {
+            if (run_len[n - 1] < run_len[n + 1]) { n--; }
+        }
+        else if (run_len[n] > run_len[n + 1]) {
+            break;
+        }
+        S_merge_at(ms, n);
     }
 }
 
-#undef WIDTH
-#define WIDTH 8
 static void
-S_msort8(void *velems, void *vscratch, size_t left, size_t right,
-         CFISH_Sort_Compare_t compare, void *context) {
-    uint8_t *elems   = (uint8_t*)velems;
-    uint8_t *scratch = (uint8_t*)vscratch;
-    if (right > left) {
-        const size_t mid = left + (right - left) / 2 + 1;
-        S_msort8(elems, scratch, left, mid - 1, compare, context);
-        S_msort8(elems, scratch, mid,  right, compare, context);
-        SI_merge((elems + left * WIDTH), (mid - left),
-                 (elems + mid * WIDTH), (right - mid + 1),
-                 scratch, WIDTH, compare, context);
-        memcpy((elems + left * WIDTH), scratch, ((right - left + 1) * WIDTH));
+S_merge_force_collapse(MergeState *ms) {
+    size_t *run_len = ms->run_len;
+
+    while (ms->num_runs > 1) {
+        size_t n = ms->num_runs - 2;
+        if (n > 0 && run_len[n - 1] < run_len[n + 1]) { n--; }
+        S_merge_at(ms, n);
     }
 }
 
-#undef WIDTH
+/***************************************************************************
+ * Pattern-defeating quicksort
+ *
+ * An introsort variant after Orson Peters' pdqsort.  Partitions use a
+ * median-of-three pivot, or a pseudo-median of nine for larger arrays.
+ * Partitions which turn out to be highly unbalanced cause some elements to
+ * be shuffled to break up patterns; once too many have occurred, heapsort
+ * takes over to guarantee O(n log n).  Runs of elements equal to the pivot
+ * are handled in linear time by partitioning them to the left, and
+ * partitions which needed no swaps are finished off with an insertion sort
+ * that gives up after a few moves.
+ */
+
+// Partitions below this size are sorted with insertion sort.
+#define INSERTION_SORT_THRESHOLD 24
+
+// Partitions above this size use the pseudo-median of nine as pivot.
+#define NINTHER_THRESHOLD 128
+
+// Maximum number of element moves before a partial insertion sort gives up.
+#define PARTIAL_INSERTION_SORT_LIMIT 8
+
+// Number of elements examined at once by block partitioning.  Offsets
+// within a block must fit in a byte.
+#define PARTITION_BLOCK_SIZE 64
+
+// Size of the buffer on the stack which holds the pivot.  Wider elements
+// need a heap allocation.
+#define PIVOT_BUF_SIZE 64
+
+typedef struct {
+    size_t                width;
+    CFISH_Sort_Compare_t  compare;
+    void                 *context;
+    uint8_t              *pivot;
+} QuickState;
+
+#define QS_LESS(qs, a, b) ((qs)->compare((qs)->context, (a), (b)) < 0)
+
 static void
-S_msort_any(void *velems, void *vscratch, size_t left, size_t right,
-            CFISH_Sort_Compare_t compare, void *context, size_t width) {
-    uint8_t *elems   = (uint8_t*)velems;
-    uint8_t *scratch = (uint8_t*)vscratch;
-    if (right > left) {
-        const size_t mid = left + (right - left) / 2 + 1;
-        S_msort_any(elems, scratch, left, mid - 1, compare, context, width);
-        S_msort_any(elems, scratch, mid,  right,   compare, context, width);
-        SI_merge((elems + left * width), (mid - left),
-                 (elems + mid * width), (right - mid + 1),
-                 scratch, width, compare, context);
-        memcpy((elems + left * width), scratch, ((right - left + 1) * width));
+S_pdqsort_loop(QuickState *qs, uint8_t *begin, uint8_t *end,
+               size_t bad_allowed, bool leftmost);
+
+void
+Sort_quicksort(void *elems, size_t num_elems, size_t width,
+               CFISH_Sort_Compare_t compare, void *context) {
+    // Arrays of 0 or 1 items are already sorted.
+    if (num_elems < 2) { return; }
+    if (width == 0) {
+        THROW(ERR, "Parameter 'width' cannot be 0");
     }
+
+    uint8_t pivot_buf[PIVOT_BUF_SIZE];
+    QuickState qs;
+    qs.width   = width;
+    qs.compare = compare;
+    qs.context = context;
+    qs.pivot   = width <= PIVOT_BUF_SIZE
+                 ? pivot_buf
+                 : (uint8_t*)MALLOCATE(width);
+
+    // Allow about log2(num_elems) bad partitions before falling back to
+    // heapsort.
+    size_t bad_allowed = 0;
+    for (size_t n = num_elems; n > 1; n >>= 1) { bad_allowed++; }
+
+    uint8_t *begin = (uint8_t*)elems;
+    S_pdqsort_loop(&qs, begin, begin + num_elems * width, bad_allowed, true);
+
+    if (qs.pivot != pivot_buf) { FREEMEM(qs.pivot); }
 }
 
+// Sort [begin, end) with insertion sort.  If `guarded` is false, the
+// element before `begin` must compare less than or equal to all elements in
+// the range.
 static CFISH_INLINE void
-SI_merge(void *left_vptr,  size_t left_size,
-         void *right_vptr, size_t right_size,
-         void *vdest, size_t width, CFISH_Sort_Compare_t compare,
-         void *context) {
-    uint8_t *left_ptr    = (uint8_t*)left_vptr;
-    uint8_t *right_ptr   = (uint8_t*)right_vptr;
-    uint8_t *left_limit  = left_ptr + left_size * width;
-    uint8_t *right_limit = right_ptr + right_size * width;
-    uint8_t *dest        = (uint8_t*)vdest;
-
-    while (left_ptr < left_limit && right_ptr < right_limit) {
-        if (compare(context, left_ptr, right_ptr) < 1) {
-            memcpy(dest, left_ptr, width);
-            dest += width;
-            left_ptr += width;
+SI_insertion_sort(QuickState *qs, uint8_t *begin, uint8_t *end,
+                  bool guarded) {
+    const size_t width = qs->width;
+    if (begin == end) { return; }
+
+    for (uint8_t *cur = begin + width; cur != end; cur += width) {
+        uint8_t *sift = cur;
+        if (QS_LESS(qs, sift, sift - width)) {
+            SI_copy(qs->pivot, sift, width);
+            do {
+                SI_copy(sift, sift - width, width);
+                sift -= width;
+            } while ((!guarded || sift != begin)
+                     && QS_LESS(qs, qs->pivot, sift - width));
+            SI_copy(sift, qs->pivot, width);
+        }
+    }
+}
+
+// Attempt to sort [begin, end) with insertion sort.  Give up and return
+// false if more than PARTIAL_INSERTION_SORT_LIMIT elements would have to be
+// moved.
+static bool
+S_partial_insertion_sort(QuickState *qs, uint8_t *begin, uint8_t *end) {
+    const size_t width = qs->width;
+    size_t       moved = 0;
+    if (begin == end) { return true; }
+
+    for (uint8_t *cur = begin + width; cur != end; cur += width) {
+        uint8_t *sift = cur;
+        if (QS_LESS(qs, sift, sift - width)) {
+            SI_copy(qs->pivot, sift, width);
+            do {
+                SI_copy(sift, sift - width, width);
+                sift -= width;
+            } while (sift != begin && QS_LESS(qs, qs->pivot, sift - width));
+            SI_copy(sift, qs->pivot, width);
+            moved += (size_t)(cur - sift) / width;
+        }
+        if (moved > PARTIAL_INSERTION_SORT_LIMIT) { return false; }
+    }
+
+    return true;
+}
+
+static CFISH_INLINE void
+SI_sort2(QuickState *qs, uint8_t *a, uint8_t *b) {
+    if (QS_LESS(qs, b, a)) { SI_swap(a, b, qs->width); }
+}
+
+static CFISH_INLINE void
+SI_sort3(QuickState *qs, uint8_t *a, uint8_t *b, uint8_t *c) {
+    SI_sort2(qs, a, b);
+    SI_sort2(qs, b, c);
+    SI_sort2(qs, a, b);
+}
+
+static void
+S_heapsort(QuickState *qs, uint8_t *begin, uint8_t *end) {
+    const size_t width     = qs->width;
+    const size_t num_elems = (size_t)(end - begin) / width;
+
+    for (size_t i = num_elems / 2; i-- > 0;) {
+        for (size_t root = i;;) {
+            size_t child = 2 * root + 1;
+            if (child >= num_elems) { break; }
+            if (child + 1 < num_elems
+                && QS_LESS(qs, begin + child * width,
+                           begin + (child + 1) * width)
+               ) {
+                child++;
+            }
+            if (!QS_LESS(qs, begin + root * width, begin + child * width)) {
+                break;
+            }
+            SI_swap(begin + root * width, begin + child * width, width);
+            root = child;
+        }
+    }
+
+    for (size_t size = num_elems; size > 1;) {
+        size--;
+        SI_swap(begin, begin + size * width, width);
+        for (size_t root = 0;;) {
+            size_t child = 2 * root + 1;
+            if (child >= size) { break; }
+            if (child + 1 < size
+                && QS_LESS(qs, begin + child * width,
+                           begin + (child + 1) * width)
+               ) {
+                child++;
+            }
+            if (!QS_LESS(qs, begin + root * width, begin + child * width)) {
+                break;
+            }
+            SI_swap(begin + root * width, begin + child * width, width);
+            root = child;
+        }
+    }
+}
+
+// Swap the elements in [*first_ptr, *last_ptr) which are on the wrong side
+// of the pivot, leaving *first_ptr == *last_ptr at the partition point.
+//
+// This is the block partitioning scheme from Edelkamp and Weiss,
+// "BlockQuicksort: How Branch Mispredictions don't affect Quicksort".  The
+// comparisons for a whole block of elements are performed first, recording
+// the offsets of misplaced elements without branching on the results, and
+// the swaps are performed afterwards.
+static void
+S_partition_blocks(QuickState *qs, uint8_t **first_ptr, uint8_t **last_ptr) {
+    const size_t  width = qs->width;
+    uint8_t      *pivot = qs->pivot;
+    uint8_t      *first = *first_ptr;
+    uint8_t      *last  = *last_ptr;
+    uint8_t       offsets_l[PARTITION_BLOCK_SIZE];
+    uint8_t       offsets_r[PARTITION_BLOCK_SIZE];
+    uint8_t      *base_l  = first;
+    uint8_t      *base_r  = last;
+    size_t        num_l   = 0;
+    size_t        num_r   = 0;
+    size_t        start_l = 0;
+    size_t        start_r = 0;
+
+    while (first < last) {
+        // Decide how many elements to examine on each side.  Only refill a
+        // block once all of its misplaced elements have been swapped.
+        size_t num_unknown = (size_t)(last - first) / width;
+        size_t left_split  = num_l == 0
+                             ? (num_r == 0 ? num_unknown / 2 : num_unknown)
+                             : 0;
+        size_t right_split = num_r == 0 ? num_unknown - left_split : 0;
+        if (left_split > PARTITION_BLOCK_SIZE) {
+            left_split = PARTITION_BLOCK_SIZE;
+        }
+        if (right_split > PARTITION_BLOCK_SIZE) {
+            right_split = PARTITION_BLOCK_SIZE;
+        }
+
+        // Record elements on the left which belong to the right.
+        for (size_t i = 0; i < left_split; i++) {
+            offsets_l[num_l] = (uint8_t)i;
+            num_l += !QS_LESS(qs, first, pivot);
+            first += width;
+        }
+
+        // Record elements on the right which belong to the left.
+        for (size_t i = 0; i < right_split; i++) {
+            last -= width;
+            offsets_r[num_r] = (uint8_t)i;
+            num_r += QS_LESS(qs, last, pivot);
+        }
+
+        // Swap as many pairs as possible.
+        size_t num = num_l < num_r ? num_l : num_r;
+        for (size_t i = 0; i < num; i++) {
+            SI_swap(base_l + offsets_l[start_l + i] * width,
+                    base_r - (offsets_r[start_r + i] + 1) * width, width);
+        }
+        num_l   -= num;
+        num_r   -= num;
+        start_l += num;
+        start_r += num;
+        if (num_l == 0) {
+            start_l = 0;
+            base_l  = first;
+        }
+        if (num_r == 0) {
+            start_r = 0;
+            base_r  = last;
+        }
+    }
+
+    // All elements have been examined.  Move the remaining misplaced
+    // elements of one of the blocks to the partition boundary.
+    if (num_l) {
+        while (num_l--) {
+            last -= width;
+            SI_swap(base_l + offsets_l[start_l + num_l] * width, last, width);
+        }
+        first = last;
+    }
+    if (num_r) {
+        while (num_r--) {
+            SI_swap(base_r - (offsets_r[start_r + num_r] + 1) * width, first,
+                    width);
+            first += width;
+        }
+        last = first;
+    }
+
+    *first_ptr = first;
+    *last_ptr  = last;
+}
+
+// Partition [begin, end) around the pivot *begin.  Elements equal to the
+// pivot go to the right.  Return the final position of the pivot and set
+// `already_partitioned` if no elements had to be swapped.  Relies on the
+// pivot having been chosen as a median of at least three elements, so that
+// the scans stop before running off the range.
+static uint8_t*
+S_partition_right(QuickState *qs, uint8_t *begin, uint8_t *end,
+                  bool *already_partitioned) {
+    const size_t  width = qs->width;
+    uint8_t      *pivot = qs->pivot;
+    uint8_t      *first = begin;
+    uint8_t      *last  = end;
+
+    SI_copy(pivot, begin, width);
+
+    // Find the first element greater than or equal to the pivot.
+    do { first += width; } while (QS_LESS(qs, first, pivot));
+
+    // Find the last element less than the pivot.  If no element before
+    // `first` was less than the pivot, guard against running off the range.
+    if (first - width == begin) {
+        while (first < last) {
+            last -= width;
+            if (QS_LESS(qs, last, pivot)) { break; }
+        }
+    }
+    else {
+        do { last -= width; } while (!QS_LESS(qs, last, pivot));
+    }
+
+    *already_partitioned = first >= last;
+
+    if (!*already_partitioned) {
+        SI_swap(first, last, width);
+        first += width;
+        S_partition_blocks(qs, &first, &last);
+    }
+
+    // Put the pivot in place.
+    uint8_t *pivot_pos = first - width;
+    SI_copy(begin, pivot_pos, width);
+    SI_copy(pivot_pos, pivot, width);
+    return pivot_pos;
+}
+
+// Partition [begin, end) around the pivot *begin.  Elements equal to the
+// pivot go to the left.  Used when the element before `begin` is known to
+// be equal to the pivot, in which case all elements equal to it end up in
+// their final position.
+static uint8_t*
+S_partition_left(QuickState *qs, uint8_t *begin, uint8_t *end) {
+    const size_t  width = qs->width;
+    uint8_t      *pivot = qs->pivot;
+    uint8_t      *first = begin;
+    uint8_t      *last  = end;
+
+    SI_copy(pivot, begin, width);
+
+    do { last -= width; } while (QS_LESS(qs, pivot, last));
+
+    if (last + width == end) {
+        while (first < last) {
+            first += width;
+            if (QS_LESS(qs, pivot, first)) { break; }
+        }
+    }
+    else {
+        do { first += width; } while (!QS_LESS(qs, pivot, first));
+    }
+
+    while (first < last) {
+        SI_swap(first, last, width);
+        do { last  -= width; } while (QS_LESS(qs, pivot, last));
+        do { first += width; } while (!QS_LESS(qs, pivot, first));
+    }
+
+    SI_copy(begin, last, width);
+    SI_copy(last, pivot, width);
+    return last;
+}
+
+static void
+S_pdqsort_loop(QuickState *qs, uint8_t *begin, uint8_t *end,
+               size_t bad_allowed, bool leftmost) {
+    const size_t width = qs->width;
+
+    while (1) {
+        const size_t size = (size_t)(end - begin) / width;
+
+        if (size < INSERTION_SORT_THRESHOLD) {
+            SI_insertion_sort(qs, begin, end, leftmost);
+            return;
+        }
+
+        // Choose the pivot as the median of three or pseudo-median of nine
+        // and move it to the front.
+        const size_t half = size / 2;
+        uint8_t *mid  = begin + half * width;
+        uint8_t *last = end - width;
+        if (size > NINTHER_THRESHOLD) {
+            SI_sort3(qs, begin, mid, last);
+            SI_sort3(qs, begin + width, mid - width, last - width);
+            SI_sort3(qs, begin + 2 * width, mid + width, last - 2 * width);
+            SI_sort3(qs, mid - width, mid, mid + width);
+            SI_swap(begin, mid, width);
         }
         else {
-            memcpy(dest, right_ptr, width);
+            SI_sort3(qs, mid, begin, last);
+        }
+
+        // If the element before this partition is not less than the pivot,
+        // then it equals the pivot and so do all elements in the partition
+        // which aren't greater.  Move those out of the way in linear time.
+        if (!leftmost && !QS_LESS(qs, begin - width, begin)) {
+            begin = S_partition_left(qs, begin, end) + width;
+            continue;
+        }
+
+        bool already_partitioned;
+        uint8_t *pivot_pos
+            = S_partition_right(qs, begin, end, &already_partitioned);
+
+        const size_t left_size  = (size_t)(pivot_pos - begin) / width;
+        const size_t right_size = (size_t)(end - pivot_pos) / width - 1;
+
+        if (left_size < size / 8 || right_size < size / 8) {
+            // Highly unbalanced partition.  Fall back to heapsort if this
+            // keeps happening, otherwise shuffle some elements around to
+            // break up the pattern that caused it.
+            if (--bad_allowed == 0) {
+                S_heapsort(qs, begin, end);
+                return;
+            }
+
+            if (left_size >= INSERTION_SORT_THRESHOLD) {
+                size_t quarter = left_size / 4;
+                SI_swap(begin, begin + quarter * width, width);
+                SI_swap(pivot_pos - width, pivot_pos - quarter * width,
+                        width);
+                if (left_size > NINTHER_THRESHOLD) {
+                    SI_swap(begin + width, begin + (quarter + 1) * width,
+                            width);
+                    SI_swap(begin + 2 * width, begin + (quarter + 2) * width,
+                            width);
+                    SI_swap(pivot_pos - 2 * width,
+                            pivot_pos - (quarter + 1) * width, width);
+                    SI_swap(pivot_pos - 3 * width,
+                            pivot_pos - (quarter + 2) * width, width);
+                }
+            }
+
+            if (right_size >= INSERTION_SORT_THRESHOLD) {
+                size_t quarter = right_size / 4;
+                SI_swap(pivot_pos + width, pivot_pos + (quarter + 1) * width,
+                        width);
+                SI_swap(end - width, end - quarter * width, width);
+                if (right_size > NINTHER_THRESHOLD) {
+                    SI_swap(pivot_pos + 2 * width,
+                            pivot_pos + (quarter + 2) * width, width);
+                    SI_swap(pivot_pos + 3 * width,
+                            pivot_pos + (quarter + 3) * width, width);
+                    SI_swap(end - 2 * width, end - (quarter + 1) * width,
+                            width);
+                    SI_swap(end - 3 * width, end - (quarter + 2) * width,
+                            width);
+                }
+            }
+        }
+        else if (already_partitioned
+                 && S_partial_insertion_sort(qs, begin, pivot_pos)
+                 && S_partial_insertion_sort(qs, pivot_pos + width, end)
+                ) {
+            // The partition was already sorted or nearly so.
+            return;
+        }
+
+        // Recurse into the left partition and loop on the right one.
+        S_pdqsort_loop(qs, begin, pivot_pos, bad_allowed, leftmost);
+        begin    = pivot_pos + width;
+        leftmost = false;
+    }
+}
+
+/***************************************************************************
+ * Parallel mergesort
+ *
+ * The array is divided into one chunk per thread, and every chunk is sorted
+ * with Sort_mergesort.  The sorted chunks are then merged pairwise in
+ * rounds, alternating between the array and the scratch buffer.  To keep all
+ * threads busy when only a few merges remain, every merge is split into
+ * independent segments by locating matching split points in both inputs
+ * with a binary search.
+ */
+
+// Arrays smaller than this are sorted serially.
+#define PARALLEL_THRESHOLD 65536
+
+// Minimum number of elements per thread.
+#define PARALLEL_MIN_CHUNK 16384
+
+#define PARALLEL_MAX_THREADS 64
+
+typedef struct {
+    size_t                width;
+    CFISH_Sort_Compare_t  compare;
+    void                 *context;
+} SortParams;
+
+// A unit of work.  Sort tasks sort the elements in `a` using `dest` as
+// scratch buffer.  Merge tasks merge `a` and `b` into `dest`; if `num_b` is
+// zero, they copy `a` to `dest`.
+typedef struct {
+    const SortParams *params;
+    bool              is_sort;
+    uint8_t          *a;
+    size_t            num_a;
+    uint8_t          *b;
+    size_t            num_b;
+    uint8_t          *dest;
+} SortTask;
+
+// Each worker runs every `stride`th task starting with `first`.
+typedef struct {
+    SortTask *tasks;
+    size_t    num_tasks;
+    size_t    first;
+    size_t    stride;
+} SortWorker;
+
+static void
+S_run_worker(void *arg);
+
+/********************************** Windows ********************************/
+#if !defined(CFISH_NOTHREADS) && defined(CHY_HAS_WINDOWS_H)
+
+#include <windows.h>
+
+typedef HANDLE SortThread;
+
+static DWORD __stdcall
+S_thread_main(void *arg) {
+    S_run_worker(arg);
+    return 0;
+}
+
+static bool
+S_thread_start(SortThread *thread, SortWorker *worker) {
+    *thread = CreateThread(NULL, 0, S_thread_main, worker, 0, NULL);
+    return *thread != NULL;
+}
+
+static void
+S_thread_join(SortThread thread) {
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+static uint32_t
+S_num_processors() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (uint32_t)info.dwNumberOfProcessors;
+}
+
+/******************************** pthreads *********************************/
+#elif !defined(CFISH_NOTHREADS) && defined(CHY_HAS_PTHREAD_H)
+
+#include <pthread.h>
+#ifdef CHY_HAS_UNISTD_H
+  #include <unistd.h>
+#endif
+
+typedef pthread_t SortThread;
+
+static void*
+S_thread_main(void *arg) {
+    S_run_worker(arg);
+    return NULL;
+}
+
+static bool
+S_thread_start(SortThread *thread, SortWorker *worker) {
+    return pthread_create(thread, NULL, S_thread_main, worker) == 0;
+}
+
+static void
+S_thread_join(SortThread thread) {
+    pthread_join(thread, NULL);
+}
+
+static uint32_t
+S_num_processors() {
+#ifdef _SC_NPROCESSORS_ONLN
+    long num = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num > 0) { return (uint32_t)num; }
+#endif
+    return 1;
+}
+
+/**************************** No thread support ****************************/
+#else
+
+typedef int SortThread;
+
+static bool
+S_thread_start(SortThread *thread, SortWorker *worker) {
+    UNUSED_VAR(thread);
+    UNUSED_VAR(worker);
+    return false;
+}
+
+static void
+S_thread_join(SortThread thread) {
+    UNUSED_VAR(thread);
+}
+
+static uint32_t
+S_num_processors() {
+    return 1;
+}
+
+#endif
+
+// Merge the sorted arrays `a` and `b` into `dest`, taking elements from `a`
+// first if they compare equal.
+static void
+S_merge(const SortParams *params, const uint8_t *a, size_t num_a,
+        const uint8_t *b, size_t num_b, uint8_t *dest) {
+    const size_t    width   = params->width;
+    const uint8_t  *a_limit = a + num_a * width;
+    const uint8_t  *b_limit = b + num_b * width;
+
+    if (num_a && num_b) {
+        while (1) {
+            size_t take_b
+                = params->compare(params->context, b, a) < 0;
+            SI_copy(dest, take_b ? b : a, width);
             dest += width;
-            right_ptr += width;
+            b    += take_b * width;
+            a    += (take_b ^ 1) * width;
+            if (a == a_limit || b == b_limit) { break; }
         }
     }
 
-    const ptrdiff_t left_remaining = left_limit - left_ptr;
-    memcpy(dest, left_ptr, (size_t)left_remaining);
-    dest += left_remaining;
-    const ptrdiff_t right_remaining = right_limit - right_ptr;
-    memcpy(dest, right_ptr, (size_t)right_remaining);
+    if (a < a_limit) {
+        memcpy(dest, a, (size_t)(a_limit - a));
+        dest += a_limit - a;
+    }
+    if (b < b_limit) {
+        memcpy(dest, b, (size_t)(b_limit - b));
+    }
 }
 
+// Return the number of elements of `a` among the first `rank` elements of
+// the merge of `a` and `b`.  `prev_split` is the result for the previous
+// segment ending at `prev_rank`.  The search is restricted so that neither
+// input can contribute a negative number of elements to the segment, even
+// if the comparator isn't a strict weak order (like comparing NaNs).
+static size_t
+S_merge_split(const SortParams *params, const uint8_t *a, size_t num_a,
+              const uint8_t *b, size_t num_b, size_t rank,
+              size_t prev_rank, size_t prev_split) {
+    const size_t width    = params->width;
+    const size_t seg_size = rank - prev_rank;
+    size_t lo = rank > num_b ? rank - num_b : 0;
+    size_t hi = prev_split + seg_size < num_a ? prev_split + seg_size : num_a;
+    if (lo < prev_split) { lo = prev_split; }
+
+    // Find the smallest count of elements from `a` so that the last element
+    // taken from `b` sorts before the next element of `a`.
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (params->compare(params->context, b + (rank - mid - 1) * width,
+                            a + mid * width) < 0
+           ) {
+            hi = mid;
+        }
+        else {
+            lo = mid + 1;
+        }
+    }
+
+    return lo;
+}
+
+static void
+S_run_task(SortTask *task) {
+    const SortParams *params = task->params;
+    if (task->is_sort) {
+        Sort_mergesort(task->a, task->dest, task->num_a, params->width,
+                       params->compare, params->context);
+    }
+    else {
+        S_merge(params, task->a, task->num_a, task->b, task->num_b,
+                task->dest);
+    }
+}
+
+static void
+S_run_worker(void *arg) {
+    SortWorker *worker = (SortWorker*)arg;
+    for (size_t i = worker->first; i < worker->num_tasks;
+         i += worker->stride
+        ) {
+        S_run_task(&worker->tasks[i]);
+    }
+}
+
+// Run all tasks using up to `num_threads` threads including the calling
+// thread, and wait for them to finish.
+static void
+S_run_tasks(SortTask *tasks, size_t num_tasks, size_t num_threads) {
+    SortWorker workers[PARALLEL_MAX_THREADS];
+    SortThread threads[PARALLEL_MAX_THREADS];
+    bool       started[PARALLEL_MAX_THREADS];
+
+    if (num_threads > num_tasks) { num_threads = num_tasks; }
+
+    for (size_t i = 0; i < num_threads; i++) {
+        workers[i].tasks     = tasks;
+        workers[i].num_tasks = num_tasks;
+        workers[i].first     = i;
+        workers[i].stride    = num_threads;
+    }
+    for (size_t i = 1; i < num_threads; i++) {
+        started[i] = S_thread_start(&threads[i], &workers[i]);
+    }
+
+    S_run_worker(&workers[0]);
+
+    for (size_t i = 1; i < num_threads; i++) {
+        if (started[i]) {
+            S_thread_join(threads[i]);
+        }
+        else {
+            // Thread creation failed, so do the work here.
+            S_run_worker(&workers[i]);
+        }
+    }
+}
+
+void
+Sort_parallel_mergesort(void *elems, void *scratch, size_t num_elems,
+                        size_t width, CFISH_Sort_Compare_t compare,
+                        void *context, uint32_t num_threads) {
+    if (num_threads == 0) { num_threads = S_num_processors(); }
+    if (num_threads > PARALLEL_MAX_THREADS) {
+        num_threads = PARALLEL_MAX_THREADS;
+    }
+    if (num_threads > num_elems / PARALLEL_MIN_CHUNK) {
+        num_threads = (uint32_t)(num_elems / PARALLEL_MIN_CHUNK);
+    }
+    if (num_elems < PARALLEL_THRESHOLD || num_threads < 2) {
+        Sort_mergesort(elems, scratch, num_elems, width, compare, context);
+        return;
+    }
+    if (width == 0) {
+        THROW(ERR, "Parameter 'width' cannot be 0");
+    }
+
+    SortParams params;
+    params.width   = width;
+    params.compare = compare;
+    params.context = context;
+
+    // Every round needs at most one task per thread plus one per merge.
+    const size_t  num_chunks = num_threads;
+    SortTask     *tasks
+        = (SortTask*)MALLOCATE(2 * num_chunks * sizeof(SortTask));
+    size_t        run_start[PARALLEL_MAX_THREADS + 1];
+    uint8_t      *src = (uint8_t*)elems;
+    uint8_t      *dst = (uint8_t*)scratch;
+
+    // Sort the chunks.
+    for (size_t i = 0; i <= num_chunks; i++) {
+        run_start[i] = (num_elems / num_chunks) * i
+                       + (i < num_elems % num_chunks ? i
+                                                     : num_elems % num_chunks);
+    }
+    for (size_t i = 0; i < num_chunks; i++) {
+        SortTask *task = &tasks[i];
+        task->params = &params;
+        task->is_sort = true;
+        task->a       = src + run_start[i] * width;
+        task->num_a   = run_start[i + 1] - run_start[i];
+        task->b       = NULL;
+        task->num_b   = 0;
+        task->dest    = dst + run_start[i] * width;
+    }
+    S_run_tasks(tasks, num_chunks, num_threads);
+
+    // Merge pairs of runs until a single run is left.
+    size_t num_runs = num_chunks;
+    while (num_runs > 1) {
+        size_t num_tasks = 0;
+
+        for (size_t i = 0; i < num_runs; i += 2) {
+            uint8_t *a     = src + run_start[i] * width;
+            size_t   num_a = run_start[i + 1] - run_start[i];
+            uint8_t *b     = NULL;
+            size_t   num_b = 0;
+            if (i + 1 < num_runs) {
+                b     = src + run_start[i + 1] * width;
+                num_b = run_start[i + 2] - run_start[i + 1];
+            }
+
+            // Split the merge into segments of about equal size.
+            size_t total    = num_a + num_b;
+            size_t segments = (total * num_threads + num_elems - 1)
+                              / num_elems;
+            size_t prev_rank  = 0;
+            size_t prev_split = 0;
+            for (size_t seg = 1; seg <= segments; seg++) {
+                size_t rank  = seg == segments
+                               ? total
+                               : total / segments * seg;
+                size_t split = S_merge_split(&params, a, num_a, b, num_b,
+                                             rank, prev_rank, prev_split);
+                SortTask *task = &tasks[num_tasks++];
+                task->params  = &params;
+                task->is_sort = false;
+                task->a       = a + prev_split * width;
+                task->num_a   = split - prev_split;
+                task->b       = b ? b + (prev_rank - prev_split) * width
+                                  : NULL;
+                task->num_b   = (rank - split) - (prev_rank - prev_split);
+                task->dest    = dst + (run_start[i] + prev_rank) * width;
+                prev_rank  = rank;
+                prev_split = split;
+            }
+        }
+
+        S_run_tasks(tasks, num_tasks, num_threads);
+
+        // Every merged run starts where its first input did.
+        size_t new_num_runs = 0;
+        for (size_t i = 0; i < num_runs; i += 2) {
+            run_start[new_num_runs++] = run_start[i];
+        }
+        run_start[new_num_runs] = num_elems;
+        num_runs = new_num_runs;
+
+        uint8_t *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    // Copy the result back if it ended up in the scratch buffer.
+    if (src != (uint8_t*)elems) {
+        size_t num_tasks = num_threads;
+        for (size_t i = 0; i < num_tasks; i++) {
+            size_t begin = num_elems / num_tasks * i;
+            size_t end   = i + 1 == num_tasks
+                           ? num_elems
+                           : num_elems / num_tasks * (i + 1);
+            SortTask *task = &tasks[i];
+            task->params  = &params;
+            task->is_sort = false;
+            task->a       = src + begin * width;
+            task->num_a   = end - begin;
+            task->b       = NULL;
+            task->num_b   = 0;
+            task->dest    = dst + begin * width;
+        }
+        S_run_tasks(tasks, num_tasks, num_threads);
+    }
+
+    FREEMEM(tasks);
+}
 
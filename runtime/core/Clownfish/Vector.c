@@ -22,7 +22,13 @@
 
 #include "Clownfish/Class.h"
 #include "Clownfish/Vector.h"
+#include "Clownfish/Blob.h"
+#include "Clownfish/ByteBuf.h"
 #include "Clownfish/Err.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Util/AllocStats.h"
+#include "Clownfish/Util/Arena.h"
 #include "Clownfish/Util/Memory.h"
 #include "Clownfish/Util/SortUtils.h"
 
@@ -56,7 +62,8 @@ Vec_init(Vector *self, size_t capacity) {
     self->cap = capacity;
 
     // Derive.
-    self->elems = (Obj**)CALLOCATE(capacity, sizeof(Obj*));
+    self->elems = (Obj**)Arena_buf_calloc(self, capacity, sizeof(Obj*));
+    ALLOCSTATS_BUF_ALLOC(self->klass, capacity * sizeof(Obj*));
 
     return self;
 }
@@ -69,11 +76,19 @@ Vec_Destroy_IMP(Vector *self) {
         for (; elems < limit; elems++) {
             DECREF(*elems);
         }
-        FREEMEM(self->elems);
+        ALLOCSTATS_BUF_FREE(self->klass, self->cap * sizeof(Obj*));
+        Arena_buf_free(self, self->elems);
     }
     SUPER_DESTROY(self, VECTOR);
 }
 
+void
+Vec_Traverse_IMP(Vector *self, Obj_Visit_t visit, void *context) {
+    for (size_t i = 0; i < self->size; i++) {
+        if (self->elems[i]) { visit(context, self->elems[i]); }
+    }
+}
+
 Vector*
 Vec_Clone_IMP(Vector *self) {
     Vector *twin = Vec_new(self->size);
@@ -172,7 +187,11 @@ Vec_Grow_IMP(Vector *self, size_t capacity) {
             S_overflow_error();
             return;
         }
-        self->elems = (Obj**)REALLOCATE(self->elems, capacity * sizeof(Obj*));
+        ALLOCSTATS_BUF_RESIZE(self->klass, self->cap * sizeof(Obj*),
+                              capacity * sizeof(Obj*));
+        self->elems = (Obj**)Arena_buf_realloc(self, self->elems,
+                                               self->cap * sizeof(Obj*),
+                                               capacity * sizeof(Obj*));
         self->cap   = capacity;
     }
 }
@@ -250,6 +269,58 @@ Vec_Sort_IMP(Vector *self) {
     FREEMEM(scratch);
 }
 
+// Return true if the elements can be compared from multiple threads.  The
+// Compare_To methods of these classes only read immutable data, and since
+// the classes are final, they can't be overridden by host subclasses.
+static bool
+S_elems_are_thread_safe(Vector *self) {
+    Class *kind = NULL;
+
+    for (size_t i = 0, max = self->size; i < max; i++) {
+        Obj *elem = self->elems[i];
+        if (elem == NULL) { continue; }
+
+        Class *klass = Obj_get_class(elem);
+        if (klass == FLOAT) {
+            // Integers and Floats can be compared with each other.
+            klass = INTEGER;
+        }
+        else if (klass != INTEGER && klass != STRING && klass != BLOB
+                 && klass != BYTEBUF
+                ) {
+            return false;
+        }
+
+        if (kind == NULL) {
+            kind = klass;
+        }
+        else if (klass != kind) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+Vec_Sort_Parallel_IMP(Vector *self, uint32_t num_threads) {
+    if (!S_elems_are_thread_safe(self)) {
+        Vec_Sort_IMP(self);
+        return;
+    }
+
+    void *scratch = MALLOCATE(self->size * sizeof(Obj*));
+    Sort_parallel_mergesort(self->elems, scratch, self->size, sizeof(void*),
+                            S_default_compare, NULL, num_threads);
+    FREEMEM(scratch);
+}
+
+void
+Vec_Sort_Unstable_IMP(Vector *self) {
+    Sort_quicksort(self->elems, self->size, sizeof(void*), S_default_compare,
+                   NULL);
+}
+
 bool
 Vec_Equals_IMP(Vector *self, Obj *other) {
     Vector *twin = (Vector*)other;
@@ -334,7 +405,11 @@ S_grow_and_oversize(Vector *self, size_t min_size) {
         capacity = MAX_VECTOR_SIZE;
     }
 
-    self->elems = (Obj**)REALLOCATE(self->elems, capacity * sizeof(Obj*));
+    ALLOCSTATS_BUF_RESIZE(self->klass, self->cap * sizeof(Obj*),
+                          capacity * sizeof(Obj*));
+    self->elems = (Obj**)Arena_buf_realloc(self, self->elems,
+                                           self->cap * sizeof(Obj*),
+                                           capacity * sizeof(Obj*));
     self->cap   = capacity;
 }
 
@@ -33,6 +33,7 @@ package clownfish
 #include "Clownfish/Hash.h"
 #include "Clownfish/HashIterator.h"
 #include "Clownfish/Vector.h"
+#include "Clownfish/TypedVector.h"
 #include "Clownfish/Num.h"
 #include "Clownfish/Boolean.h"
 #include "Clownfish/Util/Memory.h"
@@ -289,6 +290,18 @@ func GoToClownfish(value interface{}, class unsafe.Pointer, nullable bool) unsaf
 		if klass == C.CFISH_VECTOR || klass == C.CFISH_OBJ {
 			return goToVector(value, nullable)
 		}
+	case []int64:
+		if klass == C.CFISH_I64VECTOR || klass == C.CFISH_OBJ {
+			return goToI64Vector(value, nullable)
+		}
+	case []float64:
+		if klass == C.CFISH_F64VECTOR || klass == C.CFISH_OBJ {
+			return goToF64Vector(value, nullable)
+		}
+	case []uint32:
+		if klass == C.CFISH_U32VECTOR || klass == C.CFISH_OBJ {
+			return goToU32Vector(value, nullable)
+		}
 	case map[string]interface{}:
 		if klass == C.CFISH_HASH || klass == C.CFISH_OBJ {
 			return goToHash(value, nullable)
@@ -461,6 +474,78 @@ func goToVector(value interface{}, nullable bool) unsafe.Pointer {
 	panic(NewErr(mess))
 }
 
+func goToI64Vector(value interface{}, nullable bool) unsafe.Pointer {
+	switch v := value.(type) {
+	case []int64:
+		if v == nil {
+			if nullable {
+				return nil
+			}
+		} else {
+			size := len(v)
+			vec := C.cfish_I64Vec_new(C.size_t(size))
+			if size > 0 {
+				C.CFISH_I64Vec_Push_Array(vec, (*C.int64_t)(unsafe.Pointer(&v[0])),
+					C.size_t(size))
+			}
+			return unsafe.Pointer(vec)
+		}
+	case Obj:
+		certifyCF(v, C.CFISH_I64VECTOR, nullable)
+		return unsafe.Pointer(C.cfish_incref(unsafe.Pointer(v.TOPTR())))
+	}
+	mess := fmt.Sprintf("Can't convert %T to clownfish.I64Vector", value)
+	panic(NewErr(mess))
+}
+
+func goToF64Vector(value interface{}, nullable bool) unsafe.Pointer {
+	switch v := value.(type) {
+	case []float64:
+		if v == nil {
+			if nullable {
+				return nil
+			}
+		} else {
+			size := len(v)
+			vec := C.cfish_F64Vec_new(C.size_t(size))
+			if size > 0 {
+				C.CFISH_F64Vec_Push_Array(vec, (*C.double)(unsafe.Pointer(&v[0])),
+					C.size_t(size))
+			}
+			return unsafe.Pointer(vec)
+		}
+	case Obj:
+		certifyCF(v, C.CFISH_F64VECTOR, nullable)
+		return unsafe.Pointer(C.cfish_incref(unsafe.Pointer(v.TOPTR())))
+	}
+	mess := fmt.Sprintf("Can't convert %T to clownfish.F64Vector", value)
+	panic(NewErr(mess))
+}
+
+func goToU32Vector(value interface{}, nullable bool) unsafe.Pointer {
+	switch v := value.(type) {
+	case []uint32:
+		if v == nil {
+			if nullable {
+				return nil
+			}
+		} else {
+			size := len(v)
+			vec := C.cfish_U32Vec_new(C.size_t(size))
+			if size > 0 {
+				C.CFISH_U32Vec_Push_Array(vec, (*C.uint32_t)(unsafe.Pointer(&v[0])),
+					C.size_t(size))
+			}
+			return unsafe.Pointer(vec)
+		}
+	case Obj:
+		certifyCF(v, C.CFISH_U32VECTOR, nullable)
+		return unsafe.Pointer(C.cfish_incref(unsafe.Pointer(v.TOPTR())))
+	}
+	mess := fmt.Sprintf("Can't convert %T to clownfish.U32Vector", value)
+	panic(NewErr(mess))
+}
+
 func goToHash(value interface{}, nullable bool) unsafe.Pointer {
 	switch v := value.(type) {
 	case map[string]interface{}:
@@ -476,6 +561,11 @@ func goToHash(value interface{}, nullable bool) unsafe.Pointer {
 				keySize := len(key)
 				keyStr := C.CString(key)
 				cfKey := C.cfish_Str_new_steal_utf8(keyStr, C.size_t(keySize))
+				if C.cfish_Str_intern_host_keys {
+					interned := C.cfish_Str_intern(cfKey)
+					C.cfish_dec_refcount(unsafe.Pointer(cfKey))
+					cfKey = interned
+				}
 				defer C.cfish_dec_refcount(unsafe.Pointer(cfKey))
 				C.CFISH_Hash_Store(hash, cfKey, (*C.cfish_Obj)(newVal))
 			}
@@ -500,6 +590,12 @@ func ToGo(ptr unsafe.Pointer) interface{} {
 		return BlobToGo(ptr)
 	} else if class == C.CFISH_VECTOR {
 		return VectorToGo(ptr)
+	} else if class == C.CFISH_I64VECTOR {
+		return I64VectorToGo(ptr)
+	} else if class == C.CFISH_F64VECTOR {
+		return F64VectorToGo(ptr)
+	} else if class == C.CFISH_U32VECTOR {
+		return U32VectorToGo(ptr)
 	} else if class == C.CFISH_HASH {
 		return HashToGo(ptr)
 	} else if class == C.CFISH_BOOLEAN {
@@ -580,6 +676,72 @@ func VectorToGo(ptr unsafe.Pointer) []interface{} {
 	return slice
 }
 
+func I64VectorToGo(ptr unsafe.Pointer) []int64 {
+	vec := (*C.cfish_I64Vector)(ptr)
+	if vec == nil {
+		return nil
+	}
+	class := C.cfish_Obj_get_class((*C.cfish_Obj)(ptr))
+	if class != C.CFISH_I64VECTOR {
+		mess := "Not a I64Vector: " + StringToGo(unsafe.Pointer(C.CFISH_Class_Get_Name(class)))
+		panic(NewErr(mess))
+	}
+	size := C.CFISH_I64Vec_Get_Size(vec)
+	if size > C.size_t(maxInt) {
+		panic(fmt.Sprintf("Overflow: %d > %d", size, maxInt))
+	}
+	slice := make([]int64, int(size))
+	if size > 0 {
+		elems := (*[1 << 30]int64)(unsafe.Pointer(C.CFISH_I64Vec_Get_Ptr(vec)))
+		copy(slice, elems[:int(size):int(size)])
+	}
+	return slice
+}
+
+func F64VectorToGo(ptr unsafe.Pointer) []float64 {
+	vec := (*C.cfish_F64Vector)(ptr)
+	if vec == nil {
+		return nil
+	}
+	class := C.cfish_Obj_get_class((*C.cfish_Obj)(ptr))
+	if class != C.CFISH_F64VECTOR {
+		mess := "Not a F64Vector: " + StringToGo(unsafe.Pointer(C.CFISH_Class_Get_Name(class)))
+		panic(NewErr(mess))
+	}
+	size := C.CFISH_F64Vec_Get_Size(vec)
+	if size > C.size_t(maxInt) {
+		panic(fmt.Sprintf("Overflow: %d > %d", size, maxInt))
+	}
+	slice := make([]float64, int(size))
+	if size > 0 {
+		elems := (*[1 << 30]float64)(unsafe.Pointer(C.CFISH_F64Vec_Get_Ptr(vec)))
+		copy(slice, elems[:int(size):int(size)])
+	}
+	return slice
+}
+
+func U32VectorToGo(ptr unsafe.Pointer) []uint32 {
+	vec := (*C.cfish_U32Vector)(ptr)
+	if vec == nil {
+		return nil
+	}
+	class := C.cfish_Obj_get_class((*C.cfish_Obj)(ptr))
+	if class != C.CFISH_U32VECTOR {
+		mess := "Not a U32Vector: " + StringToGo(unsafe.Pointer(C.CFISH_Class_Get_Name(class)))
+		panic(NewErr(mess))
+	}
+	size := C.CFISH_U32Vec_Get_Size(vec)
+	if size > C.size_t(maxInt) {
+		panic(fmt.Sprintf("Overflow: %d > %d", size, maxInt))
+	}
+	slice := make([]uint32, int(size))
+	if size > 0 {
+		elems := (*[1 << 30]uint32)(unsafe.Pointer(C.CFISH_U32Vec_Get_Ptr(vec)))
+		copy(slice, elems[:int(size):int(size)])
+	}
+	return slice
+}
+
 func HashToGo(ptr unsafe.Pointer) map[string]interface{} {
 	hash := (*C.cfish_Hash)(ptr)
 	if hash == nil {
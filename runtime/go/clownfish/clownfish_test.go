@@ -227,6 +227,17 @@ func TestGoToBoolean(t *testing.T) {
 	}
 }
 
+func TestGoToTypedVectors(t *testing.T) {
+	ints := []int64{math.MinInt64, -1, 0, math.MaxInt64}
+	deepCheck(t, ToGo(goToI64Vector(ints, false)), ints)
+	floats := []float64{math.Inf(-1), -0.5, 0.0, math.MaxFloat64}
+	deepCheck(t, ToGo(goToF64Vector(floats, false)), floats)
+	uints := []uint32{0, 1, math.MaxUint32}
+	deepCheck(t, ToGo(goToU32Vector(uints, false)), uints)
+	empty := []int64{}
+	deepCheck(t, ToGo(goToI64Vector(empty, false)), empty)
+}
+
 func TestGoToHash(t *testing.T) {
 	expected := map[string]interface{}{
 		"foo": int64(1),
@@ -19,6 +19,7 @@
 #define C_CFISH_CLASS
 #define C_CFISH_METHOD
 #define C_CFISH_ERR
+#define C_CFISH_STRING
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -36,7 +37,11 @@
 #include "Clownfish/Method.h"
 #include "Clownfish/Num.h"
 #include "Clownfish/Obj.h"
+#include "Clownfish/ObjPool.h"
 #include "Clownfish/String.h"
+#include "Clownfish/TypedVector.h"
+#include "Clownfish/Util/AllocStats.h"
+#include "Clownfish/Util/Atomic.h"
 #include "Clownfish/Util/Memory.h"
 #include "Clownfish/Vector.h"
 
@@ -48,13 +53,17 @@ Err* (*GoCfish_TrapErr)(Err_Attempt_t routine, void *context);
 /******************************** Obj **************************************/
 
 static CFISH_INLINE bool
-SI_immortal(cfish_Class *klass) {
+SI_immortal(cfish_Obj *self) {
+    cfish_Class *klass = self->klass;
     if (klass == CFISH_CLASS
         || klass == CFISH_METHOD
         || klass == CFISH_BOOLEAN
        ){
         return true;
     }
+    if (klass == CFISH_STRING) {
+        return ((cfish_String*)self)->interned;
+    }
     return false;
 }
 
@@ -76,6 +85,11 @@ Obj*
 cfish_inc_refcount(void *vself) {
     Obj *self = (Obj*)vself;
 
+    // Cached Integers and Floats aren't flagged for special refcounting.
+    if (cfish_num_is_cached(self)) {
+        return self;
+    }
+
     // Handle special cases.
     cfish_Class *const klass = self->klass;
     if (klass->flags & CFISH_fREFCOUNTSPECIAL) {
@@ -88,7 +102,11 @@ cfish_inc_refcount(void *vself) {
                 return (cfish_Obj*)cfish_Str_new_from_trusted_utf8(utf8, size);
             }
         }
-        else if (SI_immortal(klass)) {
+        if (SI_immortal(self)) {
+            return self;
+        }
+        if (klass->flags & CFISH_fATOMICREFCOUNT) {
+            cfish_Atomic_inc_size(&self->refcount);
             return self;
         }
     }
@@ -100,11 +118,24 @@ cfish_inc_refcount(void *vself) {
 uint32_t
 cfish_dec_refcount(void *vself) {
     cfish_Obj *self = (Obj*)vself;
+    if (cfish_num_is_cached(self)) {
+        return self->refcount;
+    }
     cfish_Class *klass = self->klass;
     if (klass->flags & CFISH_fREFCOUNTSPECIAL) {
-        if (SI_immortal(klass)) {
+        if (SI_immortal(self)) {
             return self->refcount;
         }
+        if (klass->flags & CFISH_fATOMICREFCOUNT) {
+            size_t modified_refcount = cfish_Atomic_dec_size(&self->refcount);
+            if (modified_refcount == 0) {
+                Obj_Destroy(self);
+            }
+            else if (modified_refcount == SIZE_MAX) {
+                THROW(ERR, "Illegal refcount of 0");
+            }
+            return (uint32_t)modified_refcount;
+        }
     }
 
     uint32_t modified_refcount = INT32_MAX;
@@ -135,7 +166,12 @@ Obj_To_Host_IMP(Obj *self, void *vcache) {
 
 Obj*
 Class_Make_Obj_IMP(Class *self) {
+    ALLOCSTATS_OBJ_ALLOC(self);
+#ifdef CFISH_OBJ_POOL
+    Obj *obj = (Obj*)ObjPool_alloc(self->obj_alloc_size);
+#else
     Obj *obj = (Obj*)Memory_wrapped_calloc(self->obj_alloc_size, 1);
+#endif
     obj->klass = self;
     obj->refcount = 1;
     return obj;
@@ -313,4 +349,25 @@ Bool_To_Host_IMP(Boolean *self, void *vcache) {
     return super_to_host(self, vcache);
 }
 
+void*
+I64Vec_To_Host_IMP(I64Vector *self, void *vcache) {
+    I64Vec_To_Host_t super_to_host
+        = SUPER_METHOD_PTR(I64VECTOR, CFISH_I64Vec_To_Host);
+    return super_to_host(self, vcache);
+}
+
+void*
+F64Vec_To_Host_IMP(F64Vector *self, void *vcache) {
+    F64Vec_To_Host_t super_to_host
+        = SUPER_METHOD_PTR(F64VECTOR, CFISH_F64Vec_To_Host);
+    return super_to_host(self, vcache);
+}
+
+void*
+U32Vec_To_Host_IMP(U32Vector *self, void *vcache) {
+    U32Vec_To_Host_t super_to_host
+        = SUPER_METHOD_PTR(U32VECTOR, CFISH_U32Vec_To_Host);
+    return super_to_host(self, vcache);
+}
+
 
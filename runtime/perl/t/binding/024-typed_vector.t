@@ -0,0 +1,47 @@
+# Licensed to the Apache Software Foundation (ASF) under one or more
+# contributor license agreements.  See the NOTICE file distributed with
+# this work for additional information regarding copyright ownership.
+# The ASF licenses this file to You under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License.  You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+use strict;
+use warnings;
+use lib 'buildlib';
+
+use Test::More tests => 9;
+use Clownfish;
+
+my $i64_vec = Clownfish::I64Vector->new;
+isa_ok( $i64_vec, 'Clownfish::I64Vector' );
+$i64_vec->push(-1);
+$i64_vec->push_all( pack( 'q*', 2, -3, 4 ) );
+is( $i64_vec->get_size, 4, 'I64Vector push_all packed string' );
+is_deeply( [ unpack( 'q*', $i64_vec->to_perl ) ], [ -1, 2, -3, 4 ],
+    'I64Vector round trip' );
+
+my $f64_vec = Clownfish::F64Vector->new;
+$f64_vec->push_all( pack( 'd*', 0.5, -1.25 ) );
+is( $f64_vec->fetch(1), -1.25, 'F64Vector push_all packed string' );
+is_deeply( [ unpack( 'd*', $f64_vec->to_perl ) ], [ 0.5, -1.25 ],
+    'F64Vector round trip' );
+
+my $u32_vec = Clownfish::U32Vector->new;
+$u32_vec->push_all( pack( 'L*', 1, 4294967295 ) );
+is( $u32_vec->fetch(1), 4294967295, 'U32Vector push_all packed string' );
+is_deeply( [ unpack( 'L*', $u32_vec->to_perl ) ], [ 1, 4294967295 ],
+    'U32Vector round trip' );
+
+$u32_vec->push_all('');
+is( $u32_vec->get_size, 2, 'push_all empty packed string' );
+
+eval { $u32_vec->push_all('abc') };
+like( $@, qr/not a multiple/, 'Die on truncated packed string' );
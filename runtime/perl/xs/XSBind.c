@@ -22,6 +22,7 @@
 #define C_CFISH_FLOAT
 #define C_CFISH_INTEGER
 #define C_CFISH_BOOLEAN
+#define C_CFISH_STRING
 #define NEED_newRV_noinc
 #include "charmony.h"
 #include "XSBind.h"
@@ -32,6 +33,8 @@
 #include "Clownfish/Num.h"
 #include "Clownfish/PtrHash.h"
 #include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/TypedVector.h"
+#include "Clownfish/Util/AllocStats.h"
 #include "Clownfish/Util/Atomic.h"
 #include "Clownfish/Util/Memory.h"
 
@@ -86,6 +89,12 @@ S_perl_hash_to_cfish_hash(pTHX_ HV *phash, cfish_ConversionCache *cache);
 static cfish_Vector*
 S_perl_array_to_cfish_array(pTHX_ AV *parray, cfish_ConversionCache *cache);
 
+// Convert a packed string into a typed vector if `klass` is one of the typed
+// vector classes.  Return NULL otherwise.  Caller takes responsibility for a
+// refcount.
+static cfish_Obj*
+S_packed_string_to_typed_vector(pTHX_ SV *sv, cfish_Class *klass);
+
 static bool
 S_class_is_a(cfish_Class *klass, cfish_Class *ancestor) {
     while (klass != NULL) {
@@ -135,6 +144,7 @@ XSBind_new_blank_obj(pTHX_ SV *either_sv) {
 // Used to thaw Lucy objects.
 cfish_Obj*
 XSBind_foster_obj(pTHX_ SV *sv, cfish_Class *klass) {
+    CFISH_ALLOCSTATS_OBJ_ALLOC(klass);
     cfish_Obj *obj
         = (cfish_Obj*)cfish_Memory_wrapped_calloc(klass->obj_alloc_size, 1);
     SV *inner_obj = SvRV(sv);
@@ -280,6 +290,18 @@ S_maybe_perl_to_cfish(pTHX_ SV *sv, cfish_Class *klass, bool increment,
         *obj_ptr = NULL;
         return true;
     }
+    else {
+        // Accept packed strings as produced by the To_Host methods of the
+        // typed vectors.
+        cfish_Obj *obj = S_packed_string_to_typed_vector(aTHX_ sv, klass);
+        if (obj) {
+            if (!increment) {
+                sv_2mortal(XSBind_cfish_obj_to_sv_noinc(aTHX_ obj));
+            }
+            *obj_ptr = obj;
+            return true;
+        }
+    }
 
     // Stringify as last resort.
     if (klass == CFISH_STRING || klass == CFISH_OBJ) {
@@ -420,7 +442,14 @@ S_perl_hash_to_cfish_hash(pTHX_ HV *phash, cfish_ConversionCache *cache) {
             THROW(CFISH_ERR, "Can't convert to Clownfish::Obj");
         }
 
-        CFISH_Hash_Store_Utf8(retval, key_str, key_len, value);
+        if (cfish_Str_intern_host_keys) {
+            cfish_String *key = cfish_Str_intern_utf8(key_str, key_len);
+            CFISH_Hash_Store(retval, key, value);
+            CFISH_DECREF(key);
+        }
+        else {
+            CFISH_Hash_Store_Utf8(retval, key_str, key_len, value);
+        }
     }
 
     if (cache == &new_cache && cache->seen) {
@@ -487,6 +516,42 @@ S_perl_array_to_cfish_array(pTHX_ AV *parray, cfish_ConversionCache *cache) {
     return retval;
 }
 
+static cfish_Obj*
+S_packed_string_to_typed_vector(pTHX_ SV *sv, cfish_Class *klass) {
+    size_t width;
+    if (klass == CFISH_I64VECTOR)      { width = sizeof(int64_t); }
+    else if (klass == CFISH_F64VECTOR) { width = sizeof(double); }
+    else if (klass == CFISH_U32VECTOR) { width = sizeof(uint32_t); }
+    else                               { return NULL; }
+
+    STRLEN size;
+    char *ptr = SvPVbyte(sv, size);
+    if (size % width != 0) {
+        THROW(CFISH_ERR, "Length of packed string for %o not a multiple"
+              " of %u64: %u64", CFISH_Class_Get_Name(klass), (uint64_t)width,
+              (uint64_t)size);
+    }
+
+    // The buffer of the SV may not be aligned, so the Push_Array methods
+    // must copy it with memcpy.
+    size_t count = size / width;
+    if (klass == CFISH_I64VECTOR) {
+        cfish_I64Vector *vec = cfish_I64Vec_new(count);
+        CFISH_I64Vec_Push_Array(vec, (const int64_t*)ptr, count);
+        return (cfish_Obj*)vec;
+    }
+    else if (klass == CFISH_F64VECTOR) {
+        cfish_F64Vector *vec = cfish_F64Vec_new(count);
+        CFISH_F64Vec_Push_Array(vec, (const double*)ptr, count);
+        return (cfish_Obj*)vec;
+    }
+    else {
+        cfish_U32Vector *vec = cfish_U32Vec_new(count);
+        CFISH_U32Vec_Push_Array(vec, (const uint32_t*)ptr, count);
+        return (cfish_Obj*)vec;
+    }
+}
+
 struct trap_context {
     SV *routine;
     SV *context;
@@ -715,13 +780,21 @@ XSBind_destroy(pTHX_ SV *sv) {
 /**************************** Clownfish::Obj *******************************/
 
 static CFISH_INLINE bool
-SI_immortal(cfish_Class *klass) {
+SI_immortal(cfish_Obj *self) {
+    // Cached Integers and Floats.
+    if (cfish_num_is_cached(self)) {
+        return true;
+    }
+    cfish_Class *klass = self->klass;
     if (klass == CFISH_CLASS
         || klass == CFISH_METHOD
         || klass == CFISH_BOOLEAN
        ){
         return true;
     }
+    if (klass == CFISH_STRING) {
+        return ((cfish_String*)self)->interned;
+    }
     return false;
 }
 
@@ -752,7 +825,7 @@ S_lazy_init_host_obj(pTHX_ cfish_Obj *self, bool increment) {
     SvREFCNT(inner_obj) += excess;
 
     // Overwrite refcount with host object.
-    if (SI_immortal(klass)) {
+    if (SI_immortal(self)) {
         SvSHARE(inner_obj);
         if (!cfish_Atomic_cas_ptr((void**)&self->ref, old_ref.host_obj,
                                   inner_obj)) {
@@ -792,6 +865,11 @@ cfish_Obj*
 cfish_inc_refcount(void *vself) {
     cfish_Obj *self = (cfish_Obj*)vself;
 
+    // Cached Integers and Floats aren't flagged for special refcounting.
+    if (cfish_num_is_cached(self)) {
+        return self;
+    }
+
     // Handle special cases.
     cfish_Class *const klass = self->klass;
     if (klass->flags & CFISH_fREFCOUNTSPECIAL) {
@@ -804,7 +882,7 @@ cfish_inc_refcount(void *vself) {
                 return (cfish_Obj*)cfish_Str_new_from_trusted_utf8(utf8, size);
             }
         }
-        else if (SI_immortal(klass)) {
+        if (SI_immortal(self)) {
             return self;
         }
     }
@@ -825,9 +903,12 @@ uint32_t
 cfish_dec_refcount(void *vself) {
     cfish_Obj *self = (cfish_Obj*)vself;
 
+    if (cfish_num_is_cached(self)) {
+        return 1;
+    }
     cfish_Class *klass = self->klass;
     if (klass->flags & CFISH_fREFCOUNTSPECIAL) {
-        if (SI_immortal(klass)) {
+        if (SI_immortal(self)) {
             return 1;
         }
     }
@@ -942,6 +1023,7 @@ CFISH_Obj_To_Host_IMP(cfish_Obj *self, void *vcache) {
 
 cfish_Obj*
 CFISH_Class_Make_Obj_IMP(cfish_Class *self) {
+    CFISH_ALLOCSTATS_OBJ_ALLOC(self);
     cfish_Obj *obj
         = (cfish_Obj*)cfish_Memory_wrapped_calloc(self->obj_alloc_size, 1);
     obj->klass = self;
@@ -1441,6 +1523,35 @@ CFISH_Bool_To_Host_IMP(cfish_Boolean *self, void *vcache) {
     return newSViv((IV)self->value);
 }
 
+/************************** Clownfish::TypedVector **************************/
+
+// Typed vectors are converted to packed strings in native byte order which
+// can be unpacked with the "q*", "d*" and "L*" templates.
+
+void*
+CFISH_I64Vec_To_Host_IMP(cfish_I64Vector *self, void *vcache) {
+    CFISH_UNUSED_VAR(vcache);
+    dTHX;
+    return newSVpvn((char*)CFISH_I64Vec_Get_Ptr(self),
+                    CFISH_I64Vec_Get_Size(self) * sizeof(int64_t));
+}
+
+void*
+CFISH_F64Vec_To_Host_IMP(cfish_F64Vector *self, void *vcache) {
+    CFISH_UNUSED_VAR(vcache);
+    dTHX;
+    return newSVpvn((char*)CFISH_F64Vec_Get_Ptr(self),
+                    CFISH_F64Vec_Get_Size(self) * sizeof(double));
+}
+
+void*
+CFISH_U32Vec_To_Host_IMP(cfish_U32Vector *self, void *vcache) {
+    CFISH_UNUSED_VAR(vcache);
+    dTHX;
+    return newSVpvn((char*)CFISH_U32Vec_Get_Ptr(self),
+                    CFISH_U32Vec_Get_Size(self) * sizeof(uint32_t));
+}
+
 /********************* Clownfish::TestHarness::TestUtils ********************/
 
 
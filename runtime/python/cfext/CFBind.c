@@ -20,6 +20,7 @@
 #define C_CFISH_ERR
 
 #include <setjmp.h>
+#include <string.h>
 
 #include "charmony.h"
 #include "CFBind.h"
@@ -36,6 +37,8 @@
 #include "Clownfish/Num.h"
 #include "Clownfish/String.h"
 #include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/TypedVector.h"
+#include "Clownfish/Util/AllocStats.h"
 #include "Clownfish/Util/Atomic.h"
 #include "Clownfish/Util/Memory.h"
 #include "Clownfish/Vector.h"
@@ -115,7 +118,15 @@ S_py_dict_to_hash(PyObject *dict) {
                 = CFISH_MAKE_MESS("Failed to stringify as UTF-8");
             CFBind_reraise_pyerr(CFISH_ERR, mess);
         }
-        CFISH_Hash_Store_Utf8(hash, ptr, size, CFBind_py_to_cfish(value, NULL));
+        cfish_Obj *cf_value = CFBind_py_to_cfish(value, NULL);
+        if (cfish_Str_intern_host_keys) {
+            cfish_String *cf_key = cfish_Str_intern_utf8(ptr, size);
+            CFISH_Hash_Store(hash, cf_key, cf_value);
+            CFISH_DECREF(cf_key);
+        }
+        else {
+            CFISH_Hash_Store_Utf8(hash, ptr, size, cf_value);
+        }
         if (stringified != key) {
             Py_DECREF(stringified);
         }
@@ -123,6 +134,67 @@ S_py_dict_to_hash(PyObject *dict) {
     return hash;
 }
 
+// Indicate whether a buffer format string describes a single native-order
+// item of one of the types in `codes`.
+static bool
+S_buffer_format_is(const char *format, const char *codes) {
+    if (format == NULL) {
+        format = "B";
+    }
+    else if (format[0] == '@') {
+        format++;
+    }
+    return format[0] != '\0'
+           && format[1] == '\0'
+           && strchr(codes, format[0]) != NULL;
+}
+
+// Copy the contents of an object supporting the buffer protocol into a new
+// typed vector.  Return NULL if the buffer's format doesn't match the
+// element type of `klass`.
+static cfish_Obj*
+S_buffer_to_typed_vector(PyObject *py_obj, cfish_Class *klass) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(py_obj, &view,
+                           PyBUF_FORMAT | PyBUF_C_CONTIGUOUS) != 0) {
+        PyErr_Clear();
+        return NULL;
+    }
+
+    cfish_Obj *retval = NULL;
+    size_t count = view.itemsize ? (size_t)(view.len / view.itemsize) : 0;
+    if (klass == CFISH_I64VECTOR) {
+        if (view.itemsize == sizeof(int64_t)
+            && S_buffer_format_is(view.format, "qlL")
+           ) {
+            cfish_I64Vector *vec = cfish_I64Vec_new(count);
+            CFISH_I64Vec_Push_Array(vec, (const int64_t*)view.buf, count);
+            retval = (cfish_Obj*)vec;
+        }
+    }
+    else if (klass == CFISH_F64VECTOR) {
+        if (view.itemsize == sizeof(double)
+            && S_buffer_format_is(view.format, "d")
+           ) {
+            cfish_F64Vector *vec = cfish_F64Vec_new(count);
+            CFISH_F64Vec_Push_Array(vec, (const double*)view.buf, count);
+            retval = (cfish_Obj*)vec;
+        }
+    }
+    else if (klass == CFISH_U32VECTOR) {
+        if (view.itemsize == sizeof(uint32_t)
+            && S_buffer_format_is(view.format, "IL")
+           ) {
+            cfish_U32Vector *vec = cfish_U32Vec_new(count);
+            CFISH_U32Vec_Push_Array(vec, (const uint32_t*)view.buf, count);
+            retval = (cfish_Obj*)vec;
+        }
+    }
+
+    PyBuffer_Release(&view);
+    return retval;
+}
+
 static cfish_Obj*
 S_maybe_increment(void *vobj, bool increment) {
     if (increment) {
@@ -245,6 +317,20 @@ S_maybe_py_to_cfish(PyObject *py_obj, cfish_Class *klass, bool increment,
         *obj_ptr = (cfish_Obj*)cfish_Float_new(value);
         return true;
     }
+    else if ((klass == CFISH_I64VECTOR
+              || klass == CFISH_F64VECTOR
+              || klass == CFISH_U32VECTOR)
+             && PyObject_CheckBuffer(py_obj)
+            ) {
+        // Accept array.array, memoryview, and other objects supporting the
+        // buffer protocol with a matching item type.
+        cfish_Obj *vec = S_buffer_to_typed_vector(py_obj, klass);
+        if (!vec) {
+            return false;
+        }
+        *obj_ptr = vec;
+        return true;
+    }
 
     // The value did not meet the required spec, so return false to indicate
     // failure.
@@ -944,6 +1030,7 @@ S_get_cached_py_type(cfish_Class *self) {
 
 cfish_Obj*
 CFISH_Class_Make_Obj_IMP(cfish_Class *self) {
+    CFISH_ALLOCSTATS_OBJ_ALLOC(self);
     PyTypeObject *py_type = S_get_cached_py_type(self);
     cfish_Obj *obj = (cfish_Obj*)py_type->tp_alloc(py_type, 0);
     obj->klass = self;
@@ -1212,3 +1299,44 @@ CFISH_Bool_To_Host_IMP(cfish_Boolean *self, void *vcache) {
     }
 }
 
+// Typed vectors are converted to memoryviews which support the buffer
+// protocol, so they can be consumed by `array`, `struct` or NumPy without
+// further conversion.
+static PyObject*
+S_typed_vector_to_py(const void *elems, size_t size, size_t width,
+                     const char *format) {
+    PyObject *bytes = PyBytes_FromStringAndSize((const char*)elems,
+                                                (Py_ssize_t)(size * width));
+    if (!bytes) { return NULL; }
+    PyObject *view = PyMemoryView_FromObject(bytes);
+    Py_DECREF(bytes);
+    if (!view) { return NULL; }
+    PyObject *typed_view = PyObject_CallMethod(view, "cast", "s", format);
+    Py_DECREF(view);
+    return typed_view;
+}
+
+void*
+CFISH_I64Vec_To_Host_IMP(cfish_I64Vector *self, void *vcache) {
+    CFISH_UNUSED_VAR(vcache);
+    return S_typed_vector_to_py(CFISH_I64Vec_Get_Ptr(self),
+                                CFISH_I64Vec_Get_Size(self),
+                                sizeof(int64_t), "q");
+}
+
+void*
+CFISH_F64Vec_To_Host_IMP(cfish_F64Vector *self, void *vcache) {
+    CFISH_UNUSED_VAR(vcache);
+    return S_typed_vector_to_py(CFISH_F64Vec_Get_Ptr(self),
+                                CFISH_F64Vec_Get_Size(self),
+                                sizeof(double), "d");
+}
+
+void*
+CFISH_U32Vec_To_Host_IMP(cfish_U32Vector *self, void *vcache) {
+    CFISH_UNUSED_VAR(vcache);
+    return S_typed_vector_to_py(CFISH_U32Vec_Get_Ptr(self),
+                                CFISH_U32Vec_Get_Size(self),
+                                sizeof(uint32_t), "I");
+}
+
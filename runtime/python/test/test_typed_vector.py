@@ -0,0 +1,48 @@
+# Licensed to the Apache Software Foundation (ASF) under one or more
+# contributor license agreements.  See the NOTICE file distributed with
+# this work for additional information regarding copyright ownership.
+# The ASF licenses this file to You under the Apache License, Version 2.0
+# (the "License"); you may not use this file except in compliance with
+# the License.  You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import unittest
+import array
+import clownfish
+
+class TestTypedVector(unittest.TestCase):
+
+    def testI64VectorFromBuffer(self):
+        vec = clownfish.I64Vector()
+        vec.push(-1)
+        vec.push_all(array.array('q', [2, -3, 4]))
+        self.assertEqual(vec.get_size(), 4)
+        self.assertEqual(vec.fetch(2), -3)
+
+    def testF64VectorFromBuffer(self):
+        vec = clownfish.F64Vector()
+        vec.push_all(memoryview(array.array('d', [0.5, -1.25])))
+        self.assertEqual(vec.get_size(), 2)
+        self.assertEqual(vec.fetch(1), -1.25)
+
+    def testU32VectorFromBuffer(self):
+        vec = clownfish.U32Vector()
+        vec.push_all(array.array('I', [1, 4294967295]))
+        self.assertEqual(vec.fetch(1), 4294967295)
+
+    def testMismatchedBuffer(self):
+        vec = clownfish.I64Vector()
+        with self.assertRaises(TypeError):
+            vec.push_all(array.array('d', [0.5]))
+        with self.assertRaises(TypeError):
+            vec.push_all(b'12345678')
+
+if __name__ == '__main__':
+    unittest.main()
@@ -28,17 +28,24 @@
 #include "Clownfish/Test/TestString.h"
 #include "Clownfish/Test/TestCharBuf.h"
 #include "Clownfish/Test/TestClass.h"
+#include "Clownfish/Test/TestConcurrentHash.h"
 #include "Clownfish/Test/TestErr.h"
+#include "Clownfish/Test/TestFrozenHash.h"
 #include "Clownfish/Test/TestHash.h"
 #include "Clownfish/Test/TestHashIterator.h"
 #include "Clownfish/Test/TestLockFreeRegistry.h"
 #include "Clownfish/Test/TestMethod.h"
 #include "Clownfish/Test/TestNum.h"
 #include "Clownfish/Test/TestObj.h"
+#include "Clownfish/Test/TestObjPool.h"
 #include "Clownfish/Test/TestPtrHash.h"
+#include "Clownfish/Test/TestTypedVector.h"
 #include "Clownfish/Test/TestVector.h"
+#include "Clownfish/Test/Util/TestAllocStats.h"
+#include "Clownfish/Test/Util/TestArena.h"
 #include "Clownfish/Test/Util/TestAtomic.h"
 #include "Clownfish/Test/Util/TestMemory.h"
+#include "Clownfish/Test/Util/TestSortUtils.h"
 
 TestSuite*
 Test_create_test_suite() {
@@ -47,8 +54,11 @@ Test_create_test_suite() {
     TestSuite_Add_Batch(suite, (TestBatch*)TestClass_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestMethod_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestVector_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestTypedVector_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestHash_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestHashIterator_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestFrozenHash_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestConcurrentHash_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestObj_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestErr_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestBlob_new());
@@ -59,7 +69,11 @@ Test_create_test_suite() {
     TestSuite_Add_Batch(suite, (TestBatch*)TestNum_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestAtomic_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestLFReg_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestObjPool_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestArena_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestMemory_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestSortUtils_new());
+    TestSuite_Add_Batch(suite, (TestBatch*)TestAllocStats_new());
     TestSuite_Add_Batch(suite, (TestBatch*)TestPtrHash_new());
 
     return suite;
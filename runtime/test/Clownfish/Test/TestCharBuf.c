@@ -358,6 +358,97 @@ typedef struct {
     const char *pattern;
 } CatfContext;
 
+static bool
+S_catf_matches(const char *wanted, CharBuf *got) {
+    size_t size = strlen(wanted);
+    bool   ok   = got->size == size && memcmp(got->ptr, wanted, size) == 0;
+    CB_Clear(got);
+    return ok;
+}
+
+static uint64_t
+S_random_int_bits(void) {
+    // Vary the magnitude so that all digit counts are covered.
+    return TestUtils_random_u64() >> (TestUtils_random_u64() % 64);
+}
+
+static void
+test_vcatf_numbers_random(TestBatchRunner *runner) {
+    CharBuf *got = CB_new(0);
+    char     wanted[64];
+    bool     i64_ok = true;
+    bool     u64_ok = true;
+    bool     x32_ok = true;
+    bool     f64_ok = true;
+
+    static const int64_t i64_cases[] = {
+        0, 1, -1, 9, 10, 99, 100, -100, INT64_MAX, INT64_MIN
+    };
+    for (size_t i = 0; i < sizeof(i64_cases) / sizeof(int64_t); i++) {
+        sprintf(wanted, "%" PRId64, i64_cases[i]);
+        CB_catf(got, "%i64", i64_cases[i]);
+        if (!S_catf_matches(wanted, got)) { i64_ok = false; }
+    }
+    sprintf(wanted, "%" PRIu64, UINT64_MAX);
+    CB_catf(got, "%u64", UINT64_MAX);
+    if (!S_catf_matches(wanted, got)) { u64_ok = false; }
+
+    static const double f64_cases[] = {
+        0.0, 1.0, -1.0, 0.1, 0.5, 1.5, 100.0, 123456.0, 999999.0, 1e6,
+        1234567.0, 999999.5, 9999995.0, 1e-4, 1e-5, 0.000123456, 1e21,
+        1e22, 1e23, 1e-16, 1e-17, 1e-300, 1e300, 1.7976931348623157e308,
+        4.9406564584124654e-324, 0.3, 2.0 / 3.0, 3.14159265358979
+    };
+    for (size_t i = 0; i < sizeof(f64_cases) / sizeof(double); i++) {
+        sprintf(wanted, "%g", f64_cases[i]);
+        CB_catf(got, "%f64", f64_cases[i]);
+        if (!S_catf_matches(wanted, got)) { f64_ok = false; }
+    }
+    sprintf(wanted, "%g", -0.0);
+    CB_catf(got, "%f64", -0.0);
+    if (!S_catf_matches(wanted, got)) { f64_ok = false; }
+
+    for (int i = 0; i < 10000; i++) {
+        uint64_t bits = S_random_int_bits();
+
+        sprintf(wanted, "%" PRId64, (int64_t)bits);
+        CB_catf(got, "%i64", (int64_t)bits);
+        if (!S_catf_matches(wanted, got)) { i64_ok = false; }
+
+        sprintf(wanted, "%" PRIu64, bits);
+        CB_catf(got, "%u64", bits);
+        if (!S_catf_matches(wanted, got)) { u64_ok = false; }
+
+        sprintf(wanted, "%.8lx", (unsigned long)(uint32_t)bits);
+        CB_catf(got, "%x32", (uint32_t)bits);
+        if (!S_catf_matches(wanted, got)) { x32_ok = false; }
+
+        // Decimals with up to seven significant digits over a wide range
+        // of exponents, and arbitrary bit patterns.
+        double num = (double)(int64_t)(TestUtils_random_u64() % 20000000)
+                     - 10000000.0;
+        int    exp = (int)(TestUtils_random_u64() % 50) - 25;
+        for (; exp > 0; exp--) { num *= 10.0; }
+        for (; exp < 0; exp++) { num /= 10.0; }
+        sprintf(wanted, "%g", num);
+        CB_catf(got, "%f64", num);
+        if (!S_catf_matches(wanted, got)) { f64_ok = false; }
+
+        uint64_t raw = TestUtils_random_u64();
+        memcpy(&num, &raw, sizeof(num));
+        sprintf(wanted, "%g", num);
+        CB_catf(got, "%f64", num);
+        if (!S_catf_matches(wanted, got)) { f64_ok = false; }
+    }
+
+    TEST_TRUE(runner, i64_ok, "%%i64 matches sprintf");
+    TEST_TRUE(runner, u64_ok, "%%u64 matches sprintf");
+    TEST_TRUE(runner, x32_ok, "%%x32 matches sprintf");
+    TEST_TRUE(runner, f64_ok, "%%f64 matches sprintf");
+
+    DECREF(got);
+}
+
 static void
 S_catf_invalid_pattern(void *vcontext) {
     CatfContext *context = (CatfContext*)vcontext;
@@ -400,6 +491,87 @@ test_vcatf_invalid(TestBatchRunner *runner) {
     DECREF(context.charbuf);
 }
 
+static void
+S_new_invalid_template(void *vcontext) {
+    CatfContext *context = (CatfContext*)vcontext;
+    FormatTemplate *tmpl = FmtTmpl_new(context->pattern);
+    DECREF(tmpl);
+}
+
+static void
+test_FormatTemplate(TestBatchRunner *runner) {
+    static const char pattern[] =
+        "%% %o|%o|%s|%s|%i8 %i32 %i64|%u8 %u32 %u64|%f64|%x32 \xE2\x98\xBA %%";
+    String  *str    = Str_newf("string");
+    Integer *num    = Int_new(42);
+    CharBuf *wanted = CB_new(0);
+    CharBuf *got    = S_get_cb("foo ");
+
+    CB_catf(wanted, "foo ");
+    CB_catf(wanted, pattern, str, num, "chars", NULL, -8, INT32_MIN,
+            INT64_MIN, 8, UINT32_MAX, UINT64_MAX, 0.25, (uint32_t)0xBEEF);
+    FormatTemplate *tmpl = FmtTmpl_new(pattern);
+    FmtTmpl_catf(tmpl, got, str, num, "chars", NULL, -8, INT32_MIN,
+                 INT64_MIN, 8, UINT32_MAX, UINT64_MAX, 0.25,
+                 (uint32_t)0xBEEF);
+    String *wanted_str = CB_Yield_String(wanted);
+    TEST_TRUE(runner, S_cb_equals(got, wanted_str),
+              "FmtTmpl_catf matches CB_catf");
+
+    String *newf = FmtTmpl_newf(tmpl, str, num, "chars", NULL, -8,
+                                INT32_MIN, INT64_MIN, 8, UINT32_MAX,
+                                UINT64_MAX, 0.25, (uint32_t)0xBEEF);
+    TEST_TRUE(runner, Str_Ends_With(wanted_str, newf)
+                      && Str_Length(newf) + 4 == Str_Length(wanted_str),
+              "FmtTmpl_newf");
+    DECREF(newf);
+    DECREF(tmpl);
+
+    tmpl = FmtTmpl_new("key-%u32");
+    bool reuse_ok = true;
+    for (uint32_t i = 0; i < 100; i++) {
+        String *a = FmtTmpl_newf(tmpl, i);
+        String *b = Str_newf("key-%u32", i);
+        if (!Str_Equals(a, (Obj*)b)) { reuse_ok = false; }
+        DECREF(b);
+        DECREF(a);
+    }
+    TEST_TRUE(runner, reuse_ok, "Template can be reused");
+    DECREF(tmpl);
+
+    tmpl = FmtTmpl_new("");
+    newf = FmtTmpl_newf(tmpl);
+    TEST_UINT_EQ(runner, Str_Get_Size(newf), 0, "Empty template");
+    DECREF(newf);
+    DECREF(tmpl);
+
+    static FormatTemplate *cached;
+    FormatTemplate *first = FmtTmpl_cached(&cached, "cached %i32");
+    TEST_TRUE(runner, first != NULL && first == cached,
+              "cached creates template");
+    TEST_TRUE(runner, FmtTmpl_cached(&cached, "cached %i32") == first,
+              "cached returns same template");
+    DECREF(cached);
+    cached = NULL;
+
+    CatfContext context;
+    context.charbuf = NULL;
+    context.pattern = "bar %i65 baz";
+    Err *error = Err_trap(S_new_invalid_template, &context);
+    TEST_TRUE(runner, error != NULL, "Invalid specifier throws");
+    DECREF(error);
+    context.pattern = "bar \xC2 baz";
+    error = Err_trap(S_new_invalid_template, &context);
+    TEST_TRUE(runner, error != NULL, "Invalid UTF-8 throws");
+    DECREF(error);
+
+    DECREF(wanted_str);
+    DECREF(got);
+    DECREF(wanted);
+    DECREF(num);
+    DECREF(str);
+}
+
 static void
 test_Clear(TestBatchRunner *runner) {
     CharBuf *cb = S_get_cb("foo");
@@ -432,7 +604,7 @@ test_Get_Size(TestBatchRunner *runner) {
 
 void
 TestCB_Run_IMP(TestCharBuf *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 46);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 58);
     test_vcatf_percent(runner);
     test_vcatf_s(runner);
     test_vcatf_s_invalid_utf8(runner);
@@ -448,7 +620,9 @@ TestCB_Run_IMP(TestCharBuf *self, TestBatchRunner *runner) {
     test_vcatf_u64(runner);
     test_vcatf_f64(runner);
     test_vcatf_x32(runner);
+    test_vcatf_numbers_random(runner);
     test_vcatf_invalid(runner);
+    test_FormatTemplate(runner);
     test_Cat(runner);
     test_roundtrip(runner);
     test_invalid_chars(runner);
@@ -121,6 +121,43 @@ test_simple_subclass(TestBatchRunner *runner) {
     DECREF(obj);
 }
 
+static void
+test_deep_subclass(TestBatchRunner *runner) {
+    // Deeper than the ancestor display of a class.
+    Class *classes[CFISH_CLASS_DISPLAY_SIZE + 8];
+    size_t num_classes = sizeof(classes) / sizeof(classes[0]);
+    Class *parent = OBJ;
+
+    for (size_t i = 0; i < num_classes; i++) {
+        String *class_name = Str_newf("Clownfish::Test::Deep%u64", (uint64_t)i);
+        classes[i] = Class_singleton(class_name, parent);
+        parent = classes[i];
+        DECREF(class_name);
+    }
+
+    Obj *deepest = Class_Make_Obj(classes[num_classes - 1]);
+    Obj *middle  = Class_Make_Obj(classes[CFISH_CLASS_DISPLAY_SIZE - 1]);
+
+    bool all_ancestors = Obj_is_a(deepest, OBJ);
+    for (size_t i = 0; i < num_classes; i++) {
+        if (!Obj_is_a(deepest, classes[i])) { all_ancestors = false; }
+    }
+    TEST_TRUE(runner, all_ancestors, "is_a for all ancestors of deep class");
+
+    bool no_descendants = true;
+    for (size_t i = CFISH_CLASS_DISPLAY_SIZE; i < num_classes; i++) {
+        if (Obj_is_a(middle, classes[i])) { no_descendants = false; }
+    }
+    TEST_TRUE(runner, no_descendants, "is_a is false for descendants");
+
+    TEST_FALSE(runner, Obj_is_a(deepest, STRING),
+               "is_a is false for unrelated class");
+    TEST_FALSE(runner, Obj_is_a(deepest, NULL), "is_a is false for NULL");
+
+    DECREF(middle);
+    DECREF(deepest);
+}
+
 static void
 test_add_alias_to_registry(TestBatchRunner *runner) {
     static const char alias[] = "Clownfish::Test::ObjAlias";
@@ -155,9 +192,10 @@ test_Get_Methods(TestBatchRunner *runner) {
 
 void
 TestClass_Run_IMP(TestClass *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 12);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 16);
     test_bootstrap_idempotence(runner);
     test_simple_subclass(runner);
+    test_deep_subclass(runner);
     test_add_alias_to_registry(runner);
     test_Get_Methods(runner);
 }
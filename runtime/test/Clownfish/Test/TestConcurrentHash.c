@@ -0,0 +1,223 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/TestConcurrentHash.h"
+
+#include "Clownfish/Boolean.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/ConcurrentHash.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Util/Arena.h"
+
+#define NUM_THREADS 4
+
+typedef struct ThreadArgs {
+    ConcurrentHash *hash;
+    uint32_t        thread_id;
+    uint32_t        num_keys;
+    uint64_t        target_time;
+    uint32_t        missing;
+} ThreadArgs;
+
+TestConcurrentHash*
+TestConcurrentHash_new() {
+    return (TestConcurrentHash*)Class_Make_Obj(TESTCONCURRENTHASH);
+}
+
+static void
+test_single_thread(TestBatchRunner *runner) {
+    ConcurrentHash *hash = CHash_new(0);
+    String         *foo  = Str_newf("foo");
+    String         *bar  = Str_newf("bar");
+
+    CHash_Store(hash, foo, INCREF(bar));
+    Obj *value = CHash_Fetch(hash, foo);
+    TEST_TRUE(runner, value && Str_Equals(bar, value), "Store and Fetch");
+    DECREF(value);
+
+    CHash_Store(hash, foo, INCREF(foo));
+    value = CHash_Fetch_Utf8(hash, "foo", 3);
+    TEST_TRUE(runner, value && Str_Equals(foo, value),
+              "Store replaces value");
+    DECREF(value);
+    TEST_UINT_EQ(runner, CHash_Get_Size(hash), 1,
+                 "Replacing doesn't change size");
+
+    TEST_TRUE(runner, CHash_Fetch(hash, bar) == NULL,
+              "Fetch non-existent key returns NULL");
+    TEST_FALSE(runner, CHash_Has_Key(hash, bar), "Has_Key false");
+
+    value = CHash_Delete(hash, foo);
+    TEST_TRUE(runner, value && Str_Equals(foo, value), "Delete");
+    DECREF(value);
+    TEST_FALSE(runner, CHash_Has_Key(hash, foo), "Deleted key is gone");
+    TEST_TRUE(runner, CHash_Delete(hash, foo) == NULL,
+              "Delete non-existent key returns NULL");
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        String *str = Str_newf("%u32", i);
+        CHash_Store(hash, str, INCREF(str));
+        DECREF(str);
+    }
+    TEST_UINT_EQ(runner, CHash_Get_Size(hash), 1000, "Size after growth");
+    TEST_TRUE(runner, CHash_Get_Capacity(hash) > 64, "Table grew");
+
+    bool all_found = true;
+    for (uint32_t i = 0; i < 1000; i++) {
+        String *str = Str_newf("%u32", i);
+        value = CHash_Fetch(hash, str);
+        if (!value || !Str_Equals(str, value)) { all_found = false; }
+        DECREF(value);
+        DECREF(str);
+    }
+    TEST_TRUE(runner, all_found, "Fetch all keys after growth");
+
+    Vector *keys = CHash_Keys(hash);
+    TEST_UINT_EQ(runner, Vec_Get_Size(keys), 1000, "Keys");
+    DECREF(keys);
+
+    DECREF(bar);
+    DECREF(foo);
+    DECREF(hash);
+}
+
+static void
+test_arena(TestBatchRunner *runner) {
+    ConcurrentHash *hash  = CHash_new(0);
+    Arena          *arena = Arena_new(0);
+
+    Arena_Enter(arena);
+    String *key         = Str_newf("key");
+    size_t  num_objects = Arena_Get_Num_Objects(arena);
+    CHash_Store(hash, key, (Obj*)CFISH_TRUE);
+    CHash_Store(hash, key, (Obj*)CFISH_FALSE);
+    DECREF(key);
+    Arena_Leave(arena);
+    TEST_UINT_EQ(runner, Arena_Get_Num_Objects(arena), num_objects,
+                 "Key copy isn't allocated from arena");
+    TEST_UINT_EQ(runner, Arena_Release(arena), 0,
+                 "Store doesn't retain arena key");
+
+    Obj *value = CHash_Fetch_Utf8(hash, "key", 3);
+    TEST_TRUE(runner, value == (Obj*)CFISH_FALSE,
+              "Fetch after arena release");
+    DECREF(value);
+
+    DECREF(arena);
+    DECREF(hash);
+}
+
+static void
+S_churn(void *varg) {
+    ThreadArgs *args = (ThreadArgs*)varg;
+
+    // Sleep until target_time to encourage contention.
+    uint64_t time = TestUtils_time();
+    if (args->target_time > time) {
+        TestUtils_usleep(args->target_time - time);
+    }
+    TestUtils_thread_yield();
+
+    uint32_t missing = 0;
+    for (uint32_t i = 0; i < args->num_keys; i++) {
+        String *shared = Str_newf("%u32", i);
+        String *own    = Str_newf("%u32-%u32", args->thread_id, i);
+
+        CHash_Store(args->hash, shared, (Obj*)CFISH_TRUE);
+        CHash_Store(args->hash, own, (Obj*)CFISH_TRUE);
+
+        // Another thread may only have replaced the shared value.
+        if (!CHash_Has_Key(args->hash, shared)) { missing++; }
+        Obj *value = CHash_Fetch(args->hash, own);
+        if (value != (Obj*)CFISH_TRUE) { missing++; }
+        DECREF(value);
+
+        if (i % 2) {
+            DECREF(CHash_Delete(args->hash, own));
+        }
+
+        DECREF(own);
+        DECREF(shared);
+    }
+
+    args->missing = missing;
+}
+
+static void
+test_threads(TestBatchRunner *runner) {
+    if (!TestUtils_has_threads) {
+        SKIP(runner, 3, "No thread support");
+        return;
+    }
+
+    ConcurrentHash *hash = CHash_new(0);
+    ThreadArgs      thread_args[NUM_THREADS];
+    Thread         *threads[NUM_THREADS];
+    uint32_t        num_keys    = 10000;
+    uint64_t        target_time = TestUtils_time() + 200 * 1000;
+
+    for (uint32_t i = 0; i < NUM_THREADS; i++) {
+        thread_args[i].hash        = hash;
+        thread_args[i].thread_id   = i;
+        thread_args[i].num_keys    = num_keys;
+        thread_args[i].target_time = target_time;
+        thread_args[i].missing     = 0;
+        threads[i] = TestUtils_thread_create(S_churn, &thread_args[i], NULL);
+    }
+
+    uint32_t missing = 0;
+    for (uint32_t i = 0; i < NUM_THREADS; i++) {
+        TestUtils_thread_join(threads[i]);
+        missing += thread_args[i].missing;
+    }
+    TEST_UINT_EQ(runner, missing, 0, "Concurrent readers see own writes");
+
+    TEST_UINT_EQ(runner, CHash_Get_Size(hash),
+                 num_keys + NUM_THREADS * num_keys / 2,
+                 "Size after concurrent stores and deletes");
+
+    bool correct = true;
+    for (uint32_t t = 0; t < NUM_THREADS; t++) {
+        for (uint32_t i = 0; i < num_keys; i++) {
+            String *own = Str_newf("%u32-%u32", t, i);
+            if (CHash_Has_Key(hash, own) == (bool)(i % 2)) {
+                correct = false;
+            }
+            DECREF(own);
+        }
+    }
+    TEST_TRUE(runner, correct, "Right keys present after concurrent churn");
+
+    DECREF(hash);
+}
+
+void
+TestConcurrentHash_Run_IMP(TestConcurrentHash *self,
+                           TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 18);
+    test_single_thread(runner);
+    test_arena(runner);
+    test_threads(runner);
+}
+
+
@@ -0,0 +1,204 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/TestFrozenHash.h"
+
+#include "Clownfish/Boolean.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/FrozenHash.h"
+#include "Clownfish/FrozenHashIterator.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Class.h"
+
+TestFrozenHash*
+TestFrozenHash_new() {
+    return (TestFrozenHash*)Class_Make_Obj(TESTFROZENHASH);
+}
+
+static void
+S_invoke_Get_Key(void *context) {
+    FrozenHashIterator *iter = (FrozenHashIterator*)context;
+    FrozenHashIter_Get_Key(iter);
+}
+
+static void
+test_empty(TestBatchRunner *runner) {
+    Hash       *hash   = Hash_new(0);
+    FrozenHash *frozen = Hash_Freeze(hash);
+    String     *foo    = SSTR_WRAP_C("foo");
+
+    TEST_UINT_EQ(runner, FrozenHash_Get_Size(frozen), 0, "Empty size");
+    TEST_TRUE(runner, FrozenHash_Fetch(frozen, foo) == NULL,
+              "Fetch from empty FrozenHash");
+
+    FrozenHashIterator *iter = FrozenHashIter_new(frozen);
+    TEST_TRUE(runner, !FrozenHashIter_Next(iter),
+              "Next returns false on empty FrozenHash");
+    Err *get_key_error = Err_trap(S_invoke_Get_Key, iter);
+    TEST_TRUE(runner, get_key_error != NULL,
+              "Get_Key throws exception after end of iteration");
+    DECREF(get_key_error);
+
+    DECREF(iter);
+    DECREF(frozen);
+    DECREF(hash);
+}
+
+static void
+test_Fetch(TestBatchRunner *runner) {
+    Hash *hash = Hash_new(0);
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        String *str = Str_newf("%u32", i);
+        Hash_Store(hash, str, INCREF(str));
+        DECREF(str);
+    }
+    Hash_Store_Utf8(hash, "null", 4, NULL);
+
+    FrozenHash *frozen = Hash_Freeze(hash);
+    TEST_UINT_EQ(runner, FrozenHash_Get_Size(frozen), 1001, "Get_Size");
+
+    bool all_found = true;
+    for (uint32_t i = 0; i < 1000; i++) {
+        String *str   = Str_newf("%u32", i);
+        Obj    *value = FrozenHash_Fetch(frozen, str);
+        if (!value || !Str_Equals(str, value)) { all_found = false; }
+        DECREF(str);
+    }
+    TEST_TRUE(runner, all_found, "Fetch all keys");
+
+    bool none_found = true;
+    for (uint32_t i = 1000; i < 2000; i++) {
+        String *str = Str_newf("%u32", i);
+        if (FrozenHash_Has_Key(frozen, str)) { none_found = false; }
+        DECREF(str);
+    }
+    TEST_TRUE(runner, none_found, "Has_Key for missing keys");
+
+    String *forty = SSTR_WRAP_C("40");
+    TEST_TRUE(runner,
+              Str_Equals(forty, FrozenHash_Fetch_Utf8(frozen, "40", 2)),
+              "Fetch_Utf8");
+    TEST_TRUE(runner, FrozenHash_Fetch_Utf8(frozen, "null", 4) == NULL,
+              "Fetch_Utf8 NULL value");
+    String *null_key = SSTR_WRAP_C("null");
+    TEST_TRUE(runner, FrozenHash_Has_Key(frozen, null_key),
+              "Has_Key with NULL value");
+
+    // The FrozenHash is a snapshot.
+    Hash_Clear(hash);
+    TEST_TRUE(runner, FrozenHash_Has_Key(frozen, forty),
+              "Clearing the Hash doesn't affect the FrozenHash");
+
+    DECREF(frozen);
+    DECREF(hash);
+}
+
+static void
+test_Keys_Values_Iter(TestBatchRunner *runner) {
+    Hash *hash = Hash_new(0);
+
+    for (uint32_t i = 0; i < 500; i++) {
+        String *str = Str_newf("%u32", i);
+        Hash_Store(hash, str, INCREF(str));
+        DECREF(str);
+    }
+
+    FrozenHash *frozen   = Hash_Freeze(hash);
+    Vector     *expected = Hash_Keys(hash);
+    Vector     *keys     = FrozenHash_Keys(frozen);
+    Vector     *values   = FrozenHash_Values(frozen);
+    Vec_Sort(expected);
+    Vec_Sort(keys);
+    Vec_Sort(values);
+    TEST_TRUE(runner, Vec_Equals(keys, (Obj*)expected), "Keys");
+    TEST_TRUE(runner, Vec_Equals(values, (Obj*)expected), "Values");
+    DECREF(keys);
+    DECREF(values);
+
+    keys   = Vec_new(500);
+    values = Vec_new(500);
+    FrozenHashIterator *iter = FrozenHashIter_new(frozen);
+    while (FrozenHashIter_Next(iter)) {
+        Vec_Push(keys, INCREF(FrozenHashIter_Get_Key(iter)));
+        Vec_Push(values, INCREF(FrozenHashIter_Get_Value(iter)));
+    }
+    TEST_TRUE(runner, !FrozenHashIter_Next(iter),
+              "Next continues to return false after iteration finishes.");
+    Vec_Sort(keys);
+    Vec_Sort(values);
+    TEST_TRUE(runner, Vec_Equals(keys, (Obj*)expected), "Keys from Iter");
+    TEST_TRUE(runner, Vec_Equals(values, (Obj*)expected),
+              "Values from Iter");
+
+    DECREF(iter);
+    DECREF(keys);
+    DECREF(values);
+    DECREF(expected);
+    DECREF(frozen);
+    DECREF(hash);
+}
+
+static void
+test_Equals(TestBatchRunner *runner) {
+    Hash *hash = Hash_new(0);
+
+    for (uint32_t i = 0; i < 100; i++) {
+        String *str = Str_newf("%u32", i);
+        Hash_Store(hash, str, (Obj*)CFISH_TRUE);
+        DECREF(str);
+    }
+
+    FrozenHash *frozen = Hash_Freeze(hash);
+    FrozenHash *other  = FrozenHash_new(hash);
+
+    TEST_TRUE(runner, FrozenHash_Equals(frozen, (Obj*)other),
+              "Equals FrozenHash");
+    TEST_TRUE(runner, FrozenHash_Equals(frozen, (Obj*)hash), "Equals Hash");
+    TEST_TRUE(runner, Hash_Equals(hash, (Obj*)frozen),
+              "Hash Equals FrozenHash");
+
+    Hash_Store_Utf8(hash, "foo", 3, (Obj*)CFISH_TRUE);
+    TEST_FALSE(runner, FrozenHash_Equals(frozen, (Obj*)hash),
+               "Different size spoils Equals");
+    DECREF(Hash_Delete_Utf8(hash, "foo", 3));
+    Hash_Store_Utf8(hash, "50", 2, (Obj*)CFISH_FALSE);
+    TEST_FALSE(runner, Hash_Equals(hash, (Obj*)frozen),
+               "Different value spoils Equals");
+
+    DECREF(other);
+    DECREF(frozen);
+    DECREF(hash);
+}
+
+void
+TestFrozenHash_Run_IMP(TestFrozenHash *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 21);
+    test_empty(runner);
+    test_Fetch(runner);
+    test_Keys_Values_Iter(runner);
+    test_Equals(runner);
+}
+
+
@@ -225,11 +225,22 @@ test_stress(TestBatchRunner *runner) {
 static void
 test_collision(TestBatchRunner *runner) {
     Hash   *hash = Hash_new(0);
+    size_t  mask = Hash_Get_Capacity(hash) - 1;
     String *one  = Str_newf("A");
-    String *two  = Str_newf("P{2}|=~-ULE/d");
+    size_t  slot = Str_Hash_Sum(one) & mask;
 
-    TEST_TRUE(runner, Str_Hash_Sum(one) == Str_Hash_Sum(two),
-              "Keys have the same hash sum");
+    // Find a key which lands in the same bucket.
+    String *two = NULL;
+    for (int i = 0; i < 100000; i++) {
+        two = Str_newf("%i32", i);
+        if (slot == (Str_Hash_Sum(two) & mask)) {
+            break;
+        }
+        DECREF(two);
+        two = NULL;
+    }
+
+    TEST_TRUE(runner, two != NULL, "Keys land in the same bucket");
 
     Hash_Store(hash, one, INCREF(one));
     Hash_Store(hash, two, INCREF(two));
@@ -280,23 +291,47 @@ test_threshold_accounting(TestBatchRunner *runner) {
     size_t threshold = hash->threshold;
     Hash_Store(hash, key, (Obj*)CFISH_TRUE);
     Hash_Delete(hash, key);
-    TEST_UINT_EQ(runner, hash->threshold, threshold - 1,
-                 "Tombstone creation decreases threshold");
-
-    Hash_Store(hash, key, (Obj*)CFISH_TRUE);
     TEST_UINT_EQ(runner, hash->threshold, threshold,
-                 "Tombstone destruction increases threshold");
+                 "Delete doesn't affect threshold");
 
     DECREF(key);
     DECREF(hash);
+
+    // Keep 100 keys alive while churning through many more.
+    hash = Hash_new(0);
+    for (uint32_t i = 0; i < 20000; i++) {
+        String *str = Str_newf("%u32", i);
+        Hash_Store(hash, str, (Obj*)CFISH_TRUE);
+        DECREF(str);
+        if (i >= 100) {
+            str = Str_newf("%u32", i - 100);
+            Hash_Delete(hash, str);
+            DECREF(str);
+        }
+    }
+    TEST_UINT_EQ(runner, Hash_Get_Capacity(hash), 128,
+                 "Churn doesn't make table grow");
+
+    bool all_found = true;
+    for (uint32_t i = 20000 - 100; i < 20000; i++) {
+        String *str = Str_newf("%u32", i);
+        if (!Hash_Fetch(hash, str)) { all_found = false; }
+        DECREF(str);
+    }
+    TEST_TRUE(runner, all_found, "Live keys survive backward shifts");
+    TEST_UINT_EQ(runner, Hash_Get_Size(hash), 100, "Size after churn");
+
+    DECREF(hash);
 }
 
 static void
 test_tombstone_identification(TestBatchRunner *runner) {
+#if defined(CFISH_STR_HASH_DJB) && !defined(CFISH_STR_HASH_SEED)
     Hash   *hash = Hash_new(20);
     String *key  = Str_newf("P{2}|=~-U@!y>");
 
-    // Tombstones have a zero hash_sum.
+    // Cleared entries have a zero hash_sum, but empty and deleted slots are
+    // identified by their control byte alone.
     TEST_UINT_EQ(runner, Str_Hash_Sum(key), 0, "Key has zero hash sum");
 
     Hash_Store(hash, key, (Obj*)CFISH_TRUE);
@@ -306,11 +341,14 @@ test_tombstone_identification(TestBatchRunner *runner) {
 
     DECREF(key);
     DECREF(hash);
+#else
+    SKIP(runner, 2, "Zero hash sum key only known for unseeded DJB hash");
+#endif
 }
 
 void
 TestHash_Run_IMP(TestHash *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 39);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 41);
     srand((unsigned int)time((time_t*)NULL));
     test_Equals(runner);
     test_Store_and_Fetch(runner);
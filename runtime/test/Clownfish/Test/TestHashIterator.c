@@ -233,21 +233,89 @@ test_tombstone(TestBatchRunner *runner) {
                   "Get_Key doesn't return tombstone and throws error.");
         DECREF(get_key_error);
 
+        Err *get_value_error = Err_trap(S_invoke_Get_Value, iter);
+        TEST_TRUE(runner, get_value_error != NULL,
+                  "Get_Value doesn't return tombstone and throws error.");
+        DECREF(get_value_error);
+
         DECREF(str);
         DECREF(iter);
         DECREF(hash);
     }
 }
 
+static void
+S_delete_during_iteration(void *context) {
+    Hash         *hash = (Hash*)context;
+    HashIterator *iter = HashIter_new(hash);
+    while (HashIter_Next(iter)) {
+        DECREF(Hash_Delete(hash, HashIter_Get_Key(iter)));
+    }
+    DECREF(iter);
+}
+
+static void
+test_delete_during_iteration(TestBatchRunner *runner) {
+    Hash *hash = Hash_new(0);
+    for (uint32_t i = 0; i < 1000; i++) {
+        String *str = Str_newf("%u32", i);
+        Hash_Store(hash, str, (Obj*)str);
+    }
+
+    Err *error = Err_trap(S_delete_during_iteration, hash);
+    TEST_TRUE(runner, error == NULL,
+              "Deleting the current key during iteration doesn't throw");
+    DECREF(error);
+    TEST_UINT_EQ(runner, Hash_Get_Size(hash), 0,
+                 "All keys deleted during iteration");
+
+    for (uint32_t i = 0; i < 1000; i++) {
+        String *str = Str_newf("%u32", i);
+        Hash_Store(hash, str, (Obj*)str);
+    }
+
+    // Delete keys other than the current one.
+    uint32_t      num_visited = 0;
+    HashIterator *iter        = HashIter_new(hash);
+    while (HashIter_Next(iter)) {
+        num_visited++;
+        int64_t  num   = Str_To_I64(HashIter_Get_Key(iter));
+        String  *other = Str_newf("%i64", num ^ 1);
+        DECREF(Hash_Delete(hash, other));
+        DECREF(other);
+    }
+    DECREF(iter);
+    TEST_TRUE(runner, num_visited == 500 && Hash_Get_Size(hash) == 500,
+              "Deleting other keys doesn't skip or repeat entries");
+
+    bool all_found = true;
+    for (uint32_t i = 0; i < 1000; i++) {
+        String *str = Str_newf("%u32", i);
+        Obj    *val = Hash_Fetch(hash, str);
+        if (val && !Str_Equals(str, val)) { all_found = false; }
+        Hash_Store(hash, str, (Obj*)str);
+    }
+    for (uint32_t i = 0; i < 1000; i++) {
+        String *str = Str_newf("%u32", i);
+        if (!Hash_Fetch(hash, str)) { all_found = false; }
+        DECREF(str);
+    }
+    TEST_TRUE(runner, all_found && Hash_Get_Size(hash) == 1000,
+              "Lookups work after deleted slots are purged");
+
+    DECREF(hash);
+}
+
 void
 TestHashIterator_Run_IMP(TestHashIterator *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 21);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 26);
     srand((unsigned int)time((time_t*)NULL));
     test_Next(runner);
     test_empty(runner);
     test_Get_Key_and_Get_Value(runner);
     test_illegal_modification(runner);
     test_tombstone(runner);
+    test_delete_during_iteration(runner);
 }
 
 
@@ -30,7 +30,7 @@
 #include "Clownfish/TestHarness/TestUtils.h"
 #include "Clownfish/Util/Memory.h"
 
-#define NUM_THREADS 5
+#define MAX_THREADS 16
 
 typedef struct ThreadArgs {
     LockFreeRegistry *registry;
@@ -76,6 +76,32 @@ test_all(TestBatchRunner *runner) {
     LFReg_destroy(registry);
 }
 
+static void
+test_growth(TestBatchRunner *runner) {
+    LockFreeRegistry *registry = LFReg_new(1);
+    uint32_t num_objs = 10000;
+
+    uint32_t succeeded = 0;
+    for (uint32_t i = 0; i < num_objs; i++) {
+        String *obj = Str_newf("%u32", i);
+        if (LFReg_register(registry, obj, (Obj*)obj)) { succeeded++; }
+        DECREF(obj);
+    }
+    TEST_INT_EQ(runner, succeeded, num_objs,
+                "Register() many keys into a small registry");
+
+    bool all_found = true;
+    for (uint32_t i = 0; i < num_objs; i++) {
+        String *key   = Str_newf("%u32", i);
+        Obj    *value = LFReg_fetch(registry, key);
+        if (!value || !Str_Equals(key, value)) { all_found = false; }
+        DECREF(key);
+    }
+    TEST_TRUE(runner, all_found, "Fetch() all keys after growing");
+
+    LFReg_destroy(registry);
+}
+
 static void
 S_register_many(void *varg) {
     ThreadArgs *args = (ThreadArgs*)varg;
@@ -104,17 +130,18 @@ S_register_many(void *varg) {
 }
 
 static void
-test_threads(TestBatchRunner *runner) {
+S_test_threads(TestBatchRunner *runner, uint32_t num_threads,
+               size_t capacity) {
     if (!TestUtils_has_threads) {
-        SKIP(runner, 1, "No thread support");
+        SKIP(runner, 2, "No thread support");
         return;
     }
 
-    LockFreeRegistry *registry = LFReg_new(32);
-    ThreadArgs thread_args[NUM_THREADS];
+    LockFreeRegistry *registry = LFReg_new(capacity);
+    ThreadArgs thread_args[MAX_THREADS];
     uint32_t num_objs = 10000;
 
-    for (uint32_t i = 0; i < NUM_THREADS; i++) {
+    for (uint32_t i = 0; i < num_threads; i++) {
         uint32_t *nums = (uint32_t*)MALLOCATE(num_objs * sizeof(uint32_t));
 
         for (uint32_t j = 0; j < num_objs; j++) {
@@ -134,10 +161,10 @@ test_threads(TestBatchRunner *runner) {
         thread_args[i].num_objs = num_objs;
     }
 
-    Thread *threads[NUM_THREADS];
+    Thread *threads[MAX_THREADS];
     uint64_t target_time = TestUtils_time() + 200 * 1000;
 
-    for (uint32_t i = 0; i < NUM_THREADS; i++) {
+    for (uint32_t i = 0; i < num_threads; i++) {
         thread_args[i].target_time = target_time;
         threads[i]
             = TestUtils_thread_create(S_register_many, &thread_args[i], NULL);
@@ -145,7 +172,7 @@ test_threads(TestBatchRunner *runner) {
 
     uint32_t total_succeeded = 0;
 
-    for (uint32_t i = 0; i < NUM_THREADS; i++) {
+    for (uint32_t i = 0; i < num_threads; i++) {
         TestUtils_thread_join(threads[i]);
         total_succeeded += thread_args[i].succeeded;
         FREEMEM(thread_args[i].nums);
@@ -153,16 +180,40 @@ test_threads(TestBatchRunner *runner) {
 
     TEST_INT_EQ(runner, total_succeeded, num_objs,
                 "registered exactly the right number of entries across all"
-                " threads");
+                " %u32 threads", num_threads);
+
+    bool all_found = true;
+    for (uint32_t i = 0; i < num_objs; i++) {
+        String *key   = Str_newf("%u32", i);
+        Obj    *value = LFReg_fetch(registry, key);
+        if (!value || !Str_Equals(key, value)) { all_found = false; }
+        DECREF(key);
+    }
+    TEST_TRUE(runner, all_found, "Fetch() all entries registered by %u32"
+              " threads", num_threads);
 
     LFReg_destroy(registry);
 }
 
+static void
+test_threads(TestBatchRunner *runner) {
+    S_test_threads(runner, 5, 32);
+}
+
+// Many threads registering into a registry which starts with a single
+// bucket, so that buckets are split while other threads insert.
+static void
+test_stress(TestBatchRunner *runner) {
+    S_test_threads(runner, MAX_THREADS, 1);
+}
+
 void
 TestLFReg_Run_IMP(TestLockFreeRegistry *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 7);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 12);
     test_all(runner);
+    test_growth(runner);
     test_threads(runner);
+    test_stress(runner);
 }
 
 
@@ -266,13 +266,57 @@ test_Clone(TestBatchRunner *runner) {
     DECREF(f64);
 }
 
+static void
+test_cache(TestBatchRunner *runner) {
+    Integer *small    = Int_new(42);
+    Integer *small2   = Int_new(42);
+    Integer *negative = Int_new(-1);
+    Integer *big      = Int_new(INT64_C(1) << 40);
+    Integer *big2     = Int_new(INT64_C(1) << 40);
+    TEST_TRUE(runner, small == small2, "Small Integers are cached");
+    TEST_TRUE(runner, Int_is_cached(small) && Int_is_cached(negative),
+              "Int_is_cached");
+    TEST_TRUE(runner, big != big2 && !Int_is_cached(big),
+              "Large Integers aren't cached");
+    TEST_INT_EQ(runner, Int_Get_Value(negative), -1, "Cached value");
+
+    // Int_new returns a new reference even for cached values, so hosts
+    // with their own refcounting see balanced counts.
+    DECREF(small2);
+    DECREF(small);
+    Integer *again = Int_new(42);
+    TEST_INT_EQ(runner, Int_Get_Value(again), 42,
+                "Cached Integers survive DECREF");
+    DECREF(again);
+
+    Float *zero     = Float_new(0.0);
+    Float *zero2    = Float_new(0.0);
+    Float *one      = Float_new(1.0);
+    Float *one2     = Float_new(1.0);
+    Float *neg_zero = Float_new(-0.0);
+    TEST_TRUE(runner, zero == zero2 && one == one2,
+              "0.0 and 1.0 are cached");
+    TEST_TRUE(runner, Float_is_cached(zero) && !Float_is_cached(neg_zero),
+              "-0.0 isn't cached");
+
+    DECREF(neg_zero);
+    DECREF(one2);
+    DECREF(one);
+    DECREF(zero2);
+    DECREF(zero);
+    DECREF(big2);
+    DECREF(big);
+    DECREF(negative);
+}
+
 void
 TestNum_Run_IMP(TestNum *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 82);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 89);
     test_To_String(runner);
     test_accessors(runner);
     test_Equals_and_Compare_To(runner);
     test_Clone(runner);
+    test_cache(runner);
 }
 
 
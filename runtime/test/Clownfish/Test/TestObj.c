@@ -27,8 +27,12 @@
 #include "Clownfish/Err.h"
 #include "Clownfish/Test.h"
 #include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
 #include "Clownfish/Class.h"
 
+#define NUM_THREADS 4
+#define NUM_REFCOUNT_OPS 100000
+
 TestObj*
 TestObj_new() {
     return (TestObj*)Class_Make_Obj(TESTOBJ);
@@ -62,6 +66,49 @@ test_refcounts(TestBatchRunner *runner) {
     DECREF(obj);
 }
 
+static void
+S_incref_decref(void *context) {
+    Obj *obj = (Obj*)context;
+    for (uint32_t i = 0; i < NUM_REFCOUNT_OPS; i++) {
+        INCREF_NN(obj);
+    }
+    for (uint32_t i = 0; i < NUM_REFCOUNT_OPS; i++) {
+        DECREF_NN(obj);
+    }
+}
+
+static void
+test_atomic_refcounts(TestBatchRunner *runner) {
+    String *class_name = SSTR_WRAP_C("Clownfish::Test::SharedObj");
+    Class  *klass      = Class_fetch_class(class_name);
+    if (!klass) {
+        klass = Class_singleton(class_name, OBJ);
+        Class_Enable_Atomic_Refcount(klass);
+    }
+    Obj *obj = Class_Make_Obj(klass);
+
+    obj = INCREF_NN(obj);
+    TEST_INT_EQ(runner, REFCOUNT_NN(obj), 2, "INCREF_NN atomic");
+    TEST_INT_EQ(runner, DECREF_NN(obj), 1, "DECREF_NN atomic");
+
+    if (!TestUtils_has_threads) {
+        SKIP(runner, 1, "No thread support");
+    }
+    else {
+        Thread *threads[NUM_THREADS];
+        for (uint32_t i = 0; i < NUM_THREADS; i++) {
+            threads[i] = TestUtils_thread_create(S_incref_decref, obj, NULL);
+        }
+        for (uint32_t i = 0; i < NUM_THREADS; i++) {
+            TestUtils_thread_join(threads[i]);
+        }
+        TEST_INT_EQ(runner, REFCOUNT_NN(obj), 1,
+                    "Concurrent INCREF and DECREF are balanced");
+    }
+
+    DECREF(obj);
+}
+
 static void
 test_To_String(TestBatchRunner *runner) {
     Obj *testobj = S_new_testobj();
@@ -187,8 +234,9 @@ test_abstract_routines(TestBatchRunner *runner) {
 
 void
 TestObj_Run_IMP(TestObj *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 20);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 23);
     test_refcounts(runner);
+    test_atomic_refcounts(runner);
     test_To_String(runner);
     test_Equals(runner);
     test_is_a(runner);
@@ -0,0 +1,165 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/TestObjPool.h"
+
+#include "Clownfish/Class.h"
+#include "Clownfish/ObjPool.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Util/Memory.h"
+
+#define NUM_THREADS 4
+#define NUM_BLOCKS  2000
+
+typedef struct ThreadArgs {
+    uint32_t   thread_id;
+    char     **kept;
+    uint32_t   corrupted;
+} ThreadArgs;
+
+TestObjPool*
+TestObjPool_new() {
+    return (TestObjPool*)Class_Make_Obj(TESTOBJPOOL);
+}
+
+static bool
+S_is_zeroed(const char *ptr, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (ptr[i] != 0) { return false; }
+    }
+    return true;
+}
+
+static void
+test_alloc_free(TestBatchRunner *runner) {
+    char *block = (char*)ObjPool_alloc(24);
+    TEST_TRUE(runner, S_is_zeroed(block, 24), "alloc returns zeroed memory");
+
+    memset(block, 'x', 24);
+    ObjPool_free(block, 24);
+    char *again = (char*)ObjPool_alloc(24);
+    TEST_TRUE(runner, again == block, "freed block is reused");
+    TEST_TRUE(runner, S_is_zeroed(again, 24), "reused block is zeroed");
+    ObjPool_free(again, 24);
+
+    char *large = (char*)ObjPool_alloc(1000);
+    TEST_TRUE(runner, S_is_zeroed(large, 1000),
+              "large allocation is zeroed");
+    ObjPool_free(large, 1000);
+
+    // More blocks than fit in a thread's free list.
+    char   *blocks[1000];
+    bool    distinct = true;
+    for (size_t i = 0; i < 1000; i++) {
+        blocks[i] = (char*)ObjPool_alloc(48);
+        memset(blocks[i], (int)(i & 0x7F), 48);
+    }
+    for (size_t i = 0; i < 1000; i++) {
+        for (size_t j = 0; j < 48; j++) {
+            if (blocks[i][j] != (char)(i & 0x7F)) { distinct = false; }
+        }
+    }
+    TEST_TRUE(runner, distinct, "blocks don't overlap");
+    for (size_t i = 0; i < 1000; i++) {
+        ObjPool_free(blocks[i], 48);
+    }
+}
+
+static size_t
+S_block_size(uint32_t i) {
+    return (i % 16 + 1) * 16 - i % 7;
+}
+
+static void
+S_alloc_many(void *varg) {
+    ThreadArgs *args      = (ThreadArgs*)varg;
+    char       *blocks[NUM_BLOCKS];
+    uint32_t    corrupted = 0;
+
+    for (uint32_t round = 0; round < 10; round++) {
+        for (uint32_t i = 0; i < NUM_BLOCKS; i++) {
+            size_t size = S_block_size(i);
+            blocks[i] = (char*)ObjPool_alloc(size);
+            if (!S_is_zeroed(blocks[i], size)) { corrupted++; }
+            memset(blocks[i], (int)args->thread_id + 1, size);
+        }
+        TestUtils_thread_yield();
+        for (uint32_t i = 0; i < NUM_BLOCKS; i++) {
+            size_t size = S_block_size(i);
+            for (size_t j = 0; j < size; j++) {
+                if (blocks[i][j] != (char)(args->thread_id + 1)) {
+                    corrupted++;
+                    break;
+                }
+            }
+            ObjPool_free(blocks[i], size);
+        }
+    }
+
+    // Leave some blocks to be freed by another thread.
+    for (uint32_t i = 0; i < NUM_BLOCKS; i++) {
+        args->kept[i] = (char*)ObjPool_alloc(S_block_size(i));
+    }
+
+    args->corrupted = corrupted;
+}
+
+static void
+test_threads(TestBatchRunner *runner) {
+    if (!TestUtils_has_threads) {
+        SKIP(runner, 1, "No thread support");
+        return;
+    }
+
+    ThreadArgs  thread_args[NUM_THREADS];
+    Thread     *threads[NUM_THREADS];
+
+    for (uint32_t i = 0; i < NUM_THREADS; i++) {
+        thread_args[i].thread_id = i;
+        thread_args[i].kept
+            = (char**)MALLOCATE(NUM_BLOCKS * sizeof(char*));
+        thread_args[i].corrupted = 0;
+        threads[i] = TestUtils_thread_create(S_alloc_many, &thread_args[i],
+                                             NULL);
+    }
+
+    uint32_t corrupted = 0;
+    for (uint32_t i = 0; i < NUM_THREADS; i++) {
+        TestUtils_thread_join(threads[i]);
+        corrupted += thread_args[i].corrupted;
+        for (uint32_t j = 0; j < NUM_BLOCKS; j++) {
+            ObjPool_free(thread_args[i].kept[j], S_block_size(j));
+        }
+        FREEMEM(thread_args[i].kept);
+    }
+    TEST_UINT_EQ(runner, corrupted, 0,
+                 "concurrent allocations don't overlap");
+}
+
+void
+TestObjPool_Run_IMP(TestObjPool *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 6);
+    test_alloc_free(runner);
+    test_threads(runner);
+}
+
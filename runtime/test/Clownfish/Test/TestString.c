@@ -27,6 +27,8 @@
 #include "Clownfish/ByteBuf.h"
 #include "Clownfish/CharBuf.h"
 #include "Clownfish/Err.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/StringSearcher.h"
 #include "Clownfish/Test.h"
 #include "Clownfish/TestHarness/TestBatchRunner.h"
 #include "Clownfish/TestHarness/TestUtils.h"
@@ -298,6 +300,63 @@ test_utf8_valid(TestBatchRunner *runner) {
                     "missing continuation byte 4/4");
 }
 
+// Exercise the vectorized validator by embedding sequences at every
+// position relative to vector boundaries.
+static void
+test_utf8_valid_long(TestBatchRunner *runner) {
+    static const char *const sequences[] = {
+        "\xE2\x98\xBA", "\xF0\x9D\x84\x9E", "\xC3\xA9", "\xF4\x8F\xBF\xBF",
+        "\xED\xA0\xB4", "\xC1\x9C", "\xE0\x9F\xBF", "\xF0\x8F\xBF\xBF",
+        "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xF8\x88\x80\x80\x80",
+        "\xC2", "\xE2\x98", "\xF0\x9D\x84", "\xBA", "\xFF", "\xC2x",
+        "\xE2\x98x", "\xF0\x9D\x84x"
+    };
+    const size_t num_sequences = sizeof(sequences) / sizeof(sequences[0]);
+    char buf[200];
+    uint32_t disagreements = 0;
+
+    for (size_t i = 0; i < num_sequences; i++) {
+        size_t seq_len = strlen(sequences[i]);
+        for (size_t offset = 0; offset < 100; offset++) {
+            for (int filler = 0; filler < 2; filler++) {
+                // Pad with ASCII or with two-byte sequences.
+                for (size_t j = 0; j < sizeof(buf); j++) {
+                    buf[j] = filler ? (j & 1 ? '\xA9' : '\xC3') : 'x';
+                }
+                size_t start = filler ? offset & ~(size_t)1 : offset;
+                memcpy(buf + start, sequences[i], seq_len);
+                for (size_t size = start + seq_len; size <= 130; size += 43) {
+                    if (!!Str_utf8_valid(buf, size)
+                        != !!S_utf8_valid_alt(buf, size)
+                       ) {
+                        disagreements++;
+                    }
+                }
+            }
+        }
+    }
+    TEST_UINT_EQ(runner, disagreements, 0,
+                 "utf8_valid agrees with reference at all offsets");
+
+    disagreements = 0;
+    for (uint32_t i = 0; i < 1000; i++) {
+        String *string = TestUtils_random_string(TestUtils_random_u64() % 80);
+        size_t  size   = Str_Get_Size(string);
+        if (size > sizeof(buf)) { size = sizeof(buf); }
+        memcpy(buf, Str_Get_Ptr8(string), size);
+        if (size > 0 && i % 2) {
+            uint64_t rand = TestUtils_random_u64();
+            buf[rand % size] = (char)(0x80 | (rand >> 32));
+        }
+        if (!!Str_utf8_valid(buf, size) != !!S_utf8_valid_alt(buf, size)) {
+            disagreements++;
+        }
+        DECREF(string);
+    }
+    TEST_UINT_EQ(runner, disagreements, 0,
+                 "utf8_valid agrees with reference on random input");
+}
+
 static void
 S_validate_utf8(void *context) {
     const char *text = (const char*)context;
@@ -328,6 +387,20 @@ test_validate_utf8(TestBatchRunner *runner) {
         TEST_TRUE(runner, ok, "validate_utf8 truncates long prefix");
         DECREF(error);
     }
+
+    {
+        Err *error = Err_trap(S_validate_utf8,
+                              "0123456789012345678901234567890123456789"
+                              "0123456789012345678901234567890123456789"
+                              "\xE2\x98\xBA\xE2\x98\xBA\xF0\x9D\x84.");
+        String *mess = Err_Get_Mess(error);
+        const char *expected =
+            "Invalid UTF-8 after '234567890123456789\xE2\x98\xBA\xE2\x98\xBA':"
+            " F0 9D 84 2E\n";
+        bool ok = Str_Starts_With_Utf8(mess, expected, strlen(expected));
+        TEST_TRUE(runner, ok, "validate_utf8 position in long string");
+        DECREF(error);
+    }
 }
 
 static void
@@ -486,6 +559,139 @@ test_Contains_and_Find(TestBatchRunner *runner) {
     DECREF(substring);
 }
 
+static int64_t
+S_naive_find(const char *haystack, size_t haystack_size, const char *needle,
+             size_t needle_size) {
+    if (needle_size > haystack_size) { return -1; }
+    for (size_t i = 0; i <= haystack_size - needle_size; i++) {
+        if (memcmp(haystack + i, needle, needle_size) == 0) {
+            return (int64_t)i;
+        }
+    }
+    return -1;
+}
+
+static int64_t
+S_searcher_find(StringSearcher *searcher, String *haystack) {
+    StringIterator *iter = StrSearcher_Find(searcher, haystack);
+    if (iter == NULL) { return -1; }
+    size_t tick = StrIter_Recede(iter, SIZE_MAX);
+    DECREF(iter);
+    return (int64_t)tick;
+}
+
+// Fill `buf` with random characters from a small alphabet to produce lots
+// of partial matches.
+static void
+S_random_ascii(char *buf, size_t size, uint64_t alphabet_size) {
+    for (size_t i = 0; i < size; i++) {
+        buf[i] = (char)('a' + TestUtils_random_u64() % alphabet_size);
+    }
+}
+
+static void
+test_find_random(TestBatchRunner *runner) {
+    char haystack_buf[400];
+    char needle_buf[100];
+    bool str_ok      = true;
+    bool searcher_ok = true;
+
+    for (int i = 0; i < 2000; i++) {
+        uint64_t alphabet_size = 2 + TestUtils_random_u64() % 3;
+        size_t haystack_size = TestUtils_random_u64() % sizeof(haystack_buf);
+        size_t needle_size   = 1 + TestUtils_random_u64() % 80;
+        S_random_ascii(haystack_buf, haystack_size, alphabet_size);
+        if (i % 2 == 0 && needle_size <= haystack_size) {
+            // Make sure that there's a match.
+            size_t offset
+                = TestUtils_random_u64() % (haystack_size - needle_size + 1);
+            memcpy(needle_buf, haystack_buf + offset, needle_size);
+            // Perturb a byte to get near misses.
+            if (i % 4 == 0) {
+                needle_buf[TestUtils_random_u64() % needle_size] = 'a';
+            }
+        }
+        else {
+            S_random_ascii(needle_buf, needle_size, alphabet_size);
+        }
+
+        String *haystack = Str_new_from_trusted_utf8(haystack_buf,
+                                                     haystack_size);
+        String *needle   = Str_new_from_trusted_utf8(needle_buf, needle_size);
+        int64_t expected = S_naive_find(haystack_buf, haystack_size,
+                                        needle_buf, needle_size);
+
+        if (S_find(haystack, needle) != expected
+            || Str_Contains(haystack, needle) != (expected >= 0)
+           ) {
+            str_ok = false;
+        }
+
+        StringSearcher *searcher = StrSearcher_new(needle);
+        if (S_searcher_find(searcher, haystack) != expected
+            || StrSearcher_Contains_Utf8(searcher, haystack_buf,
+                                         haystack_size) != (expected >= 0)
+           ) {
+            searcher_ok = false;
+        }
+
+        DECREF(searcher);
+        DECREF(needle);
+        DECREF(haystack);
+    }
+
+    TEST_TRUE(runner, str_ok, "Find agrees with naive search");
+    TEST_TRUE(runner, searcher_ok,
+              "StringSearcher agrees with naive search");
+}
+
+static void
+test_StringSearcher(TestBatchRunner *runner) {
+    // Periodic haystack with a long needle that only matches at the end.
+    CharBuf *buf = CB_new(0);
+    for (int i = 0; i < 500; i++) { CB_Cat_Trusted_Utf8(buf, "ab", 2); }
+    CB_Cat_Trusted_Utf8(buf, "abc", 3);
+    String *haystack = CB_Yield_String(buf);
+    CB_Cat_Trusted_Utf8(buf, "\xE2\x98\xBA", 3);
+    for (int i = 0; i < 50; i++) { CB_Cat_Trusted_Utf8(buf, "ab", 2); }
+    String *unicode = CB_Yield_String(buf);
+    for (int i = 0; i < 40; i++) { CB_Cat_Trusted_Utf8(buf, "ab", 2); }
+    CB_Cat_Trusted_Utf8(buf, "c", 1);
+    String *needle = CB_Yield_String(buf);
+
+    StringSearcher *searcher = StrSearcher_new(needle);
+    TEST_TRUE(runner, StrSearcher_Get_Needle(searcher) == needle,
+              "Get_Needle");
+    TEST_INT_EQ(runner, S_searcher_find(searcher, haystack), 1003 - 81,
+                "Find long needle in periodic haystack");
+    TEST_FALSE(runner, StrSearcher_Contains(searcher, unicode),
+               "Long needle not contained");
+    TEST_TRUE(runner, StrSearcher_Contains(searcher, haystack),
+              "Reuse searcher");
+    DECREF(searcher);
+
+    String *smiley_ab = Str_newf(SMILEY "ab");
+    searcher = StrSearcher_new(smiley_ab);
+    TEST_INT_EQ(runner, S_searcher_find(searcher, unicode), 0,
+                "Find returns code point position");
+    TEST_FALSE(runner, StrSearcher_Contains(searcher, haystack),
+               "Short needle not contained");
+    DECREF(searcher);
+
+    String *empty = Str_newf("");
+    searcher = StrSearcher_new(empty);
+    TEST_INT_EQ(runner, S_searcher_find(searcher, haystack), 0,
+                "Empty needle matches at start");
+    DECREF(searcher);
+
+    DECREF(empty);
+    DECREF(smiley_ab);
+    DECREF(needle);
+    DECREF(unicode);
+    DECREF(haystack);
+    DECREF(buf);
+}
+
 static void
 test_Code_Point_At_and_From(TestBatchRunner *runner) {
     int32_t code_points[] = {
@@ -513,6 +719,87 @@ test_Code_Point_At_and_From(TestBatchRunner *runner) {
     DECREF(string);
 }
 
+static String*
+S_string_from_code_points(const int32_t *code_points, size_t count) {
+    CharBuf *buf = CB_new(count);
+    for (size_t i = 0; i < count; i++) {
+        CB_Cat_Char(buf, code_points[i]);
+    }
+    String *string = CB_Yield_String(buf);
+    DECREF(buf);
+    return string;
+}
+
+static void
+S_test_random_access(TestBatchRunner *runner, String *string,
+                     const int32_t *code_points, size_t count,
+                     const char *label) {
+    bool at_ok = true;
+    bool from_ok = true;
+    for (size_t i = 0; i < count; i++) {
+        if (Str_Code_Point_At(string, i) != code_points[i]) {
+            at_ok = false;
+        }
+        if (Str_Code_Point_From(string, count - i) != code_points[i]) {
+            from_ok = false;
+        }
+    }
+    TEST_TRUE(runner, at_ok && Str_Code_Point_At(string, count) == STR_OOB,
+              "Code_Point_At %s", label);
+    TEST_TRUE(runner,
+              from_ok && Str_Code_Point_From(string, count + 1) == STR_OOB,
+              "Code_Point_From %s", label);
+
+    bool sub_ok = true;
+    for (size_t offset = 0; offset <= count + 1; offset += 7) {
+        for (size_t len = 0; len < 80; len += 13) {
+            size_t start = offset < count ? offset : count;
+            size_t end   = len < count - start ? start + len : count;
+            String *wanted = S_string_from_code_points(code_points + start,
+                                                       end - start);
+            String *got = Str_SubString(string, offset, len);
+            if (!Str_Equals(wanted, (Obj*)got)) { sub_ok = false; }
+            DECREF(got);
+            DECREF(wanted);
+        }
+    }
+    String *all = Str_SubString(string, 0, SIZE_MAX);
+    TEST_TRUE(runner, sub_ok && Str_Equals(all, (Obj*)string),
+              "SubString %s", label);
+    DECREF(all);
+}
+
+static void
+test_random_access(TestBatchRunner *runner) {
+    static const int32_t cycle[] = { 'a', 0x263A, 0xE9, 0x1D11E, ' ' };
+    int32_t code_points[500];
+    for (size_t i = 0; i < 500; i++) {
+        code_points[i] = i % 3 ? 'a' + (int32_t)(i % 26) : cycle[i % 5];
+    }
+
+    String *mixed = S_string_from_code_points(code_points, 500);
+    TEST_UINT_EQ(runner, Str_Length(mixed), 500, "Length of long String");
+    S_test_random_access(runner, mixed, code_points, 500, "long String");
+
+    String *sub = Str_SubString(mixed, 100, 300);
+    S_test_random_access(runner, sub, code_points + 100, 300, "substring");
+
+    String *wrapped = SSTR_WRAP_UTF8(Str_Get_Ptr8(mixed),
+                                     Str_Get_Size(mixed));
+    S_test_random_access(runner, wrapped, code_points, 500,
+                         "wrapped String");
+
+    for (size_t i = 0; i < 500; i++) {
+        code_points[i] = 'a' + (int32_t)(i % 26);
+    }
+    String *ascii = S_string_from_code_points(code_points, 500);
+    S_test_random_access(runner, ascii, code_points, 500, "ASCII String");
+
+    DECREF(ascii);
+    DECREF(sub);
+    DECREF(mixed);
+}
+
 static void
 test_SubString(TestBatchRunner *runner) {
     {
@@ -538,6 +825,47 @@ test_SubString(TestBatchRunner *runner) {
     }
 }
 
+static bool
+S_is_inline(String *string) {
+    const char *ptr   = Str_Get_Ptr8(string);
+    const char *start = (const char*)string;
+    return ptr >= start && ptr < start + Class_Get_Obj_Alloc_Size(STRING);
+}
+
+static void
+test_inline_storage(TestBatchRunner *runner) {
+    String *short_str = Str_new_from_utf8("short", 5);
+    String *long_str  = Str_newf("%s", "a string too long to be stored inline");
+    String *copy      = Str_new_from_trusted_utf8(Str_Get_Ptr8(long_str),
+                                                  Str_Get_Size(long_str));
+    String *sub       = Str_SubString(long_str, 2, 6);
+    String *long_sub  = Str_SubString(long_str, 2, 30);
+    String *cat       = Str_Cat_Utf8(short_str, " cat", 4);
+    String *character = Str_new_from_char(0x263A);
+
+    TEST_TRUE(runner, S_is_inline(short_str), "Short String is inline");
+    TEST_FALSE(runner, S_is_inline(copy), "Long String isn't inline");
+    TEST_TRUE(runner, S_is_inline(sub) && Str_Equals_Utf8(sub, "string", 6),
+              "Short substring is copied inline");
+    TEST_TRUE(runner,
+              Str_Get_Ptr8(long_sub) == Str_Get_Ptr8(long_str) + 2,
+              "Long substring shares buffer");
+    TEST_TRUE(runner, S_is_inline(cat) && Str_Equals_Utf8(cat, "short cat", 9),
+              "Short Cat result is inline");
+    TEST_TRUE(runner, S_is_inline(character) && Str_Get_Size(character) == 3,
+              "new_from_char is inline");
+    TEST_INT_EQ(runner, Str_Get_Ptr8(short_str)[5], '\0',
+                "Inline content is NUL-terminated");
+
+    DECREF(character);
+    DECREF(cat);
+    DECREF(long_sub);
+    DECREF(sub);
+    DECREF(copy);
+    DECREF(long_str);
+    DECREF(short_str);
+}
+
 static void
 test_Trim(TestBatchRunner *runner) {
     String *ws_smiley = S_smiley_with_whitespace(NULL);
@@ -712,6 +1040,143 @@ test_Compare_To(TestBatchRunner *runner) {
     DECREF(abc);
 }
 
+static void
+test_intern(TestBatchRunner *runner) {
+    String *content  = Str_newf("interned-%i32", 42);
+    String *interned = Str_intern(content);
+    String *dupe     = Str_intern_utf8("interned-42", 11);
+    String *other    = Str_intern_utf8("interned-43", 11);
+
+    TEST_TRUE(runner, interned != content && interned == dupe,
+              "intern returns canonical String");
+    TEST_TRUE(runner, Str_Is_Interned(interned) && !Str_Is_Interned(content),
+              "Is_Interned");
+    String *again = Str_intern(interned);
+    TEST_TRUE(runner, again == interned, "intern of interned String");
+    DECREF(again);
+    TEST_TRUE(runner, Str_Equals(interned, (Obj*)content)
+                      && !Str_Equals(interned, (Obj*)other),
+              "Equals with interned Strings");
+
+    String *sub           = Str_SubString(content, 0, 8);
+    String *interned_sub  = Str_intern(sub);
+    String *interned_utf8 = Str_intern_utf8("interned", 8);
+    TEST_TRUE(runner, interned_sub == interned_utf8, "intern substring");
+    DECREF(interned_utf8);
+    DECREF(interned_sub);
+
+    // intern returns a new reference, so hosts with their own refcounting
+    // see balanced counts.
+    DECREF(interned);
+    TEST_TRUE(runner, Str_Equals_Utf8(dupe, "interned-42", 11),
+              "Interned Strings survive DECREF");
+
+    Hash *hash = Hash_new(0);
+    Hash_Store(hash, dupe, (Obj*)Str_newf("value"));
+    TEST_TRUE(runner, Hash_Fetch(hash, content) != NULL
+                      && Hash_Fetch(hash, other) == NULL,
+              "Hash lookup with interned key");
+    DECREF(hash);
+
+    DECREF(sub);
+    DECREF(other);
+    DECREF(dupe);
+    DECREF(content);
+}
+
+#define NUM_INTERN_THREADS 4
+#define NUM_INTERNED       1000
+
+typedef struct {
+    String   *results[NUM_INTERNED];
+    uint64_t  target_time;
+} InternArgs;
+
+static void
+S_intern_many(void *varg) {
+    InternArgs *args = (InternArgs*)varg;
+
+    // Encourage contention, so that all threads intern the same content
+    // at the same time.
+    uint64_t time = TestUtils_time();
+    if (args->target_time > time) {
+        TestUtils_usleep(args->target_time - time);
+    }
+    TestUtils_thread_yield();
+
+    for (uint32_t i = 0; i < NUM_INTERNED; i++) {
+        String *content = Str_newf("intern-race-%u32", i);
+        args->results[i] = Str_intern(content);
+        DECREF(content);
+    }
+}
+
+static void
+test_intern_threads(TestBatchRunner *runner) {
+    if (!TestUtils_has_threads) {
+        SKIP(runner, 1, "No thread support");
+        return;
+    }
+
+    InternArgs *args
+        = (InternArgs*)MALLOCATE(NUM_INTERN_THREADS * sizeof(InternArgs));
+    Thread *threads[NUM_INTERN_THREADS];
+    uint64_t target_time = TestUtils_time() + 100 * 1000;
+
+    for (uint32_t i = 0; i < NUM_INTERN_THREADS; i++) {
+        args[i].target_time = target_time;
+        threads[i] = TestUtils_thread_create(S_intern_many, &args[i], NULL);
+    }
+    for (uint32_t i = 0; i < NUM_INTERN_THREADS; i++) {
+        TestUtils_thread_join(threads[i]);
+    }
+
+    bool identical = true;
+    for (uint32_t i = 0; i < NUM_INTERNED; i++) {
+        for (uint32_t j = 0; j < NUM_INTERN_THREADS; j++) {
+            if (args[j].results[i] != args[0].results[i]
+                || !Str_Is_Interned(args[j].results[i])
+               ) {
+                identical = false;
+            }
+        }
+    }
+    TEST_TRUE(runner, identical,
+              "Concurrent intern returns the same canonical String");
+
+    for (uint32_t j = 0; j < NUM_INTERN_THREADS; j++) {
+        for (uint32_t i = 0; i < NUM_INTERNED; i++) {
+            DECREF(args[j].results[i]);
+        }
+    }
+    FREEMEM(args);
+}
+
+static void
+test_Hash_Sum(TestBatchRunner *runner) {
+    String *string    = Str_newf("a%sb%sc", smiley, smiley);
+    String *wrapper   = SSTR_WRAP_C("a" SMILEY "b" SMILEY "c");
+    String *longer    = Str_newf("xa%sb%sc", smiley, smiley);
+    String *substring = Str_SubString(longer, 1, 5);
+
+    size_t hash_sum = Str_Hash_Sum(string);
+    TEST_UINT_EQ(runner, Str_Hash_Sum(string), hash_sum,
+                 "Hash_Sum is stable across calls");
+    TEST_UINT_EQ(runner, Str_Hash_Sum(wrapper), hash_sum,
+                 "Hash_Sum of stack string matches heap string");
+    TEST_UINT_EQ(runner, Str_Hash_Sum(substring), hash_sum,
+                 "Hash_Sum of substring matches heap string");
+
+    String *copy = (String*)INCREF(wrapper);
+    TEST_UINT_EQ(runner, Str_Hash_Sum(copy), hash_sum,
+                 "Hash_Sum of copied stack string matches heap string");
+
+    DECREF(copy);
+    DECREF(substring);
+    DECREF(longer);
+    DECREF(string);
+}
+
 static void
 test_Starts_Ends_With(TestBatchRunner *runner) {
     String *prefix = S_get_str("pre" SMILEY "fix_");
@@ -1100,9 +1565,10 @@ test_iterator_substring(TestBatchRunner *runner) {
 
 void
 TestStr_Run_IMP(TestString *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 200);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 244);
     test_all_code_points(runner);
     test_utf8_valid(runner);
+    test_utf8_valid_long(runner);
     test_validate_utf8(runner);
     test_is_whitespace(runner);
     test_encode_utf8_char(runner);
@@ -1111,7 +1577,11 @@ TestStr_Run_IMP(TestString *self, TestBatchRunner *runner) {
     test_Clone(runner);
     test_Code_Point_At_and_From(runner);
     test_Contains_and_Find(runner);
+    test_find_random(runner);
+    test_StringSearcher(runner);
     test_SubString(runner);
+    test_random_access(runner);
+    test_inline_storage(runner);
     test_Trim(runner);
     test_To_F64(runner);
     test_To_I64(runner);
@@ -1121,6 +1591,9 @@ TestStr_Run_IMP(TestString *self, TestBatchRunner *runner) {
     test_To_ByteBuf(runner);
     test_Length(runner);
     test_Compare_To(runner);
+    test_Hash_Sum(runner);
+    test_intern(runner);
+    test_intern_threads(runner);
     test_Starts_Ends_With(runner);
     test_Starts_Ends_With_Utf8(runner);
     test_Get_Ptr8(runner);
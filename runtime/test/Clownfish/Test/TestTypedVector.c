@@ -0,0 +1,243 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/TestTypedVector.h"
+
+#include "Clownfish/Err.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/TypedVector.h"
+#include "Clownfish/Vector.h"
+#include "Clownfish/Class.h"
+
+TestTypedVector*
+TestTypedVector_new() {
+    return (TestTypedVector*)Class_Make_Obj(TESTTYPEDVECTOR);
+}
+
+static void
+test_Push_Fetch(TestBatchRunner *runner) {
+    I64Vector *vec = I64Vec_new(0);
+
+    for (int64_t i = 0; i < 100; i++) {
+        I64Vec_Push(vec, i * INT64_C(1000000000000));
+    }
+    TEST_UINT_EQ(runner, I64Vec_Get_Size(vec), 100, "Push");
+    TEST_TRUE(runner, I64Vec_Get_Capacity(vec) >= 100,
+              "Push grows capacity");
+    TEST_TRUE(runner,
+              I64Vec_Fetch(vec, 99) == 99 * INT64_C(1000000000000),
+              "Fetch");
+
+    int64_t *ptr = I64Vec_Get_Ptr(vec);
+    TEST_TRUE(runner, ptr[42] == 42 * INT64_C(1000000000000),
+              "Get_Ptr exposes contiguous storage");
+
+    const int64_t more[3] = { -1, INT64_MIN, INT64_MAX };
+    I64Vec_Push_Array(vec, more, 3);
+    TEST_UINT_EQ(runner, I64Vec_Get_Size(vec), 103, "Push_Array");
+    TEST_TRUE(runner,
+              I64Vec_Fetch(vec, 100) == -1
+              && I64Vec_Fetch(vec, 101) == INT64_MIN
+              && I64Vec_Fetch(vec, 102) == INT64_MAX,
+              "Push_Array copies values");
+
+    I64Vector *other = I64Vec_new(0);
+    I64Vec_Push(other, 7);
+    I64Vec_Push_All(vec, other);
+    TEST_TRUE(runner,
+              I64Vec_Get_Size(vec) == 104 && I64Vec_Fetch(vec, 103) == 7,
+              "Push_All");
+    I64Vec_Push_All(vec, vec);
+    TEST_TRUE(runner,
+              I64Vec_Get_Size(vec) == 208
+              && I64Vec_Fetch(vec, 104) == 0
+              && I64Vec_Fetch(vec, 207) == 7,
+              "Push_All onto self");
+    DECREF(other);
+
+    I64Vec_Clear(vec);
+    TEST_UINT_EQ(runner, I64Vec_Get_Size(vec), 0, "Clear");
+
+    DECREF(vec);
+}
+
+static void
+test_Store_Resize(TestBatchRunner *runner) {
+    U32Vector *vec = U32Vec_new(0);
+
+    U32Vec_Store(vec, 5, 55);
+    TEST_UINT_EQ(runner, U32Vec_Get_Size(vec), 6, "Store grows size");
+    TEST_UINT_EQ(runner, U32Vec_Fetch(vec, 5), 55, "Store");
+    TEST_UINT_EQ(runner, U32Vec_Fetch(vec, 2), 0, "Store fills gap with 0");
+
+    U32Vec_Store(vec, 2, 22);
+    TEST_UINT_EQ(runner, U32Vec_Fetch(vec, 2), 22, "Store replaces value");
+
+    U32Vec_Resize(vec, 2);
+    TEST_UINT_EQ(runner, U32Vec_Get_Size(vec), 2, "Resize to smaller size");
+    U32Vec_Resize(vec, 4);
+    TEST_UINT_EQ(runner, U32Vec_Fetch(vec, 2), 0,
+                 "Resize to larger size zeroes new elements");
+
+    U32Vec_Grow(vec, 1000);
+    TEST_TRUE(runner, U32Vec_Get_Capacity(vec) >= 1000, "Grow");
+    TEST_UINT_EQ(runner, U32Vec_Get_Size(vec), 4, "Grow keeps size");
+
+    DECREF(vec);
+}
+
+static void
+test_Sort(TestBatchRunner *runner) {
+    {
+        I64Vector *vec = I64Vec_new(0);
+        const int64_t values[6] = { 3, INT64_MIN, -7, INT64_MAX, 0, 3 };
+        const int64_t wanted[6] = { INT64_MIN, -7, 0, 3, 3, INT64_MAX };
+        I64Vec_Push_Array(vec, values, 6);
+        I64Vec_Sort(vec);
+        TEST_TRUE(runner,
+                  memcmp(I64Vec_Get_Ptr(vec), wanted, sizeof(wanted)) == 0,
+                  "I64Vector Sort");
+        DECREF(vec);
+    }
+
+    {
+        U32Vector *vec = U32Vec_new(0);
+        const uint32_t values[4] = { UINT32_MAX, 1, 0x80000000, 0 };
+        const uint32_t wanted[4] = { 0, 1, 0x80000000, UINT32_MAX };
+        U32Vec_Push_Array(vec, values, 4);
+        U32Vec_Sort(vec);
+        TEST_TRUE(runner,
+                  memcmp(U32Vec_Get_Ptr(vec), wanted, sizeof(wanted)) == 0,
+                  "U32Vector Sort");
+        DECREF(vec);
+    }
+
+    {
+        F64Vector *vec = F64Vec_new(0);
+        F64Vec_Push(vec, 2.5);
+        F64Vec_Push(vec, NAN);
+        F64Vec_Push(vec, -INFINITY);
+        F64Vec_Push(vec, -1.0);
+        F64Vec_Push(vec, NAN);
+        F64Vec_Push(vec, 0.0);
+        F64Vec_Sort(vec);
+        double *elems = F64Vec_Get_Ptr(vec);
+        TEST_TRUE(runner,
+                  elems[0] == -INFINITY && elems[1] == -1.0
+                  && elems[2] == 0.0 && elems[3] == 2.5,
+                  "F64Vector Sort");
+        TEST_TRUE(runner, isnan(elems[4]) && isnan(elems[5]),
+                  "F64Vector Sort puts NaNs last");
+        DECREF(vec);
+    }
+}
+
+static void
+test_Slice_Clone_Equals(TestBatchRunner *runner) {
+    F64Vector *vec = F64Vec_new(0);
+    for (int i = 0; i < 10; i++) {
+        F64Vec_Push(vec, i * 0.5);
+    }
+
+    F64Vector *slice = F64Vec_Slice(vec, 2, 3);
+    TEST_UINT_EQ(runner, F64Vec_Get_Size(slice), 3, "Slice size");
+    TEST_TRUE(runner,
+              F64Vec_Fetch(slice, 0) == 1.0 && F64Vec_Fetch(slice, 2) == 2.0,
+              "Slice values");
+    DECREF(slice);
+
+    slice = F64Vec_Slice(vec, 8, 10);
+    TEST_UINT_EQ(runner, F64Vec_Get_Size(slice), 2,
+                 "Slice length is truncated");
+    DECREF(slice);
+
+    F64Vector *clone = F64Vec_Clone(vec);
+    TEST_TRUE(runner, F64Vec_Equals(vec, (Obj*)clone), "Clone Equals");
+    F64Vec_Store(clone, 9, -1.0);
+    TEST_FALSE(runner, F64Vec_Equals(vec, (Obj*)clone),
+               "Equals detects different values");
+    F64Vec_Resize(clone, 9);
+    TEST_FALSE(runner, F64Vec_Equals(vec, (Obj*)clone),
+               "Equals detects different sizes");
+    DECREF(clone);
+
+    I64Vector *ints = I64Vec_new(0);
+    TEST_FALSE(runner, F64Vec_Equals(vec, (Obj*)ints),
+               "Equals with different class");
+    DECREF(ints);
+
+    DECREF(vec);
+}
+
+static void
+S_fetch_out_of_bounds(void *context) {
+    I64Vec_Fetch((I64Vector*)context, 3);
+}
+
+static void
+S_store_at_size_max(void *context) {
+    U32Vec_Store((U32Vector*)context, SIZE_MAX, 1);
+}
+
+static void
+S_push_array_overflow(void *context) {
+    int64_t value = 0;
+    I64Vec_Push((I64Vector*)context, 1);
+    I64Vec_Push_Array((I64Vector*)context, &value, SIZE_MAX);
+}
+
+static void
+S_test_exception(TestBatchRunner *runner, Err_Attempt_t func, void *context,
+                 const char *test_name) {
+    Err *error = Err_trap(func, context);
+    TEST_TRUE(runner, error != NULL, test_name);
+    DECREF(error);
+}
+
+static void
+test_exceptions(TestBatchRunner *runner) {
+    I64Vector *ints = I64Vec_new(0);
+    I64Vec_Resize(ints, 3);
+    S_test_exception(runner, S_fetch_out_of_bounds, ints,
+                     "Fetch throws when out of bounds");
+    S_test_exception(runner, S_push_array_overflow, ints,
+                     "Push_Array throws on overflow");
+    DECREF(ints);
+
+    U32Vector *u32s = U32Vec_new(0);
+    S_test_exception(runner, S_store_at_size_max, u32s,
+                     "Store throws on overflow");
+    DECREF(u32s);
+}
+
+void
+TestTypedVector_Run_IMP(TestTypedVector *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 31);
+    test_Push_Fetch(runner);
+    test_Store_Resize(runner);
+    test_Sort(runner);
+    test_Slice_Clone_Equals(runner);
+    test_exceptions(runner);
+}
+
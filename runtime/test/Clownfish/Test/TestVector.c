@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <math.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -520,13 +521,85 @@ test_Sort(TestBatchRunner *runner) {
     Vec_Push(wanted, NULL);
     Vec_Push(wanted, NULL);
 
+    Vector *unstable = Vec_Clone(array);
+
     Vec_Sort(array);
     TEST_TRUE(runner, Vec_Equals(array, (Obj*)wanted), "Sort with NULLs");
 
+    Vec_Sort_Unstable(unstable);
+    TEST_TRUE(runner, Vec_Equals(unstable, (Obj*)wanted),
+              "Sort_Unstable with NULLs");
+
+    DECREF(unstable);
     DECREF(array);
     DECREF(wanted);
 }
 
+static void
+test_Sort_Parallel(TestBatchRunner *runner) {
+    Vector *array = Vec_new(100000);
+    for (int i = 0; i < 100000; i++) {
+        uint64_t num = TestUtils_random_u64();
+        if (num % 100 == 0) {
+            Vec_Push(array, NULL);
+        }
+        else if (num % 2) {
+            Vec_Push(array, (Obj*)Int_new((int64_t)(num >> 40)));
+        }
+        else {
+            Vec_Push(array, (Obj*)Float_new((double)(num >> 40) + 0.5));
+        }
+    }
+    Vector *wanted = Vec_Clone(array);
+    Vec_Sort(wanted);
+
+    Vec_Sort_Parallel(array, 4);
+    TEST_TRUE(runner, Vec_Equals(array, (Obj*)wanted),
+              "Sort_Parallel with Integers, Floats and NULLs");
+
+    DECREF(wanted);
+    DECREF(array);
+}
+
+static void
+test_Sort_Parallel_NaN(TestBatchRunner *runner) {
+    // NaN compares equal to everything, so the comparator isn't a strict
+    // weak order.  The sort order is unspecified, but no elements may be
+    // lost or duplicated.
+    size_t  num_elems = 200000;
+    size_t  num_nans  = 0;
+    double  sum       = 0.0;
+    Vector *array     = Vec_new(num_elems);
+    for (size_t i = 0; i < num_elems; i++) {
+        uint64_t num = TestUtils_random_u64();
+        if (num % 10 == 0) {
+            Vec_Push(array, (Obj*)Float_new(NAN));
+            num_nans++;
+        }
+        else {
+            double value = (double)(num >> 44);
+            Vec_Push(array, (Obj*)Float_new(value));
+            sum += value;
+        }
+    }
+
+    Vec_Sort_Parallel(array, 4);
+
+    size_t got_nans = 0;
+    double got_sum  = 0.0;
+    for (size_t i = 0; i < Vec_Get_Size(array); i++) {
+        double value = Float_Get_Value((Float*)Vec_Fetch(array, i));
+        if (isnan(value)) { got_nans++; }
+        else              { got_sum += value; }
+    }
+    TEST_TRUE(runner, Vec_Get_Size(array) == num_elems
+                      && got_nans == num_nans
+                      && got_sum == sum,
+              "Sort_Parallel with NaNs keeps all elements");
+
+    DECREF(array);
+}
+
 static void
 test_Grow(TestBatchRunner *runner) {
     Vector *array = Vec_new(500);
@@ -553,7 +626,7 @@ test_Grow(TestBatchRunner *runner) {
 
 void
 TestVector_Run_IMP(TestVector *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 62);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 65);
     test_Equals(runner);
     test_Store_Fetch(runner);
     test_Push_Pop_Insert(runner);
@@ -566,6 +639,8 @@ TestVector_Run_IMP(TestVector *self, TestBatchRunner *runner) {
     test_Clone(runner);
     test_exceptions(runner);
     test_Sort(runner);
+    test_Sort_Parallel(runner);
+    test_Sort_Parallel_NaN(runner);
     test_Grow(runner);
 }
 
@@ -0,0 +1,185 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/Util/TestAllocStats.h"
+
+#include "Clownfish/Class.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/Num.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Util/AllocStats.h"
+#include "Clownfish/Vector.h"
+
+#define NUM_VECTORS 100
+
+TestAllocStats*
+TestAllocStats_new() {
+    return (TestAllocStats*)Class_Make_Obj(TESTALLOCSTATS);
+}
+
+static int64_t
+S_stat(Hash *snapshot, const char *class_name, const char *key) {
+    Hash *entry = (Hash*)Hash_Fetch_Utf8(snapshot, class_name,
+                                         strlen(class_name));
+    if (!entry) { return 0; }
+    Integer *value = (Integer*)Hash_Fetch_Utf8(entry, key, strlen(key));
+    return value ? Int_Get_Value(value) : 0;
+}
+
+static int64_t
+S_diff(Hash *before, Hash *after, const char *key) {
+    return S_stat(after, "Clownfish::Vector", key)
+           - S_stat(before, "Clownfish::Vector", key);
+}
+
+static void
+S_make_vectors(void *arg) {
+    Vector **vectors = (Vector**)arg;
+    for (uint32_t i = 0; i < NUM_VECTORS; i++) {
+        vectors[i] = Vec_new(10);
+    }
+    for (uint32_t i = 0; i < NUM_VECTORS / 2; i++) {
+        DECREF(vectors[i]);
+    }
+}
+
+static void
+test_counts(TestBatchRunner *runner) {
+    Vector *vectors[NUM_VECTORS];
+
+    Hash *before = AllocStats_snapshot();
+    S_make_vectors(vectors);
+    Hash *after = AllocStats_snapshot();
+
+    TEST_INT_EQ(runner, S_diff(before, after, "allocs"), NUM_VECTORS,
+                "allocs");
+    TEST_INT_EQ(runner, S_diff(before, after, "frees"), NUM_VECTORS / 2,
+                "frees");
+    TEST_INT_EQ(runner, S_diff(before, after, "live_objects"),
+                NUM_VECTORS / 2, "live_objects");
+    TEST_INT_EQ(runner, S_diff(before, after, "buffer_allocs"), NUM_VECTORS,
+                "buffer_allocs");
+    TEST_INT_EQ(runner, S_diff(before, after, "buffer_frees"),
+                NUM_VECTORS / 2, "buffer_frees");
+    TEST_TRUE(runner,
+              S_diff(before, after, "live_bytes")
+              >= (int64_t)(NUM_VECTORS / 2 * 10 * sizeof(Obj*)),
+              "live_bytes includes buffers");
+    DECREF(after);
+
+    for (uint32_t i = NUM_VECTORS / 2; i < NUM_VECTORS; i++) {
+        DECREF(vectors[i]);
+    }
+    after = AllocStats_snapshot();
+    TEST_INT_EQ(runner, S_diff(before, after, "live_objects"), 0,
+                "live_objects after free");
+    TEST_INT_EQ(runner, S_diff(before, after, "live_bytes"), 0,
+                "live_bytes after free");
+
+    DECREF(after);
+    DECREF(before);
+}
+
+static void
+test_grow(TestBatchRunner *runner) {
+    Hash *before = AllocStats_snapshot();
+    Vector *vec = Vec_new(1);
+    for (uint32_t i = 0; i < 1000; i++) {
+        Vec_Push(vec, NULL);
+    }
+    Hash *grown = AllocStats_snapshot();
+    DECREF(vec);
+    Hash *after = AllocStats_snapshot();
+
+    TEST_TRUE(runner,
+              S_diff(before, grown, "live_bytes")
+              >= (int64_t)(1000 * sizeof(Obj*)),
+              "Resized buffers are tracked");
+    TEST_INT_EQ(runner, S_diff(before, after, "live_bytes"), 0,
+                "Resized buffers are released");
+
+    DECREF(after);
+    DECREF(grown);
+    DECREF(before);
+}
+
+static void
+test_disabled(TestBatchRunner *runner) {
+    Vector *vectors[NUM_VECTORS];
+
+    AllocStats_disable();
+    Hash *before = AllocStats_snapshot();
+    S_make_vectors(vectors);
+    for (uint32_t i = NUM_VECTORS / 2; i < NUM_VECTORS; i++) {
+        DECREF(vectors[i]);
+    }
+    Hash *after = AllocStats_snapshot();
+    AllocStats_enable();
+
+    TEST_INT_EQ(runner, S_diff(before, after, "allocs"), 0,
+                "Nothing is counted while disabled");
+
+    DECREF(after);
+    DECREF(before);
+}
+
+static void
+test_threads(TestBatchRunner *runner) {
+    if (!TestUtils_has_threads) {
+        SKIP(runner, 2, "No thread support");
+        return;
+    }
+
+    Vector *vectors[NUM_VECTORS];
+
+    Hash *before = AllocStats_snapshot();
+    Thread *thread = TestUtils_thread_create(S_make_vectors, vectors, NULL);
+    TestUtils_thread_join(thread);
+    Hash *after = AllocStats_snapshot();
+
+    TEST_INT_EQ(runner, S_diff(before, after, "allocs"), NUM_VECTORS,
+                "Counts of exited threads are kept");
+
+    for (uint32_t i = NUM_VECTORS / 2; i < NUM_VECTORS; i++) {
+        DECREF(vectors[i]);
+    }
+    DECREF(after);
+    after = AllocStats_snapshot();
+    TEST_INT_EQ(runner, S_diff(before, after, "live_objects"), 0,
+                "Objects freed by other threads are subtracted");
+
+    DECREF(after);
+    DECREF(before);
+}
+
+void
+TestAllocStats_Run_IMP(TestAllocStats *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 13);
+    bool was_enabled = AllocStats_enabled;
+    AllocStats_enable();
+    test_counts(runner);
+    test_grow(runner);
+    test_disabled(runner);
+    test_threads(runner);
+    if (!was_enabled) { AllocStats_disable(); }
+}
+
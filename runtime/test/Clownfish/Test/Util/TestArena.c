@@ -0,0 +1,303 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/Util/TestArena.h"
+
+#include "Clownfish/CharBuf.h"
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Hash.h"
+#include "Clownfish/String.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/Util/Arena.h"
+#include "Clownfish/Util/Memory.h"
+#include "Clownfish/Vector.h"
+
+TestArena*
+TestArena_new() {
+    return (TestArena*)Class_Make_Obj(TESTARENA);
+}
+
+// Hosts other than C don't allocate objects from arenas.
+static bool
+S_host_uses_arenas(void) {
+    Arena *arena = Arena_new(0);
+    Arena_Enter(arena);
+    Obj *obj = (Obj*)Vec_new(0);
+    bool retval = Arena_owns(obj);
+    Arena_Leave(arena);
+    if (!retval) { DECREF(obj); }
+    DECREF(arena);
+    return retval;
+}
+
+static void
+test_scope(TestBatchRunner *runner) {
+    Arena *outer = Arena_new(0);
+    Arena *inner = Arena_new(0);
+
+    TEST_TRUE(runner, Arena_current() == NULL, "No current arena");
+    Arena_Enter(outer);
+    TEST_TRUE(runner, Arena_current() == outer, "Enter");
+    Arena_Enter(inner);
+    TEST_TRUE(runner, Arena_current() == inner, "Enter nested");
+    Arena_Leave(inner);
+    TEST_TRUE(runner, Arena_current() == outer, "Leave nested");
+    Arena_Leave(outer);
+    TEST_TRUE(runner, Arena_current() == NULL, "Leave");
+
+    char *mem = (char*)Arena_Alloc(outer, 100);
+    TEST_TRUE(runner, Arena_owns(mem) && Arena_owns(mem + 99), "Alloc");
+    TEST_FALSE(runner, Arena_owns(outer), "Arena itself isn't in arena");
+
+    DECREF(inner);
+    DECREF(outer);
+}
+
+static void
+test_objects(TestBatchRunner *runner) {
+    Arena *arena = Arena_new(256);
+    Arena_Enter(arena);
+
+    Vector  *vec  = Vec_new(0);
+    Hash    *hash = Hash_new(0);
+    CharBuf *buf  = CB_new(0);
+    for (uint32_t i = 0; i < 1000; i++) {
+        String *str = Str_newf("%u32", i);
+        Vec_Push(vec, (Obj*)str);
+        Hash_Store(hash, str, INCREF(str));
+        CB_Cat(buf, str);
+    }
+    String *joined = CB_To_String(buf);
+
+    char *heap_buf = (char*)MALLOCATE(4);
+    memcpy(heap_buf, "abc", 4);
+    String *stolen = Str_new_steal_utf8(heap_buf, 3);
+
+    Arena_Leave(arena);
+
+    TEST_TRUE(runner, Arena_owns(vec) && Arena_owns(hash) && Arena_owns(buf),
+              "Objects are allocated from the arena");
+    TEST_TRUE(runner, Arena_owns(Str_Get_Ptr8(joined)),
+              "Buffers are allocated from the arena");
+    TEST_TRUE(runner, Arena_owns(Str_Get_Ptr8(stolen))
+                      && Str_Equals_Utf8(stolen, "abc", 3),
+              "Stolen heap buffers are copied into the arena");
+    TEST_UINT_EQ(runner, Vec_Get_Size(vec), 1000, "Vector grew");
+    TEST_UINT_EQ(runner, Hash_Get_Size(hash), 1000, "Hash grew");
+
+    bool correct = true;
+    for (uint32_t i = 0; i < 1000; i++) {
+        String *str = Str_newf("%u32", i);
+        Obj *elem = Vec_Fetch(vec, i);
+        if (!Str_Equals(str, elem) || !Hash_Fetch(hash, str)) {
+            correct = false;
+        }
+        DECREF(str);
+    }
+    TEST_TRUE(runner, correct, "Contents are intact");
+    TEST_TRUE(runner, Str_Starts_With_Utf8(joined, "0123456789101112", 16),
+              "CharBuf grew");
+
+    String *copy = CB_Yield_String(buf);
+    TEST_FALSE(runner, Arena_owns(copy) || Arena_owns(Str_Get_Ptr8(copy)),
+               "String made outside of scope doesn't steal arena buffer");
+    TEST_TRUE(runner, Arena_owns_obj((Obj*)vec) && !Arena_owns_obj((Obj*)copy),
+              "owns_obj");
+    DECREF(copy);
+
+    DECREF(stolen);
+    DECREF(joined);
+    DECREF(buf);
+    DECREF(hash);
+    DECREF(vec);
+    TEST_TRUE(runner, Arena_Get_Num_Objects(arena) > 2000, "Get_Num_Objects");
+    TEST_UINT_EQ(runner, Arena_Release(arena), 0, "Nothing escaped");
+    TEST_UINT_EQ(runner, Arena_Get_Num_Objects(arena), 0,
+                 "No objects after Release");
+
+    DECREF(arena);
+}
+
+static void
+test_external_refs(TestBatchRunner *runner) {
+    Arena  *arena = Arena_new(0);
+    String *heap  = Str_newf("heap");
+    Vector *outer = Vec_new(0);
+
+    Arena_Enter(arena);
+    Vector *vec = Vec_new(0);
+    Vec_Push(vec, INCREF(heap));
+    String *str = Str_newf("escapee");
+    Vec_Push(outer, INCREF(str));
+    DECREF(str);
+    DECREF(vec);
+    Arena_Leave(arena);
+
+    TEST_UINT_EQ(runner, REFCOUNT_NN(heap), 2, "Arena object holds heap ref");
+    TEST_UINT_EQ(runner, Arena_Release(arena), 1, "Escaped object detected");
+    TEST_UINT_EQ(runner, REFCOUNT_NN(heap), 1,
+                 "Heap refs are released with arena");
+
+    DECREF(outer);
+    DECREF(heap);
+    DECREF(arena);
+}
+
+static void
+test_suspend(TestBatchRunner *runner) {
+    Arena *arena = Arena_new(0);
+
+    Arena_Enter(arena);
+    Arena *left = Arena_suspend();
+    String *heap = Str_newf("heap");
+    Arena_resume(left);
+    String *interned = Str_intern_utf8("arena_test_interned", 19);
+    Arena_Leave(arena);
+
+    TEST_TRUE(runner, left == arena, "suspend returns current arena");
+    TEST_FALSE(runner, Arena_owns_obj((Obj*)heap),
+               "Objects made while suspended come from the heap");
+    TEST_FALSE(runner, Arena_owns_obj((Obj*)interned),
+               "Interned Strings come from the heap");
+    TEST_UINT_EQ(runner, Arena_Release(arena), 0, "Nothing escaped");
+    TEST_TRUE(runner, Arena_suspend() == NULL,
+              "suspend without current arena");
+
+    DECREF(interned);
+    DECREF(heap);
+    DECREF(arena);
+}
+
+static void
+S_cache_invalid_template(void *context) {
+    static FormatTemplate *cached;
+    UNUSED_VAR(context);
+    FmtTmpl_cached(&cached, "invalid %i65");
+}
+
+static void
+test_suspend_throw(TestBatchRunner *runner) {
+    Arena *arena = Arena_new(0);
+
+    Arena_Enter(arena);
+    Err *error = Err_trap(S_cache_invalid_template, NULL);
+    Arena *current = Arena_current();
+    Arena_Leave(arena);
+
+    TEST_TRUE(runner, error != NULL, "Invalid cached template throws");
+    TEST_TRUE(runner, current == arena,
+              "Arena stays entered after invalid cached template");
+
+    DECREF(error);
+    Arena_Release(arena);
+    DECREF(arena);
+}
+
+static void
+test_escaped_container(TestBatchRunner *runner) {
+    Arena  *arena = Arena_new(0);
+    String *heap  = Str_newf("heap");
+    Vector *outer = Vec_new(0);
+
+    Arena_Enter(arena);
+    Vector *vec = Vec_new(0);
+    Hash   *hash = Hash_new(0);
+    Hash_Store_Utf8(hash, "key", 3, (Obj*)Str_newf("value"));
+    Vec_Push(vec, (Obj*)Str_newf("elem"));
+    Vec_Push(vec, (Obj*)hash);
+    Vec_Push(vec, INCREF(heap));
+    Vec_Push(outer, INCREF(vec));
+    DECREF(vec);
+    String *dropped = Str_newf("dropped");
+    DECREF(dropped);
+    Arena_Leave(arena);
+
+    TEST_UINT_EQ(runner, Arena_Release(arena), 1,
+                 "Objects reachable from escaped object aren't counted");
+    TEST_INT_EQ(runner, Vec_Get_Size(vec), 3, "Escaped Vector is intact");
+    TEST_TRUE(runner, Str_Equals_Utf8((String*)Vec_Fetch(vec, 0), "elem", 4),
+              "Element of escaped Vector is intact");
+    Hash *inner = (Hash*)Vec_Fetch(vec, 1);
+    String *value = (String*)Hash_Fetch_Utf8(inner, "key", 3);
+    TEST_TRUE(runner, value && Str_Equals_Utf8(value, "value", 5),
+              "Nested container of escaped Vector is intact");
+    TEST_UINT_EQ(runner, REFCOUNT_NN(heap), 2,
+                 "Escaped Vector keeps its heap ref");
+
+    DECREF(outer);
+    DECREF(heap);
+    DECREF(arena);
+}
+
+static void
+test_constructor_ref(TestBatchRunner *runner) {
+    Arena  *arena = Arena_new(0);
+    Vector *outer = Vec_new(0);
+
+    // Hand the reference returned by the constructor to a heap container
+    // without INCREF.
+    Arena_Enter(arena);
+    Vec_Push(outer, (Obj*)Str_newf("escapee"));
+    Arena_Leave(arena);
+
+    TEST_UINT_EQ(runner, Arena_Release(arena), 1,
+                 "Constructor ref stored outside the arena is detected");
+
+    // Memory of the escaped object must not be reused.
+    Arena_Enter(arena);
+    String *other = Str_newf("clobbered!");
+    DECREF(other);
+    Arena_Leave(arena);
+    TEST_TRUE(runner,
+              Str_Equals_Utf8((String*)Vec_Fetch(outer, 0), "escapee", 7),
+              "Escaped object stays intact");
+    TEST_UINT_EQ(runner, Arena_Release(arena), 0, "Nothing else escaped");
+
+    // A reference which is never released keeps the object as well.
+    Arena_Enter(arena);
+    String *leaked = Str_newf("leaked");
+    UNUSED_VAR(leaked);
+    Arena_Leave(arena);
+    TEST_UINT_EQ(runner, Arena_Release(arena), 1,
+                 "Unreleased constructor ref counts as escaped");
+
+    DECREF(outer);
+    DECREF(arena);
+}
+
+void
+TestArena_Run_IMP(TestArena *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 38);
+    test_scope(runner);
+    if (!S_host_uses_arenas()) {
+        SKIP(runner, 31, "Host doesn't allocate objects from arenas");
+        return;
+    }
+    test_objects(runner);
+    test_external_refs(runner);
+    test_suspend(runner);
+    test_suspend_throw(runner);
+    test_escaped_container(runner);
+    test_constructor_ref(runner);
+}
+
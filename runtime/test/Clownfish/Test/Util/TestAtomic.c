@@ -56,10 +56,39 @@ test_cas_ptr(TestBatchRunner *runner) {
     TEST_TRUE(runner, target == bar_pointer, "cas_ptr sets target");
 }
 
+static void
+test_cas_size(TestBatchRunner *runner) {
+    size_t target = 1;
+
+    TEST_TRUE(runner, Atomic_cas_size(&target, 1, 2),
+              "cas_size returns true on success");
+    TEST_UINT_EQ(runner, target, 2, "cas_size sets target");
+
+    TEST_FALSE(runner, Atomic_cas_size(&target, 1, 3),
+               "cas_size returns false when old_value doesn't match");
+    TEST_UINT_EQ(runner, target, 2,
+                 "cas_size doesn't do anything to target when old_value"
+                 " doesn't match");
+}
+
+static void
+test_inc_dec_size(TestBatchRunner *runner) {
+    size_t target = 1;
+
+    TEST_UINT_EQ(runner, Atomic_inc_size(&target), 2,
+                 "inc_size returns new value");
+    TEST_UINT_EQ(runner, target, 2, "inc_size sets target");
+    TEST_UINT_EQ(runner, Atomic_dec_size(&target), 1,
+                 "dec_size returns new value");
+    TEST_UINT_EQ(runner, Atomic_dec_size(&target), 0, "dec_size to zero");
+}
+
 void
 TestAtomic_Run_IMP(TestAtomic *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 6);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 14);
     test_cas_ptr(runner);
+    test_cas_size(runner);
+    test_inc_dec_size(runner);
 }
 
 
@@ -19,6 +19,8 @@
 
 #include "charmony.h"
 
+#include <string.h>
+
 #include "Clownfish/Test/Util/TestMemory.h"
 
 #include "Clownfish/Test.h"
@@ -107,12 +109,136 @@ test_oversize__rounding(TestBatchRunner *runner) {
     PASS(runner, "Round allocations up to the size of a pointer");
 }
 
+typedef struct {
+    const Allocator *backend;
+    int              mallocs;
+    int              callocs;
+    int              reallocs;
+    int              frees;
+    int              sized_frees;
+    size_t           freed_size;
+    int              failures;
+} CountingContext;
+
+static void*
+S_counting_malloc(void *context, size_t size) {
+    CountingContext *counts = (CountingContext*)context;
+    if (counts->failures > 0) {
+        counts->failures--;
+        return NULL;
+    }
+    counts->mallocs++;
+    return counts->backend->mallocate(counts->backend->context, size);
+}
+
+static void*
+S_counting_calloc(void *context, size_t count, size_t size) {
+    CountingContext *counts = (CountingContext*)context;
+    counts->callocs++;
+    return counts->backend->callocate(counts->backend->context, count, size);
+}
+
+static void*
+S_counting_realloc(void *context, void *ptr, size_t size) {
+    CountingContext *counts = (CountingContext*)context;
+    counts->reallocs++;
+    return counts->backend->reallocate(counts->backend->context, ptr, size);
+}
+
+static void
+S_counting_free(void *context, void *ptr) {
+    CountingContext *counts = (CountingContext*)context;
+    counts->frees++;
+    counts->backend->freemem(counts->backend->context, ptr);
+}
+
+static void
+S_counting_sized_free(void *context, void *ptr, size_t size) {
+    CountingContext *counts = (CountingContext*)context;
+    counts->sized_frees++;
+    counts->freed_size = size;
+    counts->backend->freemem(counts->backend->context, ptr);
+}
+
+static int oom_calls = 0;
+
+static bool
+S_oom_handler(size_t size) {
+    UNUSED_VAR(size);
+    oom_calls++;
+    return true;
+}
+
+static void
+test_allocator(TestBatchRunner *runner) {
+    Allocator        previous = *Memory_get_allocator();
+    CountingContext  counts;
+    Allocator        counting = {
+        S_counting_malloc,
+        S_counting_calloc,
+        S_counting_realloc,
+        S_counting_free,
+        S_counting_sized_free,
+        NULL,
+        NULL,
+        &counts
+    };
+
+    memset(&counts, 0, sizeof(counts));
+    counts.backend = &previous;
+    Memory_set_allocator(&counting);
+
+    char *ptr = (char*)MALLOCATE(10);
+    ptr = (char*)REALLOCATE(ptr, 20);
+    FREEMEM(ptr);
+    ptr = (char*)CALLOCATE(5, 4);
+    Memory_sized_free(ptr, 20);
+
+    void *aligned = Memory_aligned_malloc(64, 100);
+    bool is_aligned = ((uintptr_t)aligned & 63) == 0;
+    memset(aligned, 0, 100);
+    Memory_aligned_free(aligned, 64);
+
+    counts.failures = 2;
+    Memory_OOM_Handler_t prev_handler = Memory_set_oom_handler(S_oom_handler);
+    ptr = (char*)MALLOCATE(10);
+    Memory_set_oom_handler(prev_handler);
+    FREEMEM(ptr);
+
+    Memory_set_allocator(&previous);
+
+    TEST_INT_EQ(runner, counts.mallocs, 3, "mallocate called");
+    TEST_INT_EQ(runner, counts.callocs, 1, "callocate called");
+    TEST_INT_EQ(runner, counts.reallocs, 1, "reallocate called");
+    TEST_INT_EQ(runner, counts.frees, 3, "freemem called");
+    TEST_INT_EQ(runner, counts.sized_frees, 1, "sized_freemem called");
+    TEST_UINT_EQ(runner, counts.freed_size, 20, "sized_freemem gets size");
+    TEST_TRUE(runner, is_aligned, "aligned_malloc without backend support");
+    TEST_INT_EQ(runner, oom_calls, 2, "OOM handler called until success");
+    TEST_TRUE(runner, Memory_get_allocator()->mallocate == previous.mallocate,
+              "Restore allocator");
+}
+
+static void
+test_aligned_malloc(TestBatchRunner *runner) {
+    bool success = true;
+    for (size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+        char *ptr = (char*)Memory_aligned_malloc(alignment, 33);
+        if ((uintptr_t)ptr % alignment != 0) { success = false; }
+        memset(ptr, 'x', 33);
+        Memory_aligned_free(ptr, alignment);
+    }
+    TEST_TRUE(runner, success, "aligned_malloc");
+}
+
 void
 TestMemory_Run_IMP(TestMemory *self, TestBatchRunner *runner) {
-    TestBatchRunner_Plan(runner, (TestBatch*)self, 30);
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 40);
     test_oversize__growth_rate(runner);
     test_oversize__ceiling(runner);
     test_oversize__rounding(runner);
+    test_allocator(runner);
+    test_aligned_malloc(runner);
 }
 
 
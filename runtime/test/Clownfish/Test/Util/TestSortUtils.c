@@ -0,0 +1,283 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#define CFISH_USE_SHORT_NAMES
+#define TESTCFISH_USE_SHORT_NAMES
+
+#include "Clownfish/Test/Util/TestSortUtils.h"
+
+#include "Clownfish/Class.h"
+#include "Clownfish/Err.h"
+#include "Clownfish/Test.h"
+#include "Clownfish/TestHarness/TestBatchRunner.h"
+#include "Clownfish/TestHarness/TestUtils.h"
+#include "Clownfish/Util/Memory.h"
+#include "Clownfish/Util/SortUtils.h"
+
+TestSortUtils*
+TestSortUtils_new() {
+    return (TestSortUtils*)Class_Make_Obj(TESTSORTUTILS);
+}
+
+/* Elements consist of a key in the first 4 or 8 bytes.  Elements which are
+ * wider than 8 bytes store their original position after a 4-byte key,
+ * which allows to check for stability.
+ */
+
+typedef enum {
+    PATTERN_RANDOM,
+    PATTERN_SORTED,
+    PATTERN_REVERSED,
+    PATTERN_FEW_UNIQUE,
+    PATTERN_ORGAN_PIPE,
+    PATTERN_SAWTOOTH,
+    NUM_PATTERNS
+} Pattern;
+
+static const char *pattern_names[NUM_PATTERNS] = {
+    "random", "sorted", "reversed", "few unique", "organ pipe", "sawtooth"
+};
+
+static const size_t sizes[] = {
+    0, 1, 2, 3, 10, 23, 24, 25, 63, 64, 65, 100, 127, 128, 129, 1000, 10000
+};
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+#define MAX_SIZE 10000
+
+static uint64_t
+S_key(const uint8_t *elem, size_t width) {
+    if (width == 8) {
+        uint64_t key;
+        memcpy(&key, elem, 8);
+        return key;
+    }
+    else {
+        uint32_t key;
+        memcpy(&key, elem, 4);
+        return key;
+    }
+}
+
+static uint32_t
+S_seq(const uint8_t *elem) {
+    uint32_t seq;
+    memcpy(&seq, elem + 4, 4);
+    return seq;
+}
+
+static int
+S_compare(void *context, const void *va, const void *vb) {
+    size_t   width = *(size_t*)context;
+    uint64_t a     = S_key((const uint8_t*)va, width);
+    uint64_t b     = S_key((const uint8_t*)vb, width);
+    return (a > b) - (a < b);
+}
+
+static void
+S_fill(uint8_t *elems, size_t num_elems, size_t width, Pattern pattern) {
+    memset(elems, 0, num_elems * width);
+    for (size_t i = 0; i < num_elems; i++) {
+        uint64_t key;
+        switch (pattern) {
+            case PATTERN_RANDOM:     key = TestUtils_random_u64(); break;
+            case PATTERN_SORTED:     key = i; break;
+            case PATTERN_REVERSED:   key = num_elems - i; break;
+            case PATTERN_FEW_UNIQUE: key = TestUtils_random_u64() % 4; break;
+            case PATTERN_ORGAN_PIPE:
+                key = i < num_elems / 2 ? i : num_elems - i;
+                break;
+            case PATTERN_SAWTOOTH:   key = i % 50; break;
+            default:                 key = 0; break;
+        }
+        uint8_t *elem = elems + i * width;
+        if (width == 8) {
+            memcpy(elem, &key, 8);
+        }
+        else {
+            uint32_t key32 = (uint32_t)key;
+            memcpy(elem, &key32, 4);
+            if (width >= 8) {
+                uint32_t seq = (uint32_t)i;
+                memcpy(elem + 4, &seq, 4);
+            }
+        }
+    }
+}
+
+// Return the sum of all keys, used to check that sorting permuted the
+// elements.
+static uint64_t
+S_checksum(const uint8_t *elems, size_t num_elems, size_t width) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < num_elems; i++) {
+        sum += S_key(elems + i * width, width) * 2654435761U;
+    }
+    return sum;
+}
+
+static bool
+S_is_sorted(const uint8_t *elems, size_t num_elems, size_t width,
+            bool check_stable) {
+    for (size_t i = 1; i < num_elems; i++) {
+        const uint8_t *prev = elems + (i - 1) * width;
+        const uint8_t *elem = elems + i * width;
+        uint64_t prev_key = S_key(prev, width);
+        uint64_t key      = S_key(elem, width);
+        if (prev_key > key) { return false; }
+        if (check_stable && prev_key == key && S_seq(prev) > S_seq(elem)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void
+test_sort(TestBatchRunner *runner, size_t width) {
+    uint8_t *elems   = (uint8_t*)MALLOCATE(MAX_SIZE * width);
+    uint8_t *scratch = (uint8_t*)MALLOCATE(MAX_SIZE * width);
+    bool check_stable = width > 8;
+
+    for (int pattern = 0; pattern < NUM_PATTERNS; pattern++) {
+        bool merge_ok = true;
+        bool quick_ok = true;
+
+        for (size_t i = 0; i < NUM_SIZES; i++) {
+            size_t num_elems = sizes[i];
+
+            S_fill(elems, num_elems, width, (Pattern)pattern);
+            uint64_t checksum = S_checksum(elems, num_elems, width);
+            Sort_mergesort(elems, scratch, num_elems, width, S_compare,
+                           &width);
+            if (!S_is_sorted(elems, num_elems, width, check_stable)
+                || S_checksum(elems, num_elems, width) != checksum
+               ) {
+                merge_ok = false;
+            }
+
+            S_fill(elems, num_elems, width, (Pattern)pattern);
+            checksum = S_checksum(elems, num_elems, width);
+            Sort_quicksort(elems, num_elems, width, S_compare, &width);
+            if (!S_is_sorted(elems, num_elems, width, false)
+                || S_checksum(elems, num_elems, width) != checksum
+               ) {
+                quick_ok = false;
+            }
+        }
+
+        TEST_TRUE(runner, merge_ok, "mergesort, width %d, %s%s", (int)width,
+                  pattern_names[pattern], check_stable ? ", stable" : "");
+        TEST_TRUE(runner, quick_ok, "quicksort, width %d, %s", (int)width,
+                  pattern_names[pattern]);
+    }
+
+    FREEMEM(scratch);
+    FREEMEM(elems);
+}
+
+static void
+test_quicksort_wide(TestBatchRunner *runner) {
+    size_t   width     = 80;
+    size_t   num_elems = 1000;
+    uint8_t *elems     = (uint8_t*)MALLOCATE(num_elems * width);
+
+    S_fill(elems, num_elems, width, PATTERN_RANDOM);
+    uint64_t checksum = S_checksum(elems, num_elems, width);
+    Sort_quicksort(elems, num_elems, width, S_compare, &width);
+    TEST_TRUE(runner,
+              S_is_sorted(elems, num_elems, width, false)
+              && S_checksum(elems, num_elems, width) == checksum,
+              "quicksort with elements wider than the pivot buffer");
+
+    FREEMEM(elems);
+}
+
+static void
+test_parallel_mergesort(TestBatchRunner *runner) {
+    static const size_t par_sizes[]   = { 1000, 65536, 200001 };
+    static const uint32_t par_threads[] = { 0, 2, 3, 7 };
+    size_t    max_size = 200001;
+    size_t    width    = 12;
+    uint8_t  *elems    = (uint8_t*)MALLOCATE(max_size * width);
+    uint8_t  *scratch  = (uint8_t*)MALLOCATE(max_size * width);
+
+    static const Pattern par_patterns[] = {
+        PATTERN_RANDOM, PATTERN_FEW_UNIQUE
+    };
+
+    for (size_t p = 0; p < 2; p++) {
+        Pattern pattern = par_patterns[p];
+        bool    ok      = true;
+        for (size_t i = 0; i < sizeof(par_sizes) / sizeof(size_t); i++) {
+            for (size_t j = 0; j < sizeof(par_threads) / sizeof(uint32_t);
+                 j++
+                ) {
+                size_t num_elems = par_sizes[i];
+                S_fill(elems, num_elems, width, pattern);
+                uint64_t checksum = S_checksum(elems, num_elems, width);
+                Sort_parallel_mergesort(elems, scratch, num_elems, width,
+                                        S_compare, &width, par_threads[j]);
+                if (!S_is_sorted(elems, num_elems, width, true)
+                    || S_checksum(elems, num_elems, width) != checksum
+                   ) {
+                    ok = false;
+                }
+            }
+        }
+        TEST_TRUE(runner, ok, "parallel_mergesort, %s, stable",
+                  pattern_names[pattern]);
+    }
+
+    FREEMEM(scratch);
+    FREEMEM(elems);
+}
+
+static void
+S_mergesort_zero_width(void *context) {
+    uint64_t elems[2]   = { 2, 1 };
+    uint64_t scratch[2];
+    Sort_mergesort(elems, scratch, 2, 0, S_compare, context);
+}
+
+static void
+S_quicksort_zero_width(void *context) {
+    uint64_t elems[2] = { 2, 1 };
+    Sort_quicksort(elems, 2, 0, S_compare, context);
+}
+
+static void
+test_exceptions(TestBatchRunner *runner) {
+    size_t width = 0;
+    Err *error = Err_trap(S_mergesort_zero_width, &width);
+    TEST_TRUE(runner, error != NULL, "mergesort throws on zero width");
+    DECREF(error);
+    error = Err_trap(S_quicksort_zero_width, &width);
+    TEST_TRUE(runner, error != NULL, "quicksort throws on zero width");
+    DECREF(error);
+}
+
+void
+TestSortUtils_Run_IMP(TestSortUtils *self, TestBatchRunner *runner) {
+    TestBatchRunner_Plan(runner, (TestBatch*)self, 41);
+    test_sort(runner, 4);
+    test_sort(runner, 8);
+    test_sort(runner, 12);
+    test_quicksort_wide(runner);
+    test_parallel_mergesort(runner);
+    test_exceptions(runner);
+}
+